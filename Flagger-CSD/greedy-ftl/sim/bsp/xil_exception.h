@@ -0,0 +1,14 @@
+//////////////////////////////////////////////////////////////////////////////////
+// xil_exception.h for the Flagger-CSD simulator
+//
+// Stands in for the Xilinx standalone BSP header of the same name.
+// Interrupts are delivered by the hardware model calling dev_irq_handler().
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XIL_EXCEPTION_H
+#define XIL_EXCEPTION_H
+
+#define Xil_ExceptionEnable()
+#define Xil_ExceptionDisable()
+
+#endif	//XIL_EXCEPTION_H
@@ -0,0 +1,15 @@
+//////////////////////////////////////////////////////////////////////////////////
+// xil_io.h for the Flagger-CSD simulator
+//
+// Stands in for the Xilinx standalone BSP header of the same name.
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XIL_IO_H
+#define XIL_IO_H
+
+#include "sim_io.h"
+
+#define Xil_Out32(addr, val)	sim_io_write32((unsigned long)(addr), (val))
+#define Xil_In32(addr)			sim_io_read32((unsigned long)(addr))
+
+#endif	//XIL_IO_H
@@ -0,0 +1,17 @@
+//////////////////////////////////////////////////////////////////////////////////
+// xil_printf.h for the Flagger-CSD simulator
+//
+// Stands in for the Xilinx standalone BSP header of the same name.
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XIL_PRINTF_H
+#define XIL_PRINTF_H
+
+#include <stdio.h>
+
+#include "xparameters.h"
+#include "xil_io.h"	//the board BSP pulls Xil_In32/Xil_Out32 in through its own headers
+
+#define xil_printf		printf
+
+#endif	//XIL_PRINTF_H
@@ -0,0 +1,15 @@
+//////////////////////////////////////////////////////////////////////////////////
+// xparameters.h for the Flagger-CSD simulator
+//
+// Stands in for the generated Xilinx BSP header of the same name.
+// The NVMe IP base is never mapped, every access to it goes to the hardware model.
+// DDR4 is placed above the 32-bit DRAM space of the board.
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XPARAMETERS_H
+#define XPARAMETERS_H
+
+#define XPAR_NVME_CTRL_0_BASEADDR		0x83C00000
+#define XPAR_MIG_0_BASEADDR				0x1000000000ULL
+
+#endif	//XPARAMETERS_H
@@ -0,0 +1,25 @@
+//////////////////////////////////////////////////////////////////////////////////
+// xtime_l.h for the Flagger-CSD simulator
+//
+// Stands in for the Xilinx standalone BSP header of the same name.
+// The global timer is replaced by CLOCK_MONOTONIC in nanoseconds.
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef XTIME_L_H
+#define XTIME_L_H
+
+#include <time.h>
+
+typedef unsigned long long XTime;
+
+#define COUNTS_PER_SECOND		1000000000ULL
+
+static inline void XTime_GetTime(XTime *xtime)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	*xtime = (XTime)ts.tv_sec * COUNTS_PER_SECOND + ts.tv_nsec;
+}
+
+#endif	//XTIME_L_H
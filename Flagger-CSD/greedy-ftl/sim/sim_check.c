@@ -0,0 +1,855 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_check.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Host Checks
+// File Name: sim_check.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - runs in passes, each pass builds its commands one at a time and checks what comes back
+//   - status pass: aggregations the firmware has to accept or reject, compared by completion status
+//   - FTL pass: writes a pattern over more FTL blocks than the data buffer holds, overwrites it
+//     until garbage collection runs and reads it back
+//   - coalescing pass: thresholds the firmware cannot honour yet have to be rejected
+//   - robust pass: median, trimmed mean and weighted mean of seeded slots, read back and
+//     compared with the host model of csd_model
+//   - transform pass: an INT8 window upload is aggregated and read back quantized, compared
+//     with the quantization of the host model
+//   - cstore pass: a compressed range is written and read back, the sectors the firmware
+//     stored are decoded with the host model of checkpoint loading
+//   - remount runs only the read of the FTL pass, against the flash image the last check run left
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "math.h"
+
+#include "ftl_config.h"
+#include "address_translation.h"
+#include "nvme/nvme.h"
+#include "nvme/nvme_coalesce.h"
+#include "agg_engine.h"
+#include "transform.h"
+#include "compress_store.h"
+
+#include "agg_model.h"
+#include "ckpt_model.h"
+
+#include "sim_check.h"
+
+#define CHECK_BLOCK_BYTES				(BYTES_PER_NVME_BLOCK)
+#define CHECK_WEIGHTS_MAX				4
+
+#define CHECK_FTL_BLOCKS				(DATA_BUF_ENTRIES + DATA_BUF_ENTRIES / 4)	//more than the data buffer holds
+#define CHECK_FTL_CMD_BLOCKS			32
+#define CHECK_FTL_MAX_GENS				8		//overwrites of the pattern by which garbage collection has to have run
+
+#define CHECK_COALESCE_TIME				20		//aggregation time, 2ms
+
+#define CHECK_ROBUST_ACTID				0x1000
+#define CHECK_ROBUST_SLOTS				5
+#define CHECK_ROBUST_STRIDE				4		//blocks between the slots
+#define CHECK_ROBUST_BLOCKS				2		//blocks of a slot
+#define CHECK_ROBUST_ELEMS				(CHECK_ROBUST_BLOCKS * CHECK_BLOCK_BYTES / 4)
+#define CHECK_ROBUST_DST_ACTID			(CHECK_ROBUST_ACTID + CHECK_ROBUST_SLOTS * CHECK_ROBUST_STRIDE)
+#define CHECK_ROBUST_TOLERANCE			1e-6f	//relative, the weighted mean is summed in another order by the model
+#define CHECK_ROBUST_JOBS				3
+
+#define CHECK_XFORM_SHIFT				6		//64 elements per scale
+#define CHECK_XFORM_SLOTS				2
+#define CHECK_XFORM_SLOT_BLOCKS			4
+#define CHECK_XFORM_ELEMS				(CHECK_XFORM_SLOTS * CHECK_XFORM_SLOT_BLOCKS * XFORM_ELEMS_PER_BLOCK)
+#define CHECK_XFORM_SLOT_ELEMS			(CHECK_XFORM_SLOT_BLOCKS * XFORM_ELEMS_PER_BLOCK)
+#define CHECK_XFORM_UPLOAD_ACTID		0x2000	//FP32 slots, the window of descriptor 0 uploads them
+#define CHECK_XFORM_UPLOAD_WINDOW		0x2100
+#define CHECK_XFORM_RESULT_ACTID		0x2200	//median of the slots, quantized on read by descriptor 1
+#define CHECK_XFORM_RESULT_WINDOW		0x2300
+#define CHECK_XFORM_STEPS				5
+
+#define CHECK_CSTORE_FLAGS				(CSTORE_FLAG_ENABLE | CSTORE_FLAG_SHUFFLE4)
+#define CHECK_CSTORE_ACTID				0x3000
+#define CHECK_CSTORE_BLOCKS				64
+#define CHECK_CSTORE_POOL_ACTID			0x3100
+#define CHECK_CSTORE_POOL_BLOCKS		512
+#define CHECK_CSTORE_MAP_BLOCKS			((CHECK_CSTORE_BLOCKS * sizeof(CSTORE_MAP_ENTRY) + CHECK_BLOCK_BYTES - 1) / CHECK_BLOCK_BYTES)
+#define CHECK_CSTORE_BITMAP_BLOCKS		1
+#define CHECK_CSTORE_META_BLOCKS		(CHECK_CSTORE_POOL_BLOCKS - CSTORE_STAGING_BLOCKS)	//map, bitmap and heap
+#define CHECK_CSTORE_HEAP_SECTORS		((CHECK_CSTORE_META_BLOCKS - CHECK_CSTORE_MAP_BLOCKS - CHECK_CSTORE_BITMAP_BLOCKS) * CSTORE_SECTORS_PER_BLOCK)
+#define CHECK_CSTORE_READ_BLOCKS		64		//the pool is read back in commands of this size
+#define CHECK_CSTORE_POOL_READS			(CHECK_CSTORE_META_BLOCKS / CHECK_CSTORE_READ_BLOCKS)
+#define CHECK_CSTORE_STEP_POOL			3
+#define CHECK_CSTORE_STEP_DISABLE		(CHECK_CSTORE_STEP_POOL + CHECK_CSTORE_POOL_READS)
+
+#if (CHECK_CSTORE_META_BLOCKS % CHECK_CSTORE_READ_BLOCKS)
+#error "the cstore check reads the pool in whole commands"
+#endif
+
+#define FTL_PHASE_WRITE					0
+#define FTL_PHASE_READ					1
+
+#if (CHECK_FTL_BLOCKS > USER_PAGES)
+#error "the FTL check needs more FTL pages than the data buffer holds, raise SIM_FLASH_FILE_BLOCKS"
+#endif
+
+typedef struct _SIM_CHECK_STATUS
+{
+	const char *name;
+	unsigned int nsid;
+	unsigned int actid;
+	unsigned int bytes;
+	unsigned int dword14;				//operator, slots and trim
+	unsigned int slotStride;
+	unsigned int dstACTID;
+	float weights[CHECK_WEIGHTS_MAX];	//PRP1 data of a weighted mean
+	unsigned int sc;					//expected status code, generic command status type
+} SIM_CHECK_STATUS;
+
+typedef struct _SIM_CHECK_ROBUST
+{
+	const char *name;
+	unsigned int op;
+	unsigned int trim;
+	unsigned int exact;					//bit for bit, or within CHECK_ROBUST_TOLERANCE
+} SIM_CHECK_ROBUST;
+
+typedef struct _SIM_CHECK_PASS
+{
+	unsigned int (*next)(SIM_CHECK_CMD *cmd);					//returns 0 once the pass is done
+	void (*complete)(SIM_CHECK_CMD *cmd, unsigned int status);
+} SIM_CHECK_PASS;
+
+typedef struct _SIM_CHECK_CONTEXT
+{
+	const SIM_CHECK_PASS *pass;
+	unsigned int numOfPasses;
+	unsigned int passIdx;
+	unsigned int checkCnt;
+	unsigned int failCnt;
+
+	unsigned int statusIdx;
+	unsigned char *statusBuf;
+
+	unsigned int coalesceStep;
+
+	unsigned int ftlPhase;
+	unsigned int ftlGen;				//generation of the pattern, unknown on a remount until the first read
+	unsigned int ftlGenKnown;
+	unsigned int ftlNext;				//next block of the phase, relative to the first FTL block
+	unsigned int ftlGcStart;
+	unsigned int ftlBadCmds;
+	unsigned int ftlBadBlocks;
+	unsigned int *ftlBuf;
+
+	unsigned int robustStep;			//seeding write, then an aggregation and its read per job
+	float *robustSlots;					//slots as written, CHECK_ROBUST_STRIDE blocks apart
+	float *robustDst;
+	float robustWeights[CHECK_BLOCK_BYTES / 4];
+
+	unsigned int xformStep;				//two descriptors, the upload, the median and the read-out
+	float *xformValues;					//slots as the clients hold them
+	unsigned char *xformUpload;			//window of descriptor 0: INT8 values, then the scales
+	unsigned char *xformResult;			//window of descriptor 1 as read back
+
+	unsigned int cstoreStep;			//configuration, write, read, pool read-out, then disable
+	unsigned int cstoreBadCmds;
+	unsigned char *cstoreData;			//range as written
+	unsigned char *cstoreRead;			//range as read back
+	unsigned char *cstorePool;			//map, bitmap and heap of the pool
+} SIM_CHECK_CONTEXT;
+
+static SIM_CHECK_CONTEXT simCheck;
+
+//a rejected job has to reach the host as an error, never as a successful completion
+static const SIM_CHECK_STATUS statusChecks[] =
+{
+	{"dense sum", 1, 0, 2 * CHECK_BLOCK_BYTES, AGG_OP_DENSE_SUM, 0, 0, {0}, SC_SUCCESSFUL_COMPLETION},
+	{"unknown operator", 1, 0, CHECK_BLOCK_BYTES, 0x7F, 0, 0, {0}, SC_INVALID_FIELD_IN_COMMAND},
+	{"no such namespace", 9, 0, CHECK_BLOCK_BYTES, AGG_OP_DENSE_SUM, 0, 0, {0}, SC_INVALID_NAMESPACE_OR_FORMAT},
+	{"median", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_MEDIAN | (2 << 8), 1, 16, {0}, SC_SUCCESSFUL_COMPLETION},
+	{"trim of every slot", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_TRIMMED_MEAN | (2 << 8) | (2 << 16), 1, 16, {0}, SC_INVALID_FIELD_IN_COMMAND},
+	{"overlapping slots", 1, 0, 2 * CHECK_BLOCK_BYTES, AGG_OP_MEDIAN | (2 << 8), 1, 16, {0}, SC_INVALID_FIELD_IN_COMMAND},
+	{"unaligned offset", 1, 0, CHECK_BLOCK_BYTES - 2, AGG_OP_MEDIAN | (2 << 8), 1, 16, {0}, SC_INVALID_FIELD_IN_COMMAND},
+	{"end before start", 1, 0, 0, AGG_OP_DENSE_SUM, 0, 0, {0}, SC_INVALID_FIELD_IN_COMMAND},
+	{"weighted mean", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_WEIGHTED_MEAN | (2 << 8), 1, 16, {3.0f, 1.0f}, SC_SUCCESSFUL_COMPLETION},
+	{"weights all zero", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_WEIGHTED_MEAN | (2 << 8), 1, 16, {0.0f, 0.0f}, SC_INVALID_FIELD_IN_COMMAND},
+	{"negative weight", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_WEIGHTED_MEAN | (2 << 8), 1, 16, {2.0f, -1.0f}, SC_INVALID_FIELD_IN_COMMAND},
+	{"past the hot region", 1, HOT_REGION_PAGES - 1, 2 * CHECK_BLOCK_BYTES, AGG_OP_DENSE_SUM, 0, 0, {0}, SC_LBA_OUT_OF_RANGE},
+	{"last slot past the end", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_MEDIAN | (2 << 8), HOT_REGION_PAGES / 2, 16, {0}, SC_LBA_OUT_OF_RANGE},
+	{"slot stride overflow", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_MEDIAN | (2 << 8), 0x80000000, 16, {0}, SC_LBA_OUT_OF_RANGE},
+	{"output past the end", 1, 0, CHECK_BLOCK_BYTES, AGG_OP_MEDIAN | (2 << 8), 1, HOT_REGION_PAGES, {0}, SC_LBA_OUT_OF_RANGE},
+};
+
+#define NUM_OF_STATUS_CHECKS			(sizeof(statusChecks) / sizeof(statusChecks[0]))
+
+static const SIM_CHECK_ROBUST robustJobs[CHECK_ROBUST_JOBS] =
+{
+	{"median", AGG_OP_MEDIAN, 0, 1},
+	{"trimmed mean", AGG_OP_TRIMMED_MEAN, 1, 1},
+	{"weighted mean", AGG_OP_WEIGHTED_MEAN, 0, 0},
+};
+
+//sample counts of the clients, the last one sends an update without samples
+static const float robustWeights[CHECK_ROBUST_SLOTS] = {3.0f, 1.0f, 0.5f, 2.0f, 0.0f};
+
+static void check(const char *name, unsigned int ok)
+{
+	simCheck.checkCnt++;
+	if(!ok)
+		simCheck.failCnt++;
+	printf("check %-40s %s\n", name, ok ? "ok" : "FAILED");
+}
+
+static void *alloc_blocks(unsigned int nBlocks)
+{
+	void *buf;
+
+	buf = aligned_alloc(CHECK_BLOCK_BYTES, (unsigned long)nBlocks * CHECK_BLOCK_BYTES);
+	if(!buf)
+	{
+		fprintf(stderr, "out of host memory\n");
+		exit(1);
+	}
+
+	return buf;
+}
+
+static void build_rw(SIM_CHECK_CMD *cmd, unsigned int opc, unsigned int actid, unsigned int nBlocks, void *buf)
+{
+	memset(cmd, 0, sizeof(SIM_CHECK_CMD));
+	cmd->sqId = 1;
+	cmd->cmdDword[0] = opc;
+	cmd->cmdDword[1] = 1;		//NSID
+	cmd->cmdDword[10] = actid;
+	cmd->cmdDword[12] = nBlocks - 1;
+	cmd->buf = buf;
+}
+
+static unsigned int status_next(SIM_CHECK_CMD *cmd)
+{
+	const SIM_CHECK_STATUS *status;
+
+	if(simCheck.statusIdx == NUM_OF_STATUS_CHECKS)
+		return 0;
+
+	status = &statusChecks[simCheck.statusIdx];
+	memset(simCheck.statusBuf, 0, CHECK_BLOCK_BYTES);
+	memcpy(simCheck.statusBuf, status->weights, sizeof(status->weights));
+
+	memset(cmd, 0, sizeof(SIM_CHECK_CMD));
+	cmd->sqId = 1;
+	cmd->cmdDword[0] = IO_NVM_AGGREGATE_START;
+	cmd->cmdDword[1] = status->nsid;
+	cmd->cmdDword[2] = status->slotStride;
+	cmd->cmdDword[10] = status->actid;
+	cmd->cmdDword[13] = status->bytes;
+	cmd->cmdDword[14] = status->dword14;
+	cmd->cmdDword[15] = status->dstACTID;
+	cmd->buf = simCheck.statusBuf;
+
+	return 1;
+}
+
+static unsigned int generic_status(unsigned int sc)
+{
+	NVME_COMPLETION cpl;
+
+	cpl.dword[0] = 0;
+	cpl.statusField.SCT = SCT_GENERIC_COMMAND_STATUS;
+	cpl.statusField.SC = sc;
+
+	return cpl.statusFieldWord;
+}
+
+static void status_complete(SIM_CHECK_CMD *cmd, unsigned int status)
+{
+	const SIM_CHECK_STATUS *check;
+	unsigned int expected;
+
+	check = &statusChecks[simCheck.statusIdx++];
+	expected = generic_status(check->sc);
+
+	simCheck.checkCnt++;
+	if(status != expected)
+		simCheck.failCnt++;
+	printf("check %-24s status 0x%03X expected 0x%03X %s\n", check->name, status, expected,
+		(status == expected) ? "ok" : "FAILED");
+}
+
+//a threshold of 2 first, then the zero-based threshold 0 that leaves interrupts alone
+static unsigned int coalesce_next(SIM_CHECK_CMD *cmd)
+{
+	if(simCheck.coalesceStep == 2)
+		return 0;
+
+	memset(cmd, 0, sizeof(SIM_CHECK_CMD));
+	cmd->sqId = 0;
+	cmd->cmdDword[0] = ADMIN_SET_FEATURES;
+	cmd->cmdDword[10] = INTERRUPT_COALESCING;
+	cmd->cmdDword[11] = (CHECK_COALESCE_TIME << 8) | ((simCheck.coalesceStep == 0) ? COALESCE_MAX_THR + 1 : COALESCE_MAX_THR);
+	simCheck.coalesceStep++;
+
+	return 1;
+}
+
+static void coalesce_complete(SIM_CHECK_CMD *cmd, unsigned int status)
+{
+	if(simCheck.coalesceStep == 1)
+		check("coalescing threshold above 0 is rejected", status == generic_status(SC_INVALID_FIELD_IN_COMMAND));
+	else
+		check("coalescing threshold 0 is accepted", status == 0);
+}
+
+//the first words tell where a misplaced block came from, the rest differs for every block and generation
+static void fill_ftl_block(unsigned int *words, unsigned int block, unsigned int gen)
+{
+	unsigned int idx, state;
+
+	words[0] = block;
+	words[1] = gen;
+	state = ((block * 2654435761U) ^ (gen * 40503U)) | 1;
+	for(idx = 2; idx < CHECK_BLOCK_BYTES / 4; idx++)
+	{
+		//xorshift32
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		words[idx] = state;
+	}
+}
+
+static unsigned int ftl_next(SIM_CHECK_CMD *cmd)
+{
+	unsigned int nBlocks, idx;
+
+	if(simCheck.ftlNext == CHECK_FTL_BLOCKS)
+	{
+		simCheck.ftlNext = 0;
+		if(simCheck.ftlPhase == FTL_PHASE_READ)
+		{
+			if(simCheck.ftlBadBlocks)
+				printf("      %u of %u FTL blocks read back wrong\n", simCheck.ftlBadBlocks, (unsigned int)CHECK_FTL_BLOCKS);
+			check(simCheck.ftlGenKnown == 2 ? "ftl pattern after remount" : "ftl pattern read back",
+				simCheck.ftlBadCmds == 0 && simCheck.ftlBadBlocks == 0);
+			return 0;
+		}
+
+		//overwrite until garbage collection has moved pages of the pattern around
+		if(ftlStatus.gcVictimCnt == simCheck.ftlGcStart && simCheck.ftlGen + 1 < CHECK_FTL_MAX_GENS)
+			simCheck.ftlGen++;
+		else
+		{
+			printf("      %u generations written, %u blocks reclaimed by garbage collection\n",
+				simCheck.ftlGen + 1, ftlStatus.gcVictimCnt - simCheck.ftlGcStart);
+			check("ftl overwrites run garbage collection", ftlStatus.gcVictimCnt != simCheck.ftlGcStart);
+			simCheck.ftlPhase = FTL_PHASE_READ;
+		}
+	}
+
+	nBlocks = (CHECK_FTL_BLOCKS - simCheck.ftlNext < CHECK_FTL_CMD_BLOCKS) ? CHECK_FTL_BLOCKS - simCheck.ftlNext : CHECK_FTL_CMD_BLOCKS;
+	if(simCheck.ftlPhase == FTL_PHASE_WRITE)
+	{
+		for(idx = 0; idx < nBlocks; idx++)
+			fill_ftl_block(simCheck.ftlBuf + idx * (CHECK_BLOCK_BYTES / 4), simCheck.ftlNext + idx, simCheck.ftlGen);
+		build_rw(cmd, IO_NVM_WRITE, HOT_REGION_PAGES + simCheck.ftlNext, nBlocks, simCheck.ftlBuf);
+	}
+	else
+	{
+		memset(simCheck.ftlBuf, 0, nBlocks * CHECK_BLOCK_BYTES);
+		build_rw(cmd, IO_NVM_READ, HOT_REGION_PAGES + simCheck.ftlNext, nBlocks, simCheck.ftlBuf);
+	}
+	simCheck.ftlNext += nBlocks;
+
+	return 1;
+}
+
+static void ftl_complete(SIM_CHECK_CMD *cmd, unsigned int status)
+{
+	unsigned int expected[CHECK_BLOCK_BYTES / 4];
+	unsigned int *words;
+	unsigned int first, nBlocks, idx;
+
+	first = cmd->cmdDword[10] - HOT_REGION_PAGES;
+	nBlocks = cmd->cmdDword[12] + 1;
+	if(status != 0)
+	{
+		if(simCheck.ftlBadCmds++ == 0)
+			printf("      FTL %s of blocks %u-%u failed, status 0x%03X\n",
+				(simCheck.ftlPhase == FTL_PHASE_WRITE) ? "write" : "read", first, first + nBlocks - 1, status);
+		return;
+	}
+	if(simCheck.ftlPhase == FTL_PHASE_WRITE)
+		return;
+
+	//a remount learns the generation the last check run ended with from the first block
+	if(!simCheck.ftlGenKnown)
+	{
+		simCheck.ftlGen = simCheck.ftlBuf[1];
+		simCheck.ftlGenKnown = 2;
+	}
+
+	for(idx = 0; idx < nBlocks; idx++)
+	{
+		words = simCheck.ftlBuf + idx * (CHECK_BLOCK_BYTES / 4);
+		fill_ftl_block(expected, first + idx, simCheck.ftlGen);
+		if(memcmp(words, expected, CHECK_BLOCK_BYTES) == 0)
+			continue;
+
+		if(simCheck.ftlBadBlocks++ == 0)
+			printf("      FTL block %u holds block %u of generation %u, expected generation %u\n",
+				first + idx, words[0], words[1], simCheck.ftlGen);
+	}
+}
+
+static void seed_robust_slots()
+{
+	unsigned int idx, state;
+
+	//values in [-1, 1), every eighth one is one of 16 steps so that the sort sees ties
+	state = 0x9E3779B9;
+	for(idx = 0; idx < CHECK_ROBUST_SLOTS * CHECK_ROBUST_STRIDE * CHECK_BLOCK_BYTES / 4; idx++)
+	{
+		state ^= state << 13;
+		state ^= state >> 17;
+		state ^= state << 5;
+		if(idx % 8)
+			simCheck.robustSlots[idx] = (float)(state >> 8) / (1 << 23) - 1.0f;
+		else
+			simCheck.robustSlots[idx] = (float)(state >> 28) / 8 - 1.0f;
+	}
+}
+
+static unsigned int robust_next(SIM_CHECK_CMD *cmd)
+{
+	const SIM_CHECK_ROBUST *job;
+
+	if(simCheck.robustStep == 1 + 2 * CHECK_ROBUST_JOBS)
+		return 0;
+
+	if(simCheck.robustStep == 0)
+	{
+		seed_robust_slots();
+		build_rw(cmd, IO_NVM_WRITE, CHECK_ROBUST_ACTID, CHECK_ROBUST_SLOTS * CHECK_ROBUST_STRIDE, simCheck.robustSlots);
+	}
+	else if(simCheck.robustStep % 2)
+	{
+		job = &robustJobs[simCheck.robustStep / 2];
+		memset(simCheck.robustWeights, 0, sizeof(simCheck.robustWeights));
+		memcpy(simCheck.robustWeights, robustWeights, sizeof(robustWeights));
+
+		memset(cmd, 0, sizeof(SIM_CHECK_CMD));
+		cmd->sqId = 1;
+		cmd->cmdDword[0] = IO_NVM_AGGREGATE_START;
+		cmd->cmdDword[1] = 1;		//NSID
+		cmd->cmdDword[2] = CHECK_ROBUST_STRIDE;
+		cmd->cmdDword[10] = CHECK_ROBUST_ACTID;
+		cmd->cmdDword[13] = CHECK_ROBUST_ELEMS * sizeof(float);
+		cmd->cmdDword[14] = job->op | ((CHECK_ROBUST_SLOTS - 1) << 8) | (job->trim << 16);
+		cmd->cmdDword[15] = CHECK_ROBUST_DST_ACTID;
+		cmd->buf = simCheck.robustWeights;
+	}
+	else
+	{
+		memset(simCheck.robustDst, 0, CHECK_ROBUST_ELEMS * sizeof(float));
+		build_rw(cmd, IO_NVM_READ, CHECK_ROBUST_DST_ACTID, CHECK_ROBUST_BLOCKS, simCheck.robustDst);
+	}
+	simCheck.robustStep++;
+
+	return 1;
+}
+
+static unsigned int compare_robust(const SIM_CHECK_ROBUST *job)
+{
+	const float *slots[CHECK_ROBUST_SLOTS];
+	float expected[CHECK_ROBUST_ELEMS];
+	unsigned int slot, idx;
+	int ret;
+
+	for(slot = 0; slot < CHECK_ROBUST_SLOTS; slot++)
+		slots[slot] = simCheck.robustSlots + slot * CHECK_ROBUST_STRIDE * CHECK_BLOCK_BYTES / 4;
+	if(job->op == AGG_OP_WEIGHTED_MEAN)
+		ret = agg_model_weighted_mean(expected, slots, robustWeights, CHECK_ROBUST_SLOTS, CHECK_ROBUST_ELEMS);
+	else
+		ret = agg_model_robust(expected, slots, CHECK_ROBUST_SLOTS, CHECK_ROBUST_ELEMS, job->op, job->trim);
+	if(ret)
+		return 0;
+
+	for(idx = 0; idx < CHECK_ROBUST_ELEMS; idx++)
+	{
+		if(job->exact ? memcmp(&simCheck.robustDst[idx], &expected[idx], sizeof(float)) == 0
+			: fabsf(simCheck.robustDst[idx] - expected[idx]) <= CHECK_ROBUST_TOLERANCE * (1.0f + fabsf(expected[idx])))
+			continue;
+
+		printf("      %s element %u is %.9g, the model gives %.9g\n", job->name, idx, simCheck.robustDst[idx], expected[idx]);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void robust_complete(SIM_CHECK_CMD *cmd, unsigned int status)
+{
+	const SIM_CHECK_ROBUST *job;
+	char name[64];
+
+	if(simCheck.robustStep == 1)
+	{
+		check("robust slots written", status == 0);
+		return;
+	}
+
+	job = &robustJobs[(simCheck.robustStep - 2) / 2];
+	if(simCheck.robustStep % 2 == 0)
+	{
+		snprintf(name, sizeof(name), "%s of %u slots", job->name, CHECK_ROBUST_SLOTS);
+		check(name, status == 0);
+		return;
+	}
+
+	snprintf(name, sizeof(name), "%s matches the model", job->name);
+	check(name, status == 0 && compare_robust(job));
+}
+
+static void xform_desc(SIM_CHECK_CMD *cmd, unsigned int desc, unsigned int flags, unsigned int regionACTID,
+	unsigned int regionBlocks, unsigned int windowACTID)
+{
+	memset(cmd, 0, sizeof(SIM_CHECK_CMD));
+	cmd->sqId = 0;
+	cmd->cmdDword[0] = ADMIN_SET_FEATURES;
+	cmd->cmdDword[10] = XFORM_FEATURE_ID;
+	cmd->cmdDword[11] = desc | (XFORM_FORMAT_INT8 << 8) | (flags << 16) | (CHECK_XFORM_SHIFT << 24);
+	cmd->cmdDword[12] = regionACTID;
+	cmd->cmdDword[13] = regionBlocks;
+	cmd->cmdDword[14] = windowACTID;
+}
+
+static unsigned int xform_next(SIM_CHECK_CMD *cmd)
+{
+	unsigned int idx, state;
+
+	switch(simCheck.xformStep)
+	{
+		case 0:
+			xform_desc(cmd, 0, 0, CHECK_XFORM_UPLOAD_ACTID, CHECK_XFORM_SLOTS * CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_UPLOAD_WINDOW);
+			break;
+		case 1:
+			xform_desc(cmd, 1, XFORM_FLAG_QUANTIZE_ON_READ, CHECK_XFORM_RESULT_ACTID, CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_RESULT_WINDOW);
+			break;
+		case 2:
+			//the clients quantize their slots the way the device does
+			state = 0x2545F491;
+			for(idx = 0; idx < CHECK_XFORM_ELEMS; idx++)
+			{
+				state ^= state << 13;
+				state ^= state >> 17;
+				state ^= state << 5;
+				simCheck.xformValues[idx] = ((float)(state >> 8) / (1 << 23) - 1.0f) * (float)(1 + idx / 1024);
+			}
+			memset(simCheck.xformUpload, 0, agg_model_xform_blocks(CHECK_XFORM_SLOTS * CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_SHIFT) * CHECK_BLOCK_BYTES);
+			agg_model_quantize((s8 *)simCheck.xformUpload, (float *)(simCheck.xformUpload + CHECK_XFORM_ELEMS),
+				simCheck.xformValues, CHECK_XFORM_ELEMS, CHECK_XFORM_SHIFT);
+			build_rw(cmd, IO_NVM_WRITE, CHECK_XFORM_UPLOAD_WINDOW,
+				agg_model_xform_blocks(CHECK_XFORM_SLOTS * CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_SHIFT), simCheck.xformUpload);
+			break;
+		case 3:
+			memset(cmd, 0, sizeof(SIM_CHECK_CMD));
+			cmd->sqId = 1;
+			cmd->cmdDword[0] = IO_NVM_AGGREGATE_START;
+			cmd->cmdDword[1] = 1;		//NSID
+			cmd->cmdDword[2] = CHECK_XFORM_SLOT_BLOCKS;
+			cmd->cmdDword[10] = CHECK_XFORM_UPLOAD_ACTID;
+			cmd->cmdDword[13] = CHECK_XFORM_SLOT_ELEMS * sizeof(float);
+			cmd->cmdDword[14] = AGG_OP_MEDIAN | ((CHECK_XFORM_SLOTS - 1) << 8);
+			cmd->cmdDword[15] = CHECK_XFORM_RESULT_ACTID;
+			cmd->buf = simCheck.xformResult;
+			break;
+		case 4:
+			memset(simCheck.xformResult, 0, agg_model_xform_blocks(CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_SHIFT) * CHECK_BLOCK_BYTES);
+			build_rw(cmd, IO_NVM_READ, CHECK_XFORM_RESULT_WINDOW,
+				agg_model_xform_blocks(CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_SHIFT), simCheck.xformResult);
+			break;
+		default:
+			return 0;
+	}
+	simCheck.xformStep++;
+
+	return 1;
+}
+
+//the device dequantizes the upload, takes the median and quantizes it again on read
+static unsigned int compare_xform()
+{
+	static float uploaded[CHECK_XFORM_ELEMS];
+	static float median[CHECK_XFORM_SLOT_ELEMS];
+	static unsigned char expected[CHECK_XFORM_SLOT_ELEMS + (CHECK_XFORM_SLOT_ELEMS >> CHECK_XFORM_SHIFT) * sizeof(float)];
+	const float *slots[CHECK_XFORM_SLOTS];
+	unsigned int slot, idx;
+
+	agg_model_dequantize(uploaded, (const s8 *)simCheck.xformUpload, (const float *)(simCheck.xformUpload + CHECK_XFORM_ELEMS),
+		CHECK_XFORM_ELEMS, CHECK_XFORM_SHIFT);
+	for(slot = 0; slot < CHECK_XFORM_SLOTS; slot++)
+		slots[slot] = uploaded + slot * CHECK_XFORM_SLOT_ELEMS;
+	if(agg_model_robust(median, slots, CHECK_XFORM_SLOTS, CHECK_XFORM_SLOT_ELEMS, AGG_OP_MEDIAN, 0))
+		return 0;
+	agg_model_quantize((s8 *)expected, (float *)(expected + CHECK_XFORM_SLOT_ELEMS), median, CHECK_XFORM_SLOT_ELEMS, CHECK_XFORM_SHIFT);
+
+	for(idx = 0; idx < sizeof(expected); idx++)
+	{
+		if(simCheck.xformResult[idx] == expected[idx])
+			continue;
+
+		printf("      window byte %u is 0x%02X, the model gives 0x%02X\n", idx, simCheck.xformResult[idx], expected[idx]);
+		return 0;
+	}
+
+	return 1;
+}
+
+static void xform_complete(SIM_CHECK_CMD *cmd, unsigned int status)
+{
+	static const char *stepName[CHECK_XFORM_STEPS] =
+	{
+		"xform upload descriptor", "xform quantize-on-read descriptor", "xform INT8 upload", "xform median of the upload", NULL
+	};
+
+	if(stepName[simCheck.xformStep - 1])
+		check(stepName[simCheck.xformStep - 1], status == 0);
+	else
+		check("xform read-out matches the model", status == 0 && compare_xform());
+}
+
+static void cstore_feature(SIM_CHECK_CMD *cmd, unsigned int flags)
+{
+	memset(cmd, 0, sizeof(SIM_CHECK_CMD));
+	cmd->sqId = 0;
+	cmd->cmdDword[0] = ADMIN_SET_FEATURES;
+	cmd->cmdDword[10] = CSTORE_FEATURE_ID;
+	cmd->cmdDword[11] = flags;
+	cmd->cmdDword[12] = CHECK_CSTORE_ACTID;
+	cmd->cmdDword[13] = CHECK_CSTORE_BLOCKS;
+	cmd->cmdDword[14] = CHECK_CSTORE_POOL_ACTID;
+	cmd->cmdDword[15] = CHECK_CSTORE_POOL_BLOCKS;
+}
+
+//a third of the blocks is noise the store keeps raw, the rest compresses
+static void fill_cstore_range()
+{
+	unsigned int block, idx, state;
+	unsigned int *words;
+	float *values;
+
+	state = 0x6C078965;
+	for(block = 0; block < CHECK_CSTORE_BLOCKS; block++)
+	{
+		words = (unsigned int *)(simCheck.cstoreData + block * CHECK_BLOCK_BYTES);
+		values = (float *)words;
+		for(idx = 0; idx < CHECK_BLOCK_BYTES / 4; idx++)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			if(block % 3 == 0)
+				words[idx] = state;
+			else if(block % 3 == 1)
+				values[idx] = (float)(int)(state % 64) * 0.125f;
+			else
+				words[idx] = (block << 16) | (idx & 0xF);
+		}
+	}
+}
+
+static unsigned int cstore_next(SIM_CHECK_CMD *cmd)
+{
+	unsigned int read;
+
+	if(simCheck.cstoreStep == 0)
+		cstore_feature(cmd, CHECK_CSTORE_FLAGS);
+	else if(simCheck.cstoreStep == 1)
+	{
+		fill_cstore_range();
+		build_rw(cmd, IO_NVM_WRITE, CHECK_CSTORE_ACTID, CHECK_CSTORE_BLOCKS, simCheck.cstoreData);
+	}
+	else if(simCheck.cstoreStep == 2)
+	{
+		memset(simCheck.cstoreRead, 0, CHECK_CSTORE_BLOCKS * CHECK_BLOCK_BYTES);
+		build_rw(cmd, IO_NVM_READ, CHECK_CSTORE_ACTID, CHECK_CSTORE_BLOCKS, simCheck.cstoreRead);
+	}
+	else if(simCheck.cstoreStep < CHECK_CSTORE_STEP_DISABLE)
+	{
+		//the pool is plain hot region, reading the range has compressed everything pending
+		read = (simCheck.cstoreStep - CHECK_CSTORE_STEP_POOL) * CHECK_CSTORE_READ_BLOCKS;
+		build_rw(cmd, IO_NVM_READ, CHECK_CSTORE_POOL_ACTID + CSTORE_STAGING_BLOCKS + read, CHECK_CSTORE_READ_BLOCKS,
+			simCheck.cstorePool + read * CHECK_BLOCK_BYTES);
+	}
+	else if(simCheck.cstoreStep == CHECK_CSTORE_STEP_DISABLE)
+		cstore_feature(cmd, 0);
+	else
+		return 0;
+	simCheck.cstoreStep++;
+
+	return 1;
+}
+
+//every stored block has to decode with the loader the host uses for checkpoints
+static unsigned int decode_cstore_pool()
+{
+	static unsigned char stored[CHECK_BLOCK_BYTES];
+	static unsigned char decoded[CHECK_BLOCK_BYTES];
+	const CSTORE_MAP_ENTRY *map;
+	const unsigned char *heap;
+	unsigned int block, idx, rawCnt, packedCnt;
+
+	map = (const CSTORE_MAP_ENTRY *)simCheck.cstorePool;
+	heap = simCheck.cstorePool + (CHECK_CSTORE_MAP_BLOCKS + CHECK_CSTORE_BITMAP_BLOCKS) * CHECK_BLOCK_BYTES;
+	rawCnt = 0;
+	packedCnt = 0;
+	for(block = 0; block < CHECK_CSTORE_BLOCKS; block++)
+	{
+		if(map[block].length == 0 || map[block].length > CHECK_BLOCK_BYTES)
+		{
+			printf("      cstore block %u is stored with length %u\n", block, map[block].length);
+			return 0;
+		}
+
+		for(idx = 0; idx < ckpt_model_sectors(map[block].length); idx++)
+		{
+			if(map[block].sector[idx] >= CHECK_CSTORE_HEAP_SECTORS)
+			{
+				printf("      cstore block %u is stored in sector %u past the heap\n", block, map[block].sector[idx]);
+				return 0;
+			}
+			memcpy(stored + idx * CSTORE_SECTOR_BYTES, heap + map[block].sector[idx] * CSTORE_SECTOR_BYTES, CSTORE_SECTOR_BYTES);
+		}
+		if(ckpt_model_load_block(decoded, stored, map[block].length, UNVME_CSTORE_SHUFFLE4)
+			|| memcmp(decoded, simCheck.cstoreData + block * CHECK_BLOCK_BYTES, CHECK_BLOCK_BYTES))
+		{
+			printf("      cstore block %u of length %u does not decode to what was written\n", block, map[block].length);
+			return 0;
+		}
+
+		if(map[block].length == CHECK_BLOCK_BYTES)
+			rawCnt++;
+		else
+			packedCnt++;
+	}
+
+	printf("      %u blocks compressed, %u kept raw\n", packedCnt, rawCnt);
+	return rawCnt && packedCnt;
+}
+
+static void cstore_complete(SIM_CHECK_CMD *cmd, unsigned int status)
+{
+	if(simCheck.cstoreStep == 1)
+		check("cstore configuration", status == 0);
+	else if(simCheck.cstoreStep == 2)
+		check("cstore range written", status == 0);
+	else if(simCheck.cstoreStep == 3)
+		check("cstore range read back", status == 0
+			&& memcmp(simCheck.cstoreRead, simCheck.cstoreData, CHECK_CSTORE_BLOCKS * CHECK_BLOCK_BYTES) == 0);
+	else if(simCheck.cstoreStep <= CHECK_CSTORE_STEP_DISABLE)
+	{
+		if(status != 0)
+			simCheck.cstoreBadCmds++;
+		if(simCheck.cstoreStep == CHECK_CSTORE_STEP_DISABLE)
+			check("cstore sectors decode with the model", simCheck.cstoreBadCmds == 0 && decode_cstore_pool());
+	}
+	else
+		check("cstore disable", status == 0);
+}
+
+static const SIM_CHECK_PASS checkPasses[] =
+{
+	{status_next, status_complete},
+	{coalesce_next, coalesce_complete},
+	{robust_next, robust_complete},
+	{xform_next, xform_complete},
+	{cstore_next, cstore_complete},
+	{ftl_next, ftl_complete},
+};
+
+static const SIM_CHECK_PASS remountPasses[] =
+{
+	{ftl_next, ftl_complete},
+};
+
+void sim_check_init(unsigned int remount)
+{
+	memset(&simCheck, 0, sizeof(simCheck));
+	simCheck.statusBuf = alloc_blocks(1);
+	simCheck.ftlBuf = alloc_blocks(CHECK_FTL_CMD_BLOCKS);
+	simCheck.robustSlots = alloc_blocks(CHECK_ROBUST_SLOTS * CHECK_ROBUST_STRIDE);
+	simCheck.robustDst = alloc_blocks(CHECK_ROBUST_BLOCKS);
+	simCheck.xformValues = alloc_blocks(CHECK_XFORM_SLOTS * CHECK_XFORM_SLOT_BLOCKS);
+	simCheck.xformUpload = alloc_blocks(agg_model_xform_blocks(CHECK_XFORM_SLOTS * CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_SHIFT));
+	simCheck.xformResult = alloc_blocks(agg_model_xform_blocks(CHECK_XFORM_SLOT_BLOCKS, CHECK_XFORM_SHIFT));
+	simCheck.cstoreData = alloc_blocks(CHECK_CSTORE_BLOCKS);
+	simCheck.cstoreRead = alloc_blocks(CHECK_CSTORE_BLOCKS);
+	simCheck.cstorePool = alloc_blocks(CHECK_CSTORE_META_BLOCKS);
+	simCheck.ftlGcStart = ftlStatus.gcVictimCnt;
+
+	if(remount)
+	{
+		simCheck.pass = remountPasses;
+		simCheck.numOfPasses = sizeof(remountPasses) / sizeof(remountPasses[0]);
+		simCheck.ftlPhase = FTL_PHASE_READ;
+	}
+	else
+	{
+		simCheck.pass = checkPasses;
+		simCheck.numOfPasses = sizeof(checkPasses) / sizeof(checkPasses[0]);
+		simCheck.ftlPhase = FTL_PHASE_WRITE;
+		simCheck.ftlGenKnown = 1;
+	}
+}
+
+unsigned int sim_check_next(SIM_CHECK_CMD *cmd)
+{
+	while(simCheck.passIdx < simCheck.numOfPasses)
+	{
+		if(simCheck.pass[simCheck.passIdx].next(cmd))
+			return 1;
+		simCheck.passIdx++;
+	}
+
+	return 0;
+}
+
+void sim_check_complete(SIM_CHECK_CMD *cmd, unsigned int status)
+{
+	simCheck.pass[simCheck.passIdx].complete(cmd, status);
+}
+
+unsigned int sim_check_report()
+{
+	printf("\n%u of %u checks failed\n", simCheck.failCnt, simCheck.checkCnt);
+
+	return simCheck.failCnt;
+}
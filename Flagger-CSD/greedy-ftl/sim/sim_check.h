@@ -0,0 +1,62 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_check.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Host Checks
+// File Name: sim_check.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the checks the simulated host runs in check mode
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIM_CHECK_H_
+#define SIM_CHECK_H_
+
+typedef struct _SIM_CHECK_CMD
+{
+	unsigned int sqId;					//0 for an admin command, 1 for an IO command
+	unsigned int cmdDword[16];			//the host fills in the CID and PRP1
+	void *buf;							//data of the command, contiguous
+} SIM_CHECK_CMD;
+
+//remount only reads back the FTL data a previous check run left in the flash image
+void sim_check_init(unsigned int remount);
+
+//builds the next check command, returns 0 once all checks are done
+unsigned int sim_check_next(SIM_CHECK_CMD *cmd);
+
+//checks the completion status and the data of the command sim_check_next built last
+void sim_check_complete(SIM_CHECK_CMD *cmd, unsigned int status);
+
+//prints the summary, returns the number of failed checks
+unsigned int sim_check_report();
+
+#endif /* SIM_CHECK_H_ */
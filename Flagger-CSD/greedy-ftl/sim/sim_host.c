@@ -0,0 +1,501 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_host.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Host Model
+// File Name: sim_host.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - brings the controller up with Set Features (Number of Queues) and Create IO CQ/SQ
+//   - keeps queueDepth commands outstanding on every IO queue until numOfCmds are completed
+//   - records the latency of every command from submission to completion
+//   - reads the command processing profile (log page 0xC2) once the IO is done
+//   - shuts the controller down and reports throughput and latency per opcode
+//   - in check mode, submits the commands of sim_check.c one by one instead of the workload
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+
+#include "ftl_config.h"
+#include "nvme/nvme.h"
+#include "nvme/nvme_profile.h"
+#include "agg_engine.h"
+
+#include "sim_hw.h"
+#include "sim_host.h"
+#include "sim_check.h"
+
+#define HOST_PHASE_WAIT_RDY				0
+#define HOST_PHASE_ADMIN				1
+#define HOST_PHASE_IO					2
+#define HOST_PHASE_PROFILE				3
+#define HOST_PHASE_SHUTDOWN				4
+
+#define HOST_BLOCK_BYTES				4096
+#define SIM_CPL_STATUS_MASK				0xFFFE		//SCT and SC of a completion status word
+
+typedef struct _SIM_HOST_CMD
+{
+	unsigned int op;
+	unsigned long long submitTime;
+} SIM_HOST_CMD;
+
+typedef struct _SIM_HOST_QUEUE
+{
+	SIM_HOST_CMD *cmd;					//indexed by CID
+	unsigned short *freeCid;
+	unsigned int freeCidCnt;
+	unsigned char *buf;					//blocksPerCmd blocks per CID
+} SIM_HOST_QUEUE;
+
+typedef struct _SIM_HOST_OP_STATS
+{
+	unsigned int cmdCnt;
+	unsigned int errorCnt;
+	unsigned int *latency;				//nanoseconds, one per command
+} SIM_HOST_OP_STATS;
+
+typedef struct _SIM_HOST_CONTEXT
+{
+	SIM_HOST_CONFIG config;
+	unsigned int phase;
+	unsigned int adminStep;
+	unsigned int adminBusy;
+	unsigned int adminCid;
+	unsigned char *queueMem;			//IO CQs and SQs, only their addresses are handed to the firmware
+	PROF_LOG_PAGE *profile;
+
+	SIM_HOST_QUEUE queue[MAX_NUM_OF_IO_SQ];
+	unsigned int submittedCnt;
+	unsigned int completedCnt;
+	unsigned long long ioStartTime;
+	unsigned long long ioEndTime;
+	unsigned int randState;
+
+	SIM_HOST_OP_STATS opStats[SIM_NUM_OF_OPS];
+
+	SIM_CHECK_CMD checkCmd;
+	unsigned int checkReady;			//checkCmd is built, but the SQ was full
+	unsigned int checkBusy;
+	unsigned int checkDone;
+} SIM_HOST_CONTEXT;
+
+static SIM_HOST_CONTEXT simHost;
+
+static const char *opName[SIM_NUM_OF_OPS] = {"write", "read", "aggregate"};
+
+static unsigned int next_rand()
+{
+	//xorshift32
+	simHost.randState ^= simHost.randState << 13;
+	simHost.randState ^= simHost.randState >> 17;
+	simHost.randState ^= simHost.randState << 5;
+
+	return simHost.randState;
+}
+
+static void set_prp1(unsigned int *cmdDword, void *addr)
+{
+	cmdDword[6] = (unsigned int)((unsigned long)addr & 0xFFFFFFFF);
+	cmdDword[7] = (unsigned int)((unsigned long)addr >> 32);
+}
+
+static unsigned int num_of_admin_steps()
+{
+	return 1 + 2 * simHost.config.numOfQueues;
+}
+
+//step 0 sets the number of queues, then a CQ and its SQ are created for every IO queue
+static void build_admin_cmd(unsigned int step, unsigned int *cmdDword)
+{
+	unsigned int qID, qSize;
+
+	memset(cmdDword, 0, 16 * sizeof(unsigned int));
+	if(step == 0)
+	{
+		cmdDword[0] = ADMIN_SET_FEATURES;
+		cmdDword[10] = NUMBER_OF_QUEUES;
+		cmdDword[11] = ((simHost.config.numOfQueues - 1) << 16) | (simHost.config.numOfQueues - 1);
+	}
+	else
+	{
+		qID = (step + 1) / 2;
+		qSize = simHost.config.queueDepth + 1;		//a queue holds one entry less than its size
+		if(step % 2)
+		{
+			cmdDword[0] = ADMIN_CREATE_IO_CQ;
+			cmdDword[11] = 0x3;		//physically contiguous, interrupts enabled, vector 0
+		}
+		else
+		{
+			cmdDword[0] = ADMIN_CREATE_IO_SQ;
+			cmdDword[11] = (qID << 16) | 0x1;
+		}
+		cmdDword[10] = ((qSize - 1) << 16) | qID;
+		set_prp1(cmdDword, simHost.queueMem + (step - 1) * qSize * 64);
+	}
+
+	cmdDword[0] |= (simHost.adminCid++ & 0xFFFF) << 16;
+}
+
+static unsigned int pick_op()
+{
+	unsigned int draw, op;
+
+	draw = next_rand() % 100;
+	for(op = 0; op < SIM_NUM_OF_OPS - 1; op++)
+	{
+		if(draw < simHost.config.opPercent[op])
+			break;
+		draw -= simHost.config.opPercent[op];
+	}
+
+	return op;
+}
+
+static void build_io_cmd(unsigned int op, unsigned int cid, void *buf, unsigned int *cmdDword)
+{
+	unsigned int actid, slots;
+
+	slots = simHost.config.rangeBlocks / simHost.config.blocksPerCmd;
+	actid = simHost.config.startACTID + (next_rand() % slots) * simHost.config.blocksPerCmd;
+
+	memset(cmdDword, 0, 16 * sizeof(unsigned int));
+	cmdDword[0] = (cid << 16);
+	cmdDword[1] = 1;		//NSID
+	cmdDword[10] = actid;
+	set_prp1(cmdDword, buf);
+
+	if(op == SIM_OP_AGGREGATE)
+	{
+		cmdDword[0] |= IO_NVM_AGGREGATE_START;
+		cmdDword[12] = 0;
+		cmdDword[13] = simHost.config.blocksPerCmd * HOST_BLOCK_BYTES;
+		cmdDword[14] = AGG_OP_DENSE_SUM;
+	}
+	else
+	{
+		cmdDword[0] |= (op == SIM_OP_WRITE) ? IO_NVM_WRITE : IO_NVM_READ;
+		cmdDword[12] = simHost.config.blocksPerCmd - 1;
+	}
+}
+
+static void submit_io()
+{
+	SIM_HOST_QUEUE *queue;
+	SIM_HOST_CMD *cmd;
+	unsigned int cmdDword[16];
+	unsigned int qIdx, cid, op;
+
+	for(qIdx = 0; qIdx < simHost.config.numOfQueues; qIdx++)
+	{
+		queue = &simHost.queue[qIdx];
+		while(queue->freeCidCnt && simHost.submittedCnt < simHost.config.numOfCmds)
+		{
+			cid = queue->freeCid[queue->freeCidCnt - 1];
+			op = pick_op();
+			build_io_cmd(op, cid, queue->buf + (unsigned long)cid * simHost.config.blocksPerCmd * HOST_BLOCK_BYTES, cmdDword);
+			if(!sim_hw_submit(qIdx + 1, cmdDword))
+				return;
+
+			queue->freeCidCnt--;
+			cmd = &queue->cmd[cid];
+			cmd->op = op;
+			cmd->submitTime = sim_now();
+			simHost.submittedCnt++;
+		}
+	}
+}
+
+static void submit_check()
+{
+	SIM_CHECK_CMD *check;
+
+	if(simHost.checkBusy)
+		return;
+
+	check = &simHost.checkCmd;
+	if(!simHost.checkReady)
+	{
+		if(!sim_check_next(check))
+		{
+			simHost.checkDone = 1;
+			return;
+		}
+
+		//one check is in flight at a time, an IO check can always take CID 0
+		if(check->sqId == 0)
+			check->cmdDword[0] |= (simHost.adminCid++ & 0xFFFF) << 16;
+		set_prp1(check->cmdDword, check->buf);
+		simHost.checkReady = 1;
+	}
+
+	if(!sim_hw_submit(check->sqId, check->cmdDword))
+		return;
+
+	simHost.checkReady = 0;
+	simHost.checkBusy = 1;
+}
+
+void sim_host_poll()
+{
+	unsigned int cmdDword[16];
+
+	if(simHost.phase == HOST_PHASE_WAIT_RDY)
+	{
+		if(!sim_hw_csts_rdy())
+			return;
+		simHost.phase = HOST_PHASE_ADMIN;
+	}
+
+	if(simHost.phase == HOST_PHASE_ADMIN)
+	{
+		if(simHost.adminBusy)
+			return;
+		if(simHost.adminStep < num_of_admin_steps())
+		{
+			build_admin_cmd(simHost.adminStep, cmdDword);
+			if(sim_hw_submit(0, cmdDword))
+				simHost.adminBusy = 1;
+			return;
+		}
+
+		simHost.phase = HOST_PHASE_IO;
+		simHost.ioStartTime = sim_now();
+	}
+
+	if(simHost.phase == HOST_PHASE_IO)
+	{
+		if(simHost.config.checkMode && !simHost.checkDone)
+		{
+			submit_check();
+			return;
+		}
+		if(!simHost.config.checkMode && simHost.completedCnt < simHost.config.numOfCmds)
+		{
+			submit_io();
+			return;
+		}
+
+		simHost.ioEndTime = sim_now();
+		simHost.phase = HOST_PHASE_PROFILE;
+	}
+
+	if(simHost.phase == HOST_PHASE_PROFILE && !simHost.adminBusy)
+	{
+		memset(cmdDword, 0, sizeof(cmdDword));
+		cmdDword[0] = ADMIN_GET_LOG_PAGE | ((simHost.adminCid++ & 0xFFFF) << 16);
+		cmdDword[1] = 0xFFFFFFFF;
+		cmdDword[10] = ((sizeof(PROF_LOG_PAGE) / 4 - 1) << 16) | PROF_LOG_PAGE_ID;
+		set_prp1(cmdDword, simHost.profile);
+		if(sim_hw_submit(0, cmdDword))
+			simHost.adminBusy = 1;
+	}
+}
+
+void sim_host_complete(unsigned int sqId, unsigned int cid, unsigned int specific, unsigned int statusFieldWord)
+{
+	SIM_HOST_QUEUE *queue;
+	SIM_HOST_OP_STATS *stats;
+	SIM_HOST_CMD *cmd;
+	unsigned long long latency;
+	unsigned int status;
+
+	//bit 0 is where the IP puts the phase tag, SC and SCT sit above it
+	status = statusFieldWord & SIM_CPL_STATUS_MASK;
+	if(simHost.checkBusy && sqId == simHost.checkCmd.sqId && cid == (simHost.checkCmd.cmdDword[0] >> 16))
+	{
+		simHost.checkBusy = 0;
+		sim_check_complete(&simHost.checkCmd, status);
+		return;
+	}
+
+	if(sqId == 0)
+	{
+		if(status != 0)
+		{
+			fprintf(stderr, "admin command %u failed, status 0x%04X\n", cid, status);
+			exit(1);
+		}
+		simHost.adminBusy = 0;
+		if(simHost.phase == HOST_PHASE_ADMIN)
+			simHost.adminStep++;
+		else if(simHost.phase == HOST_PHASE_PROFILE)
+		{
+			simHost.phase = HOST_PHASE_SHUTDOWN;
+			sim_hw_set_cc(1, 1);		//normal shutdown
+		}
+		return;
+	}
+
+	queue = &simHost.queue[sqId - 1];
+	cmd = &queue->cmd[cid];
+	stats = &simHost.opStats[cmd->op];
+
+	latency = sim_now() - cmd->submitTime;
+	stats->latency[stats->cmdCnt++] = (latency > 0xFFFFFFFF) ? 0xFFFFFFFF : (unsigned int)latency;
+	if(status != 0)
+		stats->errorCnt++;
+
+	queue->freeCid[queue->freeCidCnt++] = cid;
+	simHost.completedCnt++;
+}
+
+static int compare_latency(const void *a, const void *b)
+{
+	unsigned int la = *(const unsigned int *)a, lb = *(const unsigned int *)b;
+
+	return (la > lb) - (la < lb);
+}
+
+static double percentile_us(SIM_HOST_OP_STATS *stats, unsigned int pct)
+{
+	return stats->latency[(unsigned long long)(stats->cmdCnt - 1) * pct / 100] / 1000.0;
+}
+
+static void print_profile()
+{
+	static const char *className[PROF_NUM_OF_CLASSES] = {"admin", "read", "write", "aggregate", "other"};
+	PROF_LOG_PAGE *profile;
+	PROF_STAGE_COUNTERS *counters;
+	unsigned int cmdClass, stage;
+
+	profile = simHost.profile;
+	printf("\nfirmware cycles per command (%.0f MHz cycle counter)\n", profile->cyclesPerSecond / 1e6);
+	printf("%-10s %10s %10s %10s %10s %10s %10s %10s\n", "class", "cmds", "fetch", "decode", "dma", "cpl", "total", "max");
+	for(cmdClass = 0; cmdClass < PROF_NUM_OF_CLASSES; cmdClass++)
+	{
+		counters = profile->stage[cmdClass];
+		if(counters[PROF_STAGE_TOTAL].count == 0)
+			continue;
+
+		printf("%-10s %10u", className[cmdClass], counters[PROF_STAGE_TOTAL].count);
+		for(stage = 0; stage < PROF_NUM_OF_STAGES; stage++)
+			printf(" %10llu", counters[stage].cycles / counters[stage].count);
+		printf(" %10u\n", counters[PROF_STAGE_TOTAL].maxCycles);
+	}
+}
+
+void sim_host_shutdown_done()
+{
+	SIM_HOST_OP_STATS *stats;
+	SIM_HW_STATS hwStats;
+	unsigned long long latencySum;
+	unsigned int op, idx, failCnt;
+	double seconds;
+
+	if(simHost.config.checkMode)
+	{
+		failCnt = sim_check_report();
+		fflush(stdout);
+		exit(failCnt ? 1 : 0);
+	}
+
+	seconds = (simHost.ioEndTime - simHost.ioStartTime) / 1e9;
+	sim_hw_get_stats(&hwStats);
+
+	printf("\n%u commands in %.3f s, %u queue(s) x %u deep, %u KB per command\n",
+		simHost.completedCnt, seconds, simHost.config.numOfQueues, simHost.config.queueDepth, simHost.config.blocksPerCmd * 4);
+	printf("%-10s %10s %8s %10s %10s %10s %10s %10s %10s\n", "opcode", "cmds", "errors", "KIOPS", "MB/s", "avg(us)", "p50(us)", "p99(us)", "max(us)");
+	for(op = 0; op < SIM_NUM_OF_OPS; op++)
+	{
+		stats = &simHost.opStats[op];
+		if(stats->cmdCnt == 0)
+			continue;
+
+		latencySum = 0;
+		for(idx = 0; idx < stats->cmdCnt; idx++)
+			latencySum += stats->latency[idx];
+		qsort(stats->latency, stats->cmdCnt, sizeof(unsigned int), compare_latency);
+
+		printf("%-10s %10u %8u %10.1f %10.1f %10.2f %10.2f %10.2f %10.2f\n", opName[op], stats->cmdCnt, stats->errorCnt,
+			stats->cmdCnt / seconds / 1000, (double)stats->cmdCnt * simHost.config.blocksPerCmd * HOST_BLOCK_BYTES / seconds / 1e6,
+			(double)latencySum / stats->cmdCnt / 1000, percentile_us(stats, 50), percentile_us(stats, 99), percentile_us(stats, 100));
+	}
+	printf("DMA RX %.1f MB, TX %.1f MB, accelerator %.1f MB busy %.1f%%\n", hwStats.rxBytes / 1e6, hwStats.txBytes / 1e6,
+		hwStats.aggBytes / 1e6, seconds > 0 ? hwStats.aggBusyNs / 1e9 / seconds * 100 : 0.0);
+	print_profile();
+
+	fflush(stdout);
+	exit(0);
+}
+
+void sim_host_init(SIM_HOST_CONFIG *config)
+{
+	SIM_HOST_QUEUE *queue;
+	unsigned int qIdx, cid, op;
+	unsigned long bufBytes;
+
+	memset(&simHost, 0, sizeof(simHost));
+	simHost.config = *config;
+	simHost.randState = config->seed ? config->seed : 1;
+
+	simHost.profile = aligned_alloc(HOST_BLOCK_BYTES, HOST_BLOCK_BYTES);
+	simHost.queueMem = aligned_alloc(HOST_BLOCK_BYTES, (unsigned long)2 * config->numOfQueues * (config->queueDepth + 1) * 64 + HOST_BLOCK_BYTES);
+	bufBytes = (unsigned long)config->queueDepth * config->blocksPerCmd * HOST_BLOCK_BYTES;
+	for(qIdx = 0; qIdx < config->numOfQueues; qIdx++)
+	{
+		queue = &simHost.queue[qIdx];
+		queue->cmd = calloc(config->queueDepth, sizeof(SIM_HOST_CMD));
+		queue->freeCid = malloc(config->queueDepth * sizeof(unsigned short));
+		queue->buf = aligned_alloc(HOST_BLOCK_BYTES, bufBytes);
+		if(!simHost.profile || !simHost.queueMem || !queue->cmd || !queue->freeCid || !queue->buf)
+		{
+			fprintf(stderr, "out of host memory\n");
+			exit(1);
+		}
+
+		memset(queue->buf, 0x5A + qIdx, bufBytes);
+		for(cid = 0; cid < config->queueDepth; cid++)
+			queue->freeCid[cid] = config->queueDepth - 1 - cid;
+		queue->freeCidCnt = config->queueDepth;
+	}
+
+	for(op = 0; op < SIM_NUM_OF_OPS; op++)
+	{
+		simHost.opStats[op].latency = malloc((unsigned long)config->numOfCmds * sizeof(unsigned int));
+		if(!simHost.opStats[op].latency)
+		{
+			fprintf(stderr, "out of host memory\n");
+			exit(1);
+		}
+	}
+
+	if(config->checkMode)
+		sim_check_init(config->remount);
+}
+
+void sim_host_power_on()
+{
+	sim_hw_set_cc(1, 0);
+}
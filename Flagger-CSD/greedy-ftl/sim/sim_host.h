@@ -0,0 +1,67 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_host.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Host Model
+// File Name: sim_host.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the workload of the simulated host
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIM_HOST_H_
+#define SIM_HOST_H_
+
+#define SIM_OP_WRITE					0
+#define SIM_OP_READ						1
+#define SIM_OP_AGGREGATE				2
+#define SIM_NUM_OF_OPS					3
+
+typedef struct _SIM_HOST_CONFIG
+{
+	unsigned int numOfCmds;
+	unsigned int numOfQueues;
+	unsigned int queueDepth;			//per IO queue
+	unsigned int blocksPerCmd;			//4KB NVMe blocks
+	unsigned int startACTID;
+	unsigned int rangeBlocks;			//ACTIDs are drawn from [startACTID, startACTID + rangeBlocks)
+	unsigned int opPercent[SIM_NUM_OF_OPS];
+	unsigned int seed;
+	unsigned int checkMode;				//runs the checks of sim_check.c instead of the workload
+	unsigned int remount;				//check mode only reads back what the last check run left in the flash image
+} SIM_HOST_CONFIG;
+
+void sim_host_init(SIM_HOST_CONFIG *config);
+
+//sets CC.EN, the host starts once the firmware reports CSTS.RDY
+void sim_host_power_on();
+
+#endif /* SIM_HOST_H_ */
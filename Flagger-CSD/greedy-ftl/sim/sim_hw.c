@@ -0,0 +1,505 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_hw.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Hardware Model
+// File Name: sim_hw.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - models the registers of the NVMe IP, its four host DMA FIFOs and the aggregation accelerator
+//   - DMA data is copied when the descriptor is issued, the FIFO head advances when the modeled transfer is done
+//   - a transfer takes its length over the configured bandwidth plus a fixed latency, RX and TX run in parallel
+//   - the host buffers are contiguous, an auto DMA reaches PRP1 + 4KB * cmd4KBOffset without walking a PRP list
+//   - the accelerator only models the time a job takes, the data is left as it is
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+
+#include "xparameters.h"
+#include "xtime_l.h"
+#include "nvme/debug.h"
+#include "nvme/io_access.h"
+#include "nvme/nvme.h"
+#include "nvme/host_lld.h"
+
+#include "sim_io.h"
+#include "sim_hw.h"
+
+#define HOST_IP_SPAN					(0x10000 + SIM_CMD_SLOTS * 64)
+#define AGG_ACCEL_SPAN					0x1C
+
+//register layout of the accelerator as driven by nvme_io_cmd.c
+#define AGG_CTRL_REG_ADDR				(AGG_ACCEL_BASE + 0x00)
+#define AGG_STATUS_REG_ADDR				(AGG_ACCEL_BASE + 0x04)
+#define AGG_LENGTH_REG_ADDR				(AGG_ACCEL_BASE + 0x18)
+
+#define AUTO_DMA_BYTES					4096
+
+//index of a DMA FIFO follows the byte order of HOST_DMA_FIFO_CNT_REG
+#define DMA_FIFO_INDEX(type, direction)	((((type) == HOST_DMA_AUTO_TYPE) ? 2 : 0) + (direction))
+
+typedef struct _SIM_CMD_SLOT
+{
+	unsigned int cmdDword[16];
+	unsigned int qID;
+	unsigned int busy;
+	unsigned int autoDmaCnt;		//retired auto DMAs that count towards auto completion
+} SIM_CMD_SLOT;
+
+typedef struct _SIM_DMA_ENTRY
+{
+	unsigned long long doneTime;
+	unsigned short cmdSlotTag;
+	unsigned short autoCompletion;
+} SIM_DMA_ENTRY;
+
+typedef struct _SIM_DMA_FIFO
+{
+	SIM_DMA_ENTRY entry[SIM_DMA_FIFO_DEPTH];
+	unsigned char head;
+	unsigned char tail;
+} SIM_DMA_FIFO;
+
+typedef struct _SIM_HW_CONTEXT
+{
+	SIM_HW_CONFIG config;
+	SIM_HW_STATS stats;
+
+	unsigned int irqMask;
+	unsigned int irqStatus;
+	NVME_STATUS_REG nvmeReg;
+	unsigned int adminQueueSet;
+	unsigned int ioSqSet[MAX_NUM_OF_IO_SQ][2];
+	unsigned int ioCqSet[MAX_NUM_OF_IO_CQ][2];
+
+	SIM_CMD_SLOT slot[SIM_CMD_SLOTS];
+	unsigned short freeSlot[SIM_CMD_SLOTS];
+	unsigned int freeSlotCnt;
+	unsigned short cmdFifo[SIM_CMD_SLOTS];
+	unsigned int cmdFifoHead;
+	unsigned int cmdFifoCnt;
+	unsigned char cmdSeqNum;
+
+	NVME_CPL_FIFO_REG cplReg;
+	HOST_DMA_CMD_FIFO_REG dmaReg;
+	SIM_DMA_FIFO dmaFifo[4];
+	unsigned long long dmaBusyUntil[2];		//per direction
+
+	unsigned int aggLength;
+	unsigned long long aggDoneTime;
+} SIM_HW_CONTEXT;
+
+static SIM_HW_CONTEXT simHw;
+
+unsigned long long sim_now()
+{
+	XTime now;
+
+	XTime_GetTime(&now);
+
+	return now;
+}
+
+static void raise_irq(unsigned int irqBits)
+{
+	simHw.irqStatus |= irqBits;
+	if(simHw.irqStatus & simHw.irqMask)
+		dev_irq_handler();
+}
+
+static void release_slot(unsigned int cmdSlotTag)
+{
+	ASSERT(simHw.slot[cmdSlotTag].busy);
+
+	simHw.slot[cmdSlotTag].busy = 0;
+	simHw.freeSlot[simHw.freeSlotCnt++] = cmdSlotTag;
+}
+
+static void complete_slot(unsigned int cmdSlotTag, unsigned int specific, unsigned int statusFieldWord)
+{
+	SIM_CMD_SLOT *slot;
+
+	slot = &simHw.slot[cmdSlotTag];
+	ASSERT(slot->busy);
+
+	sim_host_complete(slot->qID, slot->cmdDword[0] >> 16, specific, statusFieldWord);
+	release_slot(cmdSlotTag);
+}
+
+//the IP completes a command once all of its NLB + 1 blocks have been transferred
+static void retire_auto_dma(unsigned int cmdSlotTag)
+{
+	SIM_CMD_SLOT *slot;
+
+	slot = &simHw.slot[cmdSlotTag];
+	ASSERT(slot->busy);
+
+	slot->autoDmaCnt++;
+	if(slot->autoDmaCnt == (slot->cmdDword[12] & 0xFFFF) + 1)
+		complete_slot(cmdSlotTag, 0, 0);
+}
+
+static void retire_dma(unsigned long long now)
+{
+	SIM_DMA_FIFO *fifo;
+	unsigned int fifoIdx;
+
+	for(fifoIdx = 0; fifoIdx < 4; fifoIdx++)
+	{
+		fifo = &simHw.dmaFifo[fifoIdx];
+		while(fifo->head != fifo->tail && fifo->entry[fifo->head].doneTime <= now)
+		{
+			if(fifo->entry[fifo->head].autoCompletion)
+				retire_auto_dma(fifo->entry[fifo->head].cmdSlotTag);
+			fifo->head++;
+		}
+	}
+}
+
+static unsigned long long dma_done_time(unsigned int direction, unsigned int len)
+{
+	unsigned long long start, now;
+
+	now = sim_now();
+	start = (simHw.dmaBusyUntil[direction] > now) ? simHw.dmaBusyUntil[direction] : now;
+	if(simHw.config.dmaMBps)
+		start += (unsigned long long)len * 1000 / simHw.config.dmaMBps;
+	simHw.dmaBusyUntil[direction] = start;
+
+	return start + simHw.config.dmaLatencyNs;
+}
+
+static void issue_dma()
+{
+	HOST_DMA_CMD_FIFO_REG *dmaReg;
+	SIM_DMA_FIFO *fifo;
+	SIM_DMA_ENTRY *entry;
+	unsigned long long devAddr, hostAddr;
+	unsigned int len, autoCompletion;
+
+	dmaReg = &simHw.dmaReg;
+	devAddr = ((unsigned long long)dmaReg->devAddrH << 32) | dmaReg->devAddrL;
+	if(dmaReg->dmaType == HOST_DMA_AUTO_TYPE)
+	{
+		SIM_CMD_SLOT *slot;
+
+		slot = &simHw.slot[dmaReg->cmdSlotTag];
+		ASSERT(slot->busy);
+
+		hostAddr = (((unsigned long long)slot->cmdDword[7] << 32) | slot->cmdDword[6]) + (unsigned long long)dmaReg->cmd4KBOffset * AUTO_DMA_BYTES;
+		len = AUTO_DMA_BYTES;
+		autoCompletion = dmaReg->autoCompletion;
+	}
+	else
+	{
+		hostAddr = ((unsigned long long)dmaReg->pcieAddrH << 32) | dmaReg->pcieAddrL;
+		len = dmaReg->dmaLen;
+		autoCompletion = 0;
+	}
+
+	if(dmaReg->dmaDirection == HOST_DMA_TX_DIRECTION)
+	{
+		memcpy((void *)(unsigned long)hostAddr, (void *)(unsigned long)devAddr, len);
+		simHw.stats.txBytes += len;
+	}
+	else
+	{
+		memcpy((void *)(unsigned long)devAddr, (void *)(unsigned long)hostAddr, len);
+		simHw.stats.rxBytes += len;
+	}
+
+	fifo = &simHw.dmaFifo[DMA_FIFO_INDEX(dmaReg->dmaType, dmaReg->dmaDirection)];
+	ASSERT((unsigned char)(fifo->tail + 1) != fifo->head);
+
+	entry = &fifo->entry[fifo->tail];
+	entry->doneTime = dma_done_time(dmaReg->dmaDirection, len);
+	entry->cmdSlotTag = dmaReg->cmdSlotTag;
+	entry->autoCompletion = autoCompletion;
+	fifo->tail++;
+}
+
+static void post_cpl()
+{
+	NVME_CPL_FIFO_REG *cplReg;
+	unsigned int cmdSlotTag;
+
+	cplReg = &simHw.cplReg;
+	if(cplReg->cplType == AUTO_CPL_TYPE)
+		complete_slot(cplReg->cmdSlotTag, cplReg->specific, cplReg->statusFieldWord);
+	else if(cplReg->cplType == CMD_SLOT_RELEASE_TYPE)
+		release_slot(cplReg->cmdSlotTag);
+	else
+	{
+		//the slot of the command is released with its completion
+		for(cmdSlotTag = 0; cmdSlotTag < SIM_CMD_SLOTS; cmdSlotTag++)
+			if(simHw.slot[cmdSlotTag].busy && simHw.slot[cmdSlotTag].qID == cplReg->sqId
+				&& (simHw.slot[cmdSlotTag].cmdDword[0] >> 16) == cplReg->cid)
+			{
+				release_slot(cmdSlotTag);
+				break;
+			}
+
+		sim_host_complete(cplReg->sqId, cplReg->cid, cplReg->specific, cplReg->statusFieldWord);
+	}
+}
+
+static unsigned int fetch_cmd()
+{
+	NVME_CMD_FIFO_REG nvmeReg;
+	unsigned int cmdSlotTag;
+
+	//the firmware polls the command FIFO from its main loop, the host runs alongside it
+	retire_dma(sim_now());
+	sim_host_poll();
+
+	nvmeReg.dword = 0;
+	if(simHw.cmdFifoCnt == 0)
+		return nvmeReg.dword;
+
+	cmdSlotTag = simHw.cmdFifo[simHw.cmdFifoHead];
+	simHw.cmdFifoHead = (simHw.cmdFifoHead + 1) % SIM_CMD_SLOTS;
+	simHw.cmdFifoCnt--;
+
+	nvmeReg.qID = simHw.slot[cmdSlotTag].qID;
+	nvmeReg.cmdSlotTag = cmdSlotTag;
+	nvmeReg.cmdSeqNum = simHw.cmdSeqNum++;
+	nvmeReg.cmdValid = 1;
+
+	return nvmeReg.dword;
+}
+
+static unsigned int read_host_ip(unsigned long addr)
+{
+	switch(addr)
+	{
+		case DEV_IRQ_MASK_REG_ADDR:
+			return simHw.irqMask;
+		case DEV_IRQ_STATUS_REG_ADDR:
+			return simHw.irqStatus;
+		case PCIE_STATUS_REG_ADDR:
+		{
+			PCIE_STATUS_REG pcieReg;
+
+			pcieReg.dword = 0;
+			pcieReg.pcieLinkUp = 1;
+			return pcieReg.dword;
+		}
+		case PCIE_FUNC_REG_ADDR:
+		{
+			PCIE_FUNC_REG pcieReg;
+
+			pcieReg.dword = 0;
+			pcieReg.busMaster = 1;
+			pcieReg.msixEnable = 1;
+			return pcieReg.dword;
+		}
+		case NVME_STATUS_REG_ADDR:
+			return simHw.nvmeReg.dword;
+		case HOST_DMA_FIFO_CNT_REG_ADDR:
+		{
+			HOST_DMA_FIFO_CNT_REG dmaReg;
+
+			retire_dma(sim_now());
+			dmaReg.directDmaRx = simHw.dmaFifo[0].head;
+			dmaReg.directDmaTx = simHw.dmaFifo[1].head;
+			dmaReg.autoDmaRx = simHw.dmaFifo[2].head;
+			dmaReg.autoDmaTx = simHw.dmaFifo[3].head;
+			return dmaReg.dword;
+		}
+		case NVME_ADMIN_QUEUE_SET_REG_ADDR:
+			return simHw.adminQueueSet;
+		case NVME_CMD_FIFO_REG_ADDR:
+			return fetch_cmd();
+	}
+
+	if(addr >= NVME_IO_SQ_SET_REG_ADDR && addr < NVME_IO_SQ_SET_REG_ADDR + MAX_NUM_OF_IO_SQ * 8)
+		return simHw.ioSqSet[(addr - NVME_IO_SQ_SET_REG_ADDR) / 8][(addr / 4) % 2];
+	if(addr >= NVME_IO_CQ_SET_REG_ADDR && addr < NVME_IO_CQ_SET_REG_ADDR + MAX_NUM_OF_IO_CQ * 8)
+		return simHw.ioCqSet[(addr - NVME_IO_CQ_SET_REG_ADDR) / 8][(addr / 4) % 2];
+	if(addr >= NVME_CMD_SRAM_ADDR)
+		return simHw.slot[(addr - NVME_CMD_SRAM_ADDR) / 64].cmdDword[((addr - NVME_CMD_SRAM_ADDR) % 64) / 4];
+
+	return 0;
+}
+
+static void write_host_ip(unsigned long addr, unsigned int val)
+{
+	switch(addr)
+	{
+		case DEV_IRQ_MASK_REG_ADDR:
+			simHw.irqMask = val;
+			return;
+		case DEV_IRQ_CLEAR_REG_ADDR:
+			simHw.irqStatus &= ~val;
+			return;
+		case NVME_STATUS_REG_ADDR:
+		{
+			NVME_STATUS_REG nvmeReg;
+			unsigned int shst;
+
+			//CC belongs to the host, the firmware only reports CSTS
+			nvmeReg.dword = val;
+			shst = simHw.nvmeReg.cstsShst;
+			simHw.nvmeReg.cstsRdy = nvmeReg.cstsRdy;
+			simHw.nvmeReg.cstsShst = nvmeReg.cstsShst;
+			if(shst != 2 && nvmeReg.cstsShst == 2)
+				sim_host_shutdown_done();
+			return;
+		}
+		case NVME_ADMIN_QUEUE_SET_REG_ADDR:
+			simHw.adminQueueSet = val;
+			return;
+		case NVME_CPL_FIFO_REG_ADDR:
+		case NVME_CPL_FIFO_REG_ADDR + 4:
+			simHw.cplReg.dword[(addr - NVME_CPL_FIFO_REG_ADDR) / 4] = val;
+			return;
+		case NVME_CPL_FIFO_REG_ADDR + 8:
+			simHw.cplReg.dword[2] = val;
+			post_cpl();
+			return;
+		case HOST_DMA_CMD_FIFO_REG_ADDR:
+		case HOST_DMA_CMD_FIFO_REG_ADDR + 4:
+		case HOST_DMA_CMD_FIFO_REG_ADDR + 8:
+		case HOST_DMA_CMD_FIFO_REG_ADDR + 12:
+		case HOST_DMA_CMD_FIFO_REG_ADDR + 16:
+			simHw.dmaReg.dword[(addr - HOST_DMA_CMD_FIFO_REG_ADDR) / 4] = val;
+			return;
+		case HOST_DMA_CMD_FIFO_REG_ADDR + 20:
+			simHw.dmaReg.dword[5] = val;
+			issue_dma();
+			return;
+	}
+
+	if(addr >= NVME_IO_SQ_SET_REG_ADDR && addr < NVME_IO_SQ_SET_REG_ADDR + MAX_NUM_OF_IO_SQ * 8)
+		simHw.ioSqSet[(addr - NVME_IO_SQ_SET_REG_ADDR) / 8][(addr / 4) % 2] = val;
+	else if(addr >= NVME_IO_CQ_SET_REG_ADDR && addr < NVME_IO_CQ_SET_REG_ADDR + MAX_NUM_OF_IO_CQ * 8)
+		simHw.ioCqSet[(addr - NVME_IO_CQ_SET_REG_ADDR) / 8][(addr / 4) % 2] = val;
+}
+
+static unsigned int read_agg_accel(unsigned long addr)
+{
+	if(addr == AGG_STATUS_REG_ADDR)
+		return (sim_now() >= simHw.aggDoneTime) ? 0x1 : 0x0;
+
+	return 0;
+}
+
+static void write_agg_accel(unsigned long addr, unsigned int val)
+{
+	unsigned long long now, busy;
+
+	if(addr == AGG_LENGTH_REG_ADDR)
+		simHw.aggLength = val;
+	else if(addr == AGG_CTRL_REG_ADDR && (val & 0x1))
+	{
+		now = sim_now();
+		busy = simHw.config.aggMBps ? (unsigned long long)simHw.aggLength * 1000 / simHw.config.aggMBps : 0;
+		simHw.aggDoneTime = now + busy;
+		simHw.stats.aggBytes += simHw.aggLength;
+		simHw.stats.aggBusyNs += busy;
+	}
+}
+
+unsigned int sim_io_read32(unsigned long addr)
+{
+	if(addr - HOST_IP_ADDR < HOST_IP_SPAN)
+		return read_host_ip(addr);
+	if(addr - AGG_ACCEL_BASE < AGG_ACCEL_SPAN)
+		return read_agg_accel(addr);
+
+	return *(volatile unsigned int *)addr;
+}
+
+void sim_io_write32(unsigned long addr, unsigned int val)
+{
+	if(addr - HOST_IP_ADDR < HOST_IP_SPAN)
+		write_host_ip(addr, val);
+	else if(addr - AGG_ACCEL_BASE < AGG_ACCEL_SPAN)
+		write_agg_accel(addr, val);
+	else
+		*(volatile unsigned int *)addr = val;
+}
+
+void sim_hw_init(SIM_HW_CONFIG *config)
+{
+	unsigned int cmdSlotTag;
+
+	memset(&simHw, 0, sizeof(simHw));
+	simHw.config = *config;
+
+	for(cmdSlotTag = 0; cmdSlotTag < SIM_CMD_SLOTS; cmdSlotTag++)
+		simHw.freeSlot[cmdSlotTag] = SIM_CMD_SLOTS - 1 - cmdSlotTag;
+	simHw.freeSlotCnt = SIM_CMD_SLOTS;
+}
+
+void sim_hw_set_cc(unsigned int ccEn, unsigned int ccShn)
+{
+	DEV_IRQ_REG devReg;
+
+	devReg.dword = 0;
+	devReg.nvmeCcEn = (simHw.nvmeReg.ccEn != ccEn);
+	devReg.nvmeCcShn = (simHw.nvmeReg.ccShn != ccShn);
+
+	simHw.nvmeReg.ccEn = ccEn;
+	simHw.nvmeReg.ccShn = ccShn;
+	raise_irq(devReg.dword);
+}
+
+unsigned int sim_hw_csts_rdy()
+{
+	return simHw.nvmeReg.cstsRdy;
+}
+
+unsigned int sim_hw_submit(unsigned int qID, const unsigned int *cmdDword)
+{
+	SIM_CMD_SLOT *slot;
+	unsigned int cmdSlotTag;
+
+	if(simHw.freeSlotCnt == 0)
+		return 0;
+
+	cmdSlotTag = simHw.freeSlot[--simHw.freeSlotCnt];
+	slot = &simHw.slot[cmdSlotTag];
+	memcpy(slot->cmdDword, cmdDword, sizeof(slot->cmdDword));
+	slot->qID = qID;
+	slot->busy = 1;
+	slot->autoDmaCnt = 0;
+
+	simHw.cmdFifo[(simHw.cmdFifoHead + simHw.cmdFifoCnt) % SIM_CMD_SLOTS] = cmdSlotTag;
+	simHw.cmdFifoCnt++;
+
+	return 1;
+}
+
+void sim_hw_get_stats(SIM_HW_STATS *stats)
+{
+	*stats = simHw.stats;
+}
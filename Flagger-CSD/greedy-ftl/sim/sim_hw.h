@@ -0,0 +1,83 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_hw.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Hardware Model
+// File Name: sim_hw.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the model of the NVMe IP, its host DMA engines and the aggregation accelerator
+//   - declares the host side interface of the model
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIM_HW_H_
+#define SIM_HW_H_
+
+#define SIM_CMD_SLOTS					256		//cmd4KBOffset of an auto DMA stays below 256
+#define SIM_DMA_FIFO_DEPTH				256		//head and tail counters are 8 bits wide
+
+typedef struct _SIM_HW_CONFIG
+{
+	unsigned int dmaMBps;				//per direction, 0 completes a DMA when it is issued
+	unsigned int dmaLatencyNs;			//added to every DMA
+	unsigned int aggMBps;				//aggregation accelerator, 0 completes a job when it is started
+} SIM_HW_CONFIG;
+
+typedef struct _SIM_HW_STATS
+{
+	unsigned long long rxBytes;			//host to device
+	unsigned long long txBytes;			//device to host
+	unsigned long long aggBytes;
+	unsigned long long aggBusyNs;
+} SIM_HW_STATS;
+
+unsigned long long sim_now();
+
+void sim_hw_init(SIM_HW_CONFIG *config);
+
+//host side of the controller registers, a change of CC.EN or CC.SHN raises the matching interrupt
+void sim_hw_set_cc(unsigned int ccEn, unsigned int ccShn);
+
+unsigned int sim_hw_csts_rdy();
+
+//takes a free command slot and queues the command in the command FIFO, returns 0 if no slot is free
+unsigned int sim_hw_submit(unsigned int qID, const unsigned int *cmdDword);
+
+void sim_hw_get_stats(SIM_HW_STATS *stats);
+
+//implemented by the host model
+void sim_host_poll();
+
+void sim_host_complete(unsigned int sqId, unsigned int cid, unsigned int specific, unsigned int statusFieldWord);
+
+void sim_host_shutdown_done();
+
+#endif /* SIM_HW_H_ */
@@ -0,0 +1,48 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_io.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Register Access Hooks
+// File Name: sim_io.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the functions that IO_READ32/IO_WRITE32 and Xil_In32/Xil_Out32 expand to in the simulation build
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SIM_IO_H_
+#define SIM_IO_H_
+
+//accesses to the NVMe IP and the aggregation accelerator go to the hardware model, the rest to memory
+unsigned int sim_io_read32(unsigned long addr);
+
+void sim_io_write32(unsigned long addr, unsigned int val);
+
+#endif /* SIM_IO_H_ */
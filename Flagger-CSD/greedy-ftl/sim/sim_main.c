@@ -0,0 +1,153 @@
+//////////////////////////////////////////////////////////////////////////////////
+// sim_main.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Simulator Main
+// File Name: sim_main.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - maps the DRAM and DDR4 address ranges of the board at their physical addresses
+//   - takes the place of main.c: connects the hardware model instead of the MMU and the GIC and runs nvme_main()
+//   - the run ends when the host has shut the controller down
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#define _GNU_SOURCE
+#include "stdio.h"
+#include "stdlib.h"
+#include "unistd.h"
+#include "sys/mman.h"
+
+#include "xparameters.h"
+#include "memory_map.h"
+#include "ftl_config.h"
+#include "nvme/nvme.h"
+#include "nvme/nvme_main.h"
+#include "nvme/host_lld.h"
+
+#include "sim_hw.h"
+#include "sim_host.h"
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"  -n <cmds>       commands to complete (100000)\n"
+		"  -q <queues>     IO queues (1)\n"
+		"  -d <depth>      outstanding commands per queue, at most 255 (32)\n"
+		"  -b <blocks>     4KB blocks per command (1)\n"
+		"  -s <actid>      first ACTID of the workload (0)\n"
+		"  -r <blocks>     ACTID range of the workload (65536)\n"
+		"  -w <percent>    share of writes (50)\n"
+		"  -a <percent>    share of dense Aggregate Start commands, the rest are reads (0)\n"
+		"  -B <MB/s>       host DMA bandwidth per direction, 0 is unlimited (0)\n"
+		"  -L <ns>         host DMA latency (0)\n"
+		"  -G <MB/s>       aggregation accelerator throughput, 0 is unlimited (0)\n"
+		"  -S <seed>       workload seed (1)\n"
+		"  -c              run the host checks instead of the workload\n"
+		"  -m              with -c, only read back the FTL data the last check run left in the flash image\n",
+		prog);
+	exit(1);
+}
+
+static void map_region(unsigned long long base, unsigned long long size)
+{
+	void *addr;
+
+	//pages are only backed once the firmware touches them
+	addr = mmap((void *)(unsigned long)base, size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED_NOREPLACE, -1, 0);
+	if(addr != (void *)(unsigned long)base)
+	{
+		fprintf(stderr, "cannot map 0x%llX bytes at 0x%llX, the simulator has to be built as PIE\n", size, base);
+		exit(1);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	SIM_HW_CONFIG hwConfig = {0, 0, 0};
+	SIM_HOST_CONFIG hostConfig = {100000, 1, 32, 1, 0, 65536, {50, 50, 0}, 1, 0, 0};
+	int opt;
+
+	while((opt = getopt(argc, argv, "n:q:d:b:s:r:w:a:B:L:G:S:cm")) != -1)
+	{
+		switch(opt)
+		{
+			case 'n': hostConfig.numOfCmds = strtoul(optarg, NULL, 0); break;
+			case 'q': hostConfig.numOfQueues = strtoul(optarg, NULL, 0); break;
+			case 'd': hostConfig.queueDepth = strtoul(optarg, NULL, 0); break;
+			case 'b': hostConfig.blocksPerCmd = strtoul(optarg, NULL, 0); break;
+			case 's': hostConfig.startACTID = strtoul(optarg, NULL, 0); break;
+			case 'r': hostConfig.rangeBlocks = strtoul(optarg, NULL, 0); break;
+			case 'w': hostConfig.opPercent[SIM_OP_WRITE] = strtoul(optarg, NULL, 0); break;
+			case 'a': hostConfig.opPercent[SIM_OP_AGGREGATE] = strtoul(optarg, NULL, 0); break;
+			case 'B': hwConfig.dmaMBps = strtoul(optarg, NULL, 0); break;
+			case 'L': hwConfig.dmaLatencyNs = strtoul(optarg, NULL, 0); break;
+			case 'G': hwConfig.aggMBps = strtoul(optarg, NULL, 0); break;
+			case 'S': hostConfig.seed = strtoul(optarg, NULL, 0); break;
+			case 'c': hostConfig.checkMode = 1; break;
+			case 'm': hostConfig.remount = 1; break;
+			default: usage(argv[0]);
+		}
+	}
+
+	if(hostConfig.opPercent[SIM_OP_WRITE] + hostConfig.opPercent[SIM_OP_AGGREGATE] > 100 || (hostConfig.remount && !hostConfig.checkMode))
+		usage(argv[0]);
+	hostConfig.opPercent[SIM_OP_READ] = 100 - hostConfig.opPercent[SIM_OP_WRITE] - hostConfig.opPercent[SIM_OP_AGGREGATE];
+
+	if(hostConfig.numOfCmds == 0 || hostConfig.numOfQueues == 0 || hostConfig.numOfQueues > MAX_NUM_OF_IO_SQ
+		|| hostConfig.queueDepth == 0 || hostConfig.queueDepth > 255
+		|| hostConfig.blocksPerCmd == 0 || hostConfig.blocksPerCmd > 256 || hostConfig.rangeBlocks < hostConfig.blocksPerCmd)
+		usage(argv[0]);
+
+	//the accelerator only reaches the hot region
+	if(hostConfig.opPercent[SIM_OP_AGGREGATE] && (unsigned long long)hostConfig.startACTID + hostConfig.rangeBlocks > HOT_REGION_PAGES)
+	{
+		fprintf(stderr, "aggregation needs the workload inside the hot region (%u blocks)\n", (unsigned int)HOT_REGION_PAGES);
+		exit(1);
+	}
+
+	//keep the firmware log in front of an ASSERT abort
+	setvbuf(stdout, NULL, _IOLBF, 0);
+
+	map_region(DRAM_START_ADDR, (unsigned long long)DRAM_END_ADDR + 1 - DRAM_START_ADDR);
+	map_region(DDR4_BUFFER_BASE_ADDR, DDR4_SIZE);
+
+	sim_hw_init(&hwConfig);
+	sim_host_init(&hostConfig);
+
+	dev_irq_init();
+	sim_host_power_on();
+
+	nvme_main();
+
+	return 0;
+}
@@ -0,0 +1,258 @@
+//////////////////////////////////////////////////////////////////////////////////
+// test_arbiter.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Command Arbiter Test
+// File Name: test_arbiter.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - runs nvme_arbiter.c on its own, commands are pushed and popped directly
+//   - checks the weighted round robin of the Arbitration feature and its burst,
+//     that urgent queues go first and that the aggregation lane is bounded by the
+//     weight of the class it is placed in
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "string.h"
+
+#include "nvme/nvme.h"
+#include "nvme/nvme_arbiter.h"
+
+#define TEST_ROUNDS						10
+
+static unsigned int nextSlot;
+static unsigned int failCnt;
+
+static void check(const char *name, unsigned int cond)
+{
+	if(!cond)
+		failCnt++;
+	printf("check %-48s %s\n", name, cond ? "ok" : "FAILED");
+}
+
+static unsigned int arbitration(unsigned int burst, unsigned int hpw, unsigned int mpw, unsigned int lpw)
+{
+	ADMIN_SET_FEATURES_ARBITRATION_DW11 arbInfo;
+
+	arbInfo.dword = 0;
+	arbInfo.AB = burst;
+	arbInfo.HPW = hpw - 1;//non zero-based -> zero-based
+	arbInfo.MPW = mpw - 1;
+	arbInfo.LPW = lpw - 1;
+
+	return arbInfo.dword;
+}
+
+static void setup(unsigned int dword11)
+{
+	arb_init();
+	arb_set_arbitration(dword11);
+	nextSlot = 0;
+}
+
+static void push(unsigned int qID, unsigned int opc, unsigned int cnt)
+{
+	NVME_COMMAND nvmeCmd;
+
+	memset(&nvmeCmd, 0, sizeof(NVME_COMMAND));
+	nvmeCmd.qID = qID;
+	nvmeCmd.cmdDword[0] = opc;
+	while(cnt--)
+	{
+		nvmeCmd.cmdSlotTag = nextSlot++ % ARB_MAX_NUM_OF_CMD;
+		arb_push(&nvmeCmd);
+	}
+}
+
+//pops cnt commands, served[] counts them per qID, aggregates under qID 0
+static unsigned int pop(unsigned int cnt, unsigned int *served, unsigned int numOfQueue)
+{
+	NVME_COMMAND nvmeCmd;
+	unsigned int opc;
+
+	memset(served, 0, sizeof(unsigned int) * numOfQueue);
+	while(cnt--)
+	{
+		if(!arb_pop(&nvmeCmd))
+			return 0;
+
+		opc = nvmeCmd.cmdDword[0] & 0xFF;
+		if(opc == IO_NVM_AGGREGATE_START || opc == IO_NVM_AGGREGATE_DONE)
+			served[0]++;
+		else
+			served[nvmeCmd.qID]++;
+
+		//the host keeps the lane busy with a new round
+		if(opc == IO_NVM_AGGREGATE_START)
+			push(nvmeCmd.qID, IO_NVM_AGGREGATE_START, 1);
+	}
+
+	return 1;
+}
+
+static void test_weights()
+{
+	unsigned int served[4];
+	unsigned int round;
+	unsigned int match;
+
+	//queue 1 high, 2 medium, 3 low, one round is 4 + 2 + 1 commands
+	setup(arbitration(0, 4, 2, 1));
+	arb_set_sq_class(1, ARB_CLASS_HIGH);
+	arb_set_sq_class(2, ARB_CLASS_MEDIUM);
+	arb_set_sq_class(3, ARB_CLASS_LOW);
+	push(1, IO_NVM_READ, 100);
+	push(2, IO_NVM_READ, 100);
+	push(3, IO_NVM_READ, 100);
+
+	match = 1;
+	for(round = 0; round < TEST_ROUNDS; round++)
+		match &= pop(7, served, 4) && served[1] == 4 && served[2] == 2 && served[3] == 1;
+	check("every round follows the class weights", match);
+
+	check("high queue drains at its weight", pop(105, served, 4) && served[1] == 60 && served[2] == 30 && served[3] == 15);
+
+	//rounds without the high queue are 2 + 1 commands
+	match = 1;
+	for(round = 0; round < TEST_ROUNDS; round++)
+		match &= pop(3, served, 4) && served[2] == 2 && served[3] == 1;
+	check("empty class gives up its turns", match);
+	check("pending count drains with the queues", arb_pending_count() == 300 - 70 - 105 - 30);
+}
+
+static void test_urgent()
+{
+	unsigned int served[5];
+
+	setup(arbitration(0, 4, 2, 1));
+	arb_set_sq_class(1, ARB_CLASS_HIGH);
+	arb_set_sq_class(4, ARB_CLASS_URGENT);
+	push(1, IO_NVM_READ, 10);
+	pop(2, served, 5);
+	push(4, IO_NVM_READ, 3);
+	check("urgent queue goes ahead of the weighted classes", pop(3, served, 5) && served[4] == 3);
+	check("weighted classes resume after it", pop(8, served, 5) && served[1] == 8 && arb_pending_count() == 0);
+}
+
+static void test_burst()
+{
+	NVME_COMMAND nvmeCmd;
+	unsigned int first;
+	unsigned int idx;
+	unsigned int match;
+
+	//two queues of one class take turns of four commands
+	setup(arbitration(2, 1, 1, 1));
+	push(1, IO_NVM_READ, 16);
+	push(2, IO_NVM_READ, 16);
+
+	match = 1;
+	first = 0;
+	for(idx = 0; idx < 32; idx++)
+	{
+		match &= arb_pop(&nvmeCmd);
+		if(idx == 0)
+			first = nvmeCmd.qID;
+		match &= (nvmeCmd.qID == first) == ((idx / 4) % 2 == 0);
+	}
+	check("burst hands the turn over every 2^AB commands", match);
+}
+
+static void test_agg_lane()
+{
+	unsigned int served[4];
+	unsigned int round;
+	unsigned int match;
+
+	//the lane takes the turns of the medium class, ahead of the medium queue
+	setup(arbitration(0, 4, 2, 1));
+	arb_set_sq_class(1, ARB_CLASS_HIGH);
+	arb_set_sq_class(2, ARB_CLASS_MEDIUM);
+	arb_set_sq_class(3, ARB_CLASS_LOW);
+	check("medium is a valid aggregation class", arb_set_agg_class(ARB_CLASS_MEDIUM));
+	push(2, IO_NVM_READ, 20);
+	push(2, IO_NVM_AGGREGATE_START, 4);
+	push(1, IO_NVM_READ, 100);
+	push(3, IO_NVM_READ, 100);
+
+	match = 1;
+	for(round = 0; round < TEST_ROUNDS; round++)
+		match &= pop(7, served, 4) && served[0] == 2 && served[1] == 4 && served[2] == 0 && served[3] == 1;
+	check("busy lane is bounded by the medium weight", match);
+
+	//handing the lane back puts the aggregates behind the reads of their queue
+	check("inherit is a valid aggregation class", arb_set_agg_class(ARB_AGG_CLASS_INHERIT));
+	check("aggregates are kept when the lane is handed back", arb_sq_pending_count(2) == 24);
+	match = 1;
+	for(round = 0; round < TEST_ROUNDS; round++)
+		match &= pop(7, served, 4) && served[0] == 0 && served[2] == 2;
+	check("medium queue is served once the lane is gone", match);
+
+	//by default the lane goes ahead of every weighted class
+	setup(arbitration(0, 4, 2, 1));
+	arb_set_sq_class(1, ARB_CLASS_HIGH);
+	push(1, IO_NVM_READ, 4);
+	push(1, IO_NVM_AGGREGATE_DONE, 2);
+	check("urgent lane goes ahead of the high queue", pop(2, served, 4) && served[0] == 2 && arb_sq_pending_count(1) == 4);
+}
+
+static void test_agg_class()
+{
+	unsigned int aggClass;
+	unsigned int rejected;
+
+	setup(arbitration(0, 1, 1, 1));
+	arb_set_agg_class(ARB_CLASS_HIGH);
+
+	rejected = 1;
+	for(aggClass = ARB_CLASS_LOW + 1; aggClass < ARB_AGG_CLASS_INHERIT; aggClass++)
+		rejected &= !arb_set_agg_class(aggClass);
+	check("classes above low are rejected", rejected);
+	check("rejected class leaves the lane alone", arb_get_agg_class() == ARB_CLASS_HIGH);
+
+	rejected = 0;
+	for(aggClass = ARB_CLASS_URGENT; aggClass <= ARB_CLASS_LOW; aggClass++)
+		rejected |= !arb_set_agg_class(aggClass) || arb_get_agg_class() != aggClass;
+	check("urgent to low are accepted", !rejected);
+}
+
+int main()
+{
+	test_weights();
+	test_urgent();
+	test_burst();
+	test_agg_lane();
+	test_agg_class();
+
+	printf("\n%u check(s) failed\n", failCnt);
+
+	return failCnt ? 1 : 0;
+}
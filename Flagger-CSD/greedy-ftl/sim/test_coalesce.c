@@ -0,0 +1,246 @@
+//////////////////////////////////////////////////////////////////////////////////
+// test_coalesce.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware Simulator
+// Module Name: Interrupt Coalescing Test
+// File Name: test_coalesce.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - runs nvme_coalesce.c against a host_lld that records the CQ register writes
+//   - the auto DMA FIFO is a counter, a test completes its DMAs explicitly
+//   - checks that a command counts once its completion is posted, not once it is handled,
+//     that the threshold and the aggregation time fire, and that irqEn is restored
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdio.h"
+#include "string.h"
+#include "time.h"
+
+#include "nvme/nvme.h"
+#include "nvme/host_lld.h"
+#include "nvme/nvme_coalesce.h"
+
+#define TEST_TIME_UNITS					20		//aggregation time, 2ms
+
+typedef struct _TEST_CQ_REG
+{
+	unsigned int writeCnt;
+	unsigned int valid;
+	unsigned int irqEn;
+	unsigned int irqVector;
+	unsigned int qSize;
+	unsigned int pcieBaseAddrL;
+	unsigned int pcieBaseAddrH;
+} TEST_CQ_REG;
+
+NVME_CONTEXT g_nvmeTask;
+
+static TEST_CQ_REG cqReg[MAX_NUM_OF_IO_CQ];
+static unsigned int dmaIssued;				//auto DMAs in the FIFO, both directions
+static unsigned int dmaDone;
+static unsigned int failCnt;
+
+void set_io_cq(unsigned int ioCqIdx, unsigned int valid, unsigned int irqEn, unsigned int irqVector, unsigned int qSzie, unsigned int pcieBaseAddrL, unsigned int pcieBaseAddrH)
+{
+	TEST_CQ_REG *reg;
+
+	reg = &cqReg[ioCqIdx];
+	reg->writeCnt++;
+	reg->valid = valid;
+	reg->irqEn = irqEn;
+	reg->irqVector = irqVector;
+	reg->qSize = qSzie;
+	reg->pcieBaseAddrL = pcieBaseAddrL;
+	reg->pcieBaseAddrH = pcieBaseAddrH;
+}
+
+void get_auto_tx_dma_mark(HOST_DMA_MARK *dmaMark)
+{
+	dmaMark->tailIndex = dmaIssued;
+	dmaMark->tailAssistIndex = 0;
+}
+
+void get_auto_rx_dma_mark(HOST_DMA_MARK *dmaMark)
+{
+	get_auto_tx_dma_mark(dmaMark);
+}
+
+unsigned int check_auto_tx_dma_partial_done(unsigned int tailIndex, unsigned int tailAssistIndex)
+{
+	return dmaDone >= tailIndex;
+}
+
+unsigned int check_auto_rx_dma_partial_done(unsigned int tailIndex, unsigned int tailAssistIndex)
+{
+	return dmaDone >= tailIndex;
+}
+
+static void check(const char *name, unsigned int cond)
+{
+	if(!cond)
+		failCnt++;
+	printf("check %-48s %s\n", name, cond ? "ok" : "FAILED");
+}
+
+static void sleep_us(unsigned int us)
+{
+	struct timespec ts;
+
+	ts.tv_sec = us / 1000000;
+	ts.tv_nsec = (us % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+}
+
+static void add_cq(unsigned int ioCqIdx, unsigned int irqEn, unsigned int irqVector)
+{
+	NVME_IO_CQ_STATUS *ioCqStatus;
+
+	ioCqStatus = &g_nvmeTask.ioCqInfo[ioCqIdx];
+	ioCqStatus->valid = 1;
+	ioCqStatus->irqEn = irqEn;
+	ioCqStatus->irqVector = irqVector;
+	ioCqStatus->qSzie = 63;
+	ioCqStatus->pcieBaseAddrL = 0x10000 * (ioCqIdx + 1);
+	ioCqStatus->pcieBaseAddrH = 0x1;
+
+	//one submission queue per completion queue
+	g_nvmeTask.ioSqInfo[ioCqIdx].valid = 1;
+	g_nvmeTask.ioSqInfo[ioCqIdx].cqVector = ioCqIdx + 1;
+}
+
+//a read handled as one auto DMA that completes it
+static void handle_cmd(unsigned int sqID)
+{
+	coalesce_hold(sqID);
+	dmaIssued++;
+	coalesce_post(sqID);
+}
+
+//the CQ register carries the configuration the host created the queue with
+static unsigned int cq_restored(unsigned int ioCqIdx)
+{
+	NVME_IO_CQ_STATUS *ioCqStatus;
+	TEST_CQ_REG *reg;
+
+	ioCqStatus = &g_nvmeTask.ioCqInfo[ioCqIdx];
+	reg = &cqReg[ioCqIdx];
+
+	return reg->irqEn == 1 && reg->valid == ioCqStatus->valid && reg->irqVector == ioCqStatus->irqVector
+		&& reg->qSize == ioCqStatus->qSzie && reg->pcieBaseAddrL == ioCqStatus->pcieBaseAddrL
+		&& reg->pcieBaseAddrH == ioCqStatus->pcieBaseAddrH;
+}
+
+static void test_threshold()
+{
+	unsigned int idx;
+
+	for(idx = 0; idx < 4; idx++)
+		handle_cmd(1);
+	coalesce_poll();
+	check("vector masked while commands are handled", cqReg[0].irqEn == 0 && (g_coalesce.pendingMask & 0x2));
+	check("handled commands are not counted", g_coalesce.vector[1].pendingCnt == 0);
+
+	dmaDone += 2;
+	coalesce_poll();
+	check("posted completions are counted", g_coalesce.vector[1].pendingCnt == 2 && cqReg[0].irqEn == 0);
+
+	dmaDone++;
+	coalesce_poll();
+	check("threshold fires the vector", !(g_coalesce.pendingMask & 0x2) && g_coalesce.vector[1].pendingCnt == 0);
+	check("threshold restores irqEn", cq_restored(0));
+}
+
+static void test_deadline()
+{
+	//the fourth command of test_threshold is still in flight
+	handle_cmd(1);
+	dmaDone++;
+	coalesce_poll();
+	check("completions below the threshold are held", g_coalesce.vector[1].pendingCnt == 1 && cqReg[0].irqEn == 0);
+
+	sleep_us(TEST_TIME_UNITS * COALESCE_TIME_UNIT_US / 4);
+	coalesce_poll();
+	check("vector held before the aggregation time", (g_coalesce.pendingMask & 0x2) && cqReg[0].irqEn == 0);
+
+	sleep_us(TEST_TIME_UNITS * COALESCE_TIME_UNIT_US * 2);
+	coalesce_poll();
+	check("aggregation time fires below the threshold", !(g_coalesce.pendingMask & 0x2));
+	check("aggregation time restores irqEn", cq_restored(0));
+
+	//the last command completes while the vector is unmasked, its interrupt is not held
+	dmaDone++;
+	coalesce_poll();
+	check("completion of an unmasked vector is not held", g_coalesce.pendingMask == 0 && g_coalesce.inflightCnt == 0);
+}
+
+static void test_vectors()
+{
+	unsigned int writeCnt;
+
+	//queue 2 shares no vector with queue 1, queue 3 was created with interrupts off
+	writeCnt = cqReg[1].writeCnt;
+	handle_cmd(1);
+	check("other vectors are left alone", cqReg[1].writeCnt == writeCnt);
+	handle_cmd(3);
+	check("queue without interrupts is not coalesced", cqReg[2].writeCnt == 0 && g_coalesce.inflightCnt == 1);
+
+	//disabling coalescing on a vector signals what it holds
+	coalesce_set_vector_config(0x10000 | 1);
+	check("coalescing disable fires the vector", !(g_coalesce.pendingMask & 0x2) && cq_restored(0));
+	handle_cmd(1);
+	check("disabled vector is not masked", cqReg[0].irqEn == 1 && g_coalesce.inflightCnt == 1);
+	coalesce_set_vector_config(1);
+
+	dmaDone = dmaIssued;
+	coalesce_poll();
+	handle_cmd(2);
+	coalesce_flush();
+	check("flush restores irqEn", cq_restored(1) && g_coalesce.pendingMask == 0);
+}
+
+int main()
+{
+	memset(&g_nvmeTask, 0, sizeof(g_nvmeTask));
+	add_cq(0, 1, 1);
+	add_cq(1, 1, 2);
+	add_cq(2, 0, 3);
+
+	coalesce_init();
+	coalesce_set_feature((TEST_TIME_UNITS << 8) | (3 - 1));
+
+	test_threshold();
+	test_deadline();
+	test_vectors();
+
+	printf("\n%u check(s) failed\n", failCnt);
+
+	return failCnt ? 1 : 0;
+}
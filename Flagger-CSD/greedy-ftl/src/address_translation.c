@@ -0,0 +1,278 @@
+//////////////////////////////////////////////////////////////////////////////////
+// address_translation.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Address Translator
+// File Name: address_translation.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - translates logical pages of the FTL tier into flash pages
+//   - allocates flash pages from a single open block and keeps the free block list
+//   - rebuilds the maps from the spare areas when an existing flash image is mounted
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+#include "xil_printf.h"
+#include "nvme/debug.h"
+
+#include "ftl_config.h"
+#include "flash_backend.h"
+#include "address_translation.h"
+#include "garbage_collection.h"
+
+P_LOGICAL_PAGE_MAP logicalPageMapPtr;
+P_PHYSICAL_PAGE_MAP physicalPageMapPtr;
+P_BLOCK_MAP blockMapPtr;
+FTL_STATUS ftlStatus;
+
+static void mount_flash_image()
+{
+	FLASH_SPARE spare[PAGES_PER_BLOCK];
+	BLOCK_ENTRY *block;
+	unsigned int pbn, page, ppn, oldPpn, lpn;
+
+	for(pbn = 0; pbn < TOTAL_BLOCKS; pbn++)
+	{
+		block = &blockMapPtr->block[pbn];
+		g_flashBackend->read_block_spare(pbn, spare);
+
+		for(page = 0; page < PAGES_PER_BLOCK; page++)
+		{
+			if(spare[page].blockSeq == 0)
+				continue;
+
+			block->seq = spare[page].blockSeq;
+			lpn = spare[page].lpn;
+			if(lpn >= USER_PAGES)
+				continue;
+
+			//pages of one block are programmed in order, so an equal sequence is a newer copy
+			ppn = pbn * PAGES_PER_BLOCK + page;
+			oldPpn = logicalPageMapPtr->ppn[lpn];
+			if(oldPpn != PAGE_NONE)
+			{
+				if(blockMapPtr->block[oldPpn / PAGES_PER_BLOCK].seq > block->seq)
+					continue;
+
+				physicalPageMapPtr->lpn[oldPpn] = PAGE_NONE;
+				blockMapPtr->block[oldPpn / PAGES_PER_BLOCK].validCnt--;
+			}
+
+			logicalPageMapPtr->ppn[lpn] = ppn;
+			physicalPageMapPtr->lpn[ppn] = lpn;
+			block->validCnt++;
+		}
+
+		if(block->seq > ftlStatus.blockSeq)
+			ftlStatus.blockSeq = block->seq;
+	}
+
+	//partially programmed blocks are not reopened, their unwritten pages count as invalid
+	for(pbn = 0; pbn < TOTAL_BLOCKS; pbn++)
+	{
+		block = &blockMapPtr->block[pbn];
+		if(block->seq == 0)
+		{
+			put_free_block(pbn);
+			continue;
+		}
+
+		block->state = BLOCK_STATE_FULL;
+		block->nextPage = PAGES_PER_BLOCK;
+		block->invalidCnt = PAGES_PER_BLOCK - block->validCnt;
+		put_victim_block(pbn);
+	}
+
+	xil_printf("[ flash image mounted, %d free blocks ]\r\n", ftlStatus.freeBlockCnt);
+}
+
+void init_address_map(unsigned int mount)
+{
+	unsigned int pbn;
+
+	logicalPageMapPtr = (P_LOGICAL_PAGE_MAP)LOGICAL_PAGE_MAP_ADDR;
+	physicalPageMapPtr = (P_PHYSICAL_PAGE_MAP)PHYSICAL_PAGE_MAP_ADDR;
+	blockMapPtr = (P_BLOCK_MAP)BLOCK_MAP_ADDR;
+
+	memset(logicalPageMapPtr, 0xFF, sizeof(LOGICAL_PAGE_MAP));
+	memset(physicalPageMapPtr, 0xFF, sizeof(PHYSICAL_PAGE_MAP));
+	memset(blockMapPtr, 0, sizeof(BLOCK_MAP));
+
+	ftlStatus.freeBlockHead = BLOCK_NONE;
+	ftlStatus.freeBlockTail = BLOCK_NONE;
+	ftlStatus.freeBlockCnt = 0;
+	ftlStatus.openBlock = BLOCK_NONE;
+	ftlStatus.blockSeq = 0;
+	ftlStatus.gcRunning = 0;
+	ftlStatus.gcVictimCnt = 0;
+
+	init_victim_block_list();
+
+	if(mount)
+	{
+		mount_flash_image();
+		return;
+	}
+
+	for(pbn = 0; pbn < TOTAL_BLOCKS; pbn++)
+	{
+		g_flashBackend->erase_block(pbn);
+		put_free_block(pbn);
+	}
+}
+
+void put_free_block(unsigned int pbn)
+{
+	BLOCK_ENTRY *block;
+
+	block = &blockMapPtr->block[pbn];
+	block->seq = 0;
+	block->validCnt = 0;
+	block->invalidCnt = 0;
+	block->nextPage = 0;
+	block->state = BLOCK_STATE_FREE;
+	block->prevBlock = ftlStatus.freeBlockTail;
+	block->nextBlock = BLOCK_NONE;
+
+	if(ftlStatus.freeBlockTail == BLOCK_NONE)
+		ftlStatus.freeBlockHead = pbn;
+	else
+		blockMapPtr->block[ftlStatus.freeBlockTail].nextBlock = pbn;
+	ftlStatus.freeBlockTail = pbn;
+	ftlStatus.freeBlockCnt++;
+}
+
+static unsigned int get_free_block()
+{
+	unsigned int pbn;
+
+	pbn = ftlStatus.freeBlockHead;
+	ASSERT(pbn != BLOCK_NONE);
+
+	ftlStatus.freeBlockHead = blockMapPtr->block[pbn].nextBlock;
+	if(ftlStatus.freeBlockHead == BLOCK_NONE)
+		ftlStatus.freeBlockTail = BLOCK_NONE;
+	else
+		blockMapPtr->block[ftlStatus.freeBlockHead].prevBlock = BLOCK_NONE;
+	ftlStatus.freeBlockCnt--;
+
+	return pbn;
+}
+
+static unsigned int alloc_page()
+{
+	BLOCK_ENTRY *block;
+	unsigned int pbn, ppn;
+
+	if(ftlStatus.openBlock == BLOCK_NONE)
+	{
+		//garbage collection may leave its own open block behind
+		if(ftlStatus.freeBlockCnt <= GC_FREE_BLOCK_THRESHOLD && !ftlStatus.gcRunning)
+			garbage_collection();
+
+		if(ftlStatus.openBlock == BLOCK_NONE)
+		{
+			pbn = get_free_block();
+			blockMapPtr->block[pbn].state = BLOCK_STATE_OPEN;
+			blockMapPtr->block[pbn].seq = ++ftlStatus.blockSeq;
+			ftlStatus.openBlock = pbn;
+		}
+	}
+
+	pbn = ftlStatus.openBlock;
+	block = &blockMapPtr->block[pbn];
+	ppn = pbn * PAGES_PER_BLOCK + block->nextPage;
+
+	block->nextPage++;
+	if(block->nextPage == PAGES_PER_BLOCK)
+	{
+		block->state = BLOCK_STATE_FULL;
+		put_victim_block(pbn);
+		ftlStatus.openBlock = BLOCK_NONE;
+	}
+
+	return ppn;
+}
+
+static void invalidate_page(unsigned int ppn)
+{
+	BLOCK_ENTRY *block;
+	unsigned int pbn;
+
+	pbn = ppn / PAGES_PER_BLOCK;
+	block = &blockMapPtr->block[pbn];
+	physicalPageMapPtr->lpn[ppn] = PAGE_NONE;
+
+	if(block->state == BLOCK_STATE_FULL)
+		remove_victim_block(pbn);
+
+	block->validCnt--;
+	block->invalidCnt++;
+
+	if(block->state == BLOCK_STATE_FULL)
+		put_victim_block(pbn);
+}
+
+unsigned int addr_trans_read(unsigned int lpn, unsigned long long bufAddr)
+{
+	unsigned int ppn;
+
+	ASSERT(lpn < USER_PAGES);
+
+	ppn = logicalPageMapPtr->ppn[lpn];
+	if(ppn == PAGE_NONE)
+		return 0;
+
+	g_flashBackend->read_page(ppn, bufAddr);
+
+	return 1;
+}
+
+void addr_trans_write(unsigned int lpn, unsigned long long bufAddr)
+{
+	FLASH_SPARE spare;
+	unsigned int ppn, oldPpn;
+
+	ASSERT(lpn < USER_PAGES);
+
+	ppn = alloc_page();
+	spare.lpn = lpn;
+	spare.blockSeq = blockMapPtr->block[ppn / PAGES_PER_BLOCK].seq;
+	g_flashBackend->program_page(ppn, bufAddr, &spare);
+
+	oldPpn = logicalPageMapPtr->ppn[lpn];
+	if(oldPpn != PAGE_NONE)
+		invalidate_page(oldPpn);
+
+	logicalPageMapPtr->ppn[lpn] = ppn;
+	physicalPageMapPtr->lpn[ppn] = lpn;
+	blockMapPtr->block[ppn / PAGES_PER_BLOCK].validCnt++;
+}
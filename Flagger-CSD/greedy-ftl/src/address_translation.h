@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////////////
+// address_translation.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Address Translator
+// File Name: address_translation.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the logical/physical page maps and the block map of the page-mapped FTL
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef ADDRESS_TRANSLATION_H_
+#define ADDRESS_TRANSLATION_H_
+
+#include "ftl_config.h"
+
+#define	PAGE_NONE				0xFFFFFFFF
+#define	BLOCK_NONE				0xFFFFFFFF
+
+#define	BLOCK_STATE_FREE		0
+#define	BLOCK_STATE_OPEN		1	//being programmed
+#define	BLOCK_STATE_FULL		2	//listed in a victim bucket
+#define	BLOCK_STATE_VICTIM		3	//being collected
+
+typedef struct _LOGICAL_PAGE_MAP
+{
+	unsigned int ppn[USER_PAGES];
+} LOGICAL_PAGE_MAP, *P_LOGICAL_PAGE_MAP;
+
+typedef struct _PHYSICAL_PAGE_MAP
+{
+	unsigned int lpn[TOTAL_PAGES];	//PAGE_NONE if the page holds no valid data
+} PHYSICAL_PAGE_MAP, *P_PHYSICAL_PAGE_MAP;
+
+typedef struct _BLOCK_ENTRY
+{
+	unsigned int seq;				//program order of the block, newer copies of a page win at mount
+	unsigned short validCnt;
+	unsigned short invalidCnt;
+	unsigned short nextPage;		//PAGES_PER_BLOCK once the block is full
+	unsigned short state;
+	unsigned int prevBlock;			//links of the free list or of a victim bucket
+	unsigned int nextBlock;
+} BLOCK_ENTRY;
+
+typedef struct _BLOCK_MAP
+{
+	BLOCK_ENTRY block[TOTAL_BLOCKS];
+} BLOCK_MAP, *P_BLOCK_MAP;
+
+typedef struct _FTL_STATUS
+{
+	unsigned int freeBlockHead;
+	unsigned int freeBlockTail;
+	unsigned int freeBlockCnt;
+	unsigned int openBlock;
+	unsigned int blockSeq;
+	unsigned int gcRunning;
+	unsigned int gcVictimCnt;			//blocks reclaimed by garbage collection since power on
+} FTL_STATUS;
+
+void init_address_map(unsigned int mount);
+
+unsigned int addr_trans_read(unsigned int lpn, unsigned long long bufAddr);
+
+void addr_trans_write(unsigned int lpn, unsigned long long bufAddr);
+
+void put_free_block(unsigned int pbn);
+
+extern P_LOGICAL_PAGE_MAP logicalPageMapPtr;
+extern P_PHYSICAL_PAGE_MAP physicalPageMapPtr;
+extern P_BLOCK_MAP blockMapPtr;
+extern FTL_STATUS ftlStatus;
+
+#endif /* ADDRESS_TRANSLATION_H_ */
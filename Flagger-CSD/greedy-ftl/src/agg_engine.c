@@ -0,0 +1,324 @@
+//////////////////////////////////////////////////////////////////////////////////
+// agg_engine.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Aggregation Engine
+// File Name: agg_engine.c
+//
+// Version: v1.3.0
+//
+// Description:
+//   - software aggregation operators the accelerator does not implement
+//   - sparse sum scatter-adds client (index, value) lists into a dense accumulator
+//   - coordinate-wise median and trimmed mean over client slots
+//   - weighted mean over client slots
+//   - CRC32C of the operator output, slice-by-8 or the ARMv8 CRC instructions
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.3.0
+//   - weighted mean over client slots
+//
+// * v1.2.0
+//   - CRC32C of the operator output
+//
+// * v1.1.0
+//   - coordinate-wise median and trimmed mean
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "stdlib.h"
+
+#include "ftl_config.h"
+#include "hot_region.h"
+#include "agg_engine.h"
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+#define HOT_BLOCK_PTR(actid)	((float *)(unsigned long)(DDR4_HOT_REGION_BASE_ADDR + (unsigned long long)(actid) * BYTES_PER_NVME_BLOCK))
+
+//coordinates of all slots gathered per step, slot-major reads stay sequential
+static float robustScratch[AGG_ROBUST_SCRATCH_ELEMS];
+
+//crc32cTable[k][b] is the CRC of byte b followed by k zero bytes
+static unsigned int crc32cTable[8][256];
+
+void init_agg_engine()
+{
+	unsigned int idx, bit, crc, slice;
+
+	for(idx = 0; idx < 256; idx++)
+	{
+		crc = idx;
+		for(bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ ((crc & 0x1) ? AGG_CRC32C_POLY : 0);
+		crc32cTable[0][idx] = crc;
+	}
+
+	for(slice = 1; slice < 8; slice++)
+		for(idx = 0; idx < 256; idx++)
+		{
+			crc = crc32cTable[slice - 1][idx];
+			crc32cTable[slice][idx] = (crc >> 8) ^ crc32cTable[0][crc & 0xFF];
+		}
+}
+
+//crc of the data so far (0 for none), chains like zlib crc32()
+unsigned int agg_crc32c(unsigned int crc, unsigned long long addr, unsigned long long length)
+{
+	const unsigned char *buf;
+
+	buf = (const unsigned char *)(unsigned long)addr;
+	crc = ~crc;
+
+	for(; length && ((unsigned long)buf & 0x7); length--)
+		crc = (crc >> 8) ^ crc32cTable[0][(crc ^ *buf++) & 0xFF];
+
+	for(; length >= 8; length -= 8, buf += 8)
+	{
+#if defined(__ARM_FEATURE_CRC32)
+		crc = __crc32cd(crc, *(const unsigned long long *)buf);
+#else
+		unsigned int lo, hi;
+
+		//little endian, the low word meets the crc register
+		lo = *(const unsigned int *)buf ^ crc;
+		hi = *(const unsigned int *)(buf + 4);
+		crc = crc32cTable[7][lo & 0xFF] ^ crc32cTable[6][(lo >> 8) & 0xFF]
+			^ crc32cTable[5][(lo >> 16) & 0xFF] ^ crc32cTable[4][lo >> 24]
+			^ crc32cTable[3][hi & 0xFF] ^ crc32cTable[2][(hi >> 8) & 0xFF]
+			^ crc32cTable[1][(hi >> 16) & 0xFF] ^ crc32cTable[0][hi >> 24];
+#endif
+	}
+
+	for(; length; length--)
+		crc = (crc >> 8) ^ crc32cTable[0][(crc ^ *buf++) & 0xFF];
+
+	return ~crc;
+}
+
+static unsigned int sparse_list_sum(AGG_SPARSE_ENTRY *entry, unsigned int nnz, float *acc, unsigned int denseLength)
+{
+	unsigned int idx;
+
+	//validate first so that a corrupt list leaves the accumulator untouched
+	for(idx = 0; idx < nnz; idx++)
+		if(entry[idx].index >= denseLength)
+			return AGG_STATUS_ERROR;
+
+	for(idx = 0; idx < nnz; idx++)
+		acc[entry[idx].index] += entry[idx].value;
+
+	return AGG_STATUS_OK;
+}
+
+//dstLimit bounds the accumulator, in blocks from dstACTID, dstLength returns the bytes the lists cover
+unsigned int agg_sparse_sum(unsigned long long srcAddr, unsigned int srcLength, unsigned int dstACTID, unsigned int dstLimit, unsigned long long *dstLength)
+{
+	AGG_SPARSE_HEADER *header;
+	unsigned long long listBytes;
+	unsigned int dstBlocks;
+
+	*dstLength = 0;
+	if((srcAddr & 0x3) || (srcLength % sizeof(AGG_SPARSE_ENTRY)) || (dstACTID >= HOT_REGION_PAGES))
+		return AGG_STATUS_ERROR;
+
+	while(srcLength)
+	{
+		header = (AGG_SPARSE_HEADER *)(unsigned long)srcAddr;
+		listBytes = sizeof(AGG_SPARSE_HEADER) + (unsigned long long)header->nnz * sizeof(AGG_SPARSE_ENTRY);
+		if(listBytes > srcLength)
+			return AGG_STATUS_ERROR;
+
+		dstBlocks = ((unsigned long long)header->denseLength * sizeof(float) + BYTES_PER_NVME_BLOCK - 1) / BYTES_PER_NVME_BLOCK;
+		if(dstBlocks > HOT_REGION_PAGES - dstACTID || dstBlocks > dstLimit)
+			return AGG_STATUS_ERROR;
+		materialize_hot_region(dstACTID, dstBlocks);
+
+		if(sparse_list_sum((AGG_SPARSE_ENTRY *)(header + 1), header->nnz, HOT_BLOCK_PTR(dstACTID), header->denseLength) != AGG_STATUS_OK)
+			return AGG_STATUS_ERROR;
+
+		if((unsigned long long)header->denseLength * sizeof(float) > *dstLength)
+			*dstLength = (unsigned long long)header->denseLength * sizeof(float);
+		srcAddr += listBytes;
+		srcLength -= listBytes;
+	}
+
+	return AGG_STATUS_OK;
+}
+
+static int compare_float(const void *a, const void *b)
+{
+	float x = *(const float *)a;
+	float y = *(const float *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void sort_column(float *column, unsigned int n)
+{
+	unsigned int idx, pos;
+	float value;
+
+	if(n > AGG_ROBUST_INSERTION_SORT_MAX)
+	{
+		qsort(column, n, sizeof(float), compare_float);
+		return;
+	}
+
+	for(idx = 1; idx < n; idx++)
+	{
+		value = column[idx];
+		for(pos = idx; pos > 0 && column[pos - 1] > value; pos--)
+			column[pos] = column[pos - 1];
+		column[pos] = value;
+	}
+}
+
+static float reduce_column(float *column, unsigned int op, unsigned int nSlots, unsigned int trim)
+{
+	unsigned int idx;
+	float sum;
+
+	sort_column(column, nSlots);
+
+	if(op == AGG_OP_MEDIAN)
+	{
+		if(nSlots & 0x1)
+			return column[nSlots / 2];
+		return (column[nSlots / 2 - 1] + column[nSlots / 2]) * 0.5f;
+	}
+
+	sum = 0;
+	for(idx = trim; idx < nSlots - trim; idx++)
+		sum += column[idx];
+
+	return sum / (float)(nSlots - 2 * trim);
+}
+
+//sum of the weights, 0 if a weight is negative or not a number
+static float weight_total(const float *weights, unsigned int nSlots)
+{
+	unsigned int slot;
+	float total;
+
+	total = 0;
+	for(slot = 0; slot < nSlots; slot++)
+	{
+		if(!(weights[slot] >= 0))
+			return 0;
+		total += weights[slot];
+	}
+
+	return total;
+}
+
+//every slot is streamed once into the tile, no transpose is needed
+static void weighted_tile(AGG_ROBUST_JOB *job, unsigned int first, unsigned int count, float *dst, float scale)
+{
+	unsigned int slot, elem;
+
+	for(elem = 0; elem < count; elem++)
+		robustScratch[elem] = 0;
+
+	for(slot = 0; slot < job->nSlots; slot++)
+	{
+		float *src = HOT_BLOCK_PTR(job->srcACTID + slot * job->slotStride) + first;
+		float weight = job->weights[slot] * scale;
+
+		if(weight == 0)
+			continue;
+		for(elem = 0; elem < count; elem++)
+			robustScratch[elem] += weight * src[elem];
+	}
+
+	for(elem = 0; elem < count; elem++)
+		dst[elem] = robustScratch[elem];
+}
+
+unsigned int agg_robust_reduce(AGG_ROBUST_JOB *job)
+{
+	unsigned long long slotEnd;
+	unsigned int slotBlocks, nElems, step, base, count, slot, idx;
+	float *dst, total;
+
+	if(job->nSlots == 0 || job->nSlots > AGG_MAX_SLOTS || 2 * job->trim >= job->nSlots)
+		return AGG_STATUS_ERROR;
+	total = 0;
+	if(job->op == AGG_OP_WEIGHTED_MEAN && !(total = weight_total(job->weights, job->nSlots)))
+		return AGG_STATUS_ERROR;
+	if((job->startOffset & 0x3) || (job->endOffset & 0x3) || job->endOffset <= job->startOffset)
+		return AGG_STATUS_ERROR;
+
+	//every slot and the accumulator must lie inside the hot region
+	slotBlocks = (job->endOffset + BYTES_PER_NVME_BLOCK - 1) / BYTES_PER_NVME_BLOCK;
+	if(job->nSlots > 1 && job->slotStride < slotBlocks)
+		return AGG_STATUS_ERROR;
+	slotEnd = (unsigned long long)job->srcACTID + (unsigned long long)job->slotStride * (job->nSlots - 1) + slotBlocks;
+	if(slotEnd > HOT_REGION_PAGES || (unsigned long long)job->dstACTID + slotBlocks > HOT_REGION_PAGES)
+		return AGG_STATUS_ERROR;
+
+	for(slot = 0; slot < job->nSlots; slot++)
+		materialize_hot_region(job->srcACTID + slot * job->slotStride, slotBlocks);
+	materialize_hot_region(job->dstACTID, slotBlocks);
+
+	nElems = (job->endOffset - job->startOffset) / sizeof(float);
+	base = job->startOffset / sizeof(float);
+	dst = HOT_BLOCK_PTR(job->dstACTID) + base;
+	step = (job->op == AGG_OP_WEIGHTED_MEAN) ? AGG_ROBUST_SCRATCH_ELEMS : AGG_ROBUST_SCRATCH_ELEMS / job->nSlots;
+	job->crc = 0;
+
+	for(idx = 0; idx < nElems; idx += count)
+	{
+		count = (nElems - idx < step) ? nElems - idx : step;
+
+		if(job->op == AGG_OP_WEIGHTED_MEAN)
+			weighted_tile(job, base + idx, count, dst + idx, 1.0f / total);
+		else
+		{
+			//transpose a tile so that each coordinate's values are contiguous
+			for(slot = 0; slot < job->nSlots; slot++)
+			{
+				float *src = HOT_BLOCK_PTR(job->srcACTID + slot * job->slotStride) + base + idx;
+				unsigned int elem;
+
+				for(elem = 0; elem < count; elem++)
+					robustScratch[elem * job->nSlots + slot] = src[elem];
+			}
+
+			for(slot = 0; slot < count; slot++)
+				dst[idx + slot] = reduce_column(&robustScratch[slot * job->nSlots], job->op, job->nSlots, job->trim);
+		}
+
+		//the tile just written is still in the cache
+		if(job->flags & AGG_FLAG_CRC32C)
+			job->crc = agg_crc32c(job->crc, (unsigned long)(dst + idx), count * sizeof(float));
+	}
+
+	return AGG_STATUS_OK;
+}
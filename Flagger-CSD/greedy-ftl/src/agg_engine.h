@@ -0,0 +1,134 @@
+//////////////////////////////////////////////////////////////////////////////////
+// agg_engine.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Aggregation Engine
+// File Name: agg_engine.h
+//
+// Version: v1.3.0
+//
+// Description:
+//   - declares the aggregation operators and the sparse segment layout
+//   - declares the CRC32C of the operator output
+//   - declares the client weights of the weighted mean
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.3.0
+//   - weighted mean over client slots
+//
+// * v1.2.0
+//   - CRC32C of the operator output
+//
+// * v1.1.0
+//   - robust operators over client slots
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef AGG_ENGINE_H_
+#define AGG_ENGINE_H_
+
+/* Aggregation operator, dword14[7:0] of Aggregate Start */
+#define	AGG_OP_DENSE_SUM				0x0		//accelerator reduces the segment in place
+#define	AGG_OP_SPARSE_SUM				0x1		//firmware scatter-adds (index, value) lists into an FP32 accumulator
+#define	AGG_OP_MEDIAN					0x2		//coordinate-wise median over client slots
+#define	AGG_OP_TRIMMED_MEAN				0x3		//coordinate-wise mean without the trim lowest and highest values
+#define	AGG_OP_WEIGHTED_MEAN			0x4		//coordinate-wise mean weighted per client slot (FedAvg)
+#define	AGG_OP_NAMESPACE				0xFF	//operator and slot layout configured for the namespace
+
+/*
+ * dword14[24] of Aggregate Start, the completion specific dword returns the
+ * CRC32C (Castagnoli, as the SSE4.2 crc32 instruction) of the operator output
+ * instead of the accelerator status. The output is the segment for dense sum,
+ * the accumulator up to the largest list length for sparse sum and
+ * [startOffset, endOffset) of the accumulator for the robust operators.
+ */
+#define	AGG_FLAG_CRC32C					(1 << 24)
+#define	AGG_CRC32C_POLY					0x82F63B78	//reflected Castagnoli polynomial
+
+/*
+ * Robust operators read nSlots FP32 client updates, slot i starting at
+ * ACTID + i * slotStride. [startOffset, endOffset) selects the coordinates
+ * of every slot and the result lands at the same offset of the accumulator.
+ *   dword2      slot stride in blocks
+ *   dword14     [7:0] operator, [15:8] nSlots - 1, [23:16] trim per side
+ */
+#define	AGG_MAX_SLOTS					256
+
+/*
+ * The weighted mean takes nSlots FP32 weights, one per slot and typically the
+ * client sample counts, from the first 4KB of host data given by PRP1. The
+ * weights are normalized by their sum, so the host does not pre-scale updates.
+ */
+#define	AGG_WEIGHTS_BYTES				4096
+#define	AGG_ROBUST_SCRATCH_ELEMS		16384	//64KB tile, at least 64 coordinates per step
+#define	AGG_ROBUST_INSERTION_SORT_MAX	32
+
+#define	AGG_STATUS_OK					0
+#define	AGG_STATUS_ERROR				1
+
+/*
+ * A sparse segment is a sequence of lists, one per client update.
+ * Every list is a header followed by nnz entries and may be followed by the next list.
+ * The accumulator starts at the block given in dword15, the host clears it with
+ * Write Zeroes before the first round because unwritten blocks read as 0xFF.
+ */
+typedef struct _AGG_SPARSE_HEADER
+{
+	unsigned int nnz;
+	unsigned int denseLength;		//elements of the accumulator the indices refer to
+} AGG_SPARSE_HEADER;
+
+typedef struct _AGG_SPARSE_ENTRY
+{
+	unsigned int index;
+	float value;
+} AGG_SPARSE_ENTRY;
+
+typedef struct _AGG_ROBUST_JOB
+{
+	unsigned int op;
+	unsigned int srcACTID;
+	unsigned int slotStride;
+	unsigned int nSlots;
+	unsigned int trim;
+	unsigned int startOffset;
+	unsigned int endOffset;
+	unsigned int dstACTID;
+	unsigned int flags;				//AGG_FLAG_CRC32C folds the output into crc
+	unsigned int crc;
+	const float *weights;			//nSlots weights of the weighted mean
+} AGG_ROBUST_JOB;
+
+void init_agg_engine();
+
+unsigned int agg_crc32c(unsigned int crc, unsigned long long addr, unsigned long long length);
+
+unsigned int agg_sparse_sum(unsigned long long srcAddr, unsigned int srcLength, unsigned int dstACTID, unsigned int dstLimit, unsigned long long *dstLength);
+
+unsigned int agg_robust_reduce(AGG_ROBUST_JOB *job);
+
+#endif /* AGG_ENGINE_H_ */
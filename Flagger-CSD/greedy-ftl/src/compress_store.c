@@ -0,0 +1,531 @@
+//////////////////////////////////////////////////////////////////////////////////
+// compress_store.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Compressed Store
+// File Name: compress_store.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - compresses blocks of the checkpoint range with LZ4 into a sector heap
+//   - keeps the map from logical blocks to heap sectors
+//   - decompresses blocks into staging slots for read-out
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+#include "xtime_l.h"
+#include "nvme/debug.h"
+
+#include "ftl_config.h"
+#include "hot_region.h"
+#include "compress_store.h"
+
+#define BLOCK_ADDR(actid)		(DDR4_HOT_REGION_BASE_ADDR + (unsigned long long)(actid) * BYTES_PER_NVME_BLOCK)
+#define SECTOR_PTR(sector)		((unsigned char *)(unsigned long)(heapAddr + (unsigned long long)(sector) * CSTORE_SECTOR_BYTES))
+
+#define LZ4_MIN_MATCH			4
+#define LZ4_LAST_LITERALS		5		//a block ends with at least this many literals
+#define LZ4_MF_LIMIT			12		//the last match starts at least this far from the end
+#define LZ4_HASH_LOG			12
+#define LZ4_MAX_OFFSET			65535
+
+CSTORE_STATUS cstoreStatus;
+
+static CSTORE_MAP_ENTRY *cstoreMap;
+static unsigned char *sectorBitmap;
+static unsigned long long heapAddr;
+
+//compressed or shuffled copy of the block being converted
+static unsigned char codecBuf[BYTES_PER_NVME_BLOCK];
+static unsigned char shuffleBuf[BYTES_PER_NVME_BLOCK];
+static unsigned short lz4HashTable[1 << LZ4_HASH_LOG];
+
+static unsigned int read32(const unsigned char *p)
+{
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((unsigned int)p[3] << 24);
+}
+
+static unsigned int lz4_hash(unsigned int sequence)
+{
+	return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+static unsigned int put_length(unsigned char *dst, unsigned int pos, unsigned int length)
+{
+	while(length >= 255)
+	{
+		dst[pos++] = 255;
+		length -= 255;
+	}
+	dst[pos++] = length;
+
+	return pos;
+}
+
+//LZ4 block format, returns 0 if the result does not fit
+unsigned int lz4_compress_block(const unsigned char *src, unsigned int srcLength, unsigned char *dst, unsigned int dstCapacity)
+{
+	unsigned int ip, anchor, ref, op, literals, matchLength, hash;
+
+	memset(lz4HashTable, 0, sizeof(lz4HashTable));
+	ip = 0;
+	anchor = 0;
+	op = 0;
+
+	if(srcLength > LZ4_MF_LIMIT)
+	{
+		while(ip + LZ4_MF_LIMIT <= srcLength)
+		{
+			hash = lz4_hash(read32(src + ip));
+			ref = lz4HashTable[hash];
+			lz4HashTable[hash] = ip;
+
+			if(ref >= ip || ip - ref > LZ4_MAX_OFFSET || read32(src + ref) != read32(src + ip))
+			{
+				ip++;
+				continue;
+			}
+
+			matchLength = LZ4_MIN_MATCH;
+			while(ip + matchLength < srcLength - LZ4_LAST_LITERALS && src[ref + matchLength] == src[ip + matchLength])
+				matchLength++;
+
+			//token, literal length, literals, offset and match length in the worst case
+			literals = ip - anchor;
+			if(op + 1 + literals / 255 + 1 + literals + 2 + (matchLength - LZ4_MIN_MATCH) / 255 + 1 > dstCapacity)
+				return 0;
+
+			dst[op++] = ((literals >= 15 ? 15 : literals) << 4) | (matchLength - LZ4_MIN_MATCH >= 15 ? 15 : matchLength - LZ4_MIN_MATCH);
+			if(literals >= 15)
+				op = put_length(dst, op, literals - 15);
+			memcpy(dst + op, src + anchor, literals);
+			op += literals;
+			dst[op++] = (ip - ref) & 0xFF;
+			dst[op++] = (ip - ref) >> 8;
+			if(matchLength - LZ4_MIN_MATCH >= 15)
+				op = put_length(dst, op, matchLength - LZ4_MIN_MATCH - 15);
+
+			ip += matchLength;
+			anchor = ip;
+			if(ip + LZ4_MF_LIMIT <= srcLength)
+				lz4HashTable[lz4_hash(read32(src + ip - 2))] = ip - 2;
+		}
+	}
+
+	literals = srcLength - anchor;
+	if(op + 1 + literals / 255 + 1 + literals > dstCapacity)
+		return 0;
+
+	dst[op++] = (literals >= 15 ? 15 : literals) << 4;
+	if(literals >= 15)
+		op = put_length(dst, op, literals - 15);
+	memcpy(dst + op, src + anchor, literals);
+	op += literals;
+
+	return op;
+}
+
+//returns the decompressed length, 0 if the input is malformed
+unsigned int lz4_decompress_block(const unsigned char *src, unsigned int srcLength, unsigned char *dst, unsigned int dstCapacity)
+{
+	unsigned int ip, op, token, length, offset, extra;
+
+	ip = 0;
+	op = 0;
+	while(ip < srcLength)
+	{
+		token = src[ip++];
+
+		length = token >> 4;
+		if(length == 15)
+			do
+			{
+				if(ip >= srcLength)
+					return 0;
+				extra = src[ip++];
+				length += extra;
+			} while(extra == 255);
+
+		if(length > srcLength - ip || length > dstCapacity - op)
+			return 0;
+		memcpy(dst + op, src + ip, length);
+		ip += length;
+		op += length;
+
+		//the last sequence has no match
+		if(ip == srcLength)
+			break;
+
+		if(srcLength - ip < 2)
+			return 0;
+		offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > op)
+			return 0;
+
+		length = (token & 0xF) + LZ4_MIN_MATCH;
+		if((token & 0xF) == 15)
+			do
+			{
+				if(ip >= srcLength)
+					return 0;
+				extra = src[ip++];
+				length += extra;
+			} while(extra == 255);
+
+		if(length > dstCapacity - op)
+			return 0;
+
+		//overlapping copies repeat the pattern, copy byte by byte
+		for(; length; length--, op++)
+			dst[op] = dst[op - offset];
+	}
+
+	return op;
+}
+
+static void shuffle4(unsigned char *dst, const unsigned char *src)
+{
+	unsigned int elem, byte;
+
+	for(elem = 0; elem < BYTES_PER_NVME_BLOCK / 4; elem++)
+		for(byte = 0; byte < 4; byte++)
+			dst[byte * (BYTES_PER_NVME_BLOCK / 4) + elem] = src[elem * 4 + byte];
+}
+
+static void unshuffle4(unsigned char *dst, const unsigned char *src)
+{
+	unsigned int elem, byte;
+
+	for(elem = 0; elem < BYTES_PER_NVME_BLOCK / 4; elem++)
+		for(byte = 0; byte < 4; byte++)
+			dst[elem * 4 + byte] = src[byte * (BYTES_PER_NVME_BLOCK / 4) + elem];
+}
+
+static unsigned int alloc_sector()
+{
+	unsigned int sector;
+
+	for(sector = cstoreStatus.nextFit; ; sector = (sector + 1) % cstoreStatus.heapSectors)
+	{
+		//skip fully used bytes of the bitmap
+		if((sector & 0x7) == 0 && sectorBitmap[sector >> 3] == 0xFF)
+		{
+			sector += 7;
+			continue;
+		}
+
+		if(!((sectorBitmap[sector >> 3] >> (sector & 0x7)) & 0x1))
+			break;
+	}
+
+	sectorBitmap[sector >> 3] |= 1 << (sector & 0x7);
+	cstoreStatus.freeSectors--;
+	cstoreStatus.nextFit = (sector + 1) % cstoreStatus.heapSectors;
+
+	return sector;
+}
+
+static void unmap_block(CSTORE_MAP_ENTRY *entry)
+{
+	unsigned int idx, nSectors, sector;
+
+	if(entry->length == 0)
+		return;
+
+	nSectors = (entry->length + CSTORE_SECTOR_BYTES - 1) / CSTORE_SECTOR_BYTES;
+	for(idx = 0; idx < nSectors; idx++)
+	{
+		sector = entry->sector[idx];
+		sectorBitmap[sector >> 3] &= ~(1 << (sector & 0x7));
+	}
+
+	cstoreStatus.freeSectors += nSectors;
+	cstoreStatus.mappedBlocks--;
+	if(entry->length == BYTES_PER_NVME_BLOCK)
+		cstoreStatus.rawBlocks--;
+	cstoreStatus.storedBytes -= entry->length;
+	entry->length = 0;
+}
+
+static void store_block(unsigned int actid, const unsigned char *data)
+{
+	CSTORE_MAP_ENTRY *entry;
+	const unsigned char *src, *stored;
+	unsigned int length, nSectors, idx, chunk;
+	XTime start, end;
+
+	XTime_GetTime(&start);
+
+	src = data;
+	if(cstoreStatus.flags & CSTORE_FLAG_SHUFFLE4)
+	{
+		shuffle4(shuffleBuf, data);
+		src = shuffleBuf;
+	}
+
+	//keep the block raw unless it saves at least one sector
+	length = lz4_compress_block(src, BYTES_PER_NVME_BLOCK, codecBuf, BYTES_PER_NVME_BLOCK - CSTORE_SECTOR_BYTES);
+	stored = codecBuf;
+	if(length == 0)
+	{
+		length = BYTES_PER_NVME_BLOCK;
+		stored = data;
+	}
+
+	entry = &cstoreMap[actid - cstoreStatus.startACTID];
+	unmap_block(entry);
+
+	nSectors = (length + CSTORE_SECTOR_BYTES - 1) / CSTORE_SECTOR_BYTES;
+	for(idx = 0; idx < nSectors; idx++)
+	{
+		entry->sector[idx] = alloc_sector();
+		chunk = (length - idx * CSTORE_SECTOR_BYTES < CSTORE_SECTOR_BYTES) ? length - idx * CSTORE_SECTOR_BYTES : CSTORE_SECTOR_BYTES;
+		memcpy(SECTOR_PTR(entry->sector[idx]), stored + idx * CSTORE_SECTOR_BYTES, chunk);
+	}
+	entry->length = length;
+
+	cstoreStatus.mappedBlocks++;
+	if(length == BYTES_PER_NVME_BLOCK)
+		cstoreStatus.rawBlocks++;
+	cstoreStatus.storedBytes += length;
+	cstoreStatus.compressedBlocks++;
+	cstoreStatus.compressedBytes += length;
+
+	XTime_GetTime(&end);
+	cstoreStatus.compressTicks += end - start;
+}
+
+void init_cstore()
+{
+	memset(&cstoreStatus, 0, sizeof(CSTORE_STATUS));
+}
+
+unsigned int cstore_configure(unsigned int flags, unsigned int startACTID, unsigned int nBlocks, unsigned int poolACTID, unsigned int poolBlocks)
+{
+	unsigned int mapBlocks, bitmapBlocks, heapBlocks;
+
+	if(!(flags & CSTORE_FLAG_ENABLE))
+	{
+		init_cstore();
+		return 1;
+	}
+
+	if(nBlocks == 0 || startACTID >= storageCapacity_L || nBlocks > storageCapacity_L - startACTID)
+		return 0;
+	if(poolACTID >= HOT_REGION_PAGES || poolBlocks > HOT_REGION_PAGES - poolACTID)
+		return 0;
+	if((startACTID < poolACTID + poolBlocks) && (poolACTID < startACTID + nBlocks))
+		return 0;
+
+	mapBlocks = ((unsigned long long)nBlocks * sizeof(CSTORE_MAP_ENTRY) + BYTES_PER_NVME_BLOCK - 1) / BYTES_PER_NVME_BLOCK;
+	if(poolBlocks <= CSTORE_STAGING_BLOCKS + mapBlocks + 1)
+		return 0;
+
+	//one bitmap block covers BYTES_PER_NVME_BLOCK heap blocks
+	heapBlocks = poolBlocks - CSTORE_STAGING_BLOCKS - mapBlocks;
+	bitmapBlocks = (heapBlocks + BYTES_PER_NVME_BLOCK) / (BYTES_PER_NVME_BLOCK + 1);
+	heapBlocks -= bitmapBlocks;
+
+	init_cstore();
+	cstoreStatus.flags = flags;
+	cstoreStatus.startACTID = startACTID;
+	cstoreStatus.nBlocks = nBlocks;
+	cstoreStatus.poolACTID = poolACTID;
+	cstoreStatus.poolBlocks = poolBlocks;
+	cstoreStatus.heapSectors = heapBlocks * CSTORE_SECTORS_PER_BLOCK;
+	cstoreStatus.freeSectors = cstoreStatus.heapSectors;
+
+	cstoreMap = (CSTORE_MAP_ENTRY *)(unsigned long)BLOCK_ADDR(poolACTID + CSTORE_STAGING_BLOCKS);
+	sectorBitmap = (unsigned char *)(unsigned long)BLOCK_ADDR(poolACTID + CSTORE_STAGING_BLOCKS + mapBlocks);
+	heapAddr = BLOCK_ADDR(poolACTID + CSTORE_STAGING_BLOCKS + mapBlocks + bitmapBlocks);
+
+	//the heap itself is never read before it is written
+	prepare_hot_region_write(poolACTID, poolBlocks);
+	memset(cstoreMap, 0, (unsigned long long)(mapBlocks + bitmapBlocks) * BYTES_PER_NVME_BLOCK);
+
+	return 1;
+}
+
+unsigned int cstore_get_flags()
+{
+	return cstoreStatus.flags;
+}
+
+unsigned int cstore_range(unsigned int actid, unsigned int nBlocks)
+{
+	if(!(cstoreStatus.flags & CSTORE_FLAG_ENABLE))
+		return CSTORE_RANGE_OUTSIDE;
+	if(actid + nBlocks <= cstoreStatus.startACTID || actid >= cstoreStatus.startACTID + cstoreStatus.nBlocks)
+		return CSTORE_RANGE_OUTSIDE;
+	if(actid < cstoreStatus.startACTID || actid + nBlocks > cstoreStatus.startACTID + cstoreStatus.nBlocks)
+		return CSTORE_RANGE_STRADDLE;
+
+	return CSTORE_RANGE_INSIDE;
+}
+
+//holds heap space for blocks until they are compressed, returns 0 if the heap is full
+unsigned int cstore_reserve(unsigned int nBlocks)
+{
+	unsigned long long needed;
+
+	needed = (unsigned long long)nBlocks * CSTORE_SECTORS_PER_BLOCK;
+	if(cstoreStatus.reservedSectors + needed > cstoreStatus.freeSectors)
+		return 0;
+
+	cstoreStatus.reservedSectors += needed;
+	return 1;
+}
+
+unsigned int cstore_slot_free()
+{
+	return cstoreStatus.slotCnt < CSTORE_STAGING_BLOCKS;
+}
+
+unsigned long long cstore_take_slot(unsigned int actid)
+{
+	unsigned int slot;
+
+	slot = cstoreStatus.slotCnt++;
+	cstoreStatus.slotACTID[slot] = actid;
+
+	return BLOCK_ADDR(cstoreStatus.poolACTID + slot);
+}
+
+//the caller makes sure no host DMA uses the slots any more
+void cstore_recycle_slots()
+{
+	ASSERT(cstoreStatus.pendingHead == cstoreStatus.slotCnt);
+
+	cstoreStatus.slotCnt = 0;
+	cstoreStatus.pendingHead = 0;
+}
+
+unsigned int cstore_pending()
+{
+	return cstoreStatus.pendingHead < cstoreStatus.slotCnt;
+}
+
+//the caller makes sure the writes of the pending slots have landed in DDR4
+void cstore_compress_pending()
+{
+	unsigned int slot, actid;
+
+	for(slot = cstoreStatus.pendingHead; slot < cstoreStatus.slotCnt; slot++)
+	{
+		actid = cstoreStatus.slotACTID[slot];
+		if(actid == CSTORE_SLOT_READ)
+			continue;
+
+		cstoreStatus.reservedSectors -= CSTORE_SECTORS_PER_BLOCK;
+		store_block(actid, (unsigned char *)(unsigned long)BLOCK_ADDR(cstoreStatus.poolACTID + slot));
+	}
+
+	cstoreStatus.pendingHead = cstoreStatus.slotCnt;
+}
+
+void cstore_read_block(unsigned int actid, unsigned long long slotAddr)
+{
+	CSTORE_MAP_ENTRY *entry;
+	unsigned char *dst;
+	unsigned int nSectors, idx, chunk, length;
+	XTime start, end;
+
+	entry = &cstoreMap[actid - cstoreStatus.startACTID];
+	dst = (unsigned char *)(unsigned long)slotAddr;
+	if(entry->length == 0)
+	{
+		memset(dst, 0, BYTES_PER_NVME_BLOCK);
+		return;
+	}
+
+	XTime_GetTime(&start);
+
+	//gather the sectors, raw blocks go straight to the slot
+	nSectors = (entry->length + CSTORE_SECTOR_BYTES - 1) / CSTORE_SECTOR_BYTES;
+	for(idx = 0; idx < nSectors; idx++)
+	{
+		chunk = (entry->length - idx * CSTORE_SECTOR_BYTES < CSTORE_SECTOR_BYTES) ? entry->length - idx * CSTORE_SECTOR_BYTES : CSTORE_SECTOR_BYTES;
+		memcpy(((entry->length == BYTES_PER_NVME_BLOCK) ? dst : codecBuf) + idx * CSTORE_SECTOR_BYTES, SECTOR_PTR(entry->sector[idx]), chunk);
+	}
+
+	if(entry->length != BYTES_PER_NVME_BLOCK)
+	{
+		if(cstoreStatus.flags & CSTORE_FLAG_SHUFFLE4)
+		{
+			length = lz4_decompress_block(codecBuf, entry->length, shuffleBuf, BYTES_PER_NVME_BLOCK);
+			unshuffle4(dst, shuffleBuf);
+		}
+		else
+			length = lz4_decompress_block(codecBuf, entry->length, dst, BYTES_PER_NVME_BLOCK);
+		ASSERT(length == BYTES_PER_NVME_BLOCK);
+	}
+
+	XTime_GetTime(&end);
+	cstoreStatus.decompressedBlocks++;
+	cstoreStatus.decompressTicks += end - start;
+}
+
+//the caller compresses pending blocks first so that they cannot bring the data back,
+//blocks outside the logical range are left alone
+void cstore_unmap(unsigned int actid, unsigned int nBlocks)
+{
+	unsigned long long start, end;
+
+	if(!(cstoreStatus.flags & CSTORE_FLAG_ENABLE))
+		return;
+
+	start = (actid > cstoreStatus.startACTID) ? actid : cstoreStatus.startACTID;
+	end = (unsigned long long)actid + nBlocks;
+	if(end > (unsigned long long)cstoreStatus.startACTID + cstoreStatus.nBlocks)
+		end = (unsigned long long)cstoreStatus.startACTID + cstoreStatus.nBlocks;
+
+	for(; start < end; start++)
+		unmap_block(&cstoreMap[start - cstoreStatus.startACTID]);
+}
+
+void cstore_get_log_page(CSTORE_LOG_PAGE *logPage)
+{
+	logPage->version = CSTORE_LOG_PAGE_VERSION;
+	logPage->flags = cstoreStatus.flags;
+	logPage->ticksPerSecond = COUNTS_PER_SECOND;
+	logPage->logicalBlocks = cstoreStatus.nBlocks;
+	logPage->mappedBlocks = cstoreStatus.mappedBlocks;
+	logPage->rawBlocks = cstoreStatus.rawBlocks;
+	logPage->heapSectors = cstoreStatus.heapSectors;
+	logPage->freeSectors = cstoreStatus.freeSectors;
+	logPage->pendingBlocks = cstoreStatus.reservedSectors / CSTORE_SECTORS_PER_BLOCK;
+	logPage->storedBytes = cstoreStatus.storedBytes;
+	logPage->compressedBlocks = cstoreStatus.compressedBlocks;
+	logPage->compressedBytes = cstoreStatus.compressedBytes;
+	logPage->compressTicks = cstoreStatus.compressTicks;
+	logPage->decompressedBlocks = cstoreStatus.decompressedBlocks;
+	logPage->decompressTicks = cstoreStatus.decompressTicks;
+}
@@ -0,0 +1,158 @@
+//////////////////////////////////////////////////////////////////////////////////
+// compress_store.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Compressed Store
+// File Name: compress_store.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the LZ4 compressed block store for checkpoint ranges
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef COMPRESS_STORE_H_
+#define COMPRESS_STORE_H_
+
+#include "ftl_config.h"
+
+#define	CSTORE_SECTOR_BYTES				512
+#define	CSTORE_SECTORS_PER_BLOCK		(BYTES_PER_NVME_BLOCK / CSTORE_SECTOR_BYTES)
+#define	CSTORE_STAGING_BLOCKS			256		//1MB of write landing and read-out slots
+
+/* Set/Get Features CSTORE_FEATURE_ID dword11 */
+#define	CSTORE_FLAG_ENABLE				0x1
+#define	CSTORE_FLAG_SHUFFLE4			0x2		//compress byte planes of 4-byte elements, suits FP32 tensors
+
+#define	CSTORE_RANGE_OUTSIDE			0
+#define	CSTORE_RANGE_INSIDE				1
+#define	CSTORE_RANGE_STRADDLE			2
+
+#define	CSTORE_SLOT_READ				0xFFFFFFFF
+
+#define	CSTORE_LOG_PAGE_ID				0xC1
+#define	CSTORE_LOG_PAGE_VERSION			1
+
+/*
+ * Blocks of the logical range [startACTID, startACTID + nBlocks) are stored
+ * LZ4 compressed in a pool of hot region blocks laid out as
+ *   staging slots | map | sector bitmap | sector heap
+ * A block takes ceil(length / 512) heap sectors that need not be contiguous,
+ * so allocation never fails while enough sectors are free. Blocks that do not
+ * shrink are kept raw. Unwritten and deallocated blocks read as zeroes.
+ * Set/Get Features CSTORE_FEATURE_ID:
+ *   dword11     flags, 0 disables the store
+ *   dword12     first block of the logical range
+ *   dword13     blocks of the logical range
+ *   dword14     first block of the pool
+ *   dword15     blocks of the pool
+ * Reconfiguring the store drops its content.
+ */
+typedef struct _CSTORE_MAP_ENTRY
+{
+	unsigned int length;			//stored bytes, 0 if unmapped, BYTES_PER_NVME_BLOCK if raw
+	unsigned int sector[CSTORE_SECTORS_PER_BLOCK];
+} CSTORE_MAP_ENTRY;
+
+typedef struct _CSTORE_STATUS
+{
+	unsigned int flags;
+	unsigned int startACTID;
+	unsigned int nBlocks;
+	unsigned int poolACTID;
+	unsigned int poolBlocks;
+	unsigned int heapSectors;
+	unsigned int freeSectors;
+	unsigned int reservedSectors;	//worst case of the blocks waiting for compression
+	unsigned int nextFit;
+	unsigned int slotCnt;			//staging slots handed out since the last recycle
+	unsigned int pendingHead;		//oldest slot waiting for compression
+	unsigned int mappedBlocks;
+	unsigned int rawBlocks;
+	unsigned long long storedBytes;
+	unsigned long long compressedBlocks;
+	unsigned long long compressedBytes;	//bytes stored by compression since configuration
+	unsigned long long compressTicks;
+	unsigned long long decompressedBlocks;
+	unsigned long long decompressTicks;
+	unsigned int slotACTID[CSTORE_STAGING_BLOCKS];
+} CSTORE_STATUS;
+
+/* Vendor log page 0xC1, 512 bytes */
+typedef struct _CSTORE_LOG_PAGE
+{
+	unsigned int version;
+	unsigned int flags;
+	unsigned long long ticksPerSecond;
+	unsigned int logicalBlocks;		//blocks of the logical range
+	unsigned int mappedBlocks;		//logical blocks holding data
+	unsigned int rawBlocks;			//mapped blocks kept uncompressed
+	unsigned int heapSectors;
+	unsigned int freeSectors;
+	unsigned int pendingBlocks;
+	unsigned long long storedBytes;		//compressed bytes of the mapped blocks
+	unsigned long long compressedBlocks;
+	unsigned long long compressedBytes;
+	unsigned long long compressTicks;
+	unsigned long long decompressedBlocks;
+	unsigned long long decompressTicks;
+	unsigned char reserved0[424];
+} CSTORE_LOG_PAGE;
+
+void init_cstore();
+
+unsigned int cstore_configure(unsigned int flags, unsigned int startACTID, unsigned int nBlocks, unsigned int poolACTID, unsigned int poolBlocks);
+
+unsigned int cstore_get_flags();
+
+unsigned int cstore_range(unsigned int actid, unsigned int nBlocks);
+
+unsigned int cstore_reserve(unsigned int nBlocks);
+
+unsigned int cstore_slot_free();
+
+unsigned long long cstore_take_slot(unsigned int actid);
+
+void cstore_recycle_slots();
+
+unsigned int cstore_pending();
+
+void cstore_compress_pending();
+
+void cstore_read_block(unsigned int actid, unsigned long long slotAddr);
+
+void cstore_unmap(unsigned int actid, unsigned int nBlocks);
+
+void cstore_get_log_page(CSTORE_LOG_PAGE *logPage);
+
+unsigned int lz4_compress_block(const unsigned char *src, unsigned int srcLength, unsigned char *dst, unsigned int dstCapacity);
+
+unsigned int lz4_decompress_block(const unsigned char *src, unsigned int srcLength, unsigned char *dst, unsigned int dstCapacity);
+
+#endif /* COMPRESS_STORE_H_ */
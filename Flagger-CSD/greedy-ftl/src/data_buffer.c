@@ -0,0 +1,272 @@
+//////////////////////////////////////////////////////////////////////////////////
+// data_buffer.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Data Buffer Manager
+// File Name: data_buffer.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - caches pages of the FTL tier in DDR4 and writes dirty pages back on eviction or flush
+//   - finds entries through a hash table and evicts the least recently used one
+//   - an entry is not reused before the host DMA recorded on it has drained
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+#include "nvme/debug.h"
+
+#include "ftl_config.h"
+#include "flash_backend.h"
+#include "address_translation.h"
+#include "data_buffer.h"
+
+#define HASH(lpn)	((lpn) & (DATA_BUF_HASH_BUCKETS - 1))
+
+P_DATA_BUF_MAP dataBufMapPtr;
+static P_DATA_BUF_HASH_TABLE dataBufHashTablePtr;
+static DATA_BUF_LRU_LIST dataBufLruList;
+
+void init_data_buffer()
+{
+	unsigned int entry;
+
+	dataBufMapPtr = (P_DATA_BUF_MAP)DATA_BUF_MAP_ADDR;
+	dataBufHashTablePtr = (P_DATA_BUF_HASH_TABLE)DATA_BUF_HASH_TABLE_ADDR;
+
+	for(entry = 0; entry < DATA_BUF_ENTRIES; entry++)
+	{
+		memset(&dataBufMapPtr->entry[entry], 0, sizeof(DATA_BUF_ENTRY));
+		dataBufMapPtr->entry[entry].lpn = PAGE_NONE;
+		dataBufMapPtr->entry[entry].prevEntry = (entry == 0) ? DATA_BUF_NONE : entry - 1;
+		dataBufMapPtr->entry[entry].nextEntry = (entry == DATA_BUF_ENTRIES - 1) ? DATA_BUF_NONE : entry + 1;
+		dataBufMapPtr->entry[entry].hashPrevEntry = DATA_BUF_NONE;
+		dataBufMapPtr->entry[entry].hashNextEntry = DATA_BUF_NONE;
+	}
+
+	memset(dataBufHashTablePtr, 0xFF, sizeof(DATA_BUF_HASH_TABLE));
+
+	dataBufLruList.headEntry = 0;
+	dataBufLruList.tailEntry = DATA_BUF_ENTRIES - 1;
+}
+
+static unsigned int check_data_buffer(unsigned int lpn)
+{
+	unsigned int entry;
+
+	entry = dataBufHashTablePtr->headEntry[HASH(lpn)];
+	while(entry != DATA_BUF_NONE)
+	{
+		if(dataBufMapPtr->entry[entry].lpn == lpn)
+			return entry;
+		entry = dataBufMapPtr->entry[entry].hashNextEntry;
+	}
+
+	return DATA_BUF_NONE;
+}
+
+static void put_to_hash_list(unsigned int entry)
+{
+	DATA_BUF_ENTRY *bufEntry;
+	unsigned int bucket;
+
+	bufEntry = &dataBufMapPtr->entry[entry];
+	bucket = HASH(bufEntry->lpn);
+
+	bufEntry->hashPrevEntry = DATA_BUF_NONE;
+	bufEntry->hashNextEntry = dataBufHashTablePtr->headEntry[bucket];
+	if(bufEntry->hashNextEntry != DATA_BUF_NONE)
+		dataBufMapPtr->entry[bufEntry->hashNextEntry].hashPrevEntry = entry;
+	dataBufHashTablePtr->headEntry[bucket] = entry;
+}
+
+static void remove_from_hash_list(unsigned int entry)
+{
+	DATA_BUF_ENTRY *bufEntry;
+
+	bufEntry = &dataBufMapPtr->entry[entry];
+
+	if(bufEntry->hashPrevEntry == DATA_BUF_NONE)
+		dataBufHashTablePtr->headEntry[HASH(bufEntry->lpn)] = bufEntry->hashNextEntry;
+	else
+		dataBufMapPtr->entry[bufEntry->hashPrevEntry].hashNextEntry = bufEntry->hashNextEntry;
+
+	if(bufEntry->hashNextEntry != DATA_BUF_NONE)
+		dataBufMapPtr->entry[bufEntry->hashNextEntry].hashPrevEntry = bufEntry->hashPrevEntry;
+
+	bufEntry->hashPrevEntry = DATA_BUF_NONE;
+	bufEntry->hashNextEntry = DATA_BUF_NONE;
+}
+
+static void touch_data_buffer(unsigned int entry)
+{
+	DATA_BUF_ENTRY *bufEntry;
+
+	if(dataBufLruList.headEntry == entry)
+		return;
+
+	bufEntry = &dataBufMapPtr->entry[entry];
+
+	//unlink, the entry is not the head so it has a previous entry
+	dataBufMapPtr->entry[bufEntry->prevEntry].nextEntry = bufEntry->nextEntry;
+	if(bufEntry->nextEntry == DATA_BUF_NONE)
+		dataBufLruList.tailEntry = bufEntry->prevEntry;
+	else
+		dataBufMapPtr->entry[bufEntry->nextEntry].prevEntry = bufEntry->prevEntry;
+
+	bufEntry->prevEntry = DATA_BUF_NONE;
+	bufEntry->nextEntry = dataBufLruList.headEntry;
+	dataBufMapPtr->entry[dataBufLruList.headEntry].prevEntry = entry;
+	dataBufLruList.headEntry = entry;
+}
+
+static void wait_data_buffer_dma(unsigned int entry)
+{
+	DATA_BUF_ENTRY *bufEntry;
+
+	bufEntry = &dataBufMapPtr->entry[entry];
+
+	if(bufEntry->txDmaExe)
+	{
+		while(!check_auto_tx_dma_partial_done(bufEntry->txDmaMark.tailIndex, bufEntry->txDmaMark.tailAssistIndex));
+		bufEntry->txDmaExe = 0;
+	}
+
+	if(bufEntry->rxDmaExe)
+	{
+		while(!check_auto_rx_dma_partial_done(bufEntry->rxDmaMark.tailIndex, bufEntry->rxDmaMark.tailAssistIndex));
+		bufEntry->rxDmaExe = 0;
+	}
+}
+
+static unsigned int evict_data_buffer(unsigned int lpn)
+{
+	DATA_BUF_ENTRY *bufEntry;
+	unsigned int entry;
+
+	entry = dataBufLruList.tailEntry;
+	bufEntry = &dataBufMapPtr->entry[entry];
+
+	wait_data_buffer_dma(entry);
+
+	if(bufEntry->lpn != PAGE_NONE)
+	{
+		if(bufEntry->dirty)
+			addr_trans_write(bufEntry->lpn, get_data_buffer_addr(entry));
+		remove_from_hash_list(entry);
+	}
+
+	bufEntry->lpn = lpn;
+	bufEntry->dirty = 0;
+	put_to_hash_list(entry);
+	touch_data_buffer(entry);
+
+	return entry;
+}
+
+unsigned int get_read_data_buffer(unsigned int lpn)
+{
+	unsigned int entry;
+
+	entry = check_data_buffer(lpn);
+	if(entry != DATA_BUF_NONE)
+	{
+		touch_data_buffer(entry);
+		return entry;
+	}
+
+	entry = evict_data_buffer(lpn);
+
+	//pages that were never written read back like the erased DDR4 hot region
+	if(!addr_trans_read(lpn, get_data_buffer_addr(entry)))
+		memset((void *)(unsigned long)get_data_buffer_addr(entry), 0xFF, BYTES_PER_PAGE);
+
+	return entry;
+}
+
+unsigned int get_write_data_buffer(unsigned int lpn)
+{
+	unsigned int entry;
+
+	entry = check_data_buffer(lpn);
+	if(entry != DATA_BUF_NONE)
+	{
+		//a pending read of the old data must finish before the host overwrites it
+		wait_data_buffer_dma(entry);
+		touch_data_buffer(entry);
+	}
+	else
+		entry = evict_data_buffer(lpn);
+
+	dataBufMapPtr->entry[entry].dirty = 1;
+
+	return entry;
+}
+
+//true if the page holds data, in the buffer or on flash, pages never written read back erased
+unsigned int is_page_written(unsigned int lpn)
+{
+	return (check_data_buffer(lpn) != DATA_BUF_NONE) || (logicalPageMapPtr->ppn[lpn] != PAGE_NONE);
+}
+
+unsigned long long get_data_buffer_addr(unsigned int entry)
+{
+	return DATA_BUF_BASE_ADDR + (unsigned long long)entry * BYTES_PER_PAGE;
+}
+
+void set_data_buffer_tx_dma(unsigned int entry)
+{
+	get_auto_tx_dma_mark(&dataBufMapPtr->entry[entry].txDmaMark);
+	dataBufMapPtr->entry[entry].txDmaExe = 1;
+}
+
+void set_data_buffer_rx_dma(unsigned int entry)
+{
+	get_auto_rx_dma_mark(&dataBufMapPtr->entry[entry].rxDmaMark);
+	dataBufMapPtr->entry[entry].rxDmaExe = 1;
+}
+
+void flush_data_buffer()
+{
+	DATA_BUF_ENTRY *bufEntry;
+	unsigned int entry;
+
+	for(entry = 0; entry < DATA_BUF_ENTRIES; entry++)
+	{
+		bufEntry = &dataBufMapPtr->entry[entry];
+		if(!bufEntry->dirty)
+			continue;
+
+		wait_data_buffer_dma(entry);
+		addr_trans_write(bufEntry->lpn, get_data_buffer_addr(entry));
+		bufEntry->dirty = 0;
+	}
+
+	g_flashBackend->sync();
+}
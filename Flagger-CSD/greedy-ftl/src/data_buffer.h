@@ -0,0 +1,97 @@
+//////////////////////////////////////////////////////////////////////////////////
+// data_buffer.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Data Buffer Manager
+// File Name: data_buffer.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the DDR4 write-back cache in front of the flash backend
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef DATA_BUFFER_H_
+#define DATA_BUFFER_H_
+
+#include "ftl_config.h"
+#include "nvme/host_lld.h"
+
+#define	DATA_BUF_NONE			0xFFFFFFFF
+
+typedef struct _DATA_BUF_ENTRY
+{
+	unsigned int lpn;
+	unsigned int prevEntry;			//LRU list, head is the most recently used entry
+	unsigned int nextEntry;
+	unsigned int hashPrevEntry;
+	unsigned int hashNextEntry;
+	HOST_DMA_MARK txDmaMark;		//host DMA that still reads or writes the entry
+	HOST_DMA_MARK rxDmaMark;
+	unsigned int dirty				:1;
+	unsigned int txDmaExe			:1;
+	unsigned int rxDmaExe			:1;
+	unsigned int reserved0			:29;
+} DATA_BUF_ENTRY;
+
+typedef struct _DATA_BUF_MAP
+{
+	DATA_BUF_ENTRY entry[DATA_BUF_ENTRIES];
+} DATA_BUF_MAP, *P_DATA_BUF_MAP;
+
+typedef struct _DATA_BUF_HASH_TABLE
+{
+	unsigned int headEntry[DATA_BUF_HASH_BUCKETS];
+} DATA_BUF_HASH_TABLE, *P_DATA_BUF_HASH_TABLE;
+
+typedef struct _DATA_BUF_LRU_LIST
+{
+	unsigned int headEntry;
+	unsigned int tailEntry;
+} DATA_BUF_LRU_LIST;
+
+void init_data_buffer();
+
+unsigned int get_read_data_buffer(unsigned int lpn);
+
+unsigned int get_write_data_buffer(unsigned int lpn);
+
+unsigned int is_page_written(unsigned int lpn);
+
+unsigned long long get_data_buffer_addr(unsigned int entry);
+
+void set_data_buffer_tx_dma(unsigned int entry);
+
+void set_data_buffer_rx_dma(unsigned int entry);
+
+void flush_data_buffer();
+
+extern P_DATA_BUF_MAP dataBufMapPtr;
+
+#endif /* DATA_BUFFER_H_ */
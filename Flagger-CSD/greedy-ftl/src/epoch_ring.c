@@ -0,0 +1,158 @@
+//////////////////////////////////////////////////////////////////////////////////
+// epoch_ring.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Epoch Ring
+// File Name: epoch_ring.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - keeps N aggregation epochs per ring and the round currently uploaded
+//   - redirects the view ACTIDs to the epoch of the current round
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+
+#include "ftl_config.h"
+#include "epoch_ring.h"
+
+EPOCH_RING epochRing[EPOCH_MAX_RINGS];
+
+static unsigned int overlap(unsigned int start, unsigned int end, unsigned int lo, unsigned int hi)
+{
+	return (start < hi) && (lo < end);
+}
+
+void init_epoch_ring()
+{
+	memset(epochRing, 0, sizeof(epochRing));
+}
+
+unsigned int epoch_ring_configure(unsigned int ring, unsigned int baseACTID, unsigned int epochBlocks, unsigned int nEpochs, unsigned int viewACTID)
+{
+	unsigned long long ringBlocks;
+	unsigned int idx;
+
+	if(ring >= EPOCH_MAX_RINGS)
+		return EPOCH_STATUS_INVALID;
+
+	//zero epochs releases the ring
+	if(nEpochs == 0)
+	{
+		memset(&epochRing[ring], 0, sizeof(EPOCH_RING));
+		return EPOCH_STATUS_OK;
+	}
+
+	ringBlocks = (unsigned long long)epochBlocks * nEpochs;
+	if(epochBlocks == 0 || nEpochs < 2 || nEpochs > EPOCH_MAX_EPOCHS)
+		return EPOCH_STATUS_INVALID;
+	if(baseACTID >= HOT_REGION_PAGES || ringBlocks > HOT_REGION_PAGES - baseACTID)
+		return EPOCH_STATUS_INVALID;
+	if(viewACTID >= storageCapacity_L || epochBlocks > storageCapacity_L - viewACTID)
+		return EPOCH_STATUS_INVALID;
+	if(overlap(viewACTID, viewACTID + epochBlocks, baseACTID, baseACTID + (unsigned int)ringBlocks))
+		return EPOCH_STATUS_INVALID;
+
+	//a view must not shadow the view of another ring
+	for(idx = 0; idx < EPOCH_MAX_RINGS; idx++)
+		if(idx != ring && epochRing[idx].nEpochs
+			&& overlap(viewACTID, viewACTID + epochBlocks, epochRing[idx].viewACTID, epochRing[idx].viewACTID + epochRing[idx].epochBlocks))
+			return EPOCH_STATUS_INVALID;
+
+	epochRing[ring].baseACTID = baseACTID;
+	epochRing[ring].epochBlocks = epochBlocks;
+	epochRing[ring].nEpochs = nEpochs;
+	epochRing[ring].viewACTID = viewACTID;
+	epochRing[ring].round = 0;
+	epochRing[ring].busyMask = 0x1;
+
+	return EPOCH_STATUS_OK;
+}
+
+unsigned int epoch_ring_advance(unsigned int ring, unsigned int *round, unsigned int *epochACTID)
+{
+	EPOCH_RING *epoch;
+	unsigned int next;
+
+	if(ring >= EPOCH_MAX_RINGS || epochRing[ring].nEpochs == 0)
+		return EPOCH_STATUS_INVALID;
+
+	epoch = &epochRing[ring];
+	next = (epoch->round + 1) % epoch->nEpochs;
+	if((epoch->busyMask >> next) & 0x1)
+		return EPOCH_STATUS_BUSY;
+
+	epoch->round++;
+	epoch->busyMask |= (1 << next);
+
+	*round = epoch->round;
+	*epochACTID = epoch->baseACTID + next * epoch->epochBlocks;
+
+	return EPOCH_STATUS_OK;
+}
+
+unsigned int epoch_ring_release(unsigned int ring, unsigned int round)
+{
+	EPOCH_RING *epoch;
+
+	if(ring >= EPOCH_MAX_RINGS || epochRing[ring].nEpochs == 0)
+		return EPOCH_STATUS_INVALID;
+
+	//only completed rounds that still own their epoch can be released
+	epoch = &epochRing[ring];
+	if(round >= epoch->round || epoch->round - round >= epoch->nEpochs)
+		return EPOCH_STATUS_INVALID;
+
+	epoch->busyMask &= ~(1 << (round % epoch->nEpochs));
+
+	return EPOCH_STATUS_OK;
+}
+
+//returns 0 if the range straddles the edge of a view
+unsigned int epoch_translate(unsigned int *actid, unsigned int nBlocks)
+{
+	EPOCH_RING *epoch;
+	unsigned int idx;
+
+	for(idx = 0; idx < EPOCH_MAX_RINGS; idx++)
+	{
+		epoch = &epochRing[idx];
+		if(epoch->nEpochs == 0 || !overlap(*actid, *actid + nBlocks, epoch->viewACTID, epoch->viewACTID + epoch->epochBlocks))
+			continue;
+
+		if(*actid < epoch->viewACTID || nBlocks > epoch->viewACTID + epoch->epochBlocks - *actid)
+			return 0;
+
+		*actid = epoch->baseACTID + (epoch->round % epoch->nEpochs) * epoch->epochBlocks + (*actid - epoch->viewACTID);
+		return 1;
+	}
+
+	return 1;
+}
@@ -0,0 +1,90 @@
+//////////////////////////////////////////////////////////////////////////////////
+// epoch_ring.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Epoch Ring
+// File Name: epoch_ring.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the ring-buffered aggregation regions of federated rounds
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef EPOCH_RING_H_
+#define EPOCH_RING_H_
+
+#include "ftl_config.h"
+
+#define	EPOCH_MAX_RINGS					4
+#define	EPOCH_MAX_EPOCHS				32		//one busy bit per epoch
+
+/* Vendor admin command ADMIN_EPOCH_RING, dword10 [7:0] action, [15:8] ring */
+#define	EPOCH_ACTION_CONFIGURE			0x0		//dword11 base, dword12 epoch blocks, dword13 epochs, dword14 view
+#define	EPOCH_ACTION_ADVANCE			0x1		//dword11 bit 0 clears the new epoch, completion dword0 is the new round
+#define	EPOCH_ACTION_RELEASE			0x2		//dword11 round whose epoch the host has read out
+
+#define	EPOCH_ADVANCE_CLEAR				0x1
+
+#define	EPOCH_STATUS_OK					0
+#define	EPOCH_STATUS_INVALID			1
+#define	EPOCH_STATUS_BUSY				2		//the next epoch still holds an unreleased round
+
+/*
+ * A ring holds nEpochs epochs of epochBlocks blocks starting at baseACTID.
+ * Round r lives in epoch r % nEpochs. I/O and aggregation addressed to the
+ * view, epochBlocks blocks at viewACTID, go to the epoch of the current round,
+ * so clients keep writing to the same ACTIDs while the host reduces and reads
+ * out older rounds through their epoch ACTIDs. Advancing the round is atomic
+ * with respect to command processing: a command belongs to the round that is
+ * current when the firmware handles it.
+ */
+typedef struct _EPOCH_RING
+{
+	unsigned int baseACTID;
+	unsigned int epochBlocks;
+	unsigned int nEpochs;			//0 if the ring is not configured
+	unsigned int viewACTID;
+	unsigned int round;
+	unsigned int busyMask;			//epochs holding the current or an unreleased round
+} EPOCH_RING;
+
+extern EPOCH_RING epochRing[EPOCH_MAX_RINGS];
+
+void init_epoch_ring();
+
+unsigned int epoch_ring_configure(unsigned int ring, unsigned int baseACTID, unsigned int epochBlocks, unsigned int nEpochs, unsigned int viewACTID);
+
+unsigned int epoch_ring_advance(unsigned int ring, unsigned int *round, unsigned int *epochACTID);
+
+unsigned int epoch_ring_release(unsigned int ring, unsigned int round);
+
+unsigned int epoch_translate(unsigned int *actid, unsigned int nBlocks);
+
+#endif /* EPOCH_RING_H_ */
@@ -0,0 +1,68 @@
+//////////////////////////////////////////////////////////////////////////////////
+// flash_backend.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Flash Backend
+// File Name: flash_backend.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the page/block interface between the FTL and the capacity tier
+//   - every programmed page carries a spare area used to rebuild the map at mount
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FLASH_BACKEND_H_
+#define FLASH_BACKEND_H_
+
+#include "ftl_config.h"
+
+typedef struct _FLASH_SPARE
+{
+	unsigned int lpn;
+	unsigned int blockSeq;	//zero means the page was never programmed since the last erase
+} FLASH_SPARE;
+
+typedef struct _FLASH_BACKEND_OPS
+{
+	const char *name;
+	unsigned int (*init)();	//returns 1 if an existing flash image was found
+	void (*read_page)(unsigned int ppn, unsigned long long bufAddr);
+	void (*read_block_spare)(unsigned int pbn, FLASH_SPARE *spare);	//PAGES_PER_BLOCK entries
+	void (*program_page)(unsigned int ppn, unsigned long long bufAddr, FLASH_SPARE *spare);
+	void (*erase_block)(unsigned int pbn);
+	void (*sync)();
+} FLASH_BACKEND_OPS;
+
+extern const FLASH_BACKEND_OPS ddr4FlashBackendOps;
+extern const FLASH_BACKEND_OPS fileFlashBackendOps;
+
+extern const FLASH_BACKEND_OPS *g_flashBackend;
+
+#endif /* FLASH_BACKEND_H_ */
@@ -0,0 +1,93 @@
+//////////////////////////////////////////////////////////////////////////////////
+// flash_backend_ddr4.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Flash Backend (DDR4)
+// File Name: flash_backend_ddr4.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - keeps the flash image in the DDR4 flash image region
+//   - spare areas follow the last page of the image, nothing survives a power cycle
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+
+#include "ftl_config.h"
+#include "flash_backend.h"
+
+#define PAGE_ADDR(ppn)		(DDR4_FLASH_IMAGE_BASE_ADDR + (unsigned long long)(ppn) * BYTES_PER_PAGE)
+#define SPARE_AREA_ADDR		(DDR4_FLASH_IMAGE_BASE_ADDR + (unsigned long long)TOTAL_PAGES * BYTES_PER_PAGE)
+
+static FLASH_SPARE *spareArea;
+
+static unsigned int ddr4_init()
+{
+	spareArea = (FLASH_SPARE *)(unsigned long)SPARE_AREA_ADDR;
+	memset(spareArea, 0, sizeof(FLASH_SPARE) * TOTAL_PAGES);
+
+	return 0;
+}
+
+static void ddr4_read_page(unsigned int ppn, unsigned long long bufAddr)
+{
+	memcpy((void *)(unsigned long)bufAddr, (void *)(unsigned long)PAGE_ADDR(ppn), BYTES_PER_PAGE);
+}
+
+static void ddr4_read_block_spare(unsigned int pbn, FLASH_SPARE *spare)
+{
+	memcpy(spare, &spareArea[pbn * PAGES_PER_BLOCK], sizeof(FLASH_SPARE) * PAGES_PER_BLOCK);
+}
+
+static void ddr4_program_page(unsigned int ppn, unsigned long long bufAddr, FLASH_SPARE *spare)
+{
+	memcpy((void *)(unsigned long)PAGE_ADDR(ppn), (void *)(unsigned long)bufAddr, BYTES_PER_PAGE);
+	spareArea[ppn] = *spare;
+}
+
+static void ddr4_erase_block(unsigned int pbn)
+{
+	memset(&spareArea[pbn * PAGES_PER_BLOCK], 0, sizeof(FLASH_SPARE) * PAGES_PER_BLOCK);
+}
+
+static void ddr4_sync()
+{
+}
+
+const FLASH_BACKEND_OPS ddr4FlashBackendOps =
+{
+	"ddr4",
+	ddr4_init,
+	ddr4_read_page,
+	ddr4_read_block_spare,
+	ddr4_program_page,
+	ddr4_erase_block,
+	ddr4_sync
+};
@@ -0,0 +1,127 @@
+//////////////////////////////////////////////////////////////////////////////////
+// flash_backend_file.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Flash Backend (File)
+// File Name: flash_backend_file.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - keeps the flash image in a host file for the Linux simulation build
+//   - the image persists, so the FTL can rebuild its map from the spare areas at mount
+//   - only built with FLASH_BACKEND == FLASH_BACKEND_FILE
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#define _FILE_OFFSET_BITS 64
+
+#include "ftl_config.h"
+#include "flash_backend.h"
+
+#if (FLASH_BACKEND == FLASH_BACKEND_FILE)
+
+#include "stdio.h"
+#include "string.h"
+#include "nvme/debug.h"
+
+#define PAGE_OFFSET(ppn)	((off_t)(ppn) * BYTES_PER_PAGE)
+#define SPARE_OFFSET(ppn)	((off_t)TOTAL_PAGES * BYTES_PER_PAGE + (off_t)(ppn) * sizeof(FLASH_SPARE))
+
+static FILE *imageFile;
+
+static void file_access(off_t offset, void *buf, unsigned int size, unsigned int write)
+{
+	size_t done;
+
+	fseeko(imageFile, offset, SEEK_SET);
+	if(write)
+		done = fwrite(buf, 1, size, imageFile);
+	else
+		done = fread(buf, 1, size, imageFile);
+
+	ASSERT(done == size);
+}
+
+static unsigned int file_init()
+{
+	unsigned char lastByte = 0;
+
+	imageFile = fopen(FLASH_IMAGE_FILE_NAME, "r+b");
+	if(imageFile)
+		return 1;
+
+	//a sparse file reads back as zero, which is the spare area of an erased page
+	imageFile = fopen(FLASH_IMAGE_FILE_NAME, "w+b");
+	ASSERT(imageFile != NULL);
+	file_access(SPARE_OFFSET(TOTAL_PAGES) - 1, &lastByte, 1, 1);
+
+	return 0;
+}
+
+static void file_read_page(unsigned int ppn, unsigned long long bufAddr)
+{
+	file_access(PAGE_OFFSET(ppn), (void *)(unsigned long)bufAddr, BYTES_PER_PAGE, 0);
+}
+
+static void file_read_block_spare(unsigned int pbn, FLASH_SPARE *spare)
+{
+	file_access(SPARE_OFFSET(pbn * PAGES_PER_BLOCK), spare, sizeof(FLASH_SPARE) * PAGES_PER_BLOCK, 0);
+}
+
+static void file_program_page(unsigned int ppn, unsigned long long bufAddr, FLASH_SPARE *spare)
+{
+	file_access(PAGE_OFFSET(ppn), (void *)(unsigned long)bufAddr, BYTES_PER_PAGE, 1);
+	file_access(SPARE_OFFSET(ppn), spare, sizeof(FLASH_SPARE), 1);
+}
+
+static void file_erase_block(unsigned int pbn)
+{
+	FLASH_SPARE spare[PAGES_PER_BLOCK];
+
+	memset(spare, 0, sizeof(spare));
+	file_access(SPARE_OFFSET(pbn * PAGES_PER_BLOCK), spare, sizeof(spare), 1);
+}
+
+static void file_sync()
+{
+	fflush(imageFile);
+}
+
+const FLASH_BACKEND_OPS fileFlashBackendOps =
+{
+	"file",
+	file_init,
+	file_read_page,
+	file_read_block_spare,
+	file_program_page,
+	file_erase_block,
+	file_sync
+};
+
+#endif
@@ -0,0 +1,73 @@
+//////////////////////////////////////////////////////////////////////////////////
+// ftl_config.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: FTL Configuration
+// File Name: ftl_config.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - selects the flash backend and brings up the FTL tables and the data buffer
+//   - reports the capacity of the DDR4 hot region plus the FTL tier
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "xil_printf.h"
+#include "nvme/debug.h"
+
+#include "ftl_config.h"
+#include "flash_backend.h"
+#include "address_translation.h"
+#include "garbage_collection.h"
+#include "data_buffer.h"
+
+unsigned int storageCapacity_L;
+const FLASH_BACKEND_OPS *g_flashBackend;
+
+void ftl_init()
+{
+	unsigned int existingImage;
+
+	ASSERT(sizeof(BLOCK_ENTRY) == BLOCK_ENTRY_BYTES);
+	ASSERT(sizeof(DATA_BUF_ENTRY) == DATA_BUF_ENTRY_BYTES);
+
+#if (FLASH_BACKEND == FLASH_BACKEND_FILE)
+	g_flashBackend = &fileFlashBackendOps;
+#else
+	g_flashBackend = &ddr4FlashBackendOps;
+#endif
+
+	existingImage = g_flashBackend->init();
+	xil_printf("[ flash backend: %s, %d blocks ]\r\n", g_flashBackend->name, (unsigned int)TOTAL_BLOCKS);
+
+	init_address_map(existingImage);
+	init_data_buffer();
+
+	storageCapacity_L = HOT_REGION_PAGES + USER_PAGES;
+}
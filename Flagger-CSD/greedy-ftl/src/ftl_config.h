@@ -0,0 +1,117 @@
+//////////////////////////////////////////////////////////////////////////////////
+// ftl_config.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: FTL Configuration
+// File Name: ftl_config.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - defines the geometry of the flash backend and the capacity of the page-mapped FTL
+//   - places the FTL tables in the FTL management region
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FTL_CONFIG_H_
+#define FTL_CONFIG_H_
+
+#include "xparameters.h"
+#include "nvme/nvme.h"
+#include "memory_map.h"
+
+//************************************************************************
+#define	FLASH_BACKEND_DDR4					0	//flash image in DDR4, lost at power off
+#define	FLASH_BACKEND_FILE					1	//flash image in a host file (Linux simulation)
+
+#ifndef FLASH_BACKEND
+#define	FLASH_BACKEND						FLASH_BACKEND_DDR4
+#endif
+
+#define	FLASH_IMAGE_FILE_NAME				"flagger_flash.img"
+//************************************************************************
+
+#define	BYTES_PER_PAGE						(BYTES_PER_NVME_BLOCK)
+#define	PAGES_PER_BLOCK						256
+#define	BYTES_PER_BLOCK						(BYTES_PER_PAGE * PAGES_PER_BLOCK)
+
+#ifndef FLASH_FILE_BLOCKS
+#define	FLASH_FILE_BLOCKS					131072		//128GB
+#endif
+
+#if (FLASH_BACKEND == FLASH_BACKEND_FILE)
+#define	TOTAL_BLOCKS						(FLASH_FILE_BLOCKS)
+#else
+#define	TOTAL_BLOCKS						(DDR4_FLASH_IMAGE_SIZE / (BYTES_PER_BLOCK + PAGES_PER_BLOCK * 8))
+#endif
+#define	TOTAL_PAGES							(TOTAL_BLOCKS * PAGES_PER_BLOCK)
+
+#define	OVER_PROVISION_BLOCKS				(TOTAL_BLOCKS / 14)	//about 7%
+#define	USER_BLOCKS							(TOTAL_BLOCKS - OVER_PROVISION_BLOCKS)
+#define	USER_PAGES							(USER_BLOCKS * PAGES_PER_BLOCK)
+
+//garbage collection keeps at least this many free blocks
+#define	GC_FREE_BLOCK_THRESHOLD				4
+
+//ACTIDs below HOT_REGION_PAGES stay in DDR4, the remaining ACTIDs are served by the FTL
+#define	HOT_REGION_PAGES					(DDR4_HOT_REGION_SIZE / BYTES_PER_NVME_BLOCK)
+
+#define	DATA_BUF_ENTRIES					65536		//256MB of the DDR4 data buffer region
+#define	DATA_BUF_HASH_BUCKETS				65536		//power of two
+#define	DATA_BUF_BASE_ADDR					(DDR4_DATA_BUFFER_BASE_ADDR)
+#define	GC_BUF_ADDR							(DATA_BUF_BASE_ADDR + (unsigned long long)DATA_BUF_ENTRIES * BYTES_PER_PAGE)
+
+//fill pattern pages the host reads for blocks of the hot region that are not materialized
+#define	FILL_ERASED_PAGE_ADDR				(GC_BUF_ADDR + BYTES_PER_PAGE)
+#define	FILL_ZERO_PAGE_ADDR					(FILL_ERASED_PAGE_ADDR + BYTES_PER_PAGE)
+
+#if ((DATA_BUF_ENTRIES + 3) * BYTES_PER_PAGE > DDR4_DATA_BUFFER_SIZE)
+#error "data buffer does not fit in the DDR4 data buffer region"
+#endif
+
+//FTL management region layout, entry sizes are checked against the table types at ftl_init()
+#define	BLOCK_ENTRY_BYTES					20
+#define	DATA_BUF_ENTRY_BYTES				40
+
+#define	LOGICAL_PAGE_MAP_ADDR				(FTL_MANAGEMENT_START_ADDR)
+#define	PHYSICAL_PAGE_MAP_ADDR				(LOGICAL_PAGE_MAP_ADDR + USER_PAGES * 4)
+#define	BLOCK_MAP_ADDR						(PHYSICAL_PAGE_MAP_ADDR + TOTAL_PAGES * 4)
+#define	VICTIM_BLOCK_LIST_ADDR				(BLOCK_MAP_ADDR + TOTAL_BLOCKS * BLOCK_ENTRY_BYTES)
+#define	DATA_BUF_MAP_ADDR					(VICTIM_BLOCK_LIST_ADDR + (PAGES_PER_BLOCK + 1) * 8)
+#define	DATA_BUF_HASH_TABLE_ADDR			(DATA_BUF_MAP_ADDR + DATA_BUF_ENTRIES * DATA_BUF_ENTRY_BYTES)
+#define	FTL_MANAGEMENT_USED_END_ADDR		(DATA_BUF_HASH_TABLE_ADDR + DATA_BUF_HASH_BUCKETS * 4)
+
+#if (FTL_MANAGEMENT_USED_END_ADDR > FTL_MANAGEMENT_END_ADDR)
+#error "FTL tables exceed the FTL management region"
+#endif
+
+void ftl_init();
+
+extern unsigned int storageCapacity_L;
+
+#endif /* FTL_CONFIG_H_ */
@@ -0,0 +1,148 @@
+//////////////////////////////////////////////////////////////////////////////////
+// garbage_collection.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Garbage Collector
+// File Name: garbage_collection.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - keeps full blocks in buckets indexed by their number of invalid pages
+//   - greedy policy: the victim is a block of the highest non-empty bucket
+//   - copies the valid pages of the victim through the GC buffer and erases it
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "nvme/debug.h"
+
+#include "ftl_config.h"
+#include "flash_backend.h"
+#include "address_translation.h"
+#include "garbage_collection.h"
+
+P_VICTIM_BLOCK_LIST victimBlockListPtr;
+
+void init_victim_block_list()
+{
+	unsigned int invalidCnt;
+
+	victimBlockListPtr = (P_VICTIM_BLOCK_LIST)VICTIM_BLOCK_LIST_ADDR;
+
+	for(invalidCnt = 0; invalidCnt <= PAGES_PER_BLOCK; invalidCnt++)
+	{
+		victimBlockListPtr->bucket[invalidCnt].headBlock = BLOCK_NONE;
+		victimBlockListPtr->bucket[invalidCnt].tailBlock = BLOCK_NONE;
+	}
+}
+
+void put_victim_block(unsigned int pbn)
+{
+	VICTIM_BLOCK_ENTRY *bucket;
+	BLOCK_ENTRY *block;
+
+	block = &blockMapPtr->block[pbn];
+	bucket = &victimBlockListPtr->bucket[block->invalidCnt];
+
+	block->prevBlock = bucket->tailBlock;
+	block->nextBlock = BLOCK_NONE;
+	if(bucket->tailBlock == BLOCK_NONE)
+		bucket->headBlock = pbn;
+	else
+		blockMapPtr->block[bucket->tailBlock].nextBlock = pbn;
+	bucket->tailBlock = pbn;
+}
+
+void remove_victim_block(unsigned int pbn)
+{
+	VICTIM_BLOCK_ENTRY *bucket;
+	BLOCK_ENTRY *block;
+
+	block = &blockMapPtr->block[pbn];
+	bucket = &victimBlockListPtr->bucket[block->invalidCnt];
+
+	if(block->prevBlock == BLOCK_NONE)
+		bucket->headBlock = block->nextBlock;
+	else
+		blockMapPtr->block[block->prevBlock].nextBlock = block->nextBlock;
+
+	if(block->nextBlock == BLOCK_NONE)
+		bucket->tailBlock = block->prevBlock;
+	else
+		blockMapPtr->block[block->nextBlock].prevBlock = block->prevBlock;
+
+	block->prevBlock = BLOCK_NONE;
+	block->nextBlock = BLOCK_NONE;
+}
+
+unsigned int get_victim_block()
+{
+	unsigned int invalidCnt;
+
+	//blocks without invalid pages give nothing back
+	for(invalidCnt = PAGES_PER_BLOCK; invalidCnt > 0; invalidCnt--)
+		if(victimBlockListPtr->bucket[invalidCnt].headBlock != BLOCK_NONE)
+			return victimBlockListPtr->bucket[invalidCnt].headBlock;
+
+	return BLOCK_NONE;
+}
+
+void garbage_collection()
+{
+	unsigned int victim, page, ppn, lpn;
+
+	ftlStatus.gcRunning = 1;
+
+	while(ftlStatus.freeBlockCnt <= GC_FREE_BLOCK_THRESHOLD)
+	{
+		victim = get_victim_block();
+		if(victim == BLOCK_NONE)
+			break;
+
+		remove_victim_block(victim);
+		blockMapPtr->block[victim].state = BLOCK_STATE_VICTIM;
+
+		for(page = 0; page < PAGES_PER_BLOCK && blockMapPtr->block[victim].validCnt; page++)
+		{
+			ppn = victim * PAGES_PER_BLOCK + page;
+			lpn = physicalPageMapPtr->lpn[ppn];
+			if(lpn == PAGE_NONE)
+				continue;
+
+			g_flashBackend->read_page(ppn, GC_BUF_ADDR);
+			addr_trans_write(lpn, GC_BUF_ADDR);
+		}
+
+		ASSERT(blockMapPtr->block[victim].validCnt == 0);
+		g_flashBackend->erase_block(victim);
+		put_free_block(victim);
+		ftlStatus.gcVictimCnt++;
+	}
+
+	ftlStatus.gcRunning = 0;
+}
@@ -0,0 +1,69 @@
+//////////////////////////////////////////////////////////////////////////////////
+// garbage_collection.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Garbage Collector
+// File Name: garbage_collection.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the greedy victim selector and the garbage collector
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef GARBAGE_COLLECTION_H_
+#define GARBAGE_COLLECTION_H_
+
+#include "ftl_config.h"
+
+//full blocks are bucketed by their number of invalid pages
+typedef struct _VICTIM_BLOCK_ENTRY
+{
+	unsigned int headBlock;
+	unsigned int tailBlock;
+} VICTIM_BLOCK_ENTRY;
+
+typedef struct _VICTIM_BLOCK_LIST
+{
+	VICTIM_BLOCK_ENTRY bucket[PAGES_PER_BLOCK + 1];
+} VICTIM_BLOCK_LIST, *P_VICTIM_BLOCK_LIST;
+
+void init_victim_block_list();
+
+void put_victim_block(unsigned int pbn);
+
+void remove_victim_block(unsigned int pbn);
+
+unsigned int get_victim_block();
+
+void garbage_collection();
+
+extern P_VICTIM_BLOCK_LIST victimBlockListPtr;
+
+#endif /* GARBAGE_COLLECTION_H_ */
@@ -0,0 +1,206 @@
+//////////////////////////////////////////////////////////////////////////////////
+// hot_region.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Hot Region Manager
+// File Name: hot_region.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - keeps one state byte per 2MB chunk of the DDR4 hot region instead of clearing DDR4 at boot
+//   - reads of chunks that are not materialized are served from a fill pattern page
+//   - chunks are cleared in the background from the idle loop, or on first partial write
+//   - Write Zeroes and Deallocate of whole chunks only change the chunk state
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+#include "nvme/debug.h"
+
+#include "ftl_config.h"
+#include "hot_region.h"
+
+#define CHUNK_ADDR(chunk)	(DDR4_HOT_REGION_BASE_ADDR + (unsigned long long)(chunk) * BYTES_PER_HOT_CHUNK)
+#define BLOCK_ADDR(actid)	(DDR4_HOT_REGION_BASE_ADDR + (unsigned long long)(actid) * BYTES_PER_NVME_BLOCK)
+
+HOT_REGION_STATUS hotRegionStatus;
+
+static unsigned char chunk_fill(unsigned int chunk)
+{
+	return (hotRegionStatus.chunkState[chunk] == HOT_CHUNK_ZEROED) ? HOT_FILL_ZERO : HOT_FILL_ERASED;
+}
+
+static void set_chunk_materialized(unsigned int chunk)
+{
+	if(hotRegionStatus.chunkState[chunk] == HOT_CHUNK_MATERIALIZED)
+		return;
+
+	hotRegionStatus.chunkState[chunk] = HOT_CHUNK_MATERIALIZED;
+	hotRegionStatus.unmaterializedCnt--;
+
+	//the background cursor moves on, what it already cleared is kept
+	if(hotRegionStatus.bgChunk == chunk)
+		hotRegionStatus.bgOffset = 0;
+}
+
+static void set_chunk_synthetic(unsigned int chunk, unsigned int state)
+{
+	if(hotRegionStatus.chunkState[chunk] == HOT_CHUNK_MATERIALIZED)
+		hotRegionStatus.unmaterializedCnt++;
+	else if(hotRegionStatus.chunkState[chunk] != state && hotRegionStatus.bgChunk == chunk)
+		hotRegionStatus.bgOffset = 0;	//the part cleared so far holds the old pattern
+
+	hotRegionStatus.chunkState[chunk] = state;
+}
+
+static void materialize_chunk(unsigned int chunk)
+{
+	unsigned int offset;
+
+	if(hotRegionStatus.chunkState[chunk] == HOT_CHUNK_MATERIALIZED)
+		return;
+
+	offset = (hotRegionStatus.bgChunk == chunk) ? hotRegionStatus.bgOffset : 0;
+	memset((void *)(unsigned long)(CHUNK_ADDR(chunk) + offset), chunk_fill(chunk), BYTES_PER_HOT_CHUNK - offset);
+	set_chunk_materialized(chunk);
+}
+
+void init_hot_region()
+{
+	memset(hotRegionStatus.chunkState, HOT_CHUNK_UNWRITTEN, sizeof(hotRegionStatus.chunkState));
+	hotRegionStatus.bgChunk = 0;
+	hotRegionStatus.bgOffset = 0;
+	hotRegionStatus.unmaterializedCnt = HOT_CHUNKS;
+
+	memset((void *)(unsigned long)FILL_ERASED_PAGE_ADDR, HOT_FILL_ERASED, BYTES_PER_NVME_BLOCK);
+	memset((void *)(unsigned long)FILL_ZERO_PAGE_ADDR, HOT_FILL_ZERO, BYTES_PER_NVME_BLOCK);
+}
+
+unsigned int get_hot_region_extent(unsigned int actid, unsigned int nBlocks, unsigned long long *devAddr, unsigned int *synthetic)
+{
+	unsigned int chunk, state, extent;
+
+	chunk = actid / BLOCKS_PER_HOT_CHUNK;
+	state = hotRegionStatus.chunkState[chunk];
+
+	//neighbouring chunks in the same state extend the run
+	extent = BLOCKS_PER_HOT_CHUNK - (actid % BLOCKS_PER_HOT_CHUNK);
+	while(extent < nBlocks && hotRegionStatus.chunkState[++chunk] == state)
+		extent += BLOCKS_PER_HOT_CHUNK;
+	if(extent > nBlocks)
+		extent = nBlocks;
+
+	if(state == HOT_CHUNK_MATERIALIZED)
+	{
+		*devAddr = BLOCK_ADDR(actid);
+		*synthetic = 0;
+	}
+	else
+	{
+		*devAddr = (state == HOT_CHUNK_ZEROED) ? FILL_ZERO_PAGE_ADDR : FILL_ERASED_PAGE_ADDR;
+		*synthetic = 1;
+	}
+
+	return extent;
+}
+
+void prepare_hot_region_write(unsigned int actid, unsigned int nBlocks)
+{
+	unsigned int chunk, lastChunk;
+
+	chunk = actid / BLOCKS_PER_HOT_CHUNK;
+	lastChunk = (actid + nBlocks - 1) / BLOCKS_PER_HOT_CHUNK;
+
+	//only the chunks at both ends can be partially covered by the write
+	if(actid % BLOCKS_PER_HOT_CHUNK)
+		materialize_chunk(chunk);
+	if((actid + nBlocks) % BLOCKS_PER_HOT_CHUNK)
+		materialize_chunk(lastChunk);
+
+	for(; chunk <= lastChunk; chunk++)
+		set_chunk_materialized(chunk);
+}
+
+void materialize_hot_region(unsigned int actid, unsigned int nBlocks)
+{
+	unsigned int chunk, lastChunk;
+
+	lastChunk = (actid + nBlocks - 1) / BLOCKS_PER_HOT_CHUNK;
+	for(chunk = actid / BLOCKS_PER_HOT_CHUNK; chunk <= lastChunk; chunk++)
+		materialize_chunk(chunk);
+}
+
+void zero_hot_region(unsigned int actid, unsigned int nBlocks)
+{
+	unsigned int chunk, first, count;
+
+	while(nBlocks)
+	{
+		chunk = actid / BLOCKS_PER_HOT_CHUNK;
+		first = actid % BLOCKS_PER_HOT_CHUNK;
+		count = BLOCKS_PER_HOT_CHUNK - first;
+		if(count > nBlocks)
+			count = nBlocks;
+
+		if(count == BLOCKS_PER_HOT_CHUNK)
+			set_chunk_synthetic(chunk, HOT_CHUNK_ZEROED);
+		else if(hotRegionStatus.chunkState[chunk] != HOT_CHUNK_ZEROED)
+		{
+			materialize_chunk(chunk);
+			memset((void *)(unsigned long)BLOCK_ADDR(actid), HOT_FILL_ZERO, count * BYTES_PER_NVME_BLOCK);
+		}
+
+		actid += count;
+		nBlocks -= count;
+	}
+}
+
+unsigned int hot_region_background_step()
+{
+	unsigned int chunk;
+
+	if(hotRegionStatus.unmaterializedCnt == 0)
+		return 0;
+
+	chunk = hotRegionStatus.bgChunk;
+	if(hotRegionStatus.chunkState[chunk] == HOT_CHUNK_MATERIALIZED)
+	{
+		hotRegionStatus.bgChunk = (chunk + 1) % HOT_CHUNKS;
+		hotRegionStatus.bgOffset = 0;
+		return 1;
+	}
+
+	memset((void *)(unsigned long)(CHUNK_ADDR(chunk) + hotRegionStatus.bgOffset), chunk_fill(chunk), HOT_CHUNK_BG_STEP_BYTES);
+	hotRegionStatus.bgOffset += HOT_CHUNK_BG_STEP_BYTES;
+
+	if(hotRegionStatus.bgOffset == BYTES_PER_HOT_CHUNK)
+		set_chunk_materialized(chunk);
+
+	return 1;
+}
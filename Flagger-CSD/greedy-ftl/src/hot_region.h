@@ -0,0 +1,79 @@
+//////////////////////////////////////////////////////////////////////////////////
+// hot_region.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Hot Region Manager
+// File Name: hot_region.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the chunk state table of the DDR4 hot region
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef HOT_REGION_H_
+#define HOT_REGION_H_
+
+#include "ftl_config.h"
+
+#define	BLOCKS_PER_HOT_CHUNK			512		//2MB
+#define	HOT_CHUNKS						(HOT_REGION_PAGES / BLOCKS_PER_HOT_CHUNK)
+#define	BYTES_PER_HOT_CHUNK				(BLOCKS_PER_HOT_CHUNK * BYTES_PER_NVME_BLOCK)
+
+//bytes cleared by one background step, bounds the latency added to the main loop
+#define	HOT_CHUNK_BG_STEP_BYTES			(64 * 1024)
+
+#define	HOT_CHUNK_UNWRITTEN				0	//reads return the erase pattern (0xFF)
+#define	HOT_CHUNK_ZEROED				1	//reads return zeroes
+#define	HOT_CHUNK_MATERIALIZED			2	//DDR4 holds the data
+
+#define	HOT_FILL_ERASED					0xFF
+#define	HOT_FILL_ZERO					0x00
+
+typedef struct _HOT_REGION_STATUS
+{
+	unsigned char chunkState[HOT_CHUNKS];
+	unsigned int bgChunk;			//chunk being cleared in the background
+	unsigned int bgOffset;			//bytes of bgChunk already cleared
+	unsigned int unmaterializedCnt;
+} HOT_REGION_STATUS;
+
+void init_hot_region();
+
+unsigned int get_hot_region_extent(unsigned int actid, unsigned int nBlocks, unsigned long long *devAddr, unsigned int *synthetic);
+
+void prepare_hot_region_write(unsigned int actid, unsigned int nBlocks);
+
+void materialize_hot_region(unsigned int actid, unsigned int nBlocks);
+
+void zero_hot_region(unsigned int actid, unsigned int nBlocks);
+
+unsigned int hot_region_background_step();
+
+#endif /* HOT_REGION_H_ */
@@ -31,15 +31,19 @@
 // Module Name: Static Memory Allocator
 // File Name: memory_map.h
 //
-// Version: v1.0.0
+// Version: v1.1.0
 //
 // Description:
 //	 - allocate DRAM address space (0x0010_0000 ~ 0x3FFF_FFFF) to each module
+//	 - split the DDR4 space into the hot region, the data buffer and the flash image
 //////////////////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////////////////
 // Revision History:
 //
+// * v1.1.0
+//   - FTL management region and DDR4 layout are added
+//
 // * v1.0.0
 //   - First draft
 //////////////////////////////////////////////////////////////////////////////////
@@ -55,6 +59,11 @@
 #define NVME_MANAGEMENT_START_ADDR		0x00200000
 #define NVME_MANAGEMENT_END_ADDR		0x0FFFFFFF
 
+// Cached & Buffered
+//for FTL mapping tables and data buffer management
+#define FTL_MANAGEMENT_START_ADDR		0x18000000
+#define FTL_MANAGEMENT_END_ADDR			0x3FFFEFFF
+
 #define DUMMY_RD_WR_ADDR                (0x40000000 - 0x1000) // Reserved for NVMe IP.
 
 // Uncached & Unbuffered
@@ -63,5 +72,20 @@
 #define DRAM_END_ADDR				    0x7FFFFFFF
 
 #define DDR4_BUFFER_BASE_ADDR (XPAR_MIG_0_BASEADDR)
+#define DDR4_SIZE						0x1000000000ULL		// 64GB
+
+//ACTIDs of the hot region map linearly onto DDR4, aggregation works on them in place
+#define DDR4_HOT_REGION_BASE_ADDR		(DDR4_BUFFER_BASE_ADDR)
+#ifndef DDR4_HOT_REGION_SIZE
+#define DDR4_HOT_REGION_SIZE			0x400000000ULL		// 16GB, the simulation build uses a smaller one
+#endif
+
+//write-back data buffer in front of the flash backend
+#define DDR4_DATA_BUFFER_BASE_ADDR		(DDR4_HOT_REGION_BASE_ADDR + DDR4_HOT_REGION_SIZE)
+#define DDR4_DATA_BUFFER_SIZE			0x40000000ULL		// 1GB
+
+//flash image of the DDR4 backed flash backend
+#define DDR4_FLASH_IMAGE_BASE_ADDR		(DDR4_DATA_BUFFER_BASE_ADDR + DDR4_DATA_BUFFER_SIZE)
+#define DDR4_FLASH_IMAGE_SIZE			(DDR4_SIZE - DDR4_HOT_REGION_SIZE - DDR4_DATA_BUFFER_SIZE)
 
 #endif /* MEMORY_MAP_H_ */
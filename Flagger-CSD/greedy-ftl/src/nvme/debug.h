@@ -31,7 +31,7 @@
 // Module Name: Debug Mate
 // File Name: debug.h
 //
-// Version: v1.0.0
+// Version: v1.1.0
 //
 // Description:
 //   - defines macros for debugging
@@ -40,6 +40,9 @@
 //////////////////////////////////////////////////////////////////////////////////
 // Revision History:
 //
+// * v1.1.0
+//   - a failed ASSERT aborts the simulation build instead of spinning
+//
 // * v1.0.0
 //   - First draft
 //////////////////////////////////////////////////////////////////////////////////
@@ -59,12 +62,19 @@
 #define __IO_CMD_DONE_MESSAGE_PRINT 0
 #define __DEBUG 0
 
+#ifdef FLAGGER_SIM
+#include "stdlib.h"
+#define ASSERT_HALT()	abort()
+#else
+#define ASSERT_HALT()	while(1)
+#endif
+
 #if __ASSERT
 #define ASSERT(X)														\
 if (!(X))																\
 {																		\
 	xil_printf("\r\n\nerror in %s: Line %d\r\n", __FILE__, __LINE__);	\
-	while(1) ;															\
+	ASSERT_HALT() ;														\
 }
 #else
 #define ASSERT(X)
@@ -33,7 +33,7 @@
 // Module Name: NVMe Low Level Driver
 // File Name: host_lld.c
 //
-// Version: v1.1.0
+// Version: v1.2.0
 //
 // Description:
 //   - defines functions to control the NVMe controller
@@ -42,6 +42,9 @@
 //////////////////////////////////////////////////////////////////////////////////
 // Revision History:
 //
+// * v1.2.0
+//   - ranged auto DMA submission is added (one fifo count read per burst)
+//
 // * v1.1.0
 //	 - DMA partial done check functions are added
 //	 - DMA assist status is added to support DMA partial done check functions
@@ -58,6 +61,7 @@
 
 #include "nvme.h"
 #include "host_lld.h"
+#include "nvme_profile.h"
 
 extern NVME_CONTEXT g_nvmeTask;
 HOST_DMA_STATUS g_hostDmaStatus;
@@ -263,6 +267,7 @@ unsigned int get_nvme_cmd(unsigned short *qID, unsigned short *cmdSlotTag, unsig
 void set_auto_nvme_cpl(unsigned int cmdSlotTag, unsigned int specific, unsigned int statusFieldWord)
 {
 	NVME_CPL_FIFO_REG nvmeReg;
+	PROF_ENTER(profStart);
 
 	nvmeReg.specific = specific;
 	nvmeReg.cmdSlotTag = cmdSlotTag;
@@ -272,11 +277,14 @@ void set_auto_nvme_cpl(unsigned int cmdSlotTag, unsigned int specific, unsigned
 	//IO_WRITE32(NVME_CPL_FIFO_REG_ADDR, nvmeReg.dword[0]);
 	IO_WRITE32((NVME_CPL_FIFO_REG_ADDR + 4), nvmeReg.dword[1]);
 	IO_WRITE32((NVME_CPL_FIFO_REG_ADDR + 8), nvmeReg.dword[2]);
+
+	PROF_LEAVE(PROF_STAGE_CPL, profStart);
 }
 
 void set_nvme_slot_release(unsigned int cmdSlotTag)
 {
 	NVME_CPL_FIFO_REG nvmeReg;
+	PROF_ENTER(profStart);
 
 	nvmeReg.cmdSlotTag = cmdSlotTag;
 	nvmeReg.cplType = CMD_SLOT_RELEASE_TYPE;
@@ -284,11 +292,14 @@ void set_nvme_slot_release(unsigned int cmdSlotTag)
 	//IO_WRITE32(NVME_CPL_FIFO_REG_ADDR, nvmeReg.dword[0]);
 	//IO_WRITE32((NVME_CPL_FIFO_REG_ADDR + 4), nvmeReg.dword[1]);
 	IO_WRITE32((NVME_CPL_FIFO_REG_ADDR + 8), nvmeReg.dword[2]);
+
+	PROF_LEAVE(PROF_STAGE_CPL, profStart);
 }
 
 void set_nvme_cpl(unsigned int sqId, unsigned int cid, unsigned int specific, unsigned int statusFieldWord)
 {
 	NVME_CPL_FIFO_REG nvmeReg;
+	PROF_ENTER(profStart);
 
 	nvmeReg.cid = cid;
 	nvmeReg.sqId = sqId;
@@ -299,6 +310,8 @@ void set_nvme_cpl(unsigned int sqId, unsigned int cid, unsigned int specific, un
 	IO_WRITE32(NVME_CPL_FIFO_REG_ADDR, nvmeReg.dword[0]);
 	IO_WRITE32((NVME_CPL_FIFO_REG_ADDR + 4), nvmeReg.dword[1]);
 	IO_WRITE32((NVME_CPL_FIFO_REG_ADDR + 8), nvmeReg.dword[2]);
+
+	PROF_LEAVE(PROF_STAGE_CPL, profStart);
 }
 
 void set_io_sq(unsigned int ioSqIdx, unsigned int valid, unsigned int cqVector, unsigned int qSzie, unsigned int pcieBaseAddrL, unsigned int pcieBaseAddrH)
@@ -339,6 +352,7 @@ void set_io_cq(unsigned int ioCqIdx, unsigned int valid, unsigned int irqEn, uns
 void set_direct_tx_dma(unsigned int devAddrH, unsigned int devAddrL, unsigned int pcieAddrH, unsigned int pcieAddrL, unsigned int len)
 {
 	HOST_DMA_CMD_FIFO_REG hostDmaReg;
+	PROF_ENTER(profStart);
 
 	ASSERT((len <= 0x1000) && ((pcieAddrL & 0x3) == 0)); //modified
 	
@@ -351,6 +365,7 @@ void set_direct_tx_dma(unsigned int devAddrH, unsigned int devAddrL, unsigned in
 	hostDmaReg.dmaType = HOST_DMA_DIRECT_TYPE;
 	hostDmaReg.dmaDirection = HOST_DMA_TX_DIRECTION;
 	hostDmaReg.dmaLen = len;
+	hostDmaReg.cmdSlotTag = 0;		//a direct DMA belongs to no command slot
 
 	IO_WRITE32(HOST_DMA_CMD_FIFO_REG_ADDR, hostDmaReg.dword[0]);
 	IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 4), hostDmaReg.dword[1]);
@@ -361,11 +376,14 @@ void set_direct_tx_dma(unsigned int devAddrH, unsigned int devAddrL, unsigned in
 
 	g_hostDmaStatus.fifoTail.directDmaTx++;
 	g_hostDmaStatus.directDmaTxCnt++;
+
+	PROF_LEAVE(PROF_STAGE_DMA, profStart);
 }
 
 void set_direct_rx_dma(unsigned int devAddrH, unsigned int devAddrL, unsigned int pcieAddrH, unsigned int pcieAddrL, unsigned int len)
 {
 	HOST_DMA_CMD_FIFO_REG hostDmaReg;
+	PROF_ENTER(profStart);
 
 	ASSERT((len <= 0x1000) && ((pcieAddrL & 0x3) == 0)); //modified
 	
@@ -378,6 +396,7 @@ void set_direct_rx_dma(unsigned int devAddrH, unsigned int devAddrL, unsigned in
 	hostDmaReg.dmaType = HOST_DMA_DIRECT_TYPE;
 	hostDmaReg.dmaDirection = HOST_DMA_RX_DIRECTION;
 	hostDmaReg.dmaLen = len;
+	hostDmaReg.cmdSlotTag = 0;		//a direct DMA belongs to no command slot
 
 	IO_WRITE32(HOST_DMA_CMD_FIFO_REG_ADDR, hostDmaReg.dword[0]);
 	IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 4), hostDmaReg.dword[1]);
@@ -388,12 +407,15 @@ void set_direct_rx_dma(unsigned int devAddrH, unsigned int devAddrL, unsigned in
 
 	g_hostDmaStatus.fifoTail.directDmaRx++;
 	g_hostDmaStatus.directDmaRxCnt++;
+
+	PROF_LEAVE(PROF_STAGE_DMA, profStart);
 }
 
 void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddrH, unsigned int devAddrL, unsigned int autoCompletion)
 {
 	HOST_DMA_CMD_FIFO_REG hostDmaReg;
 	unsigned char tempTail;
+	PROF_ENTER(profStart);
 
 	ASSERT(cmd4KBOffset < 256);
 	
@@ -423,12 +445,15 @@ void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 		g_hostDmaAssistStatus.autoDmaTxOverFlowCnt++;
 
 	g_hostDmaStatus.autoDmaTxCnt++;
+
+	PROF_LEAVE(PROF_STAGE_DMA, profStart);
 }
 
 void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddrH, unsigned int devAddrL, unsigned int autoCompletion)
 {
 	HOST_DMA_CMD_FIFO_REG hostDmaReg;
 	unsigned char tempTail;
+	PROF_ENTER(profStart);
 
 	ASSERT(cmd4KBOffset < 256);
 	
@@ -458,6 +483,105 @@ void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 		g_hostDmaAssistStatus.autoDmaRxOverFlowCnt++;
 
 	g_hostDmaStatus.autoDmaRxCnt++;
+
+	PROF_LEAVE(PROF_STAGE_DMA, profStart);
+}
+
+static unsigned int get_auto_dma_free_entries(unsigned int direction)
+{
+	unsigned char head, tail;
+
+	g_hostDmaStatus.fifoHead.dword = IO_READ32(HOST_DMA_FIFO_CNT_REG_ADDR);
+	if(direction == HOST_DMA_TX_DIRECTION)
+	{
+		head = g_hostDmaStatus.fifoHead.autoDmaTx;
+		tail = g_hostDmaStatus.fifoTail.autoDmaTx;
+	}
+	else
+	{
+		head = g_hostDmaStatus.fifoHead.autoDmaRx;
+		tail = g_hostDmaStatus.fifoTail.autoDmaRx;
+	}
+
+	//one entry is kept empty to tell a full fifo from an empty one
+	return (unsigned char)(head - tail - 1);
+}
+
+static void set_auto_dma_range(unsigned int direction, unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int numOf4KB, unsigned long long devAddr, unsigned int autoCompletion)
+{
+	HOST_DMA_CMD_FIFO_REG hostDmaReg;
+	unsigned char tempTail;
+	unsigned int freeEntries, burst;
+	PROF_ENTER(profStart);
+
+	ASSERT(cmd4KBOffset + numOf4KB <= 256);
+
+	//the descriptor only changes in its device address and 4KB offset along the range
+	hostDmaReg.dword[4] = 0;
+	hostDmaReg.dmaType = HOST_DMA_AUTO_TYPE;
+	hostDmaReg.dmaDirection = direction;
+	hostDmaReg.cmdSlotTag = cmdSlotTag;
+	hostDmaReg.autoCompletion = autoCompletion;
+
+	while(numOf4KB)
+	{
+		freeEntries = get_auto_dma_free_entries(direction);
+		burst = (numOf4KB < freeEntries) ? numOf4KB : freeEntries;
+		numOf4KB -= burst;
+
+		while(burst--)
+		{
+			hostDmaReg.devAddrH = (unsigned int)(devAddr >> 32);
+			hostDmaReg.devAddrL = (unsigned int)(devAddr & 0xFFFFFFFF);
+			hostDmaReg.cmd4KBOffset = cmd4KBOffset++;
+
+			IO_WRITE32(HOST_DMA_CMD_FIFO_REG_ADDR, hostDmaReg.dword[0]);
+			IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 4), hostDmaReg.dword[1]);
+			IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 16), hostDmaReg.dword[4]);
+			IO_WRITE32((HOST_DMA_CMD_FIFO_REG_ADDR + 20), hostDmaReg.dword[5]);//slot_modified
+
+			if(direction == HOST_DMA_TX_DIRECTION)
+			{
+				tempTail = g_hostDmaStatus.fifoTail.autoDmaTx++;
+				if(tempTail > g_hostDmaStatus.fifoTail.autoDmaTx)
+					g_hostDmaAssistStatus.autoDmaTxOverFlowCnt++;
+				g_hostDmaStatus.autoDmaTxCnt++;
+			}
+			else
+			{
+				tempTail = g_hostDmaStatus.fifoTail.autoDmaRx++;
+				if(tempTail > g_hostDmaStatus.fifoTail.autoDmaRx)
+					g_hostDmaAssistStatus.autoDmaRxOverFlowCnt++;
+				g_hostDmaStatus.autoDmaRxCnt++;
+			}
+
+			devAddr += BYTES_PER_NVME_BLOCK;
+		}
+	}
+
+	PROF_LEAVE(PROF_STAGE_DMA, profStart);
+}
+
+void set_auto_tx_dma_range(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int numOf4KB, unsigned long long devAddr, unsigned int autoCompletion)
+{
+	set_auto_dma_range(HOST_DMA_TX_DIRECTION, cmdSlotTag, cmd4KBOffset, numOf4KB, devAddr, autoCompletion);
+}
+
+void set_auto_rx_dma_range(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int numOf4KB, unsigned long long devAddr, unsigned int autoCompletion)
+{
+	set_auto_dma_range(HOST_DMA_RX_DIRECTION, cmdSlotTag, cmd4KBOffset, numOf4KB, devAddr, autoCompletion);
+}
+
+void get_auto_tx_dma_mark(HOST_DMA_MARK *dmaMark)
+{
+	dmaMark->tailIndex = g_hostDmaStatus.fifoTail.autoDmaTx;
+	dmaMark->tailAssistIndex = g_hostDmaAssistStatus.autoDmaTxOverFlowCnt;
+}
+
+void get_auto_rx_dma_mark(HOST_DMA_MARK *dmaMark)
+{
+	dmaMark->tailIndex = g_hostDmaStatus.fifoTail.autoDmaRx;
+	dmaMark->tailAssistIndex = g_hostDmaAssistStatus.autoDmaRxOverFlowCnt;
 }
 
 void check_direct_tx_dma_done()
@@ -33,7 +33,7 @@
 // Module Name: NVMe Low Level Driver
 // File Name: host_lld.h
 //
-// Version: v1.1.0
+// Version: v1.2.0
 //
 // Description:
 //   - defines parameters and data structures of the NVMe low level driver
@@ -43,6 +43,9 @@
 //////////////////////////////////////////////////////////////////////////////////
 // Revision History:
 //
+// * v1.2.0
+//   - ranged auto DMA submission and DMA marks are added
+//
 // * v1.1.0
 //   - new DMA status type is added (HOST_DMA_ASSIST_STATUS)
 //	 - DMA partial done check functions are added
@@ -327,6 +330,13 @@ typedef struct _HOST_DMA_ASSIST_STATUS
 	unsigned int autoDmaRxOverFlowCnt;
 } HOST_DMA_ASSIST_STATUS;
 
+//fifo tail position right after a group of auto DMAs, for check_auto_*_dma_partial_done
+typedef struct _HOST_DMA_MARK
+{
+	unsigned int tailIndex;
+	unsigned int tailAssistIndex;
+} HOST_DMA_MARK;
+
 void dev_irq_init();
 
 void dev_irq_handler();
@@ -359,6 +369,14 @@ void set_auto_tx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigne
 
 void set_auto_rx_dma(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int devAddrH, unsigned int devAddrL, unsigned int autoCompletion);
 
+void set_auto_tx_dma_range(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int numOf4KB, unsigned long long devAddr, unsigned int autoCompletion);
+
+void set_auto_rx_dma_range(unsigned int cmdSlotTag, unsigned int cmd4KBOffset, unsigned int numOf4KB, unsigned long long devAddr, unsigned int autoCompletion);
+
+void get_auto_tx_dma_mark(HOST_DMA_MARK *dmaMark);
+
+void get_auto_rx_dma_mark(HOST_DMA_MARK *dmaMark);
+
 void set_link_width(unsigned int linkNum);
 
 void pcie_async_reset(unsigned int rstCnt);
@@ -31,15 +31,19 @@
 // Module Name: IO Access Mate
 // File Name: io_access.h
 //
-// Version: v1.0.0
+// Version: v1.1.0
 //
 // Description:
 //   - defines IO read/write macros
+//   - routes register accesses to the hardware model in the simulation build
 //////////////////////////////////////////////////////////////////////////////////
 
 //////////////////////////////////////////////////////////////////////////////////
 // Revision History:
 //
+// * v1.1.0
+//   - FLAGGER_SIM hooks are added
+//
 // * v1.0.0
 //   - First draft
 //////////////////////////////////////////////////////////////////////////////////
@@ -48,8 +52,15 @@
 #ifndef __IO_ACCESS_H_
 #define __IO_ACCESS_H_
 
+#ifdef FLAGGER_SIM
+#include "sim_io.h"
+
+#define IO_WRITE32(addr, val)		sim_io_write32((unsigned long)(addr), (val))
+#define IO_READ32(addr)				sim_io_read32((unsigned long)(addr))
+#else
 #define IO_WRITE32(addr, val)		*((volatile unsigned int *)(addr)) = val
 #define IO_READ32(addr)				*((volatile unsigned int *)(addr))
+#endif
 #define AGG_ACCEL_BASE 0x7FF00000
 
 #endif	//__IO_ACCESS_H_
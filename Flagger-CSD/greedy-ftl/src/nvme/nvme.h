@@ -55,12 +55,10 @@
 #define MAX_NUM_OF_IO_CQ	8
 
 #define ADMIN_CMD_DRAM_DATA_BUFFER		0x00200000
+#define IO_CMD_DRAM_DATA_BUFFER			0x00210000	//host data of I/O commands handled by the firmware (DSM ranges, client weights)
 
-#define ONE_GB                          (1024*1024*1024) /* 1GB */
-#define NVME_STORAGE                    68719476736ULL /* 64GB */
 #define	BYTES_PER_NVME_BLOCK		    (4096)               /* 4KB */
 
-#define STORAGE_CAPACITY_L				(NVME_STORAGE / BYTES_PER_NVME_BLOCK)
 #define STORAGE_CAPACITY_H				0x00000000
 
 #define MAX_NUM_OF_NLB					(512 * 1024 / 4096)
@@ -79,12 +77,15 @@
 #define ADMIN_SET_FEATURES									0x09
 #define ADMIN_GET_FEATURES									0x0A
 #define ADMIN_ASYNCHRONOUS_EVENT_REQUEST					0x0C
+#define ADMIN_NAMESPACE_MANAGEMENT							0x0D
 #define ADMIN_FIRMWARE_ACTIVATE								0x10
 #define ADMIN_FIRMWARE_IMAGE_DOWNLOAD						0x11
+#define ADMIN_NAMESPACE_ATTACHMENT							0x15
 #define ADMIN_FORMAT_NVM									0x80
 #define ADMIN_DOORBELL_BUFFER_CONFIG						0x7C
 #define ADMIN_SECURITY_SEND									0x81
 #define ADMIN_SECURITY_RECEIVE								0x82
+#define ADMIN_EPOCH_RING									0xC0	//vendor specific
 
 /*Opcodes for IO Commands */
 #define IO_NVM_FLUSH										0x00
@@ -92,7 +93,10 @@
 #define IO_NVM_READ											0x02
 #define IO_NVM_WRITE_UNCORRECTABLE							0x04
 #define IO_NVM_COMPARE										0x05
+#define IO_NVM_WRITE_ZEROES									0x08
 #define IO_NVM_DATASET_MANAGEMENT							0x09
+#define IO_NVM_AGGREGATE_START								0x90
+#define IO_NVM_AGGREGATE_DONE								0x91
 
 /*Status Code Type */
 #define SCT_GENERIC_COMMAND_STATUS							0
@@ -196,6 +200,10 @@
 #define TIMESTAMP											0x0E
 #define SOFTWARE_PROGRESS_MARKER							0x80
 #define ACTID_FEATURE_ID 									0xE0
+#define AGG_PRIORITY_FEATURE_ID								0xE1
+#define XFORM_FEATURE_ID									0xE2
+#define CSTORE_FEATURE_ID									0xE3
+#define NS_AGG_FEATURE_ID									0xE4	//namespace specific
 
 
 #define NVME_TASK_IDLE										0x0
@@ -304,6 +312,44 @@ typedef struct _ADMIN_SET_FEATURES_DW10
 	};
 } ADMIN_SET_FEATURES_DW10;
 
+typedef struct _ADMIN_SET_FEATURES_ARBITRATION_DW11
+{
+	union {
+		unsigned int dword;
+		struct {
+			unsigned char AB				:3;
+			unsigned char reserved0			:5;
+			unsigned char LPW;//zero-based value
+			unsigned char MPW;//zero-based value
+			unsigned char HPW;//zero-based value
+		};
+	};
+} ADMIN_SET_FEATURES_ARBITRATION_DW11;
+
+typedef struct _ADMIN_SET_FEATURES_INTERRUPT_COALESCING_DW11
+{
+	union {
+		unsigned int dword;
+		struct {
+			unsigned char THR;//zero-based value
+			unsigned char TIME;//100 microsecond increments
+			unsigned short reserved0;
+		};
+	};
+} ADMIN_SET_FEATURES_INTERRUPT_COALESCING_DW11;
+
+typedef struct _ADMIN_SET_FEATURES_INTERRUPT_VECTOR_CONFIGURATION_DW11
+{
+	union {
+		unsigned int dword;
+		struct {
+			unsigned short IV;
+			unsigned short CD				:1;
+			unsigned short reserved0		:15;
+		};
+	};
+} ADMIN_SET_FEATURES_INTERRUPT_VECTOR_CONFIGURATION_DW11;
+
 typedef struct _ADMIN_SET_FEATURES_NUMBER_OF_QUEUES_DW11
 {
 	union {
@@ -435,8 +481,9 @@ typedef struct _ADMIN_IDENTIFY_COMMAND_DW10
 	union {
 		unsigned int dword;
 		struct {
-			unsigned int CNS			:1;
-			unsigned int reserved0		:31;
+			unsigned int CNS			:8;
+			unsigned int reserved0		:8;
+			unsigned int CNTID			:16;
 		};
 	};
 } ADMIN_IDENTIFY_COMMAND_DW10;
@@ -448,7 +495,9 @@ typedef struct _ADMIN_GET_LOG_PAGE_DW10
 		unsigned int dword;
 		struct {
 			unsigned char LID;
-			unsigned char reserved0;
+			unsigned char LSP			:4;
+			unsigned char reserved0		:3;
+			unsigned char RAE			:1;
 			unsigned short NUMD			:12;
 			unsigned short reserved1	:4;
 		};
@@ -501,7 +550,8 @@ typedef struct _ADMIN_IDENTIFY_CONTROLLER
 		unsigned short supportsSecuritySendSecurityReceive		:1;
 		unsigned short supportsFormatNVM						:1;
 		unsigned short supportsFirmwareActivateFirmwareDownload	:1;
-		unsigned short reserved0								:13;
+		unsigned short supportsNamespaceManagement				:1;
+		unsigned short reserved0								:12;
 	} OACS;
 
 	unsigned char ACL;
@@ -552,7 +602,8 @@ typedef struct _ADMIN_IDENTIFY_CONTROLLER
 		unsigned short supportsCompare							:1;
 		unsigned short supportsWriteUncorrectable				:1;
 		unsigned short supportsDataSetManagement				:1;
-		unsigned short reserved0								:13;
+		unsigned short supportsWriteZeroes						:1;
+		unsigned short reserved0								:12;
 	} ONCS;
 
 	struct
@@ -849,6 +900,7 @@ typedef struct _NVME_STATUS
 	unsigned short numOfIOCompletionQueuesAllocated;//non zero-based value
 	NVME_IO_SQ_STATUS ioSqInfo[MAX_NUM_OF_IO_SQ];
 	NVME_IO_CQ_STATUS ioCqInfo[MAX_NUM_OF_IO_CQ];
+	unsigned int actid_format;						//ACTID feature (0xE0) value
 } NVME_CONTEXT;
 
 
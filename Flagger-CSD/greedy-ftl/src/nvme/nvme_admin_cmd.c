@@ -54,6 +54,16 @@
 #include "host_lld.h"
 #include "nvme_identify.h"
 #include "nvme_admin_cmd.h"
+#include "nvme_io_cmd.h"
+#include "nvme_arbiter.h"
+#include "nvme_coalesce.h"
+#include "nvme_agg_stats.h"
+#include "nvme_profile.h"
+#include "nvme_namespace.h"
+#include "../transform.h"
+#include "../hot_region.h"
+#include "../epoch_ring.h"
+#include "../compress_store.h"
 
 extern NVME_CONTEXT g_nvmeTask;
 
@@ -113,6 +123,54 @@ void handle_set_features(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
             nvmeCPL->specific = 0;
             break;
 		}
+		case AGG_PRIORITY_FEATURE_ID:
+		{
+			NVME_COMPLETION cpl;
+
+			cpl.dword[0] = 0x0;
+			if(!arb_set_agg_class(nvmeAdminCmd->dword11 & 0xFF))
+				cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+			nvmeCPL->dword[0] = cpl.dword[0];
+			nvmeCPL->specific = 0x0;
+			break;
+		}
+		case XFORM_FEATURE_ID:
+		{
+			NVME_COMPLETION cpl;
+
+			cpl.dword[0] = 0x0;
+			if(!set_transform_desc(nvmeAdminCmd->dword11, nvmeAdminCmd->dword12, nvmeAdminCmd->dword13, nvmeAdminCmd->dword14))
+				cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+			nvmeCPL->dword[0] = cpl.dword[0];
+			nvmeCPL->specific = 0x0;
+			break;
+		}
+		case CSTORE_FEATURE_ID:
+		{
+			NVME_COMPLETION cpl;
+
+			//staging slots may still be under DMA
+			check_auto_rx_dma_done();
+			check_auto_tx_dma_done();
+
+			cpl.dword[0] = 0x0;
+			if(!cstore_configure(nvmeAdminCmd->dword11, nvmeAdminCmd->dword12, nvmeAdminCmd->dword13, nvmeAdminCmd->dword14, nvmeAdminCmd->dword15))
+				cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+			nvmeCPL->dword[0] = cpl.dword[0];
+			nvmeCPL->specific = 0x0;
+			break;
+		}
+		case NS_AGG_FEATURE_ID:
+		{
+			NVME_COMPLETION cpl;
+
+			cpl.dword[0] = 0x0;
+			if(ns_set_agg(nvmeAdminCmd->NSID, nvmeAdminCmd->dword11, nvmeAdminCmd->dword12) != NS_STATUS_OK)
+				cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+			nvmeCPL->dword[0] = cpl.dword[0];
+			nvmeCPL->specific = 0x0;
+			break;
+		}
 		case NUMBER_OF_QUEUES:
 		{
 			nvmeCPL->dword[0] = 0x0;
@@ -121,12 +179,31 @@ void handle_set_features(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 		}
 		case INTERRUPT_COALESCING:
 		{
-			nvmeCPL->dword[0] = 0x0;
+			NVME_COMPLETION cpl;
+
+			cpl.dword[0] = 0x0;
+			if((nvmeAdminCmd->dword11 & 0xFF) > COALESCE_MAX_THR)
+				cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+			else
+				coalesce_set_feature(nvmeAdminCmd->dword11);
+			nvmeCPL->dword[0] = cpl.dword[0];
+			nvmeCPL->specific = 0x0;
+			break;
+		}
+		case INTERRUPT_VECTOR_CONFIGURATION:
+		{
+			NVME_COMPLETION cpl;
+
+			cpl.dword[0] = 0x0;
+			if(!coalesce_set_vector_config(nvmeAdminCmd->dword11))
+				cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+			nvmeCPL->dword[0] = cpl.dword[0];
 			nvmeCPL->specific = 0x0;
 			break;
 		}
 		case ARBITRATION:
 		{
+			arb_set_arbitration(nvmeAdminCmd->dword11);
 			nvmeCPL->dword[0] = 0x0;
 			nvmeCPL->specific = 0x0;
 			break;
@@ -187,6 +264,54 @@ void handle_get_features(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
             nvmeCPL->specific = g_nvmeTask.actid_format;
             break;
 		}
+		case AGG_PRIORITY_FEATURE_ID:
+		{
+			nvmeCPL->dword[0] = 0x0;
+			nvmeCPL->specific = arb_get_agg_class();
+			break;
+		}
+		case XFORM_FEATURE_ID:
+		{
+			nvmeCPL->dword[0] = 0x0;
+			nvmeCPL->specific = get_transform_desc(nvmeAdminCmd->dword11);
+			break;
+		}
+		case CSTORE_FEATURE_ID:
+		{
+			nvmeCPL->dword[0] = 0x0;
+			nvmeCPL->specific = cstore_get_flags();
+			break;
+		}
+		case NS_AGG_FEATURE_ID:
+		{
+			nvmeCPL->dword[0] = 0x0;
+			nvmeCPL->specific = ns_get_agg(nvmeAdminCmd->NSID);
+			break;
+		}
+		case ARBITRATION:
+		{
+			nvmeCPL->dword[0] = 0x0;
+			nvmeCPL->specific = arb_get_arbitration();
+			break;
+		}
+		case INTERRUPT_COALESCING:
+		{
+			nvmeCPL->dword[0] = 0x0;
+			nvmeCPL->specific = coalesce_get_feature();
+			break;
+		}
+		case INTERRUPT_VECTOR_CONFIGURATION:
+		{
+			unsigned int vectorConfig;
+
+			cpl.dword[0] = 0x0;
+			vectorConfig = 0x0;
+			if(!coalesce_get_vector_config(nvmeAdminCmd->dword11, &vectorConfig))
+				cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+			nvmeCPL->dword[0] = cpl.dword[0];
+			nvmeCPL->specific = vectorConfig;
+			break;
+		}
 		case NUMBER_OF_QUEUES:
 		{
 			nvmeCPL->dword[0] = 0x0;
@@ -265,7 +390,7 @@ void handle_create_io_sq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 	xil_printf("Create IO SQ, DW11: 0x%08X, DW10: 0x%08X\r\n", sqInfo11.dword, sqInfo10.dword);
 
 	ASSERT((nvmeAdminCmd->PRP1[0] & 0x3) == 0 && nvmeAdminCmd->PRP1[1] < 0x10000);
-	ASSERT(0 < sqInfo10.QID && sqInfo10.QID <= 8 && sqInfo10.QSIZE < 0x100 && 0 < sqInfo11.CQID && sqInfo11.CQID <= 8);
+	ASSERT(0 < sqInfo10.QID && sqInfo10.QID <= MAX_NUM_OF_IO_SQ && sqInfo10.QSIZE < 0x100 && 0 < sqInfo11.CQID && sqInfo11.CQID <= MAX_NUM_OF_IO_CQ);
 
 	ioSqIdx = sqInfo10.QID - 1;
 	ioSqStatus = g_nvmeTask.ioSqInfo + ioSqIdx;
@@ -277,6 +402,7 @@ void handle_create_io_sq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 	ioSqStatus->pcieBaseAddrH = nvmeAdminCmd->PRP1[1];
 
 	set_io_sq(ioSqIdx, ioSqStatus->valid, ioSqStatus->cqVector, ioSqStatus->qSzie, ioSqStatus->pcieBaseAddrL, ioSqStatus->pcieBaseAddrH);
+	arb_set_sq_class(sqInfo10.QID, sqInfo11.QPRIO);
 
 	nvmeCPL->dword[0] = 0;
 	nvmeCPL->specific = 0x0;
@@ -287,6 +413,8 @@ void handle_delete_io_sq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 {
 	ADMIN_DELETE_IO_SQ_DW10 sqInfo10;
 	NVME_IO_SQ_STATUS *ioSqStatus;
+	NVME_COMMAND abortCmd;
+	NVME_COMPLETION abortCPL;
 	unsigned int ioSqIdx;
 
 	sqInfo10.dword = nvmeAdminCmd->dword10;
@@ -304,6 +432,12 @@ void handle_delete_io_sq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 
 	set_io_sq(ioSqIdx, 0, 0, 0, 0, 0);
 
+	//commands fetched but not yet arbitrated are aborted with the queue
+	abortCPL.dword[0] = 0;
+	abortCPL.statusField.SC = SC_COMMAND_ABORTED_DUE_TO_SQ_DELETION;
+	while(arb_pop_sq(sqInfo10.QID, &abortCmd))
+		set_auto_nvme_cpl(abortCmd.cmdSlotTag, 0, abortCPL.statusFieldWord);
+
 	nvmeCPL->dword[0] = 0;
 	nvmeCPL->specific = 0x0;
 }
@@ -322,7 +456,7 @@ void handle_create_io_cq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 	xil_printf("Create IO CQ, DW11: 0x%08X, DW10: 0x%08X\r\n", cqInfo11.dword, cqInfo10.dword);
 
 	ASSERT(((nvmeAdminCmd->PRP1[0] & 0x3) == 0) && (nvmeAdminCmd->PRP1[1] < 0x10000));
-	ASSERT(cqInfo11.IV < 8 && cqInfo10.QSIZE < 0x100 && 0 < cqInfo10.QID && cqInfo10.QID <= 8);
+	ASSERT(cqInfo11.IV < 8 && cqInfo10.QSIZE < 0x100 && 0 < cqInfo10.QID && cqInfo10.QID <= MAX_NUM_OF_IO_CQ);
 
 	ioCqIdx = cqInfo10.QID - 1;
 	ioCqStatus = g_nvmeTask.ioCqInfo + ioCqIdx;
@@ -353,6 +487,9 @@ void handle_delete_io_cq(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvme
 	ioCqIdx = (unsigned int)cqInfo10.QID - 1;
 	ioCqStatus = g_nvmeTask.ioCqInfo + ioCqIdx;
 
+	//the vector may be masked on behalf of this queue
+	coalesce_flush();
+
 	ioCqStatus->valid = 0;
 	ioCqStatus->irqVector = 0;
 	ioCqStatus->qSzie = 0;
@@ -388,12 +525,29 @@ void handle_identify(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL)
 		if((nvmeAdminCmd->PRP1[0] & 0x3) != 0 || (nvmeAdminCmd->PRP2[0] & 0x3) != 0)
 			xil_printf("NI: 0xPRP1 = %08X_%08X, PRP2 = %08X_%08X\r\n", nvmeAdminCmd->PRP1[1], nvmeAdminCmd->PRP1[0], nvmeAdminCmd->PRP2[1], nvmeAdminCmd->PRP2[0]);
 
-		//ASSERT(nvmeAdminCmd->NSID == 1);
 		ASSERT((nvmeAdminCmd->PRP1[0] & 0x3) == 0 && (nvmeAdminCmd->PRP2[0] & 0x3) == 0);
-		namespace_identification(pIdentifyData);
+		namespace_identification(pIdentifyData, nvmeAdminCmd->NSID, 0);
+	}
+	else if(identifyInfo.CNS == 0x11)//Namespace Identify, allocated namespaces
+	{
+		ASSERT((nvmeAdminCmd->PRP1[0] & 0x3) == 0 && (nvmeAdminCmd->PRP2[0] & 0x3) == 0);
+		namespace_identification(pIdentifyData, nvmeAdminCmd->NSID, 1);
+	}
+	else if(identifyInfo.CNS == 0x2 || identifyInfo.CNS == 0x10)//active or allocated namespace list
+	{
+		ASSERT((nvmeAdminCmd->PRP1[0] & 0x3) == 0 && (nvmeAdminCmd->PRP2[0] & 0x3) == 0);
+		namespace_list(pIdentifyData, nvmeAdminCmd->NSID, identifyInfo.CNS == 0x10);
 	}
 	else
-		ASSERT(0);
+	{
+		NVME_COMPLETION cpl;
+
+		cpl.dword[0] = 0;
+		cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+		nvmeCPL->dword[0] = cpl.dword[0];
+		nvmeCPL->specific = 0x0;
+		return;
+	}
 	
 	prp[0] = nvmeAdminCmd->PRP1[0];
 	prp[1] = nvmeAdminCmd->PRP1[1];
@@ -420,34 +574,271 @@ void handle_identify(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL)
 
 void handle_get_log_page(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL)
 {
-	/*ADMIN_GET_LOG_PAGE_DW10 getLogPageInfo;
-
-	unsigned int prp1[2];
-	unsigned int prp2[2];
+	ADMIN_GET_LOG_PAGE_DW10 getLogPageInfo;
+	NVME_COMPLETION cpl;
+	unsigned int pLogPageData = ADMIN_CMD_DRAM_DATA_BUFFER;
+	unsigned int prp[2];
 	unsigned int prpLen;
+	unsigned int dataLen;
 
 	getLogPageInfo.dword = nvmeAdminCmd->dword10;
 
-	prp1[0] = nvmeAdminCmd->PRP1[0];
-	prp1[1] = nvmeAdminCmd->PRP1[1];
-	prpLen = 0x1000 - (prp1[0] & 0xFFF);
+	//LID
+	//Mandatory//1-Error information, 2-SMART/Health information, 3-Firmware Slot information
+	//Vendor specific//0xC0-Aggregation engine telemetry, 0xC1-Compressed store statistics, 0xC2-Command processing profile
+	if(getLogPageInfo.LID != AGG_STATS_LOG_PAGE_ID && getLogPageInfo.LID != CSTORE_LOG_PAGE_ID && getLogPageInfo.LID != PROF_LOG_PAGE_ID)
+	{
+		cpl.dword[0] = 0;
+		cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+		cpl.statusField.SC = SC_INVALID_LOG_PAGE;
+		nvmeCPL->dword[0] = cpl.dword[0];
+		nvmeCPL->specific = 0x0;
+		return;
+	}
 
-	prp2[0] = nvmeAdminCmd->PRP2[0];
-	prp2[1] = nvmeAdminCmd->PRP2[1];
+	ASSERT((nvmeAdminCmd->PRP1[0] & 0x3) == 0 && (nvmeAdminCmd->PRP2[0] & 0x3) == 0);
 
-	xil_printf("ADMIN GET LOG PAGE\n");
+	//bytes past the end of the log page read back as zero
+	memset((void*)pLogPageData, 0, 0x1000);
+	if(getLogPageInfo.LID == AGG_STATS_LOG_PAGE_ID)
+		agg_stats_get_log_page((AGG_STATS_LOG_PAGE*)pLogPageData);
+	else if(getLogPageInfo.LID == CSTORE_LOG_PAGE_ID)
+		cstore_get_log_page((CSTORE_LOG_PAGE*)pLogPageData);
+	else
+		prof_get_log_page((PROF_LOG_PAGE*)pLogPageData, getLogPageInfo.LSP & PROF_LSP_CLEAR);
 
-	//LID
-	//Mandatory//1-Error information, 2-SMART/Health information, 3-Firmware Slot information
-	//Optional//4-ChangedNamespaceList, 5-Command Effects Log
-	xil_printf("LID: 0x%X, NUMD: 0x%X \r\n", getLogPageInfo.LID, getLogPageInfo.NUMD);
+	dataLen = (getLogPageInfo.NUMD + 1) * 4;
+	if(dataLen > 0x1000)
+		dataLen = 0x1000;
+
+	prp[0] = nvmeAdminCmd->PRP1[0];
+	prp[1] = nvmeAdminCmd->PRP1[1];
+
+	prpLen = 0x1000 - (prp[0] & 0xFFF);
+	if(prpLen > dataLen)
+		prpLen = dataLen;
+	set_direct_tx_dma(0, pLogPageData, prp[1], prp[0], prpLen);
+	if(prpLen != dataLen)
+	{
+		pLogPageData = pLogPageData + prpLen;
+		prpLen = dataLen - prpLen;
+		prp[0] = nvmeAdminCmd->PRP2[0];
+		prp[1] = nvmeAdminCmd->PRP2[1];
 
-	xil_printf("PRP1[63:32] = 0x%X, PRP1[31:0] = 0x%X", prp1[1], prp1[0]);
-	xil_printf("PRP2[63:32] = 0x%X, PRP2[31:0] = 0x%X", prp2[1], prp2[0]);*/
+		set_direct_tx_dma(0, pLogPageData, prp[1], prp[0], prpLen);
+	}
 
+	check_direct_tx_dma_done();
 	nvmeCPL->dword[0] = 0;
-    nvmeCPL->statusField.SCT = 1;
-	nvmeCPL->specific = 0x9;//invalid log page
+	nvmeCPL->specific = 0x0;
+}
+
+void handle_epoch_ring(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL)
+{
+	NVME_COMPLETION cpl;
+	unsigned int action, ring, status, round, epochACTID;
+
+	action = nvmeAdminCmd->dword10 & 0xFF;
+	ring = (nvmeAdminCmd->dword10 >> 8) & 0xFF;
+	round = 0;
+
+	switch(action)
+	{
+		case EPOCH_ACTION_CONFIGURE:
+		{
+			status = epoch_ring_configure(ring, nvmeAdminCmd->dword11, nvmeAdminCmd->dword12, nvmeAdminCmd->dword13, nvmeAdminCmd->dword14);
+			break;
+		}
+		case EPOCH_ACTION_ADVANCE:
+		{
+			status = epoch_ring_advance(ring, &round, &epochACTID);
+			if(status == EPOCH_STATUS_OK && (nvmeAdminCmd->dword11 & EPOCH_ADVANCE_CLEAR))
+			{
+				//the epoch was released, only stale DMA of older commands can still touch it
+				check_auto_rx_dma_done();
+				check_auto_tx_dma_done();
+				zero_hot_region(epochACTID, epochRing[ring].epochBlocks);
+			}
+			break;
+		}
+		case EPOCH_ACTION_RELEASE:
+		{
+			status = epoch_ring_release(ring, nvmeAdminCmd->dword11);
+			break;
+		}
+		default:
+		{
+			status = EPOCH_STATUS_INVALID;
+			break;
+		}
+	}
+
+	cpl.dword[0] = 0;
+	if(status == EPOCH_STATUS_INVALID)
+		cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+	else if(status == EPOCH_STATUS_BUSY)
+		cpl.statusField.SC = SC_COMMAND_SEQUENCE_ERROR;
+	nvmeCPL->dword[0] = cpl.dword[0];
+	nvmeCPL->specific = round;
+}
+
+//4KB of command data from the host, the data may cross into the page of PRP2
+static void get_admin_cmd_data(NVME_ADMIN_COMMAND *nvmeAdminCmd, unsigned int pData)
+{
+	unsigned int prp[2];
+	unsigned int prpLen;
+
+	ASSERT((nvmeAdminCmd->PRP1[0] & 0x3) == 0 && (nvmeAdminCmd->PRP2[0] & 0x3) == 0);
+
+	prp[0] = nvmeAdminCmd->PRP1[0];
+	prp[1] = nvmeAdminCmd->PRP1[1];
+
+	prpLen = 0x1000 - (prp[0] & 0xFFF);
+	set_direct_rx_dma(0, pData, prp[1], prp[0], prpLen);
+	if(prpLen != 0x1000)
+	{
+		pData = pData + prpLen;
+		prpLen = 0x1000 - prpLen;
+		prp[0] = nvmeAdminCmd->PRP2[0];
+		prp[1] = nvmeAdminCmd->PRP2[1];
+
+		set_direct_rx_dma(0, pData, prp[1], prp[0], prpLen);
+	}
+
+	check_direct_rx_dma_done();
+}
+
+//the next owner of the blocks must not see the data, in the hot region, the FTL or a compressed range
+static void scrub_namespace(unsigned int nsid)
+{
+	NS_ENTRY *ns;
+
+	ns = NS_ENTRY_OF(nsid);
+	if(ns->nBlocks == 0)
+		return;
+
+	scrub_nvme_block(ns->baseACTID, ns->nBlocks);
+}
+
+void handle_namespace_management(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL)
+{
+	NVME_COMPLETION cpl;
+	ADMIN_IDENTIFY_NAMESPACE *nsData;
+	unsigned int sel, status, nsid;
+
+	sel = nvmeAdminCmd->dword10 & 0xF;
+	nsid = 0;
+
+	cpl.dword[0] = 0;
+	if(sel == 0)//create
+	{
+		get_admin_cmd_data(nvmeAdminCmd, ADMIN_CMD_DRAM_DATA_BUFFER);
+		nsData = (ADMIN_IDENTIFY_NAMESPACE *)ADMIN_CMD_DRAM_DATA_BUFFER;
+
+		if(nsData->NSZE[1] != 0 || nsData->NCAP[1] != 0 || nsData->FLBAS.supportedCombination != 0)
+		{
+			cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+			cpl.statusField.SC = SC_INVALID_FORMAT;
+		}
+		else if(nsData->NCAP[0] != nsData->NSZE[0])
+		{
+			cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+			cpl.statusField.SC = SC_THIN_PROVISIONING_NOT_SUPPORTED;
+		}
+		else
+		{
+			status = ns_create(nsData->NSZE[0], &nsid);
+			if(status == NS_STATUS_NO_ID)
+			{
+				cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+				cpl.statusField.SC = SC_NAMESPACE_IDENTIFIER_UNAVAILABLE;
+			}
+			else if(status == NS_STATUS_NO_CAPACITY)
+			{
+				cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+				cpl.statusField.SC = SC_NAMESPACE_INSUFFICIENT_CAPACITY;
+			}
+		}
+	}
+	else if(sel == 1)//delete
+	{
+		//queued DMA of the namespace must be done before its blocks are cleared
+		check_auto_rx_dma_done();
+		check_auto_tx_dma_done();
+
+		if(nvmeAdminCmd->NSID == NS_ALL)
+			for(nsid = 1; nsid < NS_TABLE_SIZE; nsid++)
+				scrub_namespace(nsid);
+		else
+			scrub_namespace(nvmeAdminCmd->NSID);
+
+		nsid = 0;
+		if(ns_delete(nvmeAdminCmd->NSID) != NS_STATUS_OK)
+			cpl.statusField.SC = SC_INVALID_NAMESPACE_OR_FORMAT;
+	}
+	else
+		cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+
+	nvmeCPL->dword[0] = cpl.dword[0];
+	nvmeCPL->specific = nsid;
+}
+
+void handle_namespace_attachment(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL)
+{
+	NVME_COMPLETION cpl;
+	unsigned short *ctrlList;
+	unsigned int sel, idx, found, status;
+
+	sel = nvmeAdminCmd->dword10 & 0xF;
+
+	cpl.dword[0] = 0;
+	if(sel > 1)
+	{
+		cpl.statusField.SC = SC_INVALID_FIELD_IN_COMMAND;
+		nvmeCPL->dword[0] = cpl.dword[0];
+		nvmeCPL->specific = 0x0;
+		return;
+	}
+
+	//the list holds a count followed by controller identifiers, this controller is the only one
+	get_admin_cmd_data(nvmeAdminCmd, ADMIN_CMD_DRAM_DATA_BUFFER);
+	ctrlList = (unsigned short *)ADMIN_CMD_DRAM_DATA_BUFFER;
+	found = 0;
+	for(idx = 1; idx <= ctrlList[0] && idx < 2048; idx++)
+		if(ctrlList[idx] == CONTROLLER_ID)
+			found = 1;
+
+	if(!found)
+	{
+		cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+		cpl.statusField.SC = SC_CONTROLLER_LIST_INVALID;
+	}
+	else
+	{
+		//commands of a detached namespace still in flight finish first
+		if(sel == 1)
+		{
+			check_auto_rx_dma_done();
+			check_auto_tx_dma_done();
+		}
+
+		status = ns_attach(nvmeAdminCmd->NSID, sel == 0);
+		if(status == NS_STATUS_INVALID)
+			cpl.statusField.SC = SC_INVALID_NAMESPACE_OR_FORMAT;
+		else if(status == NS_STATUS_ALREADY_ATTACHED)
+		{
+			cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+			cpl.statusField.SC = SC_NAMESPACE_ALREADY_ATTACHED;
+		}
+		else if(status == NS_STATUS_NOT_ATTACHED)
+		{
+			cpl.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+			cpl.statusField.SC = SC_NAMESPACE_NOT_ATTACHED;
+		}
+	}
+
+	nvmeCPL->dword[0] = cpl.dword[0];
+	nvmeCPL->specific = 0x0;
 }
 
 void handle_nvme_admin_cmd(NVME_COMMAND *nvmeCmd)
@@ -514,6 +905,21 @@ void handle_nvme_admin_cmd(NVME_COMMAND *nvmeCmd)
 			handle_get_log_page(nvmeAdminCmd, &nvmeCPL);
 			break;
 		}
+		case ADMIN_EPOCH_RING:
+		{
+			handle_epoch_ring(nvmeAdminCmd, &nvmeCPL);
+			break;
+		}
+		case ADMIN_NAMESPACE_MANAGEMENT:
+		{
+			handle_namespace_management(nvmeAdminCmd, &nvmeCPL);
+			break;
+		}
+		case ADMIN_NAMESPACE_ATTACHMENT:
+		{
+			handle_namespace_attachment(nvmeAdminCmd, &nvmeCPL);
+			break;
+		}
 		case ADMIN_SECURITY_RECEIVE:
 		{
 			needCpl = 0;
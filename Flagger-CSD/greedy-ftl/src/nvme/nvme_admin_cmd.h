@@ -67,6 +67,12 @@ void handle_identify(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL)
 
 void handle_get_log_page(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL);
 
+void handle_epoch_ring(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL);
+
+void handle_namespace_management(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL);
+
+void handle_namespace_attachment(NVME_ADMIN_COMMAND *nvmeAdminCmd, NVME_COMPLETION *nvmeCPL);
+
 void handle_nvme_admin_cmd(NVME_COMMAND *nvmeCmd);
 
 #endif	//__NVME_ADMIN_CMD_H_
@@ -0,0 +1,155 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_agg_stats.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Aggregation Engine Telemetry
+// File Name: nvme_agg_stats.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - keeps cumulative and per-window counters of the aggregation accelerator
+//   - windows are rotated lazily, the reported window carries its real length
+//   - fills vendor log page 0xC0
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+#include "xtime_l.h"
+
+#include "nvme_agg_stats.h"
+#include "nvme_arbiter.h"
+
+AGG_STATS_CONTEXT g_aggStats;
+
+static XTime get_time()
+{
+	XTime now;
+
+	XTime_GetTime(&now);
+
+	return now;
+}
+
+static void rotate_window(XTime now)
+{
+	if(now - g_aggStats.windowStart < g_aggStats.windowLength)
+		return;
+
+	memcpy(&g_aggStats.lastWindow, &g_aggStats.current, sizeof(AGG_STATS_COUNTERS));
+	memset(&g_aggStats.current, 0, sizeof(AGG_STATS_COUNTERS));
+	g_aggStats.lastWindowTicks = now - g_aggStats.windowStart;
+	g_aggStats.windowStart = now;
+}
+
+static unsigned int latency_bucket(XTime ticks)
+{
+	unsigned long long us;
+	unsigned int bucket;
+
+	us = ticks / (COUNTS_PER_SECOND / 1000000);
+	bucket = us ? 64 - __builtin_clzll(us) : 0;
+	if(bucket >= AGG_STATS_LATENCY_BUCKETS)
+		bucket = AGG_STATS_LATENCY_BUCKETS - 1;
+
+	return bucket;
+}
+
+static void add_job(AGG_STATS_COUNTERS *counters, XTime busy, unsigned int bucket, unsigned int bytes, unsigned int occupancy)
+{
+	counters->jobs++;
+	counters->bytes += bytes;
+	counters->busyTicks += busy;
+	counters->occupancySum += occupancy;
+	if(occupancy > counters->occupancyMax)
+		counters->occupancyMax = occupancy;
+	counters->latency[bucket]++;
+}
+
+void agg_stats_init()
+{
+	memset(&g_aggStats, 0, sizeof(AGG_STATS_CONTEXT));
+
+	g_aggStats.bootTime = get_time();
+	g_aggStats.windowStart = g_aggStats.bootTime;
+	g_aggStats.windowLength = (XTime)COUNTS_PER_SECOND / 1000 * AGG_STATS_WINDOW_MS;
+}
+
+XTime agg_stats_job_start()
+{
+	return get_time();
+}
+
+void agg_stats_job_done(XTime jobStart, XTime engineStart, unsigned int bytes)
+{
+	XTime now;
+	unsigned int bucket;
+	unsigned int occupancy;
+
+	now = get_time();
+	rotate_window(now);
+
+	bucket = latency_bucket(now - jobStart);
+	occupancy = arb_pending_count();
+	add_job(&g_aggStats.total, now - engineStart, bucket, bytes, occupancy);
+	add_job(&g_aggStats.current, now - engineStart, bucket, bytes, occupancy);
+}
+
+void agg_stats_read_dma(unsigned int bytes)
+{
+	rotate_window(get_time());
+
+	g_aggStats.total.readDmaBytes += bytes;
+	g_aggStats.current.readDmaBytes += bytes;
+}
+
+void agg_stats_write_dma(unsigned int bytes)
+{
+	rotate_window(get_time());
+
+	g_aggStats.total.writeDmaBytes += bytes;
+	g_aggStats.current.writeDmaBytes += bytes;
+}
+
+void agg_stats_get_log_page(AGG_STATS_LOG_PAGE *logPage)
+{
+	XTime now;
+
+	now = get_time();
+	rotate_window(now);
+
+	memset(logPage, 0, sizeof(AGG_STATS_LOG_PAGE));
+	logPage->version = AGG_STATS_VERSION;
+	logPage->latencyBuckets = AGG_STATS_LATENCY_BUCKETS;
+	logPage->ticksPerSecond = COUNTS_PER_SECOND;
+	logPage->uptimeTicks = now - g_aggStats.bootTime;
+	logPage->windowTicks = g_aggStats.lastWindowTicks;
+	logPage->queueOccupancy = arb_pending_count();
+	memcpy(&logPage->total, &g_aggStats.total, sizeof(AGG_STATS_COUNTERS));
+	memcpy(&logPage->window, &g_aggStats.lastWindow, sizeof(AGG_STATS_COUNTERS));
+}
@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_agg_stats.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Aggregation Engine Telemetry
+// File Name: nvme_agg_stats.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the aggregation telemetry served as vendor log page 0xC0
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NVME_AGG_STATS_H_
+#define __NVME_AGG_STATS_H_
+
+#include "xtime_l.h"
+
+#define AGG_STATS_LOG_PAGE_ID			0xC0
+#define AGG_STATS_VERSION				1
+#define AGG_STATS_WINDOW_MS				1000
+#define AGG_STATS_LATENCY_BUCKETS		32		//bucket b counts jobs of [2^(b-1), 2^b) us, bucket 0 jobs below 1 us
+
+/* The layout is shared with the host (unvme_agg_stats_t), fields are only appended */
+typedef struct _AGG_STATS_COUNTERS
+{
+	unsigned long long jobs;				//aggregation commands completed
+	unsigned long long bytes;				//bytes reduced by the accelerator
+	unsigned long long busyTicks;			//accelerator running, in timer ticks
+	unsigned long long readDmaBytes;		//moved to the host by Read commands
+	unsigned long long writeDmaBytes;		//moved from the host by Write commands
+	unsigned long long occupancySum;		//arbiter queue depth summed over the jobs
+	unsigned int occupancyMax;
+	unsigned int reserved0;
+	unsigned int latency[AGG_STATS_LATENCY_BUCKETS];
+} AGG_STATS_COUNTERS;
+
+typedef struct _AGG_STATS_LOG_PAGE
+{
+	unsigned int version;
+	unsigned int latencyBuckets;
+	unsigned long long ticksPerSecond;
+	unsigned long long uptimeTicks;
+	unsigned long long windowTicks;			//length of the window reported in 'window'
+	unsigned int queueOccupancy;			//commands waiting in the arbiter right now
+	unsigned int reserved0;
+	AGG_STATS_COUNTERS total;				//since power-on
+	AGG_STATS_COUNTERS window;				//last completed window
+	unsigned char reserved1[104];
+} AGG_STATS_LOG_PAGE;
+
+typedef struct _AGG_STATS_CONTEXT
+{
+	XTime bootTime;
+	XTime windowStart;
+	XTime windowLength;
+	XTime lastWindowTicks;
+	AGG_STATS_COUNTERS total;
+	AGG_STATS_COUNTERS current;
+	AGG_STATS_COUNTERS lastWindow;
+} AGG_STATS_CONTEXT;
+
+void agg_stats_init();
+
+XTime agg_stats_job_start();
+
+void agg_stats_job_done(XTime jobStart, XTime engineStart, unsigned int bytes);
+
+void agg_stats_read_dma(unsigned int bytes);
+
+void agg_stats_write_dma(unsigned int bytes);
+
+void agg_stats_get_log_page(AGG_STATS_LOG_PAGE *logPage);
+
+extern AGG_STATS_CONTEXT g_aggStats;
+
+#endif	//__NVME_AGG_STATS_H_
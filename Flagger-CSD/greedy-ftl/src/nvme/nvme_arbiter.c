@@ -0,0 +1,361 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_arbiter.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: NVMe Command Arbiter
+// File Name: nvme_arbiter.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - buffers fetched I/O commands per submission queue
+//   - selects the next command with NVMe weighted round-robin arbitration
+//     (urgent class strict priority, high/medium/low weighted by HPW/MPW/LPW)
+//   - routes aggregation commands to a dedicated lane with its own class
+//   - has no dependency on host_lld so it can be exercised on the host
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+
+#include "nvme.h"
+#include "nvme_arbiter.h"
+
+ARB_CONTEXT g_arbiter;
+
+static void queue_init(ARB_QUEUE *queue, unsigned int arbClass)
+{
+	queue->head = ARB_INVALID_SLOT;
+	queue->tail = ARB_INVALID_SLOT;
+	queue->count = 0;
+	queue->arbClass = arbClass;
+}
+
+static void queue_push(ARB_QUEUE *queue, unsigned int slot)
+{
+	g_arbiter.nextSlot[slot] = ARB_INVALID_SLOT;
+	if(queue->tail == ARB_INVALID_SLOT)
+		queue->head = slot;
+	else
+		g_arbiter.nextSlot[queue->tail] = slot;
+	queue->tail = slot;
+	queue->count++;
+}
+
+static unsigned int queue_pop(ARB_QUEUE *queue)
+{
+	unsigned int slot;
+
+	slot = queue->head;
+	queue->head = g_arbiter.nextSlot[slot];
+	if(queue->head == ARB_INVALID_SLOT)
+		queue->tail = ARB_INVALID_SLOT;
+	queue->count--;
+
+	return slot;
+}
+
+static unsigned int next_queue_bit(unsigned long long mask, unsigned int bit)
+{
+	unsigned long long upper;
+
+	upper = (bit < ARB_MAX_NUM_OF_SQ - 1) ? (mask & (~0ULL << (bit + 1))) : 0;
+	if(upper)
+		return __builtin_ctzll(upper);
+
+	return __builtin_ctzll(mask);
+}
+
+static unsigned int is_aggregate_cmd(NVME_COMMAND *nvmeCmd)
+{
+	unsigned int opc;
+
+	opc = nvmeCmd->cmdDword[0] & 0xFF;
+
+	return (opc == IO_NVM_AGGREGATE_START) || (opc == IO_NVM_AGGREGATE_DONE);
+}
+
+static unsigned int class_pending(unsigned int arbClass)
+{
+	if(g_arbiter.pendingMask[arbClass])
+		return 1;
+
+	return (g_arbiter.aggClass == arbClass) && g_arbiter.aggLane.count;
+}
+
+static unsigned int pop_from_class(unsigned int arbClass)
+{
+	ARB_QUEUE *queue;
+	unsigned int bit;
+	unsigned int slot;
+
+	//the aggregation lane goes ahead of the submission queues of its class
+	if((g_arbiter.aggClass == arbClass) && g_arbiter.aggLane.count)
+		return queue_pop(&g_arbiter.aggLane);
+
+	bit = g_arbiter.rrQueue[arbClass];
+	if(!((g_arbiter.pendingMask[arbClass] >> bit) & 0x1) || (g_arbiter.burstLeft[arbClass] == 0))
+	{
+		bit = next_queue_bit(g_arbiter.pendingMask[arbClass], bit);
+		g_arbiter.rrQueue[arbClass] = bit;
+		g_arbiter.burstLeft[arbClass] = g_arbiter.burst;
+	}
+	g_arbiter.burstLeft[arbClass]--;
+
+	queue = &g_arbiter.sq[bit];
+	slot = queue_pop(queue);
+	if(queue->count == 0)
+		g_arbiter.pendingMask[arbClass] &= ~(1ULL << bit);
+
+	return slot;
+}
+
+void arb_init()
+{
+	unsigned int idx;
+
+	memset(&g_arbiter, 0, sizeof(ARB_CONTEXT) - sizeof(g_arbiter.cmd));
+
+	for(idx = 0; idx < ARB_MAX_NUM_OF_SQ; idx++)
+		queue_init(&g_arbiter.sq[idx], ARB_CLASS_MEDIUM);
+
+	queue_init(&g_arbiter.aggLane, ARB_CLASS_URGENT);
+	g_arbiter.aggClass = ARB_CLASS_URGENT;
+
+	//power-on default of the Arbitration feature: round-robin, burst of one
+	arb_set_arbitration(0);
+}
+
+void arb_set_sq_class(unsigned int qID, unsigned int qprio)
+{
+	ARB_QUEUE *queue;
+
+	if(qID == 0 || qID > ARB_MAX_NUM_OF_SQ)
+		return;
+
+	queue = &g_arbiter.sq[qID - 1];
+	if(queue->count)
+	{
+		g_arbiter.pendingMask[queue->arbClass] &= ~(1ULL << (qID - 1));
+		g_arbiter.pendingMask[qprio & 0x3] |= (1ULL << (qID - 1));
+	}
+	queue->arbClass = qprio & 0x3;
+}
+
+void arb_set_arbitration(unsigned int dword11)
+{
+	ADMIN_SET_FEATURES_ARBITRATION_DW11 arbInfo;
+	unsigned int arbClass;
+
+	arbInfo.dword = dword11;
+	g_arbiter.arbitration = dword11;
+
+	if(arbInfo.AB == ARB_BURST_UNLIMITED)
+		g_arbiter.burst = 0xFFFFFFFF;
+	else
+		g_arbiter.burst = 1 << arbInfo.AB;
+
+	g_arbiter.weight[ARB_CLASS_URGENT] = 0;
+	g_arbiter.weight[ARB_CLASS_HIGH] = arbInfo.HPW + 1;//zero-based -> non zero-based
+	g_arbiter.weight[ARB_CLASS_MEDIUM] = arbInfo.MPW + 1;
+	g_arbiter.weight[ARB_CLASS_LOW] = arbInfo.LPW + 1;
+
+	for(arbClass = 0; arbClass < ARB_NUM_OF_CLASS; arbClass++)
+	{
+		g_arbiter.credit[arbClass] = g_arbiter.weight[arbClass];
+		g_arbiter.burstLeft[arbClass] = 0;
+	}
+}
+
+unsigned int arb_get_arbitration()
+{
+	return g_arbiter.arbitration;
+}
+
+unsigned int arb_set_agg_class(unsigned int aggClass)
+{
+	NVME_COMMAND *nvmeCmd;
+	unsigned int slot;
+
+	if(aggClass != ARB_AGG_CLASS_INHERIT)
+	{
+		if(aggClass > ARB_CLASS_LOW)
+			return 0;
+
+		g_arbiter.aggClass = aggClass;
+		return 1;
+	}
+
+	//hand the lane back to the submission queues it was taken from
+	g_arbiter.aggClass = ARB_AGG_CLASS_INHERIT;
+	while(g_arbiter.aggLane.count)
+	{
+		slot = queue_pop(&g_arbiter.aggLane);
+		nvmeCmd = &g_arbiter.cmd[slot];
+		g_arbiter.pendingCnt--;
+		arb_push(nvmeCmd);
+	}
+
+	return 1;
+}
+
+unsigned int arb_get_agg_class()
+{
+	return g_arbiter.aggClass;
+}
+
+unsigned int arb_push(NVME_COMMAND *nvmeCmd)
+{
+	ARB_QUEUE *queue;
+	unsigned int slot;
+	unsigned int qID;
+
+	slot = nvmeCmd->cmdSlotTag;
+	qID = nvmeCmd->qID;
+	if(slot >= ARB_MAX_NUM_OF_CMD || qID == 0 || qID > ARB_MAX_NUM_OF_SQ)
+		return 0;
+
+	if(&g_arbiter.cmd[slot] != nvmeCmd)
+		memcpy(&g_arbiter.cmd[slot], nvmeCmd, sizeof(NVME_COMMAND));
+
+	if(g_arbiter.aggClass != ARB_AGG_CLASS_INHERIT && is_aggregate_cmd(nvmeCmd))
+	{
+		queue_push(&g_arbiter.aggLane, slot);
+	}
+	else
+	{
+		queue = &g_arbiter.sq[qID - 1];
+		queue_push(queue, slot);
+		g_arbiter.pendingMask[queue->arbClass] |= (1ULL << (qID - 1));
+	}
+	g_arbiter.pendingCnt++;
+
+	return 1;
+}
+
+unsigned int arb_pop(NVME_COMMAND *nvmeCmd)
+{
+	unsigned int arbClass;
+	unsigned int slot;
+	unsigned int pass;
+
+	if(g_arbiter.pendingCnt == 0)
+		return 0;
+
+	if(class_pending(ARB_CLASS_URGENT))
+	{
+		slot = pop_from_class(ARB_CLASS_URGENT);
+	}
+	else
+	{
+		//a second pass is only needed after all pending classes ran out of credit
+		slot = ARB_INVALID_SLOT;
+		for(pass = 0; pass < 2 && slot == ARB_INVALID_SLOT; pass++)
+		{
+			for(arbClass = ARB_CLASS_HIGH; arbClass < ARB_NUM_OF_CLASS; arbClass++)
+			{
+				if(g_arbiter.credit[arbClass] && class_pending(arbClass))
+				{
+					g_arbiter.credit[arbClass]--;
+					slot = pop_from_class(arbClass);
+					break;
+				}
+			}
+
+			if(slot == ARB_INVALID_SLOT)
+				for(arbClass = ARB_CLASS_HIGH; arbClass < ARB_NUM_OF_CLASS; arbClass++)
+					g_arbiter.credit[arbClass] = g_arbiter.weight[arbClass];
+		}
+
+		if(slot == ARB_INVALID_SLOT)
+			return 0;
+	}
+
+	g_arbiter.pendingCnt--;
+	memcpy(nvmeCmd, &g_arbiter.cmd[slot], sizeof(NVME_COMMAND));
+
+	return 1;
+}
+
+unsigned int arb_pop_sq(unsigned int qID, NVME_COMMAND *nvmeCmd)
+{
+	ARB_QUEUE *queue;
+	unsigned int slot;
+	unsigned int prev;
+
+	if(qID == 0 || qID > ARB_MAX_NUM_OF_SQ)
+		return 0;
+
+	queue = &g_arbiter.sq[qID - 1];
+	if(queue->count)
+	{
+		slot = queue_pop(queue);
+		if(queue->count == 0)
+			g_arbiter.pendingMask[queue->arbClass] &= ~(1ULL << (qID - 1));
+	}
+	else
+	{
+		//commands of this queue may also be waiting in the aggregation lane
+		prev = ARB_INVALID_SLOT;
+		for(slot = g_arbiter.aggLane.head; slot != ARB_INVALID_SLOT; slot = g_arbiter.nextSlot[slot])
+		{
+			if(g_arbiter.cmd[slot].qID == qID)
+				break;
+			prev = slot;
+		}
+
+		if(slot == ARB_INVALID_SLOT)
+			return 0;
+
+		if(prev == ARB_INVALID_SLOT)
+			g_arbiter.aggLane.head = g_arbiter.nextSlot[slot];
+		else
+			g_arbiter.nextSlot[prev] = g_arbiter.nextSlot[slot];
+		if(g_arbiter.aggLane.tail == slot)
+			g_arbiter.aggLane.tail = prev;
+		g_arbiter.aggLane.count--;
+	}
+
+	g_arbiter.pendingCnt--;
+	memcpy(nvmeCmd, &g_arbiter.cmd[slot], sizeof(NVME_COMMAND));
+
+	return 1;
+}
+
+unsigned int arb_pending_count()
+{
+	return g_arbiter.pendingCnt;
+}
+
+unsigned int arb_sq_pending_count(unsigned int qID)
+{
+	if(qID == 0 || qID > ARB_MAX_NUM_OF_SQ)
+		return 0;
+
+	return g_arbiter.sq[qID - 1].count;
+}
@@ -0,0 +1,115 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_arbiter.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: NVMe Command Arbiter
+// File Name: nvme_arbiter.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the weighted round-robin arbiter for I/O submission queues
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NVME_ARBITER_H_
+#define __NVME_ARBITER_H_
+
+#include "nvme.h"
+
+#define ARB_MAX_NUM_OF_SQ			64
+#define ARB_MAX_NUM_OF_CMD			1024	//one entry per command slot tag (P_SLOT_TAG_WIDTH)
+#define ARB_FETCH_BURST				16		//commands drained from the command FIFO per main loop
+
+#define ARB_INVALID_SLOT			0xFFFF
+
+/* Priority classes, encoded like the QPRIO field of Create I/O Submission Queue */
+#define ARB_CLASS_URGENT			0
+#define ARB_CLASS_HIGH				1
+#define ARB_CLASS_MEDIUM			2
+#define ARB_CLASS_LOW				3
+#define ARB_NUM_OF_CLASS			4
+
+/* aggregation commands stay in the FIFO of their submission queue */
+#define ARB_AGG_CLASS_INHERIT		0xFF
+
+#define ARB_BURST_UNLIMITED			7
+
+#if (MAX_NUM_OF_IO_SQ > ARB_MAX_NUM_OF_SQ)
+#error "MAX_NUM_OF_IO_SQ exceeds the number of queues the arbiter can track"
+#endif
+
+typedef struct _ARB_QUEUE
+{
+	unsigned short head;
+	unsigned short tail;
+	unsigned short count;
+	unsigned char arbClass;
+	unsigned char reserved0;
+} ARB_QUEUE;
+
+typedef struct _ARB_CONTEXT
+{
+	unsigned int arbitration;							//Set Features (Arbitration) dword11
+	unsigned int burst;									//commands taken from one queue per turn
+	unsigned int weight[ARB_NUM_OF_CLASS];				//non zero-based, urgent entry unused
+	unsigned int credit[ARB_NUM_OF_CLASS];
+	unsigned int burstLeft[ARB_NUM_OF_CLASS];
+	unsigned int rrQueue[ARB_NUM_OF_CLASS];				//bit index of the queue holding the turn
+	unsigned long long pendingMask[ARB_NUM_OF_CLASS];	//bit (qID - 1) set if the queue has commands
+	unsigned int aggClass;
+	unsigned int pendingCnt;
+	ARB_QUEUE aggLane;
+	ARB_QUEUE sq[ARB_MAX_NUM_OF_SQ];					//indexed by qID - 1
+	unsigned short nextSlot[ARB_MAX_NUM_OF_CMD];
+	NVME_COMMAND cmd[ARB_MAX_NUM_OF_CMD];
+} ARB_CONTEXT;
+
+void arb_init();
+
+void arb_set_sq_class(unsigned int qID, unsigned int qprio);
+
+void arb_set_arbitration(unsigned int dword11);
+
+unsigned int arb_get_arbitration();
+
+unsigned int arb_set_agg_class(unsigned int aggClass);
+
+unsigned int arb_get_agg_class();
+
+unsigned int arb_push(NVME_COMMAND *nvmeCmd);
+
+unsigned int arb_pop(NVME_COMMAND *nvmeCmd);
+
+unsigned int arb_pop_sq(unsigned int qID, NVME_COMMAND *nvmeCmd);
+
+unsigned int arb_pending_count();
+
+unsigned int arb_sq_pending_count(unsigned int qID);
+
+#endif	//__NVME_ARBITER_H_
@@ -0,0 +1,260 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_coalesce.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: NVMe Interrupt Coalescing
+// File Name: nvme_coalesce.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - implements the Interrupt Coalescing and Interrupt Vector Configuration features
+//   - the interrupt of a vector is masked in the CQ registers while completions are held back
+//   - it is unmasked once the aggregation threshold is reached or the aggregation time expired, the IP then signals the entries already posted
+//   - a command counts toward the threshold once its completion is posted, after the auto DMAs issued for it are done
+//   - the admin completion queue is never coalesced
+//   - Set Features accepts no threshold above COALESCE_MAX_THR until the IP behaviour on unmasking is confirmed
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+#include "xil_printf.h"
+#include "xtime_l.h"
+#include "debug.h"
+
+#include "nvme.h"
+#include "host_lld.h"
+#include "nvme_coalesce.h"
+
+extern NVME_CONTEXT g_nvmeTask;
+
+COALESCE_CONTEXT g_coalesce;
+
+static XTime get_time()
+{
+	XTime now;
+
+	XTime_GetTime(&now);
+
+	return now;
+}
+
+static unsigned int coalescing_active()
+{
+	//a threshold of one or an aggregation time of zero never delays an interrupt
+	return (g_coalesce.threshold > 1) && (g_coalesce.window != 0);
+}
+
+static void set_vector_irq(unsigned int vector, unsigned int irqEn)
+{
+	NVME_IO_CQ_STATUS *ioCqStatus;
+	unsigned int ioCqIdx;
+
+	for(ioCqIdx = 0; ioCqIdx < MAX_NUM_OF_IO_CQ; ioCqIdx++)
+	{
+		ioCqStatus = g_nvmeTask.ioCqInfo + ioCqIdx;
+		if(ioCqStatus->valid && ioCqStatus->irqEn && ioCqStatus->irqVector == vector)
+			set_io_cq(ioCqIdx, ioCqStatus->valid, irqEn, ioCqStatus->irqVector, ioCqStatus->qSzie, ioCqStatus->pcieBaseAddrL, ioCqStatus->pcieBaseAddrH);
+	}
+}
+
+static void fire_vector(unsigned int vector)
+{
+	set_vector_irq(vector, 1);
+	g_coalesce.vector[vector].pendingCnt = 0;
+	g_coalesce.pendingMask &= ~(1 << vector);
+}
+
+void coalesce_init()
+{
+	memset(&g_coalesce, 0, sizeof(COALESCE_CONTEXT));
+	g_coalesce.threshold = 1;
+}
+
+void coalesce_set_feature(unsigned int dword11)
+{
+	ADMIN_SET_FEATURES_INTERRUPT_COALESCING_DW11 coalescingInfo;
+
+	coalescingInfo.dword = dword11;
+	g_coalesce.coalescing = dword11 & 0xFFFF;
+	g_coalesce.threshold = coalescingInfo.THR + 1;//zero-based -> non zero-based
+	g_coalesce.window = (XTime)coalescingInfo.TIME * COALESCE_TIME_UNIT_US * (COUNTS_PER_SECOND / 1000000);
+
+	//completions held back under the old setting are signalled right away
+	coalesce_flush();
+}
+
+unsigned int coalesce_get_feature()
+{
+	return g_coalesce.coalescing;
+}
+
+unsigned int coalesce_set_vector_config(unsigned int dword11)
+{
+	ADMIN_SET_FEATURES_INTERRUPT_VECTOR_CONFIGURATION_DW11 vectorInfo;
+
+	vectorInfo.dword = dword11;
+	if(vectorInfo.IV == 0 || vectorInfo.IV >= COALESCE_MAX_NUM_OF_VECTOR)
+		return 0;
+
+	g_coalesce.vector[vectorInfo.IV].disabled = vectorInfo.CD;
+	if(vectorInfo.CD && ((g_coalesce.pendingMask >> vectorInfo.IV) & 0x1))
+		fire_vector(vectorInfo.IV);
+
+	return 1;
+}
+
+unsigned int coalesce_get_vector_config(unsigned int dword11, unsigned int *config)
+{
+	ADMIN_SET_FEATURES_INTERRUPT_VECTOR_CONFIGURATION_DW11 vectorInfo;
+
+	vectorInfo.dword = dword11;
+	if(vectorInfo.IV >= COALESCE_MAX_NUM_OF_VECTOR)
+		return 0;
+
+	vectorInfo.reserved0 = 0;
+	vectorInfo.CD = (vectorInfo.IV == 0) ? 1 : g_coalesce.vector[vectorInfo.IV].disabled;
+	*config = vectorInfo.dword;
+
+	return 1;
+}
+
+static unsigned int inflight_posted(COALESCE_INFLIGHT *inflight)
+{
+	return check_auto_tx_dma_partial_done(inflight->txMark.tailIndex, inflight->txMark.tailAssistIndex)
+		&& check_auto_rx_dma_partial_done(inflight->rxMark.tailIndex, inflight->rxMark.tailAssistIndex);
+}
+
+static void count_completion(unsigned int vector)
+{
+	COALESCE_VECTOR *coalesceVector;
+
+	//a completion posted while the vector is unmasked has been signalled already
+	if(!((g_coalesce.pendingMask >> vector) & 0x1))
+		return;
+
+	coalesceVector = &g_coalesce.vector[vector];
+	if(coalesceVector->pendingCnt++ == 0)
+		coalesceVector->deadline = get_time() + g_coalesce.window;
+	if(coalesceVector->pendingCnt >= g_coalesce.threshold)
+		fire_vector(vector);
+}
+
+//DMAs complete in FIFO order, so do the completions of the commands tracked
+static void retire_inflight()
+{
+	COALESCE_INFLIGHT *inflight;
+
+	while(g_coalesce.inflightCnt)
+	{
+		inflight = &g_coalesce.inflight[g_coalesce.inflightHead];
+		if(!inflight_posted(inflight))
+			break;
+
+		g_coalesce.inflightHead = (g_coalesce.inflightHead + 1) % COALESCE_MAX_INFLIGHT;
+		g_coalesce.inflightCnt--;
+		count_completion(inflight->vector);
+	}
+}
+
+//vector whose interrupts the completions of a submission queue are held back on, 0 if none
+static unsigned int coalesced_vector(unsigned int sqID)
+{
+	NVME_IO_CQ_STATUS *ioCqStatus;
+	unsigned int vector;
+
+	if(sqID == 0 || sqID > MAX_NUM_OF_IO_SQ || !coalescing_active())
+		return 0;
+
+	ioCqStatus = g_nvmeTask.ioCqInfo + (g_nvmeTask.ioSqInfo[sqID - 1].cqVector - 1);
+	vector = ioCqStatus->irqVector;
+	if(!ioCqStatus->valid || !ioCqStatus->irqEn || vector >= COALESCE_MAX_NUM_OF_VECTOR || g_coalesce.vector[vector].disabled)
+		return 0;
+
+	return vector;
+}
+
+void coalesce_hold(unsigned int sqID)
+{
+	unsigned int vector;
+
+	//the interrupt is masked before the IP can post the completion of the command
+	vector = coalesced_vector(sqID);
+	if(vector && !((g_coalesce.pendingMask >> vector) & 0x1))
+	{
+		set_vector_irq(vector, 0);
+		g_coalesce.vector[vector].pendingCnt = 0;
+		g_coalesce.pendingMask |= (1 << vector);
+	}
+}
+
+void coalesce_post(unsigned int sqID)
+{
+	COALESCE_INFLIGHT *inflight;
+	unsigned int vector;
+
+	vector = coalesced_vector(sqID);
+	if(vector == 0)
+		return;
+
+	while(g_coalesce.inflightCnt == COALESCE_MAX_INFLIGHT)
+		retire_inflight();
+
+	inflight = &g_coalesce.inflight[(g_coalesce.inflightHead + g_coalesce.inflightCnt) % COALESCE_MAX_INFLIGHT];
+	inflight->vector = vector;
+	get_auto_tx_dma_mark(&inflight->txMark);
+	get_auto_rx_dma_mark(&inflight->rxMark);
+	g_coalesce.inflightCnt++;
+}
+
+void coalesce_poll()
+{
+	unsigned int vector;
+	XTime now;
+
+	//completions of an unmasked vector are retired too, they are not counted
+	retire_inflight();
+	if(g_coalesce.pendingMask == 0)
+		return;
+
+	//the aggregation time runs from the first completion held back
+	now = get_time();
+	for(vector = 1; vector < COALESCE_MAX_NUM_OF_VECTOR; vector++)
+		if(((g_coalesce.pendingMask >> vector) & 0x1) && g_coalesce.vector[vector].pendingCnt
+			&& (now >= g_coalesce.vector[vector].deadline))
+			fire_vector(vector);
+}
+
+void coalesce_flush()
+{
+	unsigned int vector;
+
+	for(vector = 1; vector < COALESCE_MAX_NUM_OF_VECTOR; vector++)
+		if((g_coalesce.pendingMask >> vector) & 0x1)
+			fire_vector(vector);
+}
@@ -0,0 +1,103 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_coalesce.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: NVMe Interrupt Coalescing
+// File Name: nvme_coalesce.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the interrupt coalescing state of the I/O completion queues
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NVME_COALESCE_H_
+#define __NVME_COALESCE_H_
+
+#include "xtime_l.h"
+#include "host_lld.h"
+
+#define COALESCE_MAX_NUM_OF_VECTOR		8		//width of the irqVector field of the CQ register
+#define COALESCE_TIME_UNIT_US			100
+#define COALESCE_MAX_INFLIGHT			256		//handled commands whose completion may not be posted yet
+
+//holding completions back relies on the IP signalling the entries posted while irqEn was 0
+//once irqEn is set again, which is not confirmed for the NVMe IP yet, so Set Features
+//rejects any aggregation threshold (zero-based) above this one
+#define COALESCE_MAX_THR				0
+
+typedef struct _COALESCE_INFLIGHT
+{
+	unsigned int vector;
+	HOST_DMA_MARK txMark;			//auto DMAs issued up to the command, the IP posts
+	HOST_DMA_MARK rxMark;			//its completion once they are done
+} COALESCE_INFLIGHT;
+
+typedef struct _COALESCE_VECTOR
+{
+	unsigned int pendingCnt;		//completions posted and held back since the last interrupt
+	unsigned int disabled;			//CD of Interrupt Vector Configuration
+	XTime deadline;
+} COALESCE_VECTOR;
+
+typedef struct _COALESCE_CONTEXT
+{
+	unsigned int coalescing;		//Set Features (Interrupt Coalescing) dword11
+	unsigned int threshold;			//non zero-based
+	XTime window;					//aggregation time in timer ticks
+	unsigned int pendingMask;		//bit v set if the interrupt of vector v is masked
+	COALESCE_VECTOR vector[COALESCE_MAX_NUM_OF_VECTOR];
+	unsigned int inflightHead;
+	unsigned int inflightCnt;
+	COALESCE_INFLIGHT inflight[COALESCE_MAX_INFLIGHT];
+} COALESCE_CONTEXT;
+
+void coalesce_init();
+
+void coalesce_set_feature(unsigned int dword11);
+
+unsigned int coalesce_get_feature();
+
+unsigned int coalesce_set_vector_config(unsigned int dword11);
+
+unsigned int coalesce_get_vector_config(unsigned int dword11, unsigned int *config);
+
+//masks the interrupt of the command's completion queue, before the command is handled
+void coalesce_hold(unsigned int sqID);
+
+//tracks the completion of the command just handled, it counts once the IP has posted it
+void coalesce_post(unsigned int sqID);
+
+void coalesce_poll();
+
+void coalesce_flush();
+
+extern COALESCE_CONTEXT g_coalesce;
+
+#endif	//__NVME_COALESCE_H_
@@ -55,6 +55,8 @@
 
 #include "nvme.h"
 #include "nvme_identify.h"
+#include "nvme_namespace.h"
+#include "../ftl_config.h"
 
 void controller_identification(unsigned int pBuffer)
 {
@@ -87,11 +89,12 @@ void controller_identification(unsigned int pBuffer)
 	//The host should not submit a command that exceeds this transfer size
 	//(2^n) * 4KB), n=8 => 1MB
 	identifyCNTL->MDTS = 0x8;
-	identifyCNTL->CNTLID = 0x9;
+	identifyCNTL->CNTLID = CONTROLLER_ID;
 
 	identifyCNTL->OACS.supportsSecuritySendSecurityReceive = 0x0;
 	identifyCNTL->OACS.supportsFormatNVM = 0x0;
 	identifyCNTL->OACS.supportsFirmwareActivateFirmwareDownload = 0x0;
+	identifyCNTL->OACS.supportsNamespaceManagement = 0x1;
 
 	identifyCNTL->ACL = 0x3;
 	identifyCNTL->AERL = 0x3;
@@ -112,11 +115,12 @@ void controller_identification(unsigned int pBuffer)
 	identifyCNTL->CQES.requiredCompletionQueueEntrySize = 0x4;
 	identifyCNTL->CQES.maximumCompletionQueueEntrySize = 0x4;
 
-	identifyCNTL->NN = 0x1;
+	identifyCNTL->NN = NS_MAX;
 
 	identifyCNTL->ONCS.supportsCompare = 0x0;
 	identifyCNTL->ONCS.supportsWriteUncorrectable = 0x0;
-	identifyCNTL->ONCS.supportsDataSetManagement = 0x0;
+	identifyCNTL->ONCS.supportsDataSetManagement = 0x1;
+	identifyCNTL->ONCS.supportsWriteZeroes = 0x1;
 
 	identifyCNTL->FUSES.supportsCompareWrite = 0x0;
 
@@ -147,19 +151,26 @@ void controller_identification(unsigned int pBuffer)
 	powerStateDesc->RWL = 0x0;
 }
 
-void namespace_identification(unsigned int pBuffer)
+//namespaces that are not active (not allocated if allocated is set) return zeroes
+void namespace_identification(unsigned int pBuffer, unsigned int nsid, unsigned int allocated)
 {
 	ADMIN_IDENTIFY_NAMESPACE *identifyNS;
 	ADMIN_IDENTIFY_FORMAT_DATA *formatData;
+	NS_IDENTIFY_VS *vendorData;
+	NS_ENTRY *ns;
 	identifyNS = (ADMIN_IDENTIFY_NAMESPACE *)pBuffer;
 
 	memset(identifyNS, 0, sizeof(ADMIN_IDENTIFY_NAMESPACE));
 
-	identifyNS->NSZE[0] = STORAGE_CAPACITY_L;
+	ns = NS_ENTRY_OF(nsid);
+	if(nsid == 0 || ns->nBlocks == 0 || (!allocated && ns->ioBlocks == 0))
+		return;
+
+	identifyNS->NSZE[0] = ns->nBlocks;
 	identifyNS->NSZE[1] = STORAGE_CAPACITY_H;
-	identifyNS->NCAP[0] = STORAGE_CAPACITY_L;
+	identifyNS->NCAP[0] = ns->nBlocks;
 	identifyNS->NCAP[1] = STORAGE_CAPACITY_H;
-	identifyNS->NUSE[0] = STORAGE_CAPACITY_L;
+	identifyNS->NUSE[0] = ns->nBlocks;
 	identifyNS->NUSE[1] = STORAGE_CAPACITY_H;
 
 	identifyNS->NSFEAT.supportsThinProvisioning = 0x0;
@@ -196,5 +207,28 @@ void namespace_identification(unsigned int pBuffer)
 	formatData->MS = 0x0;
 	formatData->LBADS = 0xC;
 	formatData->RP = 0x2;
+
+	vendorData = (NS_IDENTIFY_VS *)identifyNS->VS;
+	vendorData->baseACTID = ns->baseACTID;
+	vendorData->aggConfig = ns->aggConfig;
+	vendorData->slotStride = ns->slotStride;
+}
+
+//NSIDs above nsid in increasing order, zero terminated
+void namespace_list(unsigned int pBuffer, unsigned int nsid, unsigned int allocated)
+{
+	unsigned int *list;
+	unsigned int id, cnt;
+
+	list = (unsigned int *)pBuffer;
+	memset(list, 0, 0x1000);
+
+	if(nsid >= NS_ALL - 1)
+		return;
+
+	cnt = 0;
+	for(id = nsid + 1; id < NS_TABLE_SIZE; id++)
+		if(nsTable[id].nBlocks && (allocated || nsTable[id].ioBlocks))
+			list[cnt++] = id;
 }
 
@@ -54,10 +54,13 @@
 #define SERIAL_NUMBER				"SSDD515T"
 #define MODEL_NUMBER				"DaisyPlus OpenSSD"
 #define FIRMWARE_REVISION			"TYPE0006"
+#define CONTROLLER_ID				0x9
 
 void controller_identification(unsigned int pBuffer);
 
-void namespace_identification(unsigned int pBuffer);
+void namespace_identification(unsigned int pBuffer, unsigned int nsid, unsigned int allocated);
+
+void namespace_list(unsigned int pBuffer, unsigned int nsid, unsigned int allocated);
 
 
 #endif	//__NVME_IDENTIFY_H_
@@ -50,6 +50,7 @@
 //////////////////////////////////////////////////////////////////////////////////
 
 
+#include "string.h"
 #include "xil_printf.h"
 #include "debug.h"
 #include "io_access.h"
@@ -57,10 +58,17 @@
 #include "nvme.h"
 #include "host_lld.h"
 #include "nvme_io_cmd.h"
+#include "nvme_agg_stats.h"
+#include "nvme_namespace.h"
 #include "../memory_map.h"
+#include "../ftl_config.h"
+#include "../data_buffer.h"
+#include "../hot_region.h"
+#include "../agg_engine.h"
+#include "../transform.h"
+#include "../epoch_ring.h"
+#include "../compress_store.h"
 
-#define IO_NVM_AGGREGATE_START  0x90
-#define IO_NVM_AGGREGATE_DONE   0x91
 #define AGG_CTRL_REG            (AGG_ACCEL_BASE + 0x00)
 #define AGG_STATUS_REG          (AGG_ACCEL_BASE + 0x04)
 #define AGG_SRC_ADDR_H          (AGG_ACCEL_BASE + 0x08)
@@ -73,41 +81,257 @@ typedef struct {
     unsigned int ACTID[2];
     unsigned int startOffset;
     unsigned int endOffset;
+    unsigned int op;
+    unsigned int nSlots;
+    unsigned int trim;
+    unsigned int slotStride;
+    unsigned int dstACTID;
 } AGGREGATE_COMMAND;
 
+//rx DMA position of the latest write, aggregation must not read DDR4 ahead of it
+static HOST_DMA_MARK lastWriteDmaMark;
+
+//number of blocks at the head of the request that live in the DDR4 hot region
+static unsigned int get_hot_nvme_block(unsigned int startACTID, unsigned int requestedNvmeBlock)
+{
+    if(startACTID >= HOT_REGION_PAGES)
+        return 0;
+    if(requestedNvmeBlock > HOT_REGION_PAGES - startACTID)
+        return HOT_REGION_PAGES - startACTID;
+    return requestedNvmeBlock;
+}
+
+//quantized windows are converted lazily, bring the blocks up to date before DDR4 is accessed
+static void sync_transform(unsigned int startACTID, unsigned int nvmeBlock, unsigned int readOut)
+{
+    if(transform_pending(startACTID, nvmeBlock)) {
+        while(!check_auto_rx_dma_partial_done(lastWriteDmaMark.tailIndex, lastWriteDmaMark.tailAssistIndex));
+        transform_dequantize(startACTID, nvmeBlock);
+    }
+
+    if(readOut && transform_quantize_on_read(startACTID, nvmeBlock)) {
+        //earlier reads of the window must have left DDR4 before it is rewritten
+        check_auto_tx_dma_done();
+        transform_quantize(startACTID, nvmeBlock);
+    }
+}
+
+//blocks written to the compressed store are compressed once their rx DMA has landed
+static void flush_cstore() {
+    if(cstore_pending()) {
+        while(!check_auto_rx_dma_partial_done(lastWriteDmaMark.tailIndex, lastWriteDmaMark.tailAssistIndex));
+        cstore_compress_pending();
+    }
+}
+
+//staging slots are reused once every host DMA queued on them has finished
+static unsigned long long take_cstore_slot(unsigned int actid) {
+    if(!cstore_slot_free()) {
+        check_auto_rx_dma_done();
+        check_auto_tx_dma_done();
+        cstore_compress_pending();
+        cstore_recycle_slots();
+    }
+    return cstore_take_slot(actid);
+}
+
+unsigned int cstore_background_step() {
+    if(!cstore_pending() || !check_auto_rx_dma_partial_done(lastWriteDmaMark.tailIndex, lastWriteDmaMark.tailAssistIndex))
+        return 0;
+
+    cstore_compress_pending();
+    return 1;
+}
+
+//namespace blocks to device blocks, returns the generic status code of the command
+static unsigned int translate_nvme_block(unsigned int nsid, unsigned int *startACTID, unsigned int nvmeBlock) {
+    unsigned int status;
+
+    status = ns_translate(nsid, startACTID, nvmeBlock);
+    if(status == NS_STATUS_INVALID)
+        return SC_INVALID_NAMESPACE_OR_FORMAT;
+    if(status != NS_STATUS_OK || !epoch_translate(startACTID, nvmeBlock)
+        || cstore_range(*startACTID, nvmeBlock) == CSTORE_RANGE_STRADDLE)
+        return SC_LBA_OUT_OF_RANGE;
+
+    return SC_SUCCESSFUL_COMPLETION;
+}
+
+static void send_generic_status(unsigned int cmdSlotTag, unsigned int sc) {
+    NVME_COMPLETION nvmeCPL;
+    nvmeCPL.dword[0] = 0;
+    nvmeCPL.statusField.SCT = SCT_GENERIC_COMMAND_STATUS;
+    nvmeCPL.statusField.SC = sc;
+    set_auto_nvme_cpl(cmdSlotTag, 0, nvmeCPL.statusFieldWord);
+}
+
+static void send_aggregate_done(unsigned int cmdSlotTag, unsigned int sc, unsigned int specific) {
+    NVME_COMPLETION nvmeCPL;
+    nvmeCPL.dword[0] = 0;
+    nvmeCPL.statusField.SCT = SCT_GENERIC_COMMAND_STATUS;
+    nvmeCPL.statusField.SC = sc;
+    nvmeCPL.specific = (sc == SC_SUCCESSFUL_COMPLETION) ? specific : 0;
+    set_auto_nvme_cpl(cmdSlotTag, nvmeCPL.specific, nvmeCPL.statusFieldWord);
+}
+
 void handle_aggregate_start(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd) {
     AGGREGATE_COMMAND aggCmd;
+    XTime jobStart, engineStart;
+    unsigned int status, sc, specific, srcBlocks, spanBlocks, dstBlocks, dstLimit, crcFlag;
+    unsigned long long sparseLength, spanEnd;
+    NS_ENTRY *ns;
+
+    jobStart = agg_stats_job_start();
     aggCmd.ACTID[0] = nvmeIOCmd->dword[10];
     aggCmd.ACTID[1] = nvmeIOCmd->dword[11];
     aggCmd.startOffset = nvmeIOCmd->dword[12];
     aggCmd.endOffset = nvmeIOCmd->dword[13];
+    aggCmd.op = nvmeIOCmd->dword[14] & 0xFF;
+    aggCmd.nSlots = ((nvmeIOCmd->dword[14] >> 8) & 0xFF) + 1;
+    aggCmd.trim = (nvmeIOCmd->dword[14] >> 16) & 0xFF;
+    aggCmd.slotStride = nvmeIOCmd->dword[2];
+    aggCmd.dstACTID = nvmeIOCmd->dword[15];
+    crcFlag = nvmeIOCmd->dword[14] & AGG_FLAG_CRC32C;
+
+    //the namespace may fix the operator and the slot layout
+    if(!ns_resolve_agg(nvmeIOCmd->NSID, &aggCmd.op, &aggCmd.nSlots, &aggCmd.trim, &aggCmd.slotStride)) {
+        send_aggregate_done(cmdSlotTag, SC_INVALID_FIELD_IN_COMMAND, 0);
+        return;
+    }
+
+    if(aggCmd.endOffset <= aggCmd.startOffset) {
+        send_aggregate_done(cmdSlotTag, SC_INVALID_FIELD_IN_COMMAND, 0);
+        return;
+    }
+
+    //the span reaches from the first block of slot 0 to the last block of the last slot
+    srcBlocks = (unsigned int)(((unsigned long long)aggCmd.endOffset + BYTES_PER_NVME_BLOCK - 1) / BYTES_PER_NVME_BLOCK);
+    spanEnd = srcBlocks;
+    if(aggCmd.op == AGG_OP_MEDIAN || aggCmd.op == AGG_OP_TRIMMED_MEAN || aggCmd.op == AGG_OP_WEIGHTED_MEAN)
+        spanEnd += (unsigned long long)(aggCmd.nSlots - 1) * aggCmd.slotStride;
+    if(spanEnd > HOT_REGION_PAGES) {
+        send_aggregate_done(cmdSlotTag, SC_LBA_OUT_OF_RANGE, 0);
+        return;
+    }
+    spanBlocks = (unsigned int)spanEnd;
+    //the length of a sparse accumulator is only known from the list headers
+    dstBlocks = (aggCmd.op == AGG_OP_SPARSE_SUM) ? 1 : srcBlocks;
+    status = ns_translate(nvmeIOCmd->NSID, &aggCmd.ACTID[0], spanBlocks);
+    if(status == NS_STATUS_OK && aggCmd.op != AGG_OP_DENSE_SUM)
+        status = ns_translate(nvmeIOCmd->NSID, &aggCmd.dstACTID, dstBlocks);
+    if(status != NS_STATUS_OK) {
+        send_aggregate_done(cmdSlotTag, (status == NS_STATUS_INVALID) ? SC_INVALID_NAMESPACE_OR_FORMAT : SC_LBA_OUT_OF_RANGE, 0);
+        return;
+    }
+    ns = NS_ENTRY_OF(nvmeIOCmd->NSID);
+    dstLimit = ns->baseACTID + ns->ioBlocks - aggCmd.dstACTID;
+
+    //the view of an epoch ring stands for the epoch of the current round
+    if(!epoch_translate(&aggCmd.ACTID[0], spanBlocks)
+        || (aggCmd.op != AGG_OP_DENSE_SUM && !epoch_translate(&aggCmd.dstACTID, dstBlocks))) {
+        send_aggregate_done(cmdSlotTag, SC_LBA_OUT_OF_RANGE, 0);
+        return;
+    }
+
+    //compressed blocks are not addressable by the operators
+    if(cstore_range(aggCmd.ACTID[0], spanBlocks) != CSTORE_RANGE_OUTSIDE
+        || (aggCmd.op != AGG_OP_DENSE_SUM && cstore_range(aggCmd.dstACTID, dstBlocks) != CSTORE_RANGE_OUTSIDE)) {
+        send_aggregate_done(cmdSlotTag, SC_LBA_OUT_OF_RANGE, 0);
+        return;
+    }
+
+    //the accelerator works on DDR4 in place, FTL pages are not visible to it
+    if((unsigned long long)aggCmd.ACTID[0] + spanBlocks > HOT_REGION_PAGES
+        || (aggCmd.op != AGG_OP_DENSE_SUM && (unsigned long long)aggCmd.dstACTID + dstBlocks > HOT_REGION_PAGES)) {
+        send_aggregate_done(cmdSlotTag, SC_LBA_OUT_OF_RANGE, 0);
+        return;
+    }
 
-    unsigned long long srcAddr = (unsigned long long)DDR4_BUFFER_BASE_ADDR 
+    unsigned long long srcAddr = (unsigned long long)DDR4_HOT_REGION_BASE_ADDR 
                                + ((unsigned long long)aggCmd.ACTID[0] * BYTES_PER_NVME_BLOCK) 
                                + aggCmd.startOffset;
     unsigned int dataLength = aggCmd.endOffset - aggCmd.startOffset;
 
-    Xil_Out32(AGG_SRC_ADDR_H, (srcAddr >> 32) & 0xFFFFFFFF);
-    Xil_Out32(AGG_SRC_ADDR_L, srcAddr & 0xFFFFFFFF);
-    Xil_Out32(AGG_LENGTH_REG, dataLength);
-    Xil_Out32(AGG_CTRL_REG, 0x1);
+    while(!check_auto_rx_dma_partial_done(lastWriteDmaMark.tailIndex, lastWriteDmaMark.tailAssistIndex));
 
-    while ((Xil_In32(AGG_STATUS_REG) & 0x1) == 0);
-    unsigned int aggStatus = Xil_In32(AGG_STATUS_REG);
-    send_aggregate_done(cmdSlotTag, (aggStatus >> 1) & 0x1);
-}
+    //quantized uploads land in FP32 before the operator reads them
+    sync_transform(aggCmd.ACTID[0], spanBlocks, 0);
+    if(aggCmd.op != AGG_OP_DENSE_SUM && aggCmd.dstACTID < HOT_REGION_PAGES)
+        sync_transform(aggCmd.dstACTID, srcBlocks, 0);
 
+    materialize_hot_region(aggCmd.ACTID[0], srcBlocks);
 
-void send_aggregate_done(unsigned int cmdSlotTag, unsigned int status) {
-    NVME_COMPLETION nvmeCPL;
-    nvmeCPL.statusFieldWord = status ? 0x1 : 0x0;
-    nvmeCPL.specific = Xil_In32(AGG_STATUS_REG);
-    set_auto_nvme_cpl(nvmeCmd->cmdSlotTag, nvmeCPL.specific, nvmeCPL.statusFieldWord);
+    switch(aggCmd.op) {
+        case AGG_OP_DENSE_SUM:
+            Xil_Out32(AGG_SRC_ADDR_H, (srcAddr >> 32) & 0xFFFFFFFF);
+            Xil_Out32(AGG_SRC_ADDR_L, srcAddr & 0xFFFFFFFF);
+            Xil_Out32(AGG_LENGTH_REG, dataLength);
+            engineStart = agg_stats_job_start();
+            Xil_Out32(AGG_CTRL_REG, 0x1);
+
+            while ((Xil_In32(AGG_STATUS_REG) & 0x1) == 0);
+            specific = Xil_In32(AGG_STATUS_REG);
+            status = (specific >> 1) & 0x1;
+            //the accelerator leaves the sum in place
+            if(crcFlag && status == AGG_STATUS_OK)
+                specific = agg_crc32c(0, srcAddr, dataLength);
+            break;
+        case AGG_OP_SPARSE_SUM:
+            engineStart = agg_stats_job_start();
+            status = agg_sparse_sum(srcAddr, dataLength, aggCmd.dstACTID, dstLimit, &sparseLength);
+            specific = 0;
+            if(crcFlag && status == AGG_STATUS_OK)
+                specific = agg_crc32c(0, DDR4_HOT_REGION_BASE_ADDR + (unsigned long long)aggCmd.dstACTID * BYTES_PER_NVME_BLOCK, sparseLength);
+            break;
+        case AGG_OP_MEDIAN:
+        case AGG_OP_TRIMMED_MEAN:
+        case AGG_OP_WEIGHTED_MEAN:
+        {
+            AGG_ROBUST_JOB job;
+
+            job.op = aggCmd.op;
+            job.srcACTID = aggCmd.ACTID[0];
+            job.slotStride = aggCmd.slotStride;
+            job.nSlots = aggCmd.nSlots;
+            job.trim = (aggCmd.op == AGG_OP_TRIMMED_MEAN) ? aggCmd.trim : 0;
+            job.startOffset = aggCmd.startOffset;
+            job.endOffset = aggCmd.endOffset;
+            job.dstACTID = aggCmd.dstACTID;
+            job.flags = crcFlag;
+            job.weights = 0;
+            //the client weights come with the command, updates are not pre-scaled
+            if(aggCmd.op == AGG_OP_WEIGHTED_MEAN) {
+                set_auto_rx_dma(cmdSlotTag, 0, 0, IO_CMD_DRAM_DATA_BUFFER, NVME_COMMAND_AUTO_COMPLETION_OFF);
+                check_auto_rx_dma_done();
+                job.weights = (const float *)IO_CMD_DRAM_DATA_BUFFER;
+            }
+
+            engineStart = agg_stats_job_start();
+            status = agg_robust_reduce(&job);
+            dataLength *= aggCmd.nSlots;
+            specific = (crcFlag && status == AGG_STATUS_OK) ? job.crc : 0;
+            break;
+        }
+        default:
+            //Invalid Field reports it, the host can send these at will
+            engineStart = agg_stats_job_start();
+            status = AGG_STATUS_ERROR;
+            specific = 0;
+            break;
+    }
+
+    //the engines only fail on a job the command described wrongly
+    sc = SC_SUCCESSFUL_COMPLETION;
+    if(status != AGG_STATUS_OK)
+        sc = (aggCmd.op == AGG_OP_DENSE_SUM) ? SC_INTERNAL_DEVICE_ERROR : SC_INVALID_FIELD_IN_COMMAND;
+
+    agg_stats_job_done(jobStart, engineStart, dataLength);
+    send_aggregate_done(cmdSlotTag, sc, specific);
 }
 
 
 void handle_nvme_io_read(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd) {
-    unsigned int requestedNvmeBlock, dmaIndex, numOfNvmeBlock, devAddrH, devAddrL;
+    unsigned int requestedNvmeBlock, hotNvmeBlock, dmaIndex, bufEntry, extent, synthetic, status;
     unsigned long long devAddr;
 
     IO_READ_COMMAND_DW12 readInfo12;
@@ -118,29 +342,55 @@ void handle_nvme_io_read(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd) {
     startACTID[0] = nvmeIOCmd->dword[10];
     startACTID[1] = nvmeIOCmd->dword[11];
     nlb = readInfo12.NLB;
-    ASSERT(startACTID[0] < STORAGE_CAPACITY_L && (startACTID[1] < STORAGE_CAPACITY_H || startACTID[1] == 0));
+    status = translate_nvme_block(nvmeIOCmd->NSID, &startACTID[0], nlb + 1);
+    if(status != SC_SUCCESSFUL_COMPLETION) {
+        send_generic_status(cmdSlotTag, status);
+        return;
+    }
+    ASSERT(startACTID[0] + nlb < storageCapacity_L && startACTID[1] == 0);
     ASSERT((nvmeIOCmd->PRP1[0] & 0x3) == 0 && (nvmeIOCmd->PRP2[0] & 0x3) == 0);
     ASSERT(nvmeIOCmd->PRP1[1] < 0x10000 && nvmeIOCmd->PRP2[1] < 0x10000);
 
-    dmaIndex = 0;
     requestedNvmeBlock = nlb + 1;
-    devAddr = (unsigned long long)DDR4_BUFFER_BASE_ADDR + (unsigned long long)startACTID[0] * (unsigned long long)BYTES_PER_NVME_BLOCK;
-    devAddrH = (unsigned int)(devAddr >> 32);
-    devAddrL = (unsigned int)(devAddr & 0xFFFFFFFF);
-    numOfNvmeBlock = 0;
+    if(cstore_range(startACTID[0], requestedNvmeBlock) == CSTORE_RANGE_INSIDE) {
+        agg_stats_read_dma(requestedNvmeBlock * BYTES_PER_NVME_BLOCK);
+        //staged writes of the range are compressed first so that the map is current
+        flush_cstore();
+        for(dmaIndex = 0; dmaIndex < requestedNvmeBlock; dmaIndex++) {
+            devAddr = take_cstore_slot(CSTORE_SLOT_READ);
+            cstore_read_block(startACTID[0] + dmaIndex, devAddr);
+            set_auto_tx_dma(cmdSlotTag, dmaIndex, (unsigned int)(devAddr >> 32), (unsigned int)(devAddr & 0xFFFFFFFF), NVME_COMMAND_AUTO_COMPLETION_ON);
+        }
+        return;
+    }
+
+    hotNvmeBlock = get_hot_nvme_block(startACTID[0], requestedNvmeBlock);
+    agg_stats_read_dma(requestedNvmeBlock * BYTES_PER_NVME_BLOCK);
+    if(hotNvmeBlock)
+        sync_transform(startACTID[0], hotNvmeBlock, 1);
 
-    while(numOfNvmeBlock < requestedNvmeBlock) {
-        set_auto_tx_dma(cmdSlotTag, dmaIndex, devAddrH, devAddrL, NVME_COMMAND_AUTO_COMPLETION_ON);
-        numOfNvmeBlock++;
-        dmaIndex++;
-        devAddr += BYTES_PER_NVME_BLOCK;
-        devAddrH = (unsigned int)(devAddr >> 32);
-        devAddrL = (unsigned int)(devAddr & 0xFFFFFFFF);
+    //the linear store keeps materialized runs contiguous, hand them over in one go
+    for(dmaIndex = 0; dmaIndex < hotNvmeBlock; dmaIndex += extent) {
+        extent = get_hot_region_extent(startACTID[0] + dmaIndex, hotNvmeBlock - dmaIndex, &devAddr, &synthetic);
+        if(synthetic) {
+            unsigned int fillIndex;
+            for(fillIndex = dmaIndex; fillIndex < dmaIndex + extent; fillIndex++)
+                set_auto_tx_dma(cmdSlotTag, fillIndex, (unsigned int)(devAddr >> 32), (unsigned int)(devAddr & 0xFFFFFFFF), NVME_COMMAND_AUTO_COMPLETION_ON);
+        }
+        else
+            set_auto_tx_dma_range(cmdSlotTag, dmaIndex, extent, devAddr, NVME_COMMAND_AUTO_COMPLETION_ON);
+    }
+
+    for(dmaIndex = hotNvmeBlock; dmaIndex < requestedNvmeBlock; dmaIndex++) {
+        bufEntry = get_read_data_buffer(startACTID[0] + dmaIndex - HOT_REGION_PAGES);
+        devAddr = get_data_buffer_addr(bufEntry);
+        set_auto_tx_dma(cmdSlotTag, dmaIndex, (unsigned int)(devAddr >> 32), (unsigned int)(devAddr & 0xFFFFFFFF), NVME_COMMAND_AUTO_COMPLETION_ON);
+        set_data_buffer_tx_dma(bufEntry);
     }
 }
 
 void handle_nvme_io_write(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd) {
-    unsigned int requestedNvmeBlock, dmaIndex, numOfNvmeBlock, devAddrH, devAddrL;
+    unsigned int requestedNvmeBlock, hotNvmeBlock, dmaIndex, bufEntry, status;
     unsigned long long devAddr;
     
     IO_READ_COMMAND_DW12 writeInfo12;
@@ -151,28 +401,173 @@ void handle_nvme_io_write(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd) {
     startACTID[0] = nvmeIOCmd->dword[10];
     startACTID[1] = nvmeIOCmd->dword[11];
     nlb = writeInfo12.NLB;
+    status = translate_nvme_block(nvmeIOCmd->NSID, &startACTID[0], nlb + 1);
+    if(status != SC_SUCCESSFUL_COMPLETION) {
+        send_generic_status(cmdSlotTag, status);
+        return;
+    }
 
-    ASSERT(startACTID[0] < STORAGE_CAPACITY_L && (startACTID[1] < STORAGE_CAPACITY_H || startACTID[1] == 0));
+    ASSERT(startACTID[0] + nlb < storageCapacity_L && startACTID[1] == 0);
     ASSERT((nvmeIOCmd->PRP1[0] & 0xF) == 0 && (nvmeIOCmd->PRP2[0] & 0xF) == 0);
     ASSERT(nvmeIOCmd->PRP1[1] < 0x10000 && nvmeIOCmd->PRP2[1] < 0x10000);
 
-    dmaIndex = 0;
     requestedNvmeBlock = nlb + 1;
-    devAddr = (unsigned long long)DDR4_BUFFER_BASE_ADDR + (unsigned long long)startACTID[0] * (unsigned long long)BYTES_PER_NVME_BLOCK;
-    devAddrH = (unsigned int)(devAddr >> 32);
-    devAddrL = (unsigned int)(devAddr & 0xFFFFFFFF);
-    numOfNvmeBlock = 0;
+    if(cstore_range(startACTID[0], requestedNvmeBlock) == CSTORE_RANGE_INSIDE) {
+        //the heap must take the blocks even if none of them compresses
+        if(!cstore_reserve(requestedNvmeBlock)) {
+            NVME_COMPLETION nvmeCPL;
+            nvmeCPL.dword[0] = 0;
+            nvmeCPL.statusField.SCT = SCT_COMMAND_SPECIFIC_STATUS;
+            nvmeCPL.statusField.SC = SC_CAPACITY_EXCEEDED;
+            set_auto_nvme_cpl(cmdSlotTag, 0, nvmeCPL.statusFieldWord);
+            return;
+        }
+
+        agg_stats_write_dma(requestedNvmeBlock * BYTES_PER_NVME_BLOCK);
+        for(dmaIndex = 0; dmaIndex < requestedNvmeBlock; dmaIndex++) {
+            devAddr = take_cstore_slot(startACTID[0] + dmaIndex);
+            set_auto_rx_dma(cmdSlotTag, dmaIndex, (unsigned int)(devAddr >> 32), (unsigned int)(devAddr & 0xFFFFFFFF), NVME_COMMAND_AUTO_COMPLETION_ON);
+        }
+        get_auto_rx_dma_mark(&lastWriteDmaMark);
+        return;
+    }
+
+    hotNvmeBlock = get_hot_nvme_block(startACTID[0], requestedNvmeBlock);
+    agg_stats_write_dma(requestedNvmeBlock * BYTES_PER_NVME_BLOCK);
 
-    while(numOfNvmeBlock < requestedNvmeBlock) {
-        set_auto_rx_dma(cmdSlotTag, dmaIndex, devAddrH, devAddrL, NVME_COMMAND_AUTO_COMPLETION_ON);
-        numOfNvmeBlock++;
-        dmaIndex++;
-        devAddr += BYTES_PER_NVME_BLOCK;
-        devAddrH = (unsigned int)(devAddr >> 32);
-        devAddrL = (unsigned int)(devAddr & 0xFFFFFFFF);
+    if(hotNvmeBlock) {
+        //pending conversions must not pick up the new data
+        sync_transform(startACTID[0], hotNvmeBlock, 0);
+        prepare_hot_region_write(startACTID[0], hotNvmeBlock);
+        devAddr = (unsigned long long)DDR4_HOT_REGION_BASE_ADDR + (unsigned long long)startACTID[0] * (unsigned long long)BYTES_PER_NVME_BLOCK;
+        set_auto_rx_dma_range(cmdSlotTag, 0, hotNvmeBlock, devAddr, NVME_COMMAND_AUTO_COMPLETION_ON);
+        get_auto_rx_dma_mark(&lastWriteDmaMark);
+        transform_note_write(startACTID[0], hotNvmeBlock);
+    }
+
+    for(dmaIndex = hotNvmeBlock; dmaIndex < requestedNvmeBlock; dmaIndex++) {
+        bufEntry = get_write_data_buffer(startACTID[0] + dmaIndex - HOT_REGION_PAGES);
+        devAddr = get_data_buffer_addr(bufEntry);
+        set_auto_rx_dma(cmdSlotTag, dmaIndex, (unsigned int)(devAddr >> 32), (unsigned int)(devAddr & 0xFFFFFFFF), NVME_COMMAND_AUTO_COMPLETION_ON);
+        set_data_buffer_rx_dma(bufEntry);
     }
 }
 
+static void zero_hot_blocks(unsigned int startACTID, unsigned int hotNvmeBlock) {
+    sync_transform(startACTID, hotNvmeBlock, 0);
+    //host DMA queued by earlier commands must not land on or read the cleared blocks
+    check_auto_rx_dma_done();
+    check_auto_tx_dma_done();
+    zero_hot_region(startACTID, hotNvmeBlock);
+}
+
+//used by Write Zeroes and Deallocate, deallocated blocks read back as zeroes
+static void zero_nvme_block(unsigned int startACTID, unsigned int requestedNvmeBlock) {
+    unsigned int hotNvmeBlock, numOfNvmeBlock, bufEntry;
+
+    if(cstore_range(startACTID, requestedNvmeBlock) == CSTORE_RANGE_INSIDE) {
+        //staged writes must not bring the data back
+        flush_cstore();
+        cstore_unmap(startACTID, requestedNvmeBlock);
+        return;
+    }
+
+    hotNvmeBlock = get_hot_nvme_block(startACTID, requestedNvmeBlock);
+    if(hotNvmeBlock)
+        zero_hot_blocks(startACTID, hotNvmeBlock);
+
+    //the FTL tier writes zero pages so that the result survives a remount
+    for(numOfNvmeBlock = hotNvmeBlock; numOfNvmeBlock < requestedNvmeBlock; numOfNvmeBlock++) {
+        bufEntry = get_write_data_buffer(startACTID + numOfNvmeBlock - HOT_REGION_PAGES);
+        memset((void *)(unsigned long)get_data_buffer_addr(bufEntry), 0, BYTES_PER_NVME_BLOCK);
+    }
+}
+
+//the next owner of a deleted namespace must not see its data, in any tier
+void scrub_nvme_block(unsigned int startACTID, unsigned int requestedNvmeBlock) {
+    unsigned int hotNvmeBlock, numOfNvmeBlock, bufEntry, lpn;
+
+    //the part of a compressed range inside the extent is dropped, the range stays configured
+    if(cstore_range(startACTID, requestedNvmeBlock) != CSTORE_RANGE_OUTSIDE) {
+        flush_cstore();
+        cstore_unmap(startACTID, requestedNvmeBlock);
+    }
+
+    hotNvmeBlock = get_hot_nvme_block(startACTID, requestedNvmeBlock);
+    if(hotNvmeBlock)
+        zero_hot_blocks(startACTID, hotNvmeBlock);
+
+    //a namespace may span most of the flash, only the pages holding data are overwritten
+    for(numOfNvmeBlock = hotNvmeBlock; numOfNvmeBlock < requestedNvmeBlock; numOfNvmeBlock++) {
+        lpn = startACTID + numOfNvmeBlock - HOT_REGION_PAGES;
+        if(!is_page_written(lpn))
+            continue;
+        bufEntry = get_write_data_buffer(lpn);
+        memset((void *)(unsigned long)get_data_buffer_addr(bufEntry), 0, BYTES_PER_NVME_BLOCK);
+    }
+}
+
+void handle_nvme_io_write_zeroes(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd) {
+    NVME_COMPLETION nvmeCPL;
+    IO_WRITE_COMMAND_DW12 writeInfo12;
+    unsigned int startACTID[2];
+    unsigned int status;
+
+    writeInfo12.dword = nvmeIOCmd->dword[12];
+    startACTID[0] = nvmeIOCmd->dword[10];
+    startACTID[1] = nvmeIOCmd->dword[11];
+
+    nvmeCPL.dword[0] = 0;
+    nvmeCPL.statusFieldWord = 0;
+    status = (startACTID[1] != 0) ? SC_LBA_OUT_OF_RANGE : translate_nvme_block(nvmeIOCmd->NSID, &startACTID[0], writeInfo12.NLB + 1);
+    if(status != SC_SUCCESSFUL_COMPLETION) {
+        nvmeCPL.statusField.SCT = SCT_GENERIC_COMMAND_STATUS;
+        nvmeCPL.statusField.SC = status;
+    }
+    else
+        zero_nvme_block(startACTID[0], writeInfo12.NLB + 1);
+
+    set_auto_nvme_cpl(cmdSlotTag, 0, nvmeCPL.statusFieldWord);
+}
+
+void handle_nvme_io_dataset_management(unsigned int cmdSlotTag, NVME_IO_COMMAND *nvmeIOCmd) {
+    NVME_COMPLETION nvmeCPL;
+    _IO_DATASET_MANAGEMENT_COMMAND_DW10 dsmInfo10;
+    _IO_DATASET_MANAGEMENT_COMMAND_DW11 dsmInfo11;
+    DATASET_MANAGEMENT_RANGE *dsmRange;
+    unsigned int rangeIdx, status;
+
+    *(unsigned int *)&dsmInfo10 = nvmeIOCmd->dword[10];
+    *(unsigned int *)&dsmInfo11 = nvmeIOCmd->dword[11];
+
+    nvmeCPL.dword[0] = 0;
+    nvmeCPL.statusFieldWord = 0;
+
+    //access hints are accepted and ignored
+    if(dsmInfo11.AD) {
+        set_auto_rx_dma(cmdSlotTag, 0, 0, IO_CMD_DRAM_DATA_BUFFER, NVME_COMMAND_AUTO_COMPLETION_OFF);
+        check_auto_rx_dma_done();
+
+        dsmRange = (DATASET_MANAGEMENT_RANGE *)IO_CMD_DRAM_DATA_BUFFER;
+        for(rangeIdx = 0; rangeIdx <= dsmInfo10.NR; rangeIdx++) {
+            if(dsmRange[rangeIdx].lengthInLogicalBlocks == 0)
+                continue;
+
+            status = (dsmRange[rangeIdx].startingLBA[1] != 0) ? SC_LBA_OUT_OF_RANGE
+                : translate_nvme_block(nvmeIOCmd->NSID, &dsmRange[rangeIdx].startingLBA[0], dsmRange[rangeIdx].lengthInLogicalBlocks);
+            if(status != SC_SUCCESSFUL_COMPLETION) {
+                nvmeCPL.statusField.SCT = SCT_GENERIC_COMMAND_STATUS;
+                nvmeCPL.statusField.SC = status;
+                break;
+            }
+
+            zero_nvme_block(dsmRange[rangeIdx].startingLBA[0], dsmRange[rangeIdx].lengthInLogicalBlocks);
+        }
+    }
+
+    set_auto_nvme_cpl(cmdSlotTag, 0, nvmeCPL.statusFieldWord);
+}
+
 void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd) {
     NVME_IO_COMMAND *nvmeIOCmd;
     NVME_COMPLETION nvmeCPL;
@@ -184,6 +579,8 @@ void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd) {
     switch(opc) {
         case IO_NVM_FLUSH:
             PRINT("IO Flush Command\r\n");
+            flush_data_buffer();
+            flush_cstore();
             nvmeCPL.dword[0] = 0;
             nvmeCPL.specific = 0x0;
             set_auto_nvme_cpl(nvmeCmd->cmdSlotTag, nvmeCPL.specific, nvmeCPL.statusFieldWord);
@@ -196,6 +593,14 @@ void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd) {
             PRINT("IO Read Command\r\n");
             handle_nvme_io_read(nvmeCmd->cmdSlotTag, nvmeIOCmd);
             break;
+        case IO_NVM_WRITE_ZEROES:
+            PRINT("IO Write Zeroes Command\r\n");
+            handle_nvme_io_write_zeroes(nvmeCmd->cmdSlotTag, nvmeIOCmd);
+            break;
+        case IO_NVM_DATASET_MANAGEMENT:
+            PRINT("IO Dataset Management Command\r\n");
+            handle_nvme_io_dataset_management(nvmeCmd->cmdSlotTag, nvmeIOCmd);
+            break;
         case IO_NVM_AGGREGATE_START:
             PRINT("Host requested aggregation start\n");
             handle_aggregate_start(nvmeCmd->cmdSlotTag, nvmeIOCmd);
@@ -49,4 +49,8 @@
 
 void handle_nvme_io_cmd(NVME_COMMAND *nvmeCmd);
 
+unsigned int cstore_background_step();
+
+void scrub_nvme_block(unsigned int startACTID, unsigned int requestedNvmeBlock);
+
 #endif	//__NVME_IO_CMD_H_
@@ -65,24 +65,55 @@
 #include "nvme_main.h"
 #include "nvme_admin_cmd.h"
 #include "nvme_io_cmd.h"
+#include "nvme_arbiter.h"
+#include "nvme_coalesce.h"
+#include "nvme_agg_stats.h"
+#include "nvme_namespace.h"
+#include "nvme_profile.h"
 
 #include "../memory_map.h"
+#include "../ftl_config.h"
+#include "../data_buffer.h"
+#include "../hot_region.h"
+#include "../transform.h"
+#include "../epoch_ring.h"
+#include "../compress_store.h"
+#include "../agg_engine.h"
 
 volatile NVME_CONTEXT g_nvmeTask;
 
+static void reset_io_queues()
+{
+	unsigned int qIdx;
+
+	for(qIdx = 0; qIdx < MAX_NUM_OF_IO_CQ; qIdx++)
+		set_io_cq(qIdx, 0, 0, 0, 0, 0, 0);
+
+	for(qIdx = 0; qIdx < MAX_NUM_OF_IO_SQ; qIdx++)
+		set_io_sq(qIdx, 0, 0, 0, 0, 0);
+
+	arb_init();
+	coalesce_init();
+}
+
 void nvme_main()
 {
 	unsigned int rstCnt = 0;
-	unsigned char *p_storage = (unsigned char *)DDR4_BUFFER_BASE_ADDR;
 
-	//memset(p_storage, 0xFF, NVME_STORAGE);
-	for(long long i = 0; i < NVME_STORAGE / ONE_GB; i++)
-	{
-		xil_printf("init[%d] : 0x%llx\r\n", i, p_storage + i * ONE_GB);
-		memset(p_storage + i * ONE_GB, 0xFF, ONE_GB);
-	}
-
-	xil_printf("[ storage capacity %d MB ]\r\n", STORAGE_CAPACITY_L / ((1024*1024) / BYTES_PER_NVME_BLOCK));
+	//DDR4 is cleared lazily, the controller can report ready right away
+	init_hot_region();
+	init_transform();
+	init_epoch_ring();
+	init_cstore();
+	ftl_init();
+	init_namespaces();
+	init_agg_engine();
+	arb_init();
+	coalesce_init();
+	agg_stats_init();
+	prof_init();
+
+	xil_printf("[ storage capacity %d MB ]\r\n", storageCapacity_L / ((1024*1024) / BYTES_PER_NVME_BLOCK));
 
 	xil_printf("Turn on the host PC \r\n");
 
@@ -99,26 +130,54 @@ void nvme_main()
 				g_nvmeTask.status = NVME_TASK_RUNNING;
 				xil_printf("\r\nNVMe ready!!!\r\n");
 			}
+			else
+				hot_region_background_step();
 		}
 		else if(g_nvmeTask.status == NVME_TASK_RUNNING)
 		{
 			NVME_COMMAND nvmeCmd;
 			unsigned int cmdValid;
+			unsigned int fetchCnt;
 
-			cmdValid = get_nvme_cmd(&nvmeCmd.qID, &nvmeCmd.cmdSlotTag, &nvmeCmd.cmdSeqNum, nvmeCmd.cmdDword);
-
-			if(cmdValid == 1)
+			//drain the command FIFO so that every submission queue takes part in arbitration
+			for(fetchCnt = 0; fetchCnt < ARB_FETCH_BURST; fetchCnt++)
 			{
+				PROF_ENTER(fetchStart);
+				cmdValid = get_nvme_cmd(&nvmeCmd.qID, &nvmeCmd.cmdSlotTag, &nvmeCmd.cmdSeqNum, nvmeCmd.cmdDword);
+				if(cmdValid == 0)
+					break;
+
 				rstCnt = 0;
 				if(nvmeCmd.qID == 0)
 				{
+					PROF_FETCH_DONE(nvmeCmd.cmdSlotTag, fetchStart);
+					PROF_CMD_BEGIN(nvmeCmd.qID, nvmeCmd.cmdSlotTag, nvmeCmd.cmdDword[0] & 0xFF);
 					handle_nvme_admin_cmd(&nvmeCmd);
+					PROF_CMD_END();
 				}
 				else
 				{
-					handle_nvme_io_cmd(&nvmeCmd);
+					cmdValid = arb_push(&nvmeCmd);
+					ASSERT(cmdValid == 1);
+					PROF_FETCH_DONE(nvmeCmd.cmdSlotTag, fetchStart);
 				}
 			}
+
+			if(arb_pop(&nvmeCmd) == 1)
+			{
+				PROF_CMD_BEGIN(nvmeCmd.qID, nvmeCmd.cmdSlotTag, nvmeCmd.cmdDword[0] & 0xFF);
+				coalesce_hold(nvmeCmd.qID);
+				handle_nvme_io_cmd(&nvmeCmd);
+
+				PROF_ENTER(cplStart);
+				coalesce_post(nvmeCmd.qID);
+				PROF_LEAVE(PROF_STAGE_CPL, cplStart);
+				PROF_CMD_END();
+			}
+			else if(fetchCnt == 0 && !cstore_background_step())
+				hot_region_background_step();
+
+			coalesce_poll();
 		}
 		else if(g_nvmeTask.status == NVME_TASK_SHUTDOWN)
 		{
@@ -126,14 +185,10 @@ void nvme_main()
 			nvmeReg.dword = IO_READ32(NVME_STATUS_REG_ADDR);
 			if(nvmeReg.ccShn != 0)
 			{
-				unsigned int qID;
 				set_nvme_csts_shst(1);
 
-				for(qID = 0; qID < 8; qID++)
-				{
-					set_io_cq(qID, 0, 0, 0, 0, 0, 0);
-					set_io_sq(qID, 0, 0, 0, 0, 0);
-				}
+				flush_data_buffer();
+				reset_io_queues();
 
 				set_nvme_admin_queue(0, 0, 0);
 				g_nvmeTask.cacheEn = 0;
@@ -149,18 +204,12 @@ void nvme_main()
 			ccEn = check_nvme_cc_en();
 			if(ccEn == 0)
 			{
-                unsigned int qID;
-
 				g_nvmeTask.cacheEn = 0;
 				set_nvme_csts_shst(0);
 				set_nvme_csts_rdy(0);
 
-                set_nvme_admin_queue(0, 0, 0);
-                for(qID = 0; qID < 8; qID++)
-                {
-                    set_io_cq(qID, 0, 0, 0, 0, 0, 0);
-                    set_io_sq(qID, 0, 0, 0, 0, 0);
-                }
+				set_nvme_admin_queue(0, 0, 0);
+				reset_io_queues();
 
 				g_nvmeTask.status = NVME_TASK_IDLE;
 				xil_printf("\r\nNVMe disable!!!\r\n");
@@ -168,12 +217,7 @@ void nvme_main()
 		}
 		else if(g_nvmeTask.status == NVME_TASK_RESET)
 		{
-			unsigned int qID;
-			for(qID = 0; qID < 8; qID++)
-			{
-				set_io_cq(qID, 0, 0, 0, 0, 0, 0);
-				set_io_sq(qID, 0, 0, 0, 0, 0);
-			}
+			reset_io_queues();
 
 			if (rstCnt== 5){
 				pcie_async_reset(rstCnt);
@@ -0,0 +1,213 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_namespace.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Namespace Manager
+// File Name: nvme_namespace.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - keeps one table entry per NSID, namespaces are disjoint extents of the device blocks
+//   - translates namespace blocks to device blocks with one bounds check
+//   - holds the aggregation operator, data type and slot layout of every namespace
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+
+#include "debug.h"
+
+#include "nvme.h"
+#include "nvme_namespace.h"
+#include "../ftl_config.h"
+#include "../agg_engine.h"
+
+NS_ENTRY nsTable[NS_TABLE_SIZE];
+
+static void reset_ns_entry(NS_ENTRY *ns)
+{
+	ns->baseACTID = 0;
+	ns->nBlocks = 0;
+	ns->ioBlocks = 0;
+	ns->aggConfig = NS_AGG_OP_ANY;
+	ns->slotStride = 0;
+}
+
+//namespace 1 covers the whole device until the host changes the layout
+void init_namespaces()
+{
+	unsigned int nsid;
+
+	for(nsid = 0; nsid < NS_TABLE_SIZE; nsid++)
+		reset_ns_entry(&nsTable[nsid]);
+
+	nsTable[1].nBlocks = storageCapacity_L;
+	nsTable[1].ioBlocks = storageCapacity_L;
+}
+
+unsigned int ns_translate(unsigned int nsid, unsigned int *actid, unsigned int nBlocks)
+{
+	NS_ENTRY *ns;
+
+	ns = NS_ENTRY_OF(nsid);
+	if(ns->ioBlocks == 0)
+		return NS_STATUS_INVALID;
+	if(*actid >= ns->ioBlocks || nBlocks > ns->ioBlocks - *actid)
+		return NS_STATUS_OUT_OF_RANGE;
+
+	*actid += ns->baseACTID;
+	return NS_STATUS_OK;
+}
+
+//first fit between the allocated extents, the lowest free blocks are in the DDR4 hot region
+unsigned int ns_create(unsigned int nBlocks, unsigned int *nsid)
+{
+	unsigned int id, other, start, moved;
+
+	if(nBlocks == 0 || nBlocks > storageCapacity_L)
+		return NS_STATUS_NO_CAPACITY;
+
+	for(id = 1; id < NS_TABLE_SIZE; id++)
+		if(nsTable[id].nBlocks == 0)
+			break;
+	if(id == NS_TABLE_SIZE)
+		return NS_STATUS_NO_ID;
+
+	//move the candidate past every extent it overlaps until it fits
+	start = 0;
+	do
+	{
+		moved = 0;
+		for(other = 1; other < NS_TABLE_SIZE; other++)
+		{
+			if(nsTable[other].nBlocks == 0)
+				continue;
+			if(start < nsTable[other].baseACTID + nsTable[other].nBlocks && nsTable[other].baseACTID < start + nBlocks)
+			{
+				start = nsTable[other].baseACTID + nsTable[other].nBlocks;
+				moved = 1;
+			}
+		}
+		if(start > storageCapacity_L || nBlocks > storageCapacity_L - start)
+			return NS_STATUS_NO_CAPACITY;
+	} while(moved);
+
+	reset_ns_entry(&nsTable[id]);
+	nsTable[id].baseACTID = start;
+	nsTable[id].nBlocks = nBlocks;
+	*nsid = id;
+
+	return NS_STATUS_OK;
+}
+
+unsigned int ns_delete(unsigned int nsid)
+{
+	if(nsid == NS_ALL)
+	{
+		for(nsid = 1; nsid < NS_TABLE_SIZE; nsid++)
+			reset_ns_entry(&nsTable[nsid]);
+		return NS_STATUS_OK;
+	}
+
+	if(nsid == 0 || nsid >= NS_TABLE_SIZE || nsTable[nsid].nBlocks == 0)
+		return NS_STATUS_INVALID;
+
+	reset_ns_entry(&nsTable[nsid]);
+	return NS_STATUS_OK;
+}
+
+unsigned int ns_attach(unsigned int nsid, unsigned int attach)
+{
+	NS_ENTRY *ns;
+
+	if(nsid == 0 || nsid >= NS_TABLE_SIZE || nsTable[nsid].nBlocks == 0)
+		return NS_STATUS_INVALID;
+
+	ns = &nsTable[nsid];
+	if(attach && ns->ioBlocks)
+		return NS_STATUS_ALREADY_ATTACHED;
+	if(!attach && !ns->ioBlocks)
+		return NS_STATUS_NOT_ATTACHED;
+
+	ns->ioBlocks = attach ? ns->nBlocks : 0;
+	return NS_STATUS_OK;
+}
+
+unsigned int ns_set_agg(unsigned int nsid, unsigned int dword11, unsigned int dword12)
+{
+	unsigned int op, dataType, nSlots, trim;
+
+	if(nsid == 0 || nsid >= NS_TABLE_SIZE || nsTable[nsid].nBlocks == 0)
+		return NS_STATUS_INVALID;
+
+	op = dword11 & 0xFF;
+	dataType = (dword11 >> 8) & 0xFF;
+	nSlots = ((dword11 >> 16) & 0xFF) + 1;
+	trim = (dword11 >> 24) & 0xFF;
+
+	//the operators reduce FP32 only
+	if(dataType != NS_DATA_TYPE_FP32)
+		return NS_STATUS_INVALID;
+	if(op != NS_AGG_OP_ANY && op > AGG_OP_WEIGHTED_MEAN)
+		return NS_STATUS_INVALID;
+	if(op == AGG_OP_TRIMMED_MEAN && 2 * trim >= nSlots)
+		return NS_STATUS_INVALID;
+
+	nsTable[nsid].aggConfig = dword11;
+	nsTable[nsid].slotStride = dword12;
+	return NS_STATUS_OK;
+}
+
+unsigned int ns_get_agg(unsigned int nsid)
+{
+	return NS_ENTRY_OF(nsid)->aggConfig;
+}
+
+//fills in the job parameters of AGG_OP_NAMESPACE, returns 0 if the namespace does not allow the operator
+unsigned int ns_resolve_agg(unsigned int nsid, unsigned int *op, unsigned int *nSlots, unsigned int *trim, unsigned int *slotStride)
+{
+	NS_ENTRY *ns;
+	unsigned int nsOp;
+
+	ns = NS_ENTRY_OF(nsid);
+	nsOp = ns->aggConfig & 0xFF;
+
+	if(*op == AGG_OP_NAMESPACE)
+	{
+		if(nsOp == NS_AGG_OP_ANY)
+			return 0;
+
+		*op = nsOp;
+		*nSlots = ((ns->aggConfig >> 16) & 0xFF) + 1;
+		*trim = (ns->aggConfig >> 24) & 0xFF;
+		*slotStride = ns->slotStride;
+		return 1;
+	}
+
+	return (nsOp == NS_AGG_OP_ANY || nsOp == *op);
+}
@@ -0,0 +1,104 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_namespace.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Namespace Manager
+// File Name: nvme_namespace.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the namespace table indexed by NSID
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NVME_NAMESPACE_H_
+#define __NVME_NAMESPACE_H_
+
+#define NS_MAX							8
+#define NS_TABLE_SIZE					(NS_MAX + 1)	//entry 0 stands for every NSID that is not valid
+#define NS_ALL							0xFFFFFFFF
+
+#define NS_STATUS_OK					0
+#define NS_STATUS_INVALID				1	//no such namespace or not attached
+#define NS_STATUS_OUT_OF_RANGE			2
+#define NS_STATUS_NO_ID					3
+#define NS_STATUS_NO_CAPACITY			4
+#define NS_STATUS_ALREADY_ATTACHED		5
+#define NS_STATUS_NOT_ATTACHED			6
+
+/*
+ * Aggregation configuration of a namespace, Set/Get Features NS_AGG_FEATURE_ID
+ *   dword11     [7:0] operator, [15:8] data type, [23:16] nSlots - 1, [31:24] trim per side
+ *   dword12     slot stride in blocks
+ * Aggregate Start with operator AGG_OP_NAMESPACE takes all of them from the namespace.
+ * A namespace with an operator other than NS_AGG_OP_ANY rejects other operators.
+ */
+#define NS_AGG_OP_ANY					0xFF
+#define NS_DATA_TYPE_FP32				0
+
+typedef struct _NS_ENTRY
+{
+	unsigned int baseACTID;			//first device block
+	unsigned int nBlocks;			//0 if the namespace is not allocated
+	unsigned int ioBlocks;			//nBlocks while attached, 0 otherwise
+	unsigned int aggConfig;			//dword11 of NS_AGG_FEATURE_ID
+	unsigned int slotStride;
+} NS_ENTRY;
+
+/* Reported at the start of the vendor specific area of Identify Namespace */
+typedef struct _NS_IDENTIFY_VS
+{
+	unsigned int baseACTID;
+	unsigned int aggConfig;
+	unsigned int slotStride;
+	unsigned int reserved0;
+} NS_IDENTIFY_VS;
+
+extern NS_ENTRY nsTable[NS_TABLE_SIZE];
+
+//a bounds check and an index, the table is kept current by the admin commands
+#define NS_ENTRY_OF(nsid)				(&nsTable[((nsid) < NS_TABLE_SIZE) ? (nsid) : 0])
+
+void init_namespaces();
+
+unsigned int ns_translate(unsigned int nsid, unsigned int *actid, unsigned int nBlocks);
+
+unsigned int ns_create(unsigned int nBlocks, unsigned int *nsid);
+
+unsigned int ns_delete(unsigned int nsid);
+
+unsigned int ns_attach(unsigned int nsid, unsigned int attach);
+
+unsigned int ns_set_agg(unsigned int nsid, unsigned int dword11, unsigned int dword12);
+
+unsigned int ns_get_agg(unsigned int nsid);
+
+unsigned int ns_resolve_agg(unsigned int nsid, unsigned int *op, unsigned int *nSlots, unsigned int *trim, unsigned int *slotStride);
+
+#endif	//__NVME_NAMESPACE_H_
@@ -0,0 +1,182 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_profile.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Command Processing Profiler
+// File Name: nvme_profile.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - counts cycles per opcode class in fetch, decode, DMA setup and completion
+//   - keeps a log2 histogram per class and stage
+//   - the cycle rate is calibrated against the global timer at boot
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+#include "xtime_l.h"
+
+#include "nvme.h"
+#include "nvme_profile.h"
+
+PROF_CONTEXT g_prof;
+
+static unsigned int cycle_bucket(PROF_CYCLES cycles)
+{
+	int bucket;
+
+	bucket = cycles ? 31 - __builtin_clz(cycles) - 5 : 0;
+	if(bucket < 0)
+		bucket = 0;
+	if(bucket >= PROF_HISTOGRAM_BUCKETS)
+		bucket = PROF_HISTOGRAM_BUCKETS - 1;
+
+	return bucket;
+}
+
+static void add_sample(PROF_STAGE_COUNTERS *counters, PROF_CYCLES cycles)
+{
+	counters->cycles += cycles;
+	counters->count++;
+	if(cycles > counters->maxCycles)
+		counters->maxCycles = cycles;
+	counters->histogram[cycle_bucket(cycles)]++;
+}
+
+static unsigned int cmd_class(unsigned int qID, unsigned int opc)
+{
+	if(qID == 0)
+		return PROF_CLASS_ADMIN;
+
+	switch(opc)
+	{
+		case IO_NVM_READ:
+			return PROF_CLASS_READ;
+		case IO_NVM_WRITE:
+			return PROF_CLASS_WRITE;
+		case IO_NVM_AGGREGATE_START:
+			return PROF_CLASS_AGGREGATE;
+		default:
+			return PROF_CLASS_OTHER;
+	}
+}
+
+void prof_init()
+{
+	XTime start, now;
+	PROF_CYCLES startCycles, cycles;
+
+	memset(&g_prof, 0, sizeof(PROF_CONTEXT));
+
+#if defined(__ARM_ARCH_7A__)
+	//PMCR: enable the counters and reset the cycle counter, PMCNTENSET: enable the cycle counter
+	__asm__ volatile("mcr p15, 0, %0, c9, c12, 0" :: "r"(0x5));
+	__asm__ volatile("mcr p15, 0, %0, c9, c12, 1" :: "r"(0x80000000));
+#elif defined(__aarch64__)
+	//same on the A53, PMCCFILTR_EL0 of zero also counts the cycles spent at EL3
+	__asm__ volatile("msr pmccfiltr_el0, %0" :: "r"(0x0ULL));
+	__asm__ volatile("msr pmcr_el0, %0" :: "r"(0x5ULL));
+	__asm__ volatile("msr pmcntenset_el0, %0" :: "r"(0x80000000ULL));
+	__asm__ volatile("isb");
+#endif
+
+	//one millisecond of the global timer gives the cycle rate
+	XTime_GetTime(&start);
+	startCycles = prof_cycles();
+	do
+		XTime_GetTime(&now);
+	while(now - start < COUNTS_PER_SECOND / 1000);
+	cycles = prof_cycles() - startCycles;
+
+	g_prof.cyclesPerSecond = (unsigned long long)cycles * COUNTS_PER_SECOND / (now - start);
+	g_prof.clearTime = now;
+}
+
+void prof_fetch_done(unsigned int cmdSlotTag, PROF_CYCLES start)
+{
+	g_prof.fetchCycles[cmdSlotTag] = prof_cycles() - start;
+}
+
+void prof_cmd_begin(unsigned int qID, unsigned int cmdSlotTag, unsigned int opc)
+{
+	g_prof.active = 1;
+	g_prof.cmdClass = cmd_class(qID, opc);
+	g_prof.cmdSlotTag = cmdSlotTag;
+	memset(g_prof.stageCycles, 0, sizeof(g_prof.stageCycles));
+	g_prof.cmdStart = prof_cycles();
+}
+
+void prof_leave(unsigned int stage, PROF_CYCLES start)
+{
+	if(g_prof.active)
+		g_prof.stageCycles[stage] += prof_cycles() - start;
+}
+
+void prof_cmd_end()
+{
+	PROF_STAGE_COUNTERS *counters;
+	PROF_CYCLES handler;
+
+	handler = prof_cycles() - g_prof.cmdStart;
+	g_prof.active = 0;
+
+	g_prof.stageCycles[PROF_STAGE_FETCH] = g_prof.fetchCycles[g_prof.cmdSlotTag];
+	g_prof.stageCycles[PROF_STAGE_DECODE] = handler - g_prof.stageCycles[PROF_STAGE_DMA] - g_prof.stageCycles[PROF_STAGE_CPL];
+	g_prof.stageCycles[PROF_STAGE_TOTAL] = g_prof.stageCycles[PROF_STAGE_FETCH] + handler;
+
+	counters = g_prof.stage[g_prof.cmdClass];
+	add_sample(&counters[PROF_STAGE_FETCH], g_prof.stageCycles[PROF_STAGE_FETCH]);
+	add_sample(&counters[PROF_STAGE_DECODE], g_prof.stageCycles[PROF_STAGE_DECODE]);
+	add_sample(&counters[PROF_STAGE_DMA], g_prof.stageCycles[PROF_STAGE_DMA]);
+	add_sample(&counters[PROF_STAGE_CPL], g_prof.stageCycles[PROF_STAGE_CPL]);
+	add_sample(&counters[PROF_STAGE_TOTAL], g_prof.stageCycles[PROF_STAGE_TOTAL]);
+}
+
+void prof_get_log_page(PROF_LOG_PAGE *logPage, unsigned int clear)
+{
+	XTime now;
+
+	XTime_GetTime(&now);
+
+	memset(logPage, 0, sizeof(PROF_LOG_PAGE));
+	logPage->version = PROF_VERSION;
+	logPage->numOfClasses = PROF_NUM_OF_CLASSES;
+	logPage->numOfStages = PROF_NUM_OF_STAGES;
+	logPage->histogramBuckets = PROF_HISTOGRAM_BUCKETS;
+	logPage->cyclesPerSecond = g_prof.cyclesPerSecond;
+	logPage->ticksPerSecond = COUNTS_PER_SECOND;
+	logPage->elapsedTicks = now - g_prof.clearTime;
+	memcpy(logPage->stage, g_prof.stage, sizeof(g_prof.stage));
+
+	if(clear)
+	{
+		memset(g_prof.stage, 0, sizeof(g_prof.stage));
+		g_prof.clearTime = now;
+	}
+}
@@ -0,0 +1,160 @@
+//////////////////////////////////////////////////////////////////////////////////
+// nvme_profile.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Command Processing Profiler
+// File Name: nvme_profile.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the per opcode cycle counters served as vendor log page 0xC2
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef __NVME_PROFILE_H_
+#define __NVME_PROFILE_H_
+
+#include "xtime_l.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define __CMD_PROFILE 1
+
+#define PROF_LOG_PAGE_ID				0xC2
+#define PROF_VERSION					1
+#define PROF_LSP_CLEAR					0x1		//Log Specific Field, clear the counters after the read
+
+#define PROF_CLASS_ADMIN				0
+#define PROF_CLASS_READ					1
+#define PROF_CLASS_WRITE				2
+#define PROF_CLASS_AGGREGATE			3
+#define PROF_CLASS_OTHER				4		//other IO commands
+#define PROF_NUM_OF_CLASSES				5
+
+#define PROF_STAGE_FETCH				0		//command FIFO and SRAM reads, arbiter push
+#define PROF_STAGE_DECODE				1		//handler except the two stages below
+#define PROF_STAGE_DMA					2		//host DMA descriptors issued, including waits for free FIFO entries
+#define PROF_STAGE_CPL					3		//completion FIFO writes and interrupt coalescing
+#define PROF_STAGE_TOTAL				4		//sum of the stages above
+#define PROF_NUM_OF_STAGES				5
+
+#define PROF_HISTOGRAM_BUCKETS			20		//bucket b counts [2^(b+5), 2^(b+6)) cycles, bucket 0 below 64 cycles
+
+typedef unsigned int PROF_CYCLES;			//differences stay correct across a wrap of the counter
+
+/* The layout is shared with the host (unvme_cmd_profile_t), fields are only appended */
+typedef struct _PROF_STAGE_COUNTERS
+{
+	unsigned long long cycles;
+	unsigned int count;
+	unsigned int maxCycles;
+	unsigned int histogram[PROF_HISTOGRAM_BUCKETS];
+} PROF_STAGE_COUNTERS;
+
+typedef struct _PROF_LOG_PAGE
+{
+	unsigned int version;
+	unsigned int numOfClasses;
+	unsigned int numOfStages;
+	unsigned int histogramBuckets;
+	unsigned long long cyclesPerSecond;
+	unsigned long long ticksPerSecond;
+	unsigned long long elapsedTicks;		//since power-on or the last clear
+	PROF_STAGE_COUNTERS stage[PROF_NUM_OF_CLASSES][PROF_NUM_OF_STAGES];
+} PROF_LOG_PAGE;
+
+typedef struct _PROF_CONTEXT
+{
+	unsigned long long cyclesPerSecond;
+	XTime clearTime;
+	PROF_CYCLES fetchCycles[1024];			//indexed by command slot tag (P_SLOT_TAG_WIDTH)
+
+	unsigned int active;					//a command is being handled
+	unsigned int cmdClass;
+	unsigned int cmdSlotTag;
+	PROF_CYCLES cmdStart;
+	PROF_CYCLES stageCycles[PROF_NUM_OF_STAGES];
+
+	PROF_STAGE_COUNTERS stage[PROF_NUM_OF_CLASSES][PROF_NUM_OF_STAGES];
+} PROF_CONTEXT;
+
+//ARM PMU cycle counter on the board, the TSC on an x86 simulation host, the global timer otherwise
+static inline PROF_CYCLES prof_cycles()
+{
+#if defined(__ARM_ARCH_7A__)
+	PROF_CYCLES cycles;
+
+	__asm__ volatile("mrc p15, 0, %0, c9, c13, 0" : "=r"(cycles));
+	return cycles;
+#elif defined(__aarch64__)
+	unsigned long long cycles;
+
+	__asm__ volatile("mrs %0, pmccntr_el0" : "=r"(cycles));
+	return (PROF_CYCLES)cycles;
+#elif defined(__x86_64__) || defined(__i386__)
+	return (PROF_CYCLES)__rdtsc();
+#else
+	XTime now;
+
+	XTime_GetTime(&now);
+	return (PROF_CYCLES)now;
+#endif
+}
+
+#if __CMD_PROFILE
+#define PROF_ENTER(start)						PROF_CYCLES start = prof_cycles()
+#define PROF_LEAVE(stage, start)				prof_leave(stage, start)
+#define PROF_FETCH_DONE(cmdSlotTag, start)		prof_fetch_done(cmdSlotTag, start)
+#define PROF_CMD_BEGIN(qID, cmdSlotTag, opc)	prof_cmd_begin(qID, cmdSlotTag, opc)
+#define PROF_CMD_END()							prof_cmd_end()
+#else
+#define PROF_ENTER(start)
+#define PROF_LEAVE(stage, start)
+#define PROF_FETCH_DONE(cmdSlotTag, start)
+#define PROF_CMD_BEGIN(qID, cmdSlotTag, opc)
+#define PROF_CMD_END()
+#endif
+
+void prof_init();
+
+void prof_fetch_done(unsigned int cmdSlotTag, PROF_CYCLES start);
+
+void prof_cmd_begin(unsigned int qID, unsigned int cmdSlotTag, unsigned int opc);
+
+void prof_leave(unsigned int stage, PROF_CYCLES start);
+
+void prof_cmd_end();
+
+void prof_get_log_page(PROF_LOG_PAGE *logPage, unsigned int clear);
+
+extern PROF_CONTEXT g_prof;
+
+#endif	//__NVME_PROFILE_H_
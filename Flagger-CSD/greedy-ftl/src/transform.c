@@ -0,0 +1,316 @@
+//////////////////////////////////////////////////////////////////////////////////
+// transform.c for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Transform Stage
+// File Name: transform.c
+//
+// Version: v1.0.0
+//
+// Description:
+//   - dequantizes INT8 uploads into FP32 regions of the hot region
+//   - quantizes FP32 regions into their window on read-out
+//   - conversion runs in software, the accelerator only sums FP32
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#include "string.h"
+
+#include "ftl_config.h"
+#include "hot_region.h"
+#include "transform.h"
+
+#define HOT_BLOCK_PTR(actid)	((void *)(unsigned long)(DDR4_HOT_REGION_BASE_ADDR + (unsigned long long)(actid) * BYTES_PER_NVME_BLOCK))
+
+XFORM_DESC xformDesc[XFORM_MAX_DESC];
+
+static unsigned int overlap(unsigned int start, unsigned int end, unsigned int lo, unsigned int hi)
+{
+	return (start < hi) && (lo < end);
+}
+
+static unsigned int touches_desc(XFORM_DESC *desc, unsigned int actid, unsigned int nBlocks)
+{
+	unsigned int windowEnd;
+
+	windowEnd = desc->windowACTID + desc->dataBlocks + desc->scaleBlocks;
+
+	return overlap(actid, actid + nBlocks, desc->regionACTID, desc->regionACTID + desc->regionBlocks)
+		|| overlap(actid, actid + nBlocks, desc->windowACTID, windowEnd);
+}
+
+//region blocks, relative to the region, whose window bytes lie in [actid, actid + nBlocks)
+static unsigned int window_to_region(XFORM_DESC *desc, unsigned int actid, unsigned int nBlocks, unsigned int *start, unsigned int *end)
+{
+	unsigned int lo, hi, scaleACTID, groupBlocks;
+
+	*start = desc->regionBlocks;
+	*end = 0;
+
+	lo = (actid > desc->windowACTID) ? actid : desc->windowACTID;
+	hi = (actid + nBlocks < desc->windowACTID + desc->dataBlocks) ? actid + nBlocks : desc->windowACTID + desc->dataBlocks;
+	if(lo < hi)
+	{
+		*start = (lo - desc->windowACTID) * XFORM_INT8_RATIO;
+		*end = (hi - desc->windowACTID) * XFORM_INT8_RATIO;
+	}
+
+	//a scale block holds the scales of XFORM_ELEMS_PER_BLOCK groups
+	scaleACTID = desc->windowACTID + desc->dataBlocks;
+	groupBlocks = 1 << desc->groupShift;
+	lo = (actid > scaleACTID) ? actid : scaleACTID;
+	hi = (actid + nBlocks < scaleACTID + desc->scaleBlocks) ? actid + nBlocks : scaleACTID + desc->scaleBlocks;
+	if(lo < hi)
+	{
+		if((lo - scaleACTID) * groupBlocks < *start)
+			*start = (lo - scaleACTID) * groupBlocks;
+		if((hi - scaleACTID) * groupBlocks > *end)
+			*end = (hi - scaleACTID) * groupBlocks;
+	}
+
+	if(*end > desc->regionBlocks)
+		*end = desc->regionBlocks;
+
+	return *start < *end;
+}
+
+static void dequantize_blocks(XFORM_DESC *desc, unsigned int start, unsigned int end)
+{
+	signed char *data;
+	float *scale, *region;
+	unsigned int elem, lastElem;
+
+	data = (signed char *)HOT_BLOCK_PTR(desc->windowACTID);
+	scale = (float *)HOT_BLOCK_PTR(desc->windowACTID + desc->dataBlocks);
+	region = (float *)HOT_BLOCK_PTR(desc->regionACTID);
+
+	prepare_hot_region_write(desc->regionACTID + start, end - start);
+
+	lastElem = end * XFORM_ELEMS_PER_BLOCK;
+	for(elem = start * XFORM_ELEMS_PER_BLOCK; elem < lastElem; elem++)
+		region[elem] = (float)data[elem] * scale[elem >> desc->groupShift];
+}
+
+//round half away from zero, the host reference rounds the same way
+static signed char quantize_value(float value, float inverse)
+{
+	float scaled;
+	int q;
+
+	scaled = value * inverse;
+	q = (int)(scaled + ((scaled < 0) ? -0.5f : 0.5f));
+	if(q > XFORM_INT8_MAX)
+		q = XFORM_INT8_MAX;
+	else if(q < -XFORM_INT8_MAX)
+		q = -XFORM_INT8_MAX;
+
+	return (signed char)q;
+}
+
+static void quantize_blocks(XFORM_DESC *desc, unsigned int start, unsigned int end)
+{
+	signed char *data;
+	float *scale, *region;
+	float maxAbs, magnitude, inverse;
+	unsigned int group, lastGroup, groupElems, elem, lastElem;
+
+	materialize_hot_region(desc->regionACTID + start, end - start);
+	materialize_hot_region(desc->windowACTID, desc->dataBlocks + desc->scaleBlocks);
+
+	data = (signed char *)HOT_BLOCK_PTR(desc->windowACTID);
+	scale = (float *)HOT_BLOCK_PTR(desc->windowACTID + desc->dataBlocks);
+	region = (float *)HOT_BLOCK_PTR(desc->regionACTID);
+	groupElems = 1 << desc->groupShift;
+
+	lastGroup = (end * XFORM_ELEMS_PER_BLOCK) >> desc->groupShift;
+	for(group = (start * XFORM_ELEMS_PER_BLOCK) >> desc->groupShift; group < lastGroup; group++)
+	{
+		elem = group * groupElems;
+		lastElem = elem + groupElems;
+
+		maxAbs = 0;
+		for(; elem < lastElem; elem++)
+		{
+			magnitude = (region[elem] < 0) ? -region[elem] : region[elem];
+			if(magnitude > maxAbs)
+				maxAbs = magnitude;
+		}
+
+		scale[group] = maxAbs / XFORM_INT8_MAX;
+		inverse = (maxAbs > 0) ? XFORM_INT8_MAX / maxAbs : 0;
+		for(elem = group * groupElems; elem < lastElem; elem++)
+			data[elem] = quantize_value(region[elem], inverse);
+	}
+}
+
+void init_transform()
+{
+	memset(xformDesc, 0, sizeof(xformDesc));
+}
+
+unsigned int set_transform_desc(unsigned int dword11, unsigned int dword12, unsigned int dword13, unsigned int dword14)
+{
+	XFORM_DESC desc;
+	unsigned int index;
+
+	index = dword11 & 0xFF;
+	if(index >= XFORM_MAX_DESC)
+		return 0;
+
+	memset(&desc, 0, sizeof(XFORM_DESC));
+	desc.format = (dword11 >> 8) & 0xFF;
+	if(desc.format == XFORM_FORMAT_NONE)
+	{
+		xformDesc[index] = desc;
+		return 1;
+	}
+
+	desc.flags = (dword11 >> 16) & 0xFF;
+	desc.groupShift = (dword11 >> 24) & 0xFF;
+	desc.regionACTID = dword12;
+	desc.regionBlocks = dword13;
+	desc.windowACTID = dword14;
+	desc.dataBlocks = desc.regionBlocks / XFORM_INT8_RATIO;
+	desc.scaleBlocks = (desc.regionBlocks + (1 << desc.groupShift) - 1) >> desc.groupShift;
+	desc.dirtyStart = desc.regionBlocks;
+	desc.dirtyEnd = 0;
+
+	if(desc.format != XFORM_FORMAT_INT8 || desc.groupShift < XFORM_MIN_GROUP_SHIFT || desc.groupShift > XFORM_MAX_GROUP_SHIFT)
+		return 0;
+	if(desc.regionBlocks == 0 || (desc.regionBlocks % XFORM_INT8_RATIO))
+		return 0;
+	if(desc.regionACTID >= HOT_REGION_PAGES || desc.regionBlocks > HOT_REGION_PAGES - desc.regionACTID)
+		return 0;
+	if(desc.windowACTID >= HOT_REGION_PAGES || desc.dataBlocks + desc.scaleBlocks > HOT_REGION_PAGES - desc.windowACTID)
+		return 0;
+	if(overlap(desc.regionACTID, desc.regionACTID + desc.regionBlocks, desc.windowACTID, desc.windowACTID + desc.dataBlocks + desc.scaleBlocks))
+		return 0;
+
+	xformDesc[index] = desc;
+	return 1;
+}
+
+unsigned int get_transform_desc(unsigned int dword11)
+{
+	XFORM_DESC *desc;
+	unsigned int index;
+
+	index = dword11 & 0xFF;
+	if(index >= XFORM_MAX_DESC)
+		return 0;
+
+	desc = &xformDesc[index];
+	if(desc->format == XFORM_FORMAT_NONE)
+		return index;
+
+	return index | (desc->format << 8) | (desc->flags << 16) | (desc->groupShift << 24);
+}
+
+void transform_note_write(unsigned int actid, unsigned int nBlocks)
+{
+	XFORM_DESC *desc;
+	unsigned int index, start, end;
+
+	for(index = 0; index < XFORM_MAX_DESC; index++)
+	{
+		desc = &xformDesc[index];
+		if(desc->format == XFORM_FORMAT_NONE || !window_to_region(desc, actid, nBlocks, &start, &end))
+			continue;
+
+		if(start < desc->dirtyStart)
+			desc->dirtyStart = start;
+		if(end > desc->dirtyEnd)
+			desc->dirtyEnd = end;
+	}
+}
+
+unsigned int transform_pending(unsigned int actid, unsigned int nBlocks)
+{
+	XFORM_DESC *desc;
+	unsigned int index;
+
+	for(index = 0; index < XFORM_MAX_DESC; index++)
+	{
+		desc = &xformDesc[index];
+		if(desc->format != XFORM_FORMAT_NONE && desc->dirtyStart < desc->dirtyEnd && touches_desc(desc, actid, nBlocks))
+			return 1;
+	}
+
+	return 0;
+}
+
+//the caller makes sure the window writes have landed in DDR4
+void transform_dequantize(unsigned int actid, unsigned int nBlocks)
+{
+	XFORM_DESC *desc;
+	unsigned int index;
+
+	for(index = 0; index < XFORM_MAX_DESC; index++)
+	{
+		desc = &xformDesc[index];
+		if(desc->format == XFORM_FORMAT_NONE || desc->dirtyStart >= desc->dirtyEnd || !touches_desc(desc, actid, nBlocks))
+			continue;
+
+		dequantize_blocks(desc, desc->dirtyStart, desc->dirtyEnd);
+		desc->dirtyStart = desc->regionBlocks;
+		desc->dirtyEnd = 0;
+	}
+}
+
+unsigned int transform_quantize_on_read(unsigned int actid, unsigned int nBlocks)
+{
+	XFORM_DESC *desc;
+	unsigned int index, start, end;
+
+	for(index = 0; index < XFORM_MAX_DESC; index++)
+	{
+		desc = &xformDesc[index];
+		if(desc->format != XFORM_FORMAT_NONE && (desc->flags & XFORM_FLAG_QUANTIZE_ON_READ)
+			&& window_to_region(desc, actid, nBlocks, &start, &end))
+			return 1;
+	}
+
+	return 0;
+}
+
+//the caller makes sure earlier reads of the window have left DDR4
+void transform_quantize(unsigned int actid, unsigned int nBlocks)
+{
+	XFORM_DESC *desc;
+	unsigned int index, start, end;
+
+	for(index = 0; index < XFORM_MAX_DESC; index++)
+	{
+		desc = &xformDesc[index];
+		if(desc->format == XFORM_FORMAT_NONE || !(desc->flags & XFORM_FLAG_QUANTIZE_ON_READ)
+			|| !window_to_region(desc, actid, nBlocks, &start, &end))
+			continue;
+
+		quantize_blocks(desc, start, end);
+	}
+}
@@ -0,0 +1,100 @@
+//////////////////////////////////////////////////////////////////////////////////
+// transform.h for Flagger-CSD
+//
+// This file is part of Cosmos+ OpenSSD.
+//
+// Cosmos+ OpenSSD is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 3, or (at your option)
+// any later version.
+//
+// Cosmos+ OpenSSD is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+// See the GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with Cosmos+ OpenSSD; see the file COPYING.
+// If not, see <http://www.gnu.org/licenses/>.
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Project Name: Flagger-CSD
+// Design Name: Flagger-CSD Firmware
+// Module Name: Transform Stage
+// File Name: transform.h
+//
+// Version: v1.0.0
+//
+// Description:
+//   - declares the quantize/dequantize descriptors of hot region ranges
+//////////////////////////////////////////////////////////////////////////////////
+
+//////////////////////////////////////////////////////////////////////////////////
+// Revision History:
+//
+// * v1.0.0
+//   - First draft
+//////////////////////////////////////////////////////////////////////////////////
+
+#ifndef TRANSFORM_H_
+#define TRANSFORM_H_
+
+#include "ftl_config.h"
+
+#define	XFORM_MAX_DESC					8
+
+#define	XFORM_FORMAT_NONE				0x0		//descriptor unused
+#define	XFORM_FORMAT_INT8				0x1		//symmetric INT8, one FP32 scale per group
+
+#define	XFORM_FLAG_QUANTIZE_ON_READ		0x1		//reads of the window return the region quantized
+
+#define	XFORM_ELEMS_PER_BLOCK			(BYTES_PER_NVME_BLOCK / sizeof(float))
+#define	XFORM_INT8_RATIO				(sizeof(float) / sizeof(signed char))
+#define	XFORM_MIN_GROUP_SHIFT			5		//32 elements
+#define	XFORM_MAX_GROUP_SHIFT			10		//one group per FP32 block
+#define	XFORM_INT8_MAX					127
+
+/*
+ * A descriptor pairs an FP32 region with a quantized window, both in the hot region.
+ * The window holds regionBlocks / 4 blocks of INT8 values followed by the FP32 scales,
+ * one per group of elements. Window writes are dequantized into the region lazily,
+ * before anything reads the region or the window.
+ * Set/Get Features XFORM_FEATURE_ID:
+ *   dword11     [7:0] descriptor, [15:8] format, [23:16] flags, [31:24] log2 of group elements
+ *   dword12     first block of the FP32 region
+ *   dword13     region blocks, a multiple of 4
+ *   dword14     first block of the window
+ * Reprogramming a descriptor drops window data that is not dequantized yet.
+ */
+typedef struct _XFORM_DESC
+{
+	unsigned int format;
+	unsigned int flags;
+	unsigned int groupShift;
+	unsigned int regionACTID;
+	unsigned int regionBlocks;
+	unsigned int windowACTID;
+	unsigned int dataBlocks;		//INT8 blocks at the head of the window
+	unsigned int scaleBlocks;		//scale blocks behind them
+	unsigned int dirtyStart;		//region blocks waiting for dequantization
+	unsigned int dirtyEnd;
+} XFORM_DESC;
+
+void init_transform();
+
+unsigned int set_transform_desc(unsigned int dword11, unsigned int dword12, unsigned int dword13, unsigned int dword14);
+
+unsigned int get_transform_desc(unsigned int dword11);
+
+void transform_note_write(unsigned int actid, unsigned int nBlocks);
+
+unsigned int transform_pending(unsigned int actid, unsigned int nBlocks);
+
+void transform_dequantize(unsigned int actid, unsigned int nBlocks);
+
+unsigned int transform_quantize_on_read(unsigned int actid, unsigned int nBlocks);
+
+void transform_quantize(unsigned int actid, unsigned int nBlocks);
+
+#endif /* TRANSFORM_H_ */
@@ -0,0 +1,162 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+
+// Chrome trace event format, for chrome://tracing and Perfetto
+static bool write_trace(const char* path, const std::vector<trace_span>& spans) {
+    FILE* f = fopen(path, "w");
+    if (!f)
+        return false;
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"setup\"}},\n");
+    fprintf(f, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":1,\"args\":{\"name\":\"rounds\"}}");
+    for (const trace_span& sp : spans)
+        fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"round\":%d}}",
+                sp.name, sp.tid ? "round" : "setup", sp.tid, sp.ts, sp.dur, sp.round);
+    fprintf(f, "\n]}\n");
+    return fclose(f) == 0;
+}
+
+// Run the round the command line describes the given number of times. The
+// output of every round is read back and verified against the device CRC
+// and the host reference model, each stage of a round
+// is timed and the stages are summarized as percentiles over the rounds.
+// Returns the rounds that failed.
+static int bench(stream_ctx& s, rx_backend& rx, uint32_t basePort, const round_desc& rd, int rounds,
+                 std::chrono::high_resolution_clock::time_point t0, std::vector<trace_span>& spans) {
+    const char* names[] = {"enqueue", "receive", "write", "aggregate", "read_back", "verify", "round"};
+    const int numStages = sizeof(names) / sizeof(names[0]);
+    std::vector<std::vector<double>> durs(numStages);
+    std::vector<char> out;
+    std::vector<size_t> at;
+    int failed = 0;
+
+    for (int i = 0; i < rounds; i++) {
+        round_report rep;
+        auto start = std::chrono::high_resolution_clock::now();
+        run_round(s, rx, basePort, rd, rep);
+        auto readStart = std::chrono::high_resolution_clock::now();
+        if (!stream_readback(s, out, at))
+            rep.failures++;
+        auto verifyStart = std::chrono::high_resolution_clock::now();
+        rep.failures += stream_verify(s, out, at);
+        rep.failures += stream_reference(s, out, at);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        // stages overlap within a round, each one spans from its first to
+        // its last activity
+        double base = since_us(t0, start);
+        double readUs = since_us(start, readStart);
+        double verifyUs = since_us(start, verifyStart);
+        double span[numStages][2] = {
+            {0, rep.enqueueUs},
+            {rep.enqueueUs, rep.rxUs},
+            {rep.firstRxUs, rep.writeUs},
+            {rep.aggStartUs, rep.roundUs},
+            {readUs, verifyUs},
+            {verifyUs, since_us(start, end)},
+            {0, since_us(start, end)},
+        };
+        for (int k = 0; k < numStages; k++) {
+            double dur = std::max(span[k][1] - span[k][0], 0.0);
+            durs[k].push_back(dur);
+            spans.push_back({names[k], 1, i, base + span[k][0], dur});
+        }
+
+        char report[512];
+        format_report(report, sizeof(report), i, rep);
+        printf("%s\n", report);
+        if (rep.failures)
+            failed++;
+    }
+
+    printf("%d round(s) of %u client(s) x %u bytes, chunks of %u bytes, %d failed\n",
+           rounds, rd.clients, rd.bytes, rd.chunkBytes, failed);
+    printf("%-10s %12s %12s %12s %12s\n", "stage", "p50_us", "p90_us", "p99_us", "max_us");
+    for (int k = 0; k < numStages; k++)
+        printf("%-10s %12.1f %12.1f %12.1f %12.1f\n", names[k], percentile(durs[k], 0.50),
+               percentile(durs[k], 0.90), percentile(durs[k], 0.99), percentile(durs[k], 1.0));
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    const char* prog = argv[0];
+    int benchRounds = 1;
+    const char* tracePath = NULL;
+    session_opts o;
+    session_defaults(o);
+    int opt;
+    while ((opt = getopt(argc, argv, "b:t:" SESSION_OPTS)) != -1) {
+        if (opt == 'b')
+            benchRounds = strtol(optarg, NULL, 10);
+        else if (opt == 't')
+            tracePath = optarg;
+        else if (!session_option(o, opt, optarg))
+            return EXIT_FAILURE;
+    }
+    // the positional arguments keep their indices
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    if (argc < 2 || benchRounds < 1) {
+        std::cout << "Usage: " << prog << " [-b <rounds>] [-t <trace.json>] " SESSION_USAGE << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (const char* bad = session_args(o, argc, argv)) {
+        std::cout << bad << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    session ss;
+    session_open(ss, o);
+
+    int status = EXIT_SUCCESS;
+    if (const char* bad = check_round(ss.s, *ss.rx, o.rd)) {
+        printf("%s\n", bad);
+        status = EXIT_FAILURE;
+    } else {
+        for (const trace_span& sp : ss.spans)
+            printf("setup %s_us=%.1f\n", sp.name, sp.dur);
+        if (bench(ss.s, *ss.rx, o.basePort, o.rd, benchRounds, ss.t0, ss.spans))
+            status = EXIT_FAILURE;
+        if (tracePath && !write_trace(tracePath, ss.spans)) {
+            std::cerr << "trace " << tracePath << ": " << strerror(errno) << std::endl;
+            status = EXIT_FAILURE;
+        }
+    }
+    session_close(ss);
+    return status;
+}
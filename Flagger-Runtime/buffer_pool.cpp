@@ -0,0 +1,102 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#include "buffer_pool.h"
+#include <stdio.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#define HP_MPOL_PREFERRED 1     // mbind mode, from numaif.h without libnuma
+
+int pci_numa_node(const char* bdf) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/bus/pci/devices/%s/numa_node", bdf);
+    FILE* f = fopen(path, "r");
+    int node = -1;
+    if (f) {
+        if (fscanf(f, "%d", &node) != 1)
+            node = -1;
+        fclose(f);
+    }
+    return node;
+}
+
+bool hp_alloc(hp_buf& hb, size_t bytes, int node) {
+    static const int shifts[] = { 30, 21 };
+    hb = hp_buf();
+    for (int shift : shifts) {
+        size_t page = (size_t)1 << shift;
+        // a 1 GiB page is not spent on a much smaller buffer
+        if (shift == 30 && bytes < page)
+            continue;
+        size_t len = (bytes + page - 1) & ~(page - 1);
+        void* p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+        if (p != MAP_FAILED) {
+            hb.buf = (char*)p;
+            hb.bytes = len;
+            hb.pageBytes = page;
+            break;
+        }
+    }
+    if (!hb.buf) {
+        size_t len = (bytes + (2 << 20) - 1) & ~(size_t)((2 << 20) - 1);
+        void* p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return false;
+        madvise(p, len, MADV_HUGEPAGE);
+        hb.buf = (char*)p;
+        hb.bytes = len;
+        hb.pageBytes = sysconf(_SC_PAGESIZE);
+    }
+
+    // placed before the first touch, which is what allocates the pages
+    // maxnode counts one past the last bit the kernel reads, a maxnode of
+    // 64 would drop node 63
+    unsigned long mask = 0;
+    if (node >= 0 && node < (int)(8 * sizeof(mask))) {
+        mask = 1ul << node;
+        if (syscall(SYS_mbind, hb.buf, hb.bytes, HP_MPOL_PREFERRED, &mask, 8 * sizeof(mask) + 1, 0))
+            std::cerr << "mbind to node " << node << ": " << strerror(errno) << std::endl;
+    }
+    for (size_t off = 0; off < hb.bytes; off += hb.pageBytes)
+        hb.buf[off] = 0;
+    if (mlock(hb.buf, hb.bytes))
+        std::cerr << "mlock of " << (hb.bytes >> 20) << " MiB: " << strerror(errno) << ", buffer may be paged" << std::endl;
+    return true;
+}
+
+void hp_free(hp_buf& hb) {
+    if (hb.buf)
+        munmap(hb.buf, hb.bytes);
+    hb = hp_buf();
+}
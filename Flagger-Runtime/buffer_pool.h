@@ -0,0 +1,52 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#ifndef _BUFFER_POOL_H
+#define _BUFFER_POOL_H
+
+#include <stddef.h>
+
+// A buffer kept for the whole run. It comes from 1 GiB or 2 MiB hugepages
+// when the system has them reserved, else from transparent hugepages, is
+// placed on a NUMA node, faulted in and locked before the first round, so
+// that no round pays for page faults and the XRT and unvme mappings of the
+// buffer need few IOTLB entries.
+struct hp_buf {
+    char* buf;
+    size_t bytes;               // mapped, a multiple of pageBytes
+    size_t pageBytes;           // page size backing the buffer
+};
+
+// NUMA node of a PCI device, -1 if not known
+int pci_numa_node(const char* bdf);
+
+bool hp_alloc(hp_buf& hb, size_t bytes, int node);
+
+void hp_free(hp_buf& hb);
+
+#endif // _BUFFER_POOL_H
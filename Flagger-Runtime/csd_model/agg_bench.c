@@ -0,0 +1,111 @@
+/**
+ * @file
+ * @brief Dense vs sparse aggregation benchmark on the host reference model.
+ *
+ * For each density the benchmark top-k encodes N client updates, reduces
+ * them both ways and reports the bytes a client would move to the CSD
+ * along with the reduction throughput of the model.
+ *
+ * Usage: agg_bench [elements] [clients]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "agg_model.h"
+
+
+/// densities swept by the benchmark
+static const double densities[] = { 0.001, 0.01, 0.05, 0.1, 0.25, 0.5 };
+
+/// current time in seconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], 0, 0) : 1 << 20;
+    int clients = argc > 2 ? atoi(argv[2]) : 8;
+    if (n == 0 || clients < 1) {
+        fprintf(stderr, "Usage: %s [elements] [clients]\n", argv[0]);
+        return 1;
+    }
+
+    float* update = malloc(n * sizeof(float));
+    float* masked = malloc(n * sizeof(float));
+    float* dense_acc = malloc(n * sizeof(float));
+    float* sparse_acc = malloc(n * sizeof(float));
+    void** seg = calloc(clients, sizeof(void*));
+    int c;
+    for (c = 0; c < clients; c++) seg[c] = malloc(agg_model_sparse_bytes(n));
+    float** dense = calloc(clients, sizeof(float*));
+    for (c = 0; c < clients; c++) dense[c] = malloc(n * sizeof(float));
+
+    printf("%zu elements, %d clients\n", n, clients);
+    printf("%8s %12s %12s %8s %12s %12s %8s\n", "density", "dense_B", "sparse_B",
+           "ratio", "dense_GB/s", "sparse_GB/s", "maxerr");
+
+    srand(1);
+    size_t d;
+    for (d = 0; d < sizeof(densities) / sizeof(densities[0]); d++) {
+        size_t k = (size_t)(densities[d] * n);
+        if (k == 0) k = 1;
+
+        // the dense path ships the sparsified update with its zeroes
+        for (c = 0; c < clients; c++) {
+            size_t i;
+            for (i = 0; i < n; i++) update[i] = (float)rand() / RAND_MAX - 0.5f;
+            agg_model_sparsify(seg[c], update, n, k);
+            memset(masked, 0, n * sizeof(float));
+            agg_model_sparse_sum(masked, n, seg[c], agg_model_sparse_bytes(k));
+            memcpy(dense[c], masked, n * sizeof(float));
+        }
+
+        memset(dense_acc, 0, n * sizeof(float));
+        double t = now();
+        for (c = 0; c < clients; c++) agg_model_dense_sum(dense_acc, dense[c], n);
+        double dense_sec = now() - t;
+
+        memset(sparse_acc, 0, n * sizeof(float));
+        t = now();
+        for (c = 0; c < clients; c++) {
+            if (agg_model_sparse_sum(sparse_acc, n, seg[c], agg_model_sparse_bytes(k))) {
+                fprintf(stderr, "bad sparse segment\n");
+                return 1;
+            }
+        }
+        double sparse_sec = now() - t;
+
+        float maxerr = 0;
+        size_t i;
+        for (i = 0; i < n; i++) {
+            float e = fabsf(dense_acc[i] - sparse_acc[i]);
+            if (e > maxerr) maxerr = e;
+        }
+
+        double dense_bytes = (double)n * sizeof(float) * clients;
+        double sparse_bytes = (double)agg_model_sparse_bytes(k) * clients;
+        printf("%8.3f %12.0f %12.0f %7.1fx %12.2f %12.2f %8.2g\n", densities[d],
+               dense_bytes, sparse_bytes, dense_bytes / sparse_bytes,
+               dense_bytes / dense_sec / 1e9, sparse_bytes / sparse_sec / 1e9, maxerr);
+    }
+
+    for (c = 0; c < clients; c++) {
+        free(seg[c]);
+        free(dense[c]);
+    }
+    free(seg);
+    free(dense);
+    free(update);
+    free(masked);
+    free(dense_acc);
+    free(sparse_acc);
+    return 0;
+}
@@ -0,0 +1,353 @@
+/**
+ * @file
+ * @brief Host reference model of the CSD aggregation operators.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#include "agg_model.h"
+
+/// scratch tile of the robust operators in floats (256KB, about L2 size)
+#define AGG_MODEL_TILE_ELEMS    65536
+
+/// columns up to this size are sorted in place, larger ones with qsort
+#define AGG_MODEL_INSERTION_MAX 32
+
+/// largest magnitude of a quantized value
+#define AGG_MODEL_INT8_MAX      127
+
+
+/**
+ * Add a dense update to the accumulator (UNVME_AGG_DENSE_SUM).
+ * @param   acc         accumulator
+ * @param   src         update
+ * @param   n           number of elements
+ */
+void agg_model_dense_sum(float* acc, const float* src, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) acc[i] += src[i];
+}
+
+/**
+ * Scatter-add a sparse segment into the accumulator (UNVME_AGG_SPARSE_SUM).
+ * The segment holds one or more lists back to back, as on the device.
+ * @param   acc         accumulator
+ * @param   acclen      accumulator length in elements
+ * @param   seg         segment
+ * @param   seglen      segment length in bytes
+ * @return  0 if ok else -1 (a bad list leaves the accumulator untouched).
+ */
+int agg_model_sparse_sum(float* acc, size_t acclen, const void* seg, size_t seglen)
+{
+    const u8* p = seg;
+
+    if (seglen % sizeof(unvme_agg_entry_t)) return -1;
+
+    while (seglen) {
+        const unvme_agg_sparse_t* hdr = (const unvme_agg_sparse_t*)p;
+        const unvme_agg_entry_t* ent = (const unvme_agg_entry_t*)(hdr + 1);
+        size_t len = agg_model_sparse_bytes(hdr->nnz);
+        if (seglen < sizeof(*hdr) || len > seglen || hdr->denselen > acclen) return -1;
+
+        u32 i;
+        for (i = 0; i < hdr->nnz; i++) {
+            if (ent[i].index >= hdr->denselen) return -1;
+        }
+        for (i = 0; i < hdr->nnz; i++) acc[ent[i].index] += ent[i].value;
+
+        p += len;
+        seglen -= len;
+    }
+    return 0;
+}
+
+/**
+ * Size of a sparse list.
+ * @param   nnz         number of entries
+ * @return  bytes of the header and the entries.
+ */
+size_t agg_model_sparse_bytes(size_t nnz)
+{
+    return sizeof(unvme_agg_sparse_t) + nnz * sizeof(unvme_agg_entry_t);
+}
+
+/// qsort comparator, descending
+static int agg_model_cmp_desc(const void* a, const void* b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x < y) - (x > y);
+}
+
+/**
+ * Encode the k largest magnitude elements of a dense update as a sparse list.
+ * Ties at the threshold are taken in index order until k entries are out.
+ * @param   seg         output, agg_model_sparse_bytes(k) bytes
+ * @param   dense       dense update
+ * @param   n           number of elements
+ * @param   k           entries to keep
+ * @return  number of entries written.
+ */
+size_t agg_model_sparsify(void* seg, const float* dense, size_t n, size_t k)
+{
+    unvme_agg_sparse_t* hdr = seg;
+    unvme_agg_entry_t* ent = (unvme_agg_entry_t*)(hdr + 1);
+    size_t i, nnz = 0;
+
+    if (k > n) k = n;
+    float thresh = 0.0f;
+    if (k && k < n) {
+        float* mag = malloc(n * sizeof(float));
+        for (i = 0; i < n; i++) mag[i] = fabsf(dense[i]);
+        qsort(mag, n, sizeof(float), agg_model_cmp_desc);
+        thresh = mag[k - 1];
+        free(mag);
+    }
+
+    // strictly above the threshold first so that ties cannot crowd them out
+    for (i = 0; i < n && nnz < k; i++) {
+        if (k == n || fabsf(dense[i]) > thresh) {
+            ent[nnz].index = i;
+            ent[nnz++].value = dense[i];
+        }
+    }
+    for (i = 0; i < n && nnz < k; i++) {
+        if (fabsf(dense[i]) == thresh) {
+            ent[nnz].index = i;
+            ent[nnz++].value = dense[i];
+        }
+    }
+
+    hdr->nnz = nnz;
+    hdr->denselen = n;
+    return nnz;
+}
+
+/// qsort comparator, ascending
+static int agg_model_cmp_asc(const void* a, const void* b)
+{
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Reduce one coordinate column the way the device does.
+ * @param   col         values of all slots, sorted in place
+ * @param   nslots      number of slots
+ * @param   op          UNVME_AGG_MEDIAN or UNVME_AGG_TRIMMED_MEAN
+ * @param   trim        values dropped per side
+ * @return  reduced value.
+ */
+static float agg_model_column(float* col, int nslots, int op, int trim)
+{
+    int i, j;
+
+    if (nslots > AGG_MODEL_INSERTION_MAX) {
+        qsort(col, nslots, sizeof(float), agg_model_cmp_asc);
+    } else {
+        for (i = 1; i < nslots; i++) {
+            float v = col[i];
+            for (j = i; j > 0 && col[j - 1] > v; j--) col[j] = col[j - 1];
+            col[j] = v;
+        }
+    }
+
+    if (op == UNVME_AGG_MEDIAN) {
+        if (nslots & 1) return col[nslots / 2];
+        return (col[nslots / 2 - 1] + col[nslots / 2]) * 0.5f;
+    }
+
+    // summed in sorted order so that the result matches the device bit for bit
+    float sum = 0;
+    for (i = trim; i < nslots - trim; i++) sum += col[i];
+    return sum / (float)(nslots - 2 * trim);
+}
+
+/**
+ * Coordinate-wise median or trimmed mean over client updates.
+ * Coordinates are processed in tiles: each slot is read sequentially
+ * into a transposed scratch tile so that every column is contiguous.
+ * @param   out         result, n elements
+ * @param   slots       client updates, n elements each
+ * @param   nslots      number of client updates
+ * @param   n           number of elements
+ * @param   op          UNVME_AGG_MEDIAN or UNVME_AGG_TRIMMED_MEAN
+ * @param   trim        values dropped per side (trimmed mean only)
+ * @return  0 if ok else -1.
+ */
+int agg_model_robust(float* out, const float* const* slots, int nslots,
+                     size_t n, int op, int trim)
+{
+    if (op == UNVME_AGG_MEDIAN) trim = 0;
+    else if (op != UNVME_AGG_TRIMMED_MEAN) return -1;
+    if (nslots < 1 || trim < 0 || 2 * trim >= nslots) return -1;
+
+    size_t tile = AGG_MODEL_TILE_ELEMS / nslots;
+    if (tile == 0) tile = 1;
+    float* scratch = malloc(tile * nslots * sizeof(float));
+    if (!scratch) return -1;
+
+    size_t base, i;
+    for (base = 0; base < n; base += tile) {
+        size_t count = n - base < tile ? n - base : tile;
+        int s;
+        for (s = 0; s < nslots; s++) {
+            const float* src = slots[s] + base;
+            for (i = 0; i < count; i++) scratch[i * nslots + s] = src[i];
+        }
+        for (i = 0; i < count; i++) {
+            out[base + i] = agg_model_column(scratch + i * nslots, nslots, op, trim);
+        }
+    }
+
+    free(scratch);
+    return 0;
+}
+
+/**
+ * Weighted mean over client slots (UNVME_AGG_WEIGHTED_MEAN), the FedAvg
+ * average with each client weighted by its sample count. Slots are added
+ * in order with the weight divided by the total, as the device does.
+ * @param   out         result, n elements
+ * @param   slots       nslots client updates of n elements
+ * @param   weights     nslots weights, not negative and not all 0
+ * @param   nslots      number of client updates
+ * @param   n           number of elements
+ * @return  0 if ok else -1.
+ */
+int agg_model_weighted_mean(float* out, const float* const* slots, const float* weights,
+                            int nslots, size_t n)
+{
+    float total = 0;
+    int s;
+    if (nslots < 1) return -1;
+    for (s = 0; s < nslots; s++) {
+        if (!(weights[s] >= 0)) return -1;
+        total += weights[s];
+    }
+    if (!(total > 0)) return -1;
+
+    float scale = 1.0f / total;
+    size_t i;
+    memset(out, 0, n * sizeof(float));
+    for (s = 0; s < nslots; s++) {
+        float w = weights[s] * scale;
+        if (w == 0) continue;
+        for (i = 0; i < n; i++) out[i] += w * slots[s][i];
+    }
+    return 0;
+}
+
+/**
+ * Window size of a UNVME_XFORM_INT8 transform descriptor.
+ * @param   nblocks     FP32 region blocks, a multiple of 4
+ * @param   groupshift  log2 of elements per scale
+ * @return  window blocks (INT8 blocks followed by the scale blocks).
+ */
+size_t agg_model_xform_blocks(size_t nblocks, int groupshift)
+{
+    size_t group = (size_t)1 << groupshift;
+    return nblocks / 4 + (nblocks + group - 1) / group;
+}
+
+/// round half away from zero and saturate, as the device does
+static s8 agg_model_quantize_value(float v, float inv)
+{
+    float t = v * inv;
+    int q = (int)(t + (t < 0 ? -0.5f : 0.5f));
+    if (q > AGG_MODEL_INT8_MAX) q = AGG_MODEL_INT8_MAX;
+    else if (q < -AGG_MODEL_INT8_MAX) q = -AGG_MODEL_INT8_MAX;
+    return (s8)q;
+}
+
+/**
+ * Quantize FP32 values to symmetric INT8 (UNVME_XFORM_INT8).
+ * Every group of 2^groupshift elements gets the scale max|x| / 127.
+ * The result is bit identical to what the device writes to a window.
+ * @param   q           quantized values, n bytes
+ * @param   scale       scales, n >> groupshift elements
+ * @param   x           values, n a multiple of the group size
+ * @param   n           number of elements
+ * @param   groupshift  log2 of elements per scale (at least 3)
+ */
+void agg_model_quantize(s8* q, float* scale, const float* x, size_t n, int groupshift)
+{
+    size_t group = (size_t)1 << groupshift;
+    size_t g, i;
+
+    for (g = 0; g < n >> groupshift; g++) {
+        const float* xg = x + g * group;
+        s8* qg = q + g * group;
+        float maxabs = 0;
+        i = 0;
+#ifdef __AVX2__
+        const __m256 absmask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+        __m256 vmax = _mm256_setzero_ps();
+        for (; i + 8 <= group; i += 8) {
+            vmax = _mm256_max_ps(vmax, _mm256_and_ps(_mm256_loadu_ps(xg + i), absmask));
+        }
+        float lanes[8];
+        _mm256_storeu_ps(lanes, vmax);
+        int l;
+        for (l = 0; l < 8; l++) if (lanes[l] > maxabs) maxabs = lanes[l];
+#endif
+        for (; i < group; i++) {
+            float a = fabsf(xg[i]);
+            if (a > maxabs) maxabs = a;
+        }
+
+        scale[g] = maxabs / AGG_MODEL_INT8_MAX;
+        float inv = maxabs > 0 ? AGG_MODEL_INT8_MAX / maxabs : 0;
+        i = 0;
+#ifdef __AVX2__
+        const __m256 vinv = _mm256_set1_ps(inv);
+        const __m256 half = _mm256_set1_ps(0.5f);
+        const __m256 sign = _mm256_set1_ps(-0.0f);
+        const __m256 vlim = _mm256_set1_ps(AGG_MODEL_INT8_MAX);
+        for (; i + 8 <= group; i += 8) {
+            __m256 t = _mm256_mul_ps(_mm256_loadu_ps(xg + i), vinv);
+            // -0.5 only below zero, like the scalar t < 0 test
+            __m256 neg = _mm256_cmp_ps(t, _mm256_setzero_ps(), _CMP_LT_OQ);
+            __m256 h = _mm256_or_ps(half, _mm256_and_ps(neg, sign));
+            __m256 r = _mm256_round_ps(_mm256_add_ps(t, h), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+            r = _mm256_min_ps(_mm256_max_ps(r, _mm256_sub_ps(_mm256_setzero_ps(), vlim)), vlim);
+            __m256i v32 = _mm256_cvttps_epi32(r);
+            __m128i v16 = _mm_packs_epi32(_mm256_castsi256_si128(v32), _mm256_extracti128_si256(v32, 1));
+            _mm_storel_epi64((__m128i*)(qg + i), _mm_packs_epi16(v16, v16));
+        }
+#endif
+        for (; i < group; i++) qg[i] = agg_model_quantize_value(xg[i], inv);
+    }
+}
+
+/**
+ * Dequantize symmetric INT8 values to FP32 (UNVME_XFORM_INT8).
+ * The result is bit identical to what the device writes to a region.
+ * @param   x           values, n elements
+ * @param   q           quantized values
+ * @param   scale       scales, n >> groupshift elements
+ * @param   n           number of elements
+ * @param   groupshift  log2 of elements per scale
+ */
+void agg_model_dequantize(float* x, const s8* q, const float* scale, size_t n, int groupshift)
+{
+    size_t i = 0;
+#ifdef __AVX2__
+    // groups are at least 8 elements, a vector never spans two scales
+    if (groupshift >= 3) {
+        for (; i + 8 <= n; i += 8) {
+            __m256i v32 = _mm256_cvtepi8_epi32(_mm_loadl_epi64((const __m128i*)(q + i)));
+            __m256 v = _mm256_mul_ps(_mm256_cvtepi32_ps(v32), _mm256_set1_ps(scale[i >> groupshift]));
+            _mm256_storeu_ps(x + i, v);
+        }
+    }
+#endif
+    for (; i < n; i++) x[i] = (float)q[i] * scale[i >> groupshift];
+}
@@ -0,0 +1,44 @@
+/**
+ * @file
+ * @brief Host reference model of the CSD aggregation operators.
+ *
+ * The model follows the segment layouts the firmware consumes so that
+ * device results can be verified and jobs can fall back to the host.
+ */
+
+#ifndef _AGG_MODEL_H
+#define _AGG_MODEL_H
+
+#include <stddef.h>
+
+#include "libunvme.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void agg_model_dense_sum(float* acc, const float* src, size_t n);
+
+int agg_model_sparse_sum(float* acc, size_t acclen, const void* seg, size_t seglen);
+
+size_t agg_model_sparse_bytes(size_t nnz);
+
+size_t agg_model_sparsify(void* seg, const float* dense, size_t n, size_t k);
+
+int agg_model_robust(float* out, const float* const* slots, int nslots,
+                     size_t n, int op, int trim);
+
+int agg_model_weighted_mean(float* out, const float* const* slots, const float* weights,
+                            int nslots, size_t n);
+
+size_t agg_model_xform_blocks(size_t nblocks, int groupshift);
+
+void agg_model_quantize(s8* q, float* scale, const float* x, size_t n, int groupshift);
+
+void agg_model_dequantize(float* x, const s8* q, const float* scale, size_t n, int groupshift);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _AGG_MODEL_H
@@ -0,0 +1,123 @@
+/**
+ * @file
+ * @brief Quantized upload benchmark on the host reference model.
+ *
+ * Quantizes client updates the way they are uploaded to a transform
+ * window, checks the vector code against a scalar loop and reports the
+ * bytes saved and the error of the aggregate after dequantization.
+ *
+ * Usage: agg_quant_bench [elements] [clients] [groupshift]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "agg_model.h"
+
+
+/// current time in seconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// scalar quantizer, the specification the vector code must match
+static void scalar_quantize(s8* q, float* scale, const float* x, size_t n, int groupshift)
+{
+    size_t group = (size_t)1 << groupshift;
+    size_t g, i;
+    for (g = 0; g < n >> groupshift; g++) {
+        float maxabs = 0;
+        for (i = g * group; i < (g + 1) * group; i++) {
+            if (fabsf(x[i]) > maxabs) maxabs = fabsf(x[i]);
+        }
+        scale[g] = maxabs / 127;
+        float inv = maxabs > 0 ? 127 / maxabs : 0;
+        for (i = g * group; i < (g + 1) * group; i++) {
+            float t = x[i] * inv;
+            int v = (int)(t + (t < 0 ? -0.5f : 0.5f));
+            q[i] = v > 127 ? 127 : v < -127 ? -127 : v;
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], 0, 0) : 1 << 22;
+    int nclients = argc > 2 ? atoi(argv[2]) : 8;
+    int groupshift = argc > 3 ? atoi(argv[3]) : 7;
+    size_t group = (size_t)1 << groupshift;
+    if (groupshift < 5 || groupshift > 10 || n % 4096 || nclients < 1) {
+        fprintf(stderr, "Usage: %s [elements, multiple of 4096] [clients] [groupshift 5-10]\n", argv[0]);
+        return 1;
+    }
+
+    float* x = malloc(n * sizeof(float));
+    float* y = malloc(n * sizeof(float));
+    float* exact = calloc(n, sizeof(float));
+    float* approx = calloc(n, sizeof(float));
+    s8* q = malloc(n);
+    s8* qref = malloc(n);
+    float* scale = malloc((n / group) * sizeof(float));
+    float* sref = malloc((n / group) * sizeof(float));
+
+    double qsec = 0, rsec = 0, dsec = 0;
+    int match = 1;
+    int c;
+    size_t i;
+    srand(1);
+    for (c = 0; c < nclients; c++) {
+        // gradients: mostly small values with a few large ones
+        for (i = 0; i < n; i++) {
+            float u = (float)rand() / RAND_MAX - 0.5f;
+            x[i] = (rand() % 64) ? u * 0.01f : u;
+        }
+
+        double t = now();
+        agg_model_quantize(q, scale, x, n, groupshift);
+        qsec += now() - t;
+
+        t = now();
+        scalar_quantize(qref, sref, x, n, groupshift);
+        rsec += now() - t;
+        if (memcmp(q, qref, n) || memcmp(scale, sref, (n / group) * sizeof(float))) match = 0;
+
+        t = now();
+        agg_model_dequantize(y, q, scale, n, groupshift);
+        dsec += now() - t;
+
+        agg_model_dense_sum(exact, x, n);
+        agg_model_dense_sum(approx, y, n);
+    }
+
+    double maxerr = 0, maxval = 0;
+    for (i = 0; i < n; i++) {
+        if (fabs(approx[i] - exact[i]) > maxerr) maxerr = fabs(approx[i] - exact[i]);
+        if (fabs(exact[i]) > maxval) maxval = fabs(exact[i]);
+    }
+
+    size_t fp32 = n * sizeof(float);
+    size_t window = agg_model_xform_blocks(n / 1024, groupshift) * 4096;
+    double gb = (double)fp32 * nclients / 1e9;
+    printf("%zu elements, %d clients, %zu elements per scale\n", n, nclients, group);
+    printf("upload bytes    fp32 %zu  int8 %zu  (%.2fx less)\n", fp32, window, (double)fp32 / window);
+    printf("quantize        %.2f GB/s (scalar %.2f GB/s)  match %s\n",
+           gb / qsec, gb / rsec, match ? "yes" : "no");
+    printf("dequantize      %.2f GB/s\n", gb / dsec);
+    printf("aggregate error max %.3g, relative to max %.3g\n", maxerr, maxerr / maxval);
+
+    free(x);
+    free(y);
+    free(exact);
+    free(approx);
+    free(q);
+    free(qref);
+    free(scale);
+    free(sref);
+    return match ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+/**
+ * @file
+ * @brief Weighted mean (FedAvg) benchmark on the host reference model.
+ *
+ * Compares the fused weighted mean, which applies each client's weight
+ * while summing, against scaling every update on the host first and then
+ * summing, which costs an extra read and write of every update. Both
+ * must agree up to rounding, the fused pass may contract to FMA.
+ * A round whose weights are all 0, or that has a negative weight, has no
+ * mean and must be rejected, as the device fails such a job.
+ *
+ * Usage: agg_weighted_bench [elements] [clients]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "agg_model.h"
+
+
+/// current time in seconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// host pre-scaling, every update is scaled in place before the plain sum
+static void prescaled_mean(float* out, float** slots, const float* weights, int nslots, size_t n)
+{
+    float total = 0;
+    size_t i;
+    int s;
+    for (s = 0; s < nslots; s++) total += weights[s];
+    float scale = 1.0f / total;
+
+    memset(out, 0, n * sizeof(float));
+    for (s = 0; s < nslots; s++) {
+        float w = weights[s] * scale;
+        if (w == 0) continue;
+        for (i = 0; i < n; i++) slots[s][i] *= w;
+        agg_model_dense_sum(out, slots[s], n);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t n = argc > 1 ? strtoul(argv[1], 0, 0) : 1 << 22;
+    int nslots = argc > 2 ? atoi(argv[2]) : 16;
+    if (n == 0 || nslots < 1 || nslots > 256) {
+        fprintf(stderr, "Usage: %s [elements] [clients 1-256]\n", argv[0]);
+        return 1;
+    }
+
+    float** slots = calloc(nslots, sizeof(float*));
+    float* weights = malloc(nslots * sizeof(float));
+    int s;
+    srand(1);
+    for (s = 0; s < nslots; s++) {
+        slots[s] = malloc(n * sizeof(float));
+        size_t i;
+        for (i = 0; i < n; i++) slots[s][i] = (float)rand() / RAND_MAX - 0.5f;
+        // sample counts of the clients, skewed as in non-IID rounds
+        weights[s] = (float)(100 + rand() % 5000);
+    }
+    float* fused = malloc(n * sizeof(float));
+    float* host = malloc(n * sizeof(float));
+
+    double t = now();
+    if (agg_model_weighted_mean(fused, (const float* const*)slots, weights, nslots, n)) {
+        fprintf(stderr, "invalid weighted job\n");
+        return 1;
+    }
+    double fused_sec = now() - t;
+
+    t = now();
+    prescaled_mean(host, slots, weights, nslots, n);
+    double host_sec = now() - t;
+
+    // the fused pass reads each update once, pre-scaling reads it twice
+    // and writes it once more
+    double bytes = (double)n * sizeof(float) * nslots;
+    printf("%zu elements, %d clients\n", n, nslots);
+    printf("%12s %10s %10s\n", "variant", "ms", "GB/s");
+    printf("%12s %10.1f %10.2f\n", "fused", fused_sec * 1e3, bytes / fused_sec / 1e9);
+    printf("%12s %10.1f %10.2f\n", "prescaled", host_sec * 1e3, bytes / host_sec / 1e9);
+    int match = 1;
+    size_t i;
+    for (i = 0; i < n; i++) {
+        if (fabsf(fused[i] - host[i]) > 1e-6f) match = 0;
+    }
+    printf("match %s\n", match ? "yes" : "no");
+
+    // the zero-weight round leaves host untouched, it must not be taken as a result
+    memcpy(fused, host, n * sizeof(float));
+    for (s = 0; s < nslots; s++) weights[s] = 0;
+    int rejected = agg_model_weighted_mean(fused, (const float* const*)slots, weights, nslots, n) != 0;
+    weights[nslots - 1] = 2;
+    weights[0] = -1;
+    rejected &= agg_model_weighted_mean(fused, (const float* const*)slots, weights, nslots, n) != 0;
+    rejected &= memcmp(fused, host, n * sizeof(float)) == 0;
+    printf("invalid weights rejected %s\n", rejected ? "yes" : "no");
+
+    for (s = 0; s < nslots; s++) free(slots[s]);
+    free(slots);
+    free(weights);
+    free(fused);
+    free(host);
+    return match && rejected ? 0 : 1;
+}
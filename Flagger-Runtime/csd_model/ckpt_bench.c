@@ -0,0 +1,130 @@
+/**
+ * @file
+ * @brief Checkpoint compression benchmark on the host reference model.
+ *
+ * Stores synthetic FP32 checkpoint shards the way the compressed store
+ * does, with and without byte plane shuffling, verifies the round trip
+ * and reports the compression ratio, the codec throughput and the
+ * checkpoints a pool holds compared to an uncompressed range.
+ *
+ * Usage: ckpt_bench [MB per shard] [pool GB]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "ckpt_model.h"
+
+
+/// current time in seconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// standard normal sample
+static float normal(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+/// fill a shard, returns its name
+static const char* fill(float* x, size_t n, int kind)
+{
+    size_t i;
+    switch (kind) {
+    case 0:
+        // weights trained in FP32
+        for (i = 0; i < n; i++) x[i] = normal() * 0.02f;
+        return "fp32 weights";
+    case 1:
+        // weights kept in BF16 and saved as FP32, low mantissa is zero
+        for (i = 0; i < n; i++) {
+            float v = normal() * 0.02f;
+            u32 b;
+            memcpy(&b, &v, 4);
+            b &= 0xFFFF0000;
+            memcpy(&x[i], &b, 4);
+        }
+        return "bf16 in fp32";
+    case 2:
+        // optimizer state of parameters mostly untouched (embeddings)
+        for (i = 0; i < n; i++) x[i] = (rand() % 10) ? 0 : normal() * 1e-3f;
+        return "sparse state";
+    default:
+        // quantization-aware weights on 256 levels
+        for (i = 0; i < n; i++) x[i] = roundf(normal() * 16) / 512;
+        return "8-bit levels";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    size_t mb = argc > 1 ? strtoul(argv[1], 0, 0) : 64;
+    double poolgb = argc > 2 ? atof(argv[2]) : 8;
+    if (mb == 0 || poolgb <= 0) {
+        fprintf(stderr, "Usage: %s [MB per shard] [pool GB]\n", argv[0]);
+        return 1;
+    }
+
+    size_t bytes = mb << 20;
+    size_t nblocks = bytes / CKPT_MODEL_BLOCK;
+    float* x = malloc(bytes);
+    u8* stored = malloc(bytes);
+    size_t* len = malloc(nblocks * sizeof(size_t));
+    u8 block[CKPT_MODEL_BLOCK];
+    int ok = 1;
+    int kind, shuffle;
+    size_t b;
+
+    printf("%zu MB per shard, %.1f GB pool, %d-byte sectors\n", mb, poolgb, CKPT_MODEL_SECTOR);
+    printf("%-14s %-8s %7s %7s %10s %10s %9s\n",
+           "shard", "shuffle", "ratio", "raw", "comp GB/s", "dec GB/s", "capacity");
+    srand(1);
+    for (kind = 0; kind < 4; kind++) {
+        const char* name = fill(x, bytes / sizeof(float), kind);
+        for (shuffle = 0; shuffle < 2; shuffle++) {
+            u32 flags = UNVME_CSTORE_ENABLE | (shuffle ? UNVME_CSTORE_SHUFFLE4 : 0);
+            size_t sectors = 0, raw = 0;
+
+            double t = now();
+            for (b = 0; b < nblocks; b++) {
+                len[b] = ckpt_model_store_block(stored + b * CKPT_MODEL_BLOCK,
+                                                (u8*)x + b * CKPT_MODEL_BLOCK, flags);
+            }
+            double csec = now() - t;
+
+            t = now();
+            for (b = 0; b < nblocks; b++) {
+                if (ckpt_model_load_block(block, stored + b * CKPT_MODEL_BLOCK, len[b], flags) ||
+                    memcmp(block, (u8*)x + b * CKPT_MODEL_BLOCK, CKPT_MODEL_BLOCK)) ok = 0;
+            }
+            double dsec = now() - t;
+
+            for (b = 0; b < nblocks; b++) {
+                sectors += ckpt_model_sectors(len[b]);
+                if (len[b] == CKPT_MODEL_BLOCK) raw++;
+            }
+
+            // heap space is handed out in sectors, the ratio includes the rounding
+            double ratio = (double)bytes / (sectors * CKPT_MODEL_SECTOR);
+            printf("%-14s %-8s %6.2fx %6.1f%% %10.2f %10.2f %8.1fx\n",
+                   name, shuffle ? "yes" : "no", ratio, 100.0 * raw / nblocks,
+                   bytes / csec / 1e9, bytes / dsec / 1e9,
+                   floor(poolgb * (1 << 30) * ratio / bytes) / floor(poolgb * (1 << 30) / bytes));
+        }
+    }
+    printf("round trip %s\n", ok ? "ok" : "FAILED");
+
+    free(x);
+    free(stored);
+    free(len);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,248 @@
+/**
+ * @file
+ * @brief Host reference model of the CSD compressed store.
+ */
+
+#include <string.h>
+
+#include "ckpt_model.h"
+
+#define LZ4_MIN_MATCH           4       ///< shortest match
+#define LZ4_LAST_LITERALS       5       ///< a block ends with this many literals
+#define LZ4_MF_LIMIT            12      ///< last match starts this far from the end
+#define LZ4_HASH_LOG            12      ///< log2 of hash table entries
+#define LZ4_MAX_OFFSET          65535   ///< farthest match
+
+
+/// load 4 bytes little endian
+static u32 ckpt_model_read32(const u8* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((u32)p[3] << 24);
+}
+
+/// hash of a 4-byte sequence
+static u32 ckpt_model_hash(u32 v)
+{
+    return (v * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+/// append an LZ4 length continuation
+static size_t ckpt_model_put_length(u8* dst, size_t pos, size_t len)
+{
+    for (; len >= 255; len -= 255) dst[pos++] = 255;
+    dst[pos++] = len;
+    return pos;
+}
+
+/**
+ * Compress to the LZ4 block format, with the match finder of the firmware.
+ * Inputs are limited to 64KB, the reach of the 16-bit hash entries.
+ * @param   dst         output
+ * @param   cap         output capacity
+ * @param   src         input
+ * @param   len         input length (up to 64KB)
+ * @return  compressed length or 0 if it does not fit.
+ */
+size_t ckpt_model_lz4_compress(void* dst, size_t cap, const void* src, size_t len)
+{
+    const u8* in = src;
+    u8* out = dst;
+    u16 table[1 << LZ4_HASH_LOG];
+    size_t ip = 0, anchor = 0, op = 0, lit, mlen;
+
+    if (len > 65536) return 0;
+    memset(table, 0, sizeof(table));
+
+    while (len > LZ4_MF_LIMIT && ip + LZ4_MF_LIMIT <= len) {
+        u32 h = ckpt_model_hash(ckpt_model_read32(in + ip));
+        size_t ref = table[h];
+        table[h] = ip;
+        if (ref >= ip || ip - ref > LZ4_MAX_OFFSET ||
+            ckpt_model_read32(in + ref) != ckpt_model_read32(in + ip)) {
+            ip++;
+            continue;
+        }
+
+        mlen = LZ4_MIN_MATCH;
+        while (ip + mlen < len - LZ4_LAST_LITERALS && in[ref + mlen] == in[ip + mlen]) mlen++;
+
+        lit = ip - anchor;
+        if (op + 1 + lit / 255 + 1 + lit + 2 + (mlen - LZ4_MIN_MATCH) / 255 + 1 > cap) return 0;
+        out[op++] = ((lit >= 15 ? 15 : lit) << 4) |
+                    (mlen - LZ4_MIN_MATCH >= 15 ? 15 : mlen - LZ4_MIN_MATCH);
+        if (lit >= 15) op = ckpt_model_put_length(out, op, lit - 15);
+        memcpy(out + op, in + anchor, lit);
+        op += lit;
+        out[op++] = (ip - ref) & 0xFF;
+        out[op++] = (ip - ref) >> 8;
+        if (mlen - LZ4_MIN_MATCH >= 15) op = ckpt_model_put_length(out, op, mlen - LZ4_MIN_MATCH - 15);
+
+        ip += mlen;
+        anchor = ip;
+        if (ip + LZ4_MF_LIMIT <= len) table[ckpt_model_hash(ckpt_model_read32(in + ip - 2))] = ip - 2;
+    }
+
+    lit = len - anchor;
+    if (op + 1 + lit / 255 + 1 + lit > cap) return 0;
+    out[op++] = (lit >= 15 ? 15 : lit) << 4;
+    if (lit >= 15) op = ckpt_model_put_length(out, op, lit - 15);
+    memcpy(out + op, in + anchor, lit);
+    return op + lit;
+}
+
+/**
+ * Decompress an LZ4 block. Malformed input is rejected, never overruns.
+ * @param   dst         output
+ * @param   cap         output capacity
+ * @param   src         compressed block
+ * @param   len         compressed length
+ * @return  decompressed length or -1 if the block is malformed.
+ */
+long ckpt_model_lz4_decompress(void* dst, size_t cap, const void* src, size_t len)
+{
+    const u8* in = src;
+    u8* out = dst;
+    size_t ip = 0, op = 0, n, off;
+    u8 token, extra;
+
+    while (ip < len) {
+        token = in[ip++];
+        n = token >> 4;
+        if (n == 15) {
+            do {
+                if (ip >= len) return -1;
+                extra = in[ip++];
+                n += extra;
+            } while (extra == 255);
+        }
+        if (n > len - ip || n > cap - op) return -1;
+        memcpy(out + op, in + ip, n);
+        ip += n;
+        op += n;
+
+        // the last sequence has no match
+        if (ip == len) break;
+
+        if (len - ip < 2) return -1;
+        off = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        if (off == 0 || off > op) return -1;
+
+        n = (token & 0xF) + LZ4_MIN_MATCH;
+        if ((token & 0xF) == 15) {
+            do {
+                if (ip >= len) return -1;
+                extra = in[ip++];
+                n += extra;
+            } while (extra == 255);
+        }
+        if (n > cap - op) return -1;
+
+        // overlapping matches repeat a pattern, copy forward
+        if (off >= n) {
+            memcpy(out + op, out + op - off, n);
+            op += n;
+        } else {
+            for (; n; n--, op++) out[op] = out[op - off];
+        }
+    }
+    return op;
+}
+
+/**
+ * Split 4-byte elements into byte planes (CSTORE_FLAG_SHUFFLE4).
+ * @param   dst         byte planes
+ * @param   src         elements
+ * @param   len         bytes, a multiple of 4
+ */
+void ckpt_model_shuffle4(void* dst, const void* src, size_t len)
+{
+    const u8* in = src;
+    u8* out = dst;
+    size_t n = len / 4, i;
+    for (i = 0; i < n; i++) {
+        out[i] = in[4 * i];
+        out[n + i] = in[4 * i + 1];
+        out[2 * n + i] = in[4 * i + 2];
+        out[3 * n + i] = in[4 * i + 3];
+    }
+}
+
+/**
+ * Join byte planes back into 4-byte elements.
+ * @param   dst         elements
+ * @param   src         byte planes
+ * @param   len         bytes, a multiple of 4
+ */
+void ckpt_model_unshuffle4(void* dst, const void* src, size_t len)
+{
+    const u8* in = src;
+    u8* out = dst;
+    size_t n = len / 4, i;
+    for (i = 0; i < n; i++) {
+        out[4 * i] = in[i];
+        out[4 * i + 1] = in[n + i];
+        out[4 * i + 2] = in[2 * n + i];
+        out[4 * i + 3] = in[3 * n + i];
+    }
+}
+
+/**
+ * Convert a block the way the device stores it. Blocks that do not
+ * save at least one sector are kept raw.
+ * @param   dst         stored form (CKPT_MODEL_BLOCK bytes)
+ * @param   src         logical block
+ * @param   flags       UNVME_CSTORE_* flags of the store
+ * @return  stored length, CKPT_MODEL_BLOCK if the block is raw.
+ */
+size_t ckpt_model_store_block(void* dst, const void* src, u32 flags)
+{
+    u8 planes[CKPT_MODEL_BLOCK];
+    const void* in = src;
+
+    if (flags & UNVME_CSTORE_SHUFFLE4) {
+        ckpt_model_shuffle4(planes, src, CKPT_MODEL_BLOCK);
+        in = planes;
+    }
+
+    size_t len = ckpt_model_lz4_compress(dst, CKPT_MODEL_BLOCK - CKPT_MODEL_SECTOR, in, CKPT_MODEL_BLOCK);
+    if (len) return len;
+
+    memcpy(dst, src, CKPT_MODEL_BLOCK);
+    return CKPT_MODEL_BLOCK;
+}
+
+/**
+ * Restore a logical block from its stored form.
+ * @param   dst         logical block
+ * @param   src         stored form
+ * @param   len         stored length
+ * @param   flags       UNVME_CSTORE_* flags of the store
+ * @return  0 if ok else -1.
+ */
+int ckpt_model_load_block(void* dst, const void* src, size_t len, u32 flags)
+{
+    u8 planes[CKPT_MODEL_BLOCK];
+
+    if (len == CKPT_MODEL_BLOCK) {
+        memcpy(dst, src, CKPT_MODEL_BLOCK);
+        return 0;
+    }
+
+    if (!(flags & UNVME_CSTORE_SHUFFLE4))
+        return ckpt_model_lz4_decompress(dst, CKPT_MODEL_BLOCK, src, len) == CKPT_MODEL_BLOCK ? 0 : -1;
+
+    if (ckpt_model_lz4_decompress(planes, CKPT_MODEL_BLOCK, src, len) != CKPT_MODEL_BLOCK) return -1;
+    ckpt_model_unshuffle4(dst, planes, CKPT_MODEL_BLOCK);
+    return 0;
+}
+
+/**
+ * Heap sectors taken by a stored block.
+ * @param   len         stored length
+ * @return  number of sectors.
+ */
+size_t ckpt_model_sectors(size_t len)
+{
+    return (len + CKPT_MODEL_SECTOR - 1) / CKPT_MODEL_SECTOR;
+}
@@ -0,0 +1,36 @@
+/**
+ * @file
+ * @brief Host reference model of the CSD compressed store.
+ *
+ * Blocks are converted exactly as the firmware stores them, so that
+ * the space a checkpoint takes on the device can be estimated on the
+ * host and device blocks can be checked.
+ */
+
+#ifndef _CKPT_MODEL_H
+#define _CKPT_MODEL_H
+
+#include <stddef.h>
+
+#include "libunvme.h"
+
+#define CKPT_MODEL_BLOCK        4096    ///< bytes of a logical block
+#define CKPT_MODEL_SECTOR       512     ///< allocation unit of the pool heap
+
+
+size_t ckpt_model_lz4_compress(void* dst, size_t cap, const void* src, size_t len);
+
+long ckpt_model_lz4_decompress(void* dst, size_t cap, const void* src, size_t len);
+
+void ckpt_model_shuffle4(void* dst, const void* src, size_t len);
+
+void ckpt_model_unshuffle4(void* dst, const void* src, size_t len);
+
+size_t ckpt_model_store_block(void* dst, const void* src, u32 flags);
+
+int ckpt_model_load_block(void* dst, const void* src, size_t len, u32 flags);
+
+size_t ckpt_model_sectors(size_t len);
+
+
+#endif // _CKPT_MODEL_H
@@ -0,0 +1,141 @@
+/**
+ * @file
+ * @brief Multi-node reduction benchmark over the loopback transport.
+ *
+ * Forks one process per node. Every node sums the updates of its local
+ * clients, standing in for its CSD, then the partial sums are reduced
+ * across the nodes along a tree and a ring, with and without chunk
+ * pipelining. Update values are small integers, so every node must end
+ * up with exactly the same sum.
+ *
+ * Usage: tree_bench [nodes] [elements] [chunk] [fanout] [clients] [port]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "agg_model.h"
+#include "tree_reduce.h"
+
+
+/// current time in seconds
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/// element i of the update of a client of a node
+static float update(int node, int client, size_t i)
+{
+    return (float)((int)((node * 131 + client * 7 + i) % 17) - 8);
+}
+
+/// partial sum of the local clients of a node
+static void local_sum(float* buf, int node, int clients, size_t n)
+{
+    float* up = malloc(n * sizeof(float));
+    size_t i;
+    int c;
+    memset(buf, 0, n * sizeof(float));
+    for (c = 0; c < clients; c++) {
+        for (i = 0; i < n; i++) up[i] = update(node, c, i);
+        agg_model_dense_sum(buf, up, n);
+    }
+    free(up);
+}
+
+/// one node of the benchmark, returns the number of failed jobs
+static int run_node(int rank, int nranks, size_t n, size_t chunk, int fanout,
+                    int clients, int port)
+{
+    tree_transport_t tp;
+    if (tree_loopback_open(&tp, rank, nranks, port)) {
+        fprintf(stderr, "node %d: loopback transport failed\n", rank);
+        return 1;
+    }
+
+    float* buf = malloc(n * sizeof(float));
+    float* want = calloc(n, sizeof(float));
+    float* part = malloc(n * sizeof(float));
+    float one = 1;
+    int node, failed = 0;
+    for (node = 0; node < nranks; node++) {
+        local_sum(part, node, clients, n);
+        agg_model_dense_sum(want, part, n);
+    }
+    local_sum(part, rank, clients, n);
+
+    const tree_job_t jobs[] = {
+        { TREE_TOPO_TREE, fanout, n },
+        { TREE_TOPO_TREE, fanout, chunk },
+        { TREE_TOPO_RING, fanout, n },
+        { TREE_TOPO_RING, fanout, chunk },
+    };
+    const tree_job_t barrier = { TREE_TOPO_TREE, 2, 1 };
+    int j;
+    for (j = 0; j < (int)(sizeof(jobs) / sizeof(jobs[0])); j++) {
+        memcpy(buf, part, n * sizeof(float));
+        tree_allreduce(&tp, &one, 1, &barrier);
+
+        double t = now();
+        int err = tree_allreduce(&tp, buf, n, &jobs[j]);
+        double sec = now() - t;
+
+        int match = !err && !memcmp(buf, want, n * sizeof(float));
+        float ok = match;
+        tree_allreduce(&tp, &ok, 1, &barrier);
+        if (!match) failed++;
+
+        if (rank == 0) {
+            printf("%6s %8d %10zu %10.2f %10.2f %6s\n",
+                   jobs[j].topo == TREE_TOPO_TREE ? "tree" : "ring",
+                   jobs[j].topo == TREE_TOPO_TREE ? fanout : 1,
+                   jobs[j].chunk * sizeof(float) / 1024, sec * 1e3,
+                   n * sizeof(float) / sec / 1e9, ok == nranks ? "yes" : "no");
+        }
+    }
+
+    tree_loopback_close(&tp);
+    free(buf);
+    free(want);
+    free(part);
+    return failed;
+}
+
+int main(int argc, char* argv[])
+{
+    int nranks = argc > 1 ? atoi(argv[1]) : 8;
+    size_t n = argc > 2 ? strtoul(argv[2], 0, 0) : 1 << 22;
+    size_t chunk = argc > 3 ? strtoul(argv[3], 0, 0) : 1 << 14;
+    int fanout = argc > 4 ? atoi(argv[4]) : 2;
+    int clients = argc > 5 ? atoi(argv[5]) : 4;
+    int port = argc > 6 ? atoi(argv[6]) : 47000;
+    if (nranks < 1 || nranks > TREE_MAX_RANKS || n == 0 || chunk == 0 ||
+        fanout < 1 || clients < 1) {
+        fprintf(stderr, "Usage: %s [nodes 1-%d] [elements] [chunk] [fanout] [clients] [port]\n",
+                argv[0], TREE_MAX_RANKS);
+        return 1;
+    }
+
+    printf("%d nodes, %zu elements, %d clients per node\n", nranks, n, clients);
+    printf("%6s %8s %10s %10s %10s %6s\n", "topo", "fanout", "chunk_kb", "ms", "GB/s", "match");
+    fflush(stdout);
+
+    int r;
+    for (r = 1; r < nranks; r++) {
+        if (fork() == 0) _exit(run_node(r, nranks, n, chunk, fanout, clients, port) ? 1 : 0);
+    }
+    int failed = run_node(0, nranks, n, chunk, fanout, clients, port);
+
+    int status;
+    while (wait(&status) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) failed++;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+/**
+ * @file
+ * @brief Multi-node reduction of partial aggregates across Flagger nodes.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "agg_model.h"
+#include "tree_reduce.h"
+
+/// seconds a node waits for a lower rank to start listening
+#define TREE_CONNECT_TIMEOUT    10
+
+/// socket buffer size of a loopback connection
+#define TREE_SOCKBUF_BYTES      (4 << 20)
+
+
+/**
+ * Reduce to rank 0 along a k-ary tree and broadcast the sum back.
+ * A node adds the chunk of each child and passes it up at once, so the
+ * levels of the tree work on consecutive chunks at the same time.
+ */
+static int tree_reduce_tree(const tree_transport_t* tp, float* buf, size_t n,
+                            const tree_job_t* job, float* tmp)
+{
+    int rank = tp->rank;
+    int parent = (rank - 1) / job->fanout;
+    int first = rank * job->fanout + 1;
+    int last = first + job->fanout;
+    if (last > tp->nranks) last = tp->nranks;
+    size_t off;
+    int c;
+
+    for (off = 0; off < n; off += job->chunk) {
+        size_t len = n - off < job->chunk ? n - off : job->chunk;
+        for (c = first; c < last; c++) {
+            if (tp->recv(tp->ctx, c, tmp, len * sizeof(float))) return -1;
+            agg_model_dense_sum(buf + off, tmp, len);
+        }
+        if (rank && tp->send(tp->ctx, parent, buf + off, len * sizeof(float))) return -1;
+    }
+
+    // the broadcast starts once every node is done sending up, so a node
+    // never blocks sending down to a child that is blocked sending up
+    for (off = 0; off < n; off += job->chunk) {
+        size_t len = n - off < job->chunk ? n - off : job->chunk;
+        if (rank && tp->recv(tp->ctx, parent, buf + off, len * sizeof(float))) return -1;
+        for (c = first; c < last; c++) {
+            if (tp->send(tp->ctx, c, buf + off, len * sizeof(float))) return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Ring reduce-scatter followed by ring all-gather. Segment i of the
+ * buffer ends up summed on rank i - 1 after the first phase, every node
+ * sends and receives n / nranks elements per step.
+ */
+static int tree_reduce_ring(const tree_transport_t* tp, float* buf, size_t n,
+                            const tree_job_t* job, float* tmp)
+{
+    int p = tp->nranks;
+    int right = (tp->rank + 1) % p;
+    int left = (tp->rank + p - 1) % p;
+    int phase, step;
+
+    for (phase = 0; phase < 2; phase++) {
+        for (step = 0; step < p - 1; step++) {
+            // reduce-scatter passes on what it summed in the step before,
+            // all-gather what it received in the step before
+            int sseg = (tp->rank - step + phase + p) % p;
+            int rseg = (sseg + p - 1) % p;
+            size_t soff = n * sseg / p, slen = n * (sseg + 1) / p - soff;
+            size_t roff = n * rseg / p, rlen = n * (rseg + 1) / p - roff;
+            size_t k;
+
+            for (k = 0; k < slen || k < rlen; k += job->chunk) {
+                size_t sl = k < slen ? (slen - k < job->chunk ? slen - k : job->chunk) : 0;
+                size_t rl = k < rlen ? (rlen - k < job->chunk ? rlen - k : job->chunk) : 0;
+                float* dst = phase ? buf + roff + k : tmp;
+                if (tp->sendrecv(tp->ctx, right, buf + soff + k, sl * sizeof(float),
+                                 left, dst, rl * sizeof(float))) return -1;
+                if (!phase) agg_model_dense_sum(buf + roff + k, tmp, rl);
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Sum buf over all nodes, every node gets the sum back in buf.
+ * @param   tp          transport
+ * @param   buf         partial sum of this node, replaced by the total
+ * @param   n           number of elements, the same on every node
+ * @param   job         topology and chunking
+ * @return  0 if ok else -1.
+ */
+int tree_allreduce(const tree_transport_t* tp, float* buf, size_t n, const tree_job_t* job)
+{
+    if (job->chunk == 0 || (job->topo == TREE_TOPO_TREE && job->fanout < 1)) return -1;
+    if (tp->nranks == 1 || n == 0) return 0;
+
+    float* tmp = malloc(job->chunk * sizeof(float));
+    if (!tmp) return -1;
+
+    int err = -1;
+    if (job->topo == TREE_TOPO_TREE) err = tree_reduce_tree(tp, buf, n, job, tmp);
+    else if (job->topo == TREE_TOPO_RING) err = tree_reduce_ring(tp, buf, n, job, tmp);
+
+    free(tmp);
+    return err;
+}
+
+
+/// loopback transport context, one connection per peer
+typedef struct _tree_loopback {
+    int                 fd[TREE_MAX_RANKS]; ///< connection to each peer, -1 for self
+} tree_loopback_t;
+
+static int loopback_send(void* ctx, int peer, const void* buf, size_t len)
+{
+    int fd = ((tree_loopback_t*)ctx)->fd[peer];
+    const char* p = buf;
+    while (len) {
+        ssize_t r = send(fd, p, len, MSG_NOSIGNAL);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        len -= r;
+    }
+    return 0;
+}
+
+static int loopback_recv(void* ctx, int peer, void* buf, size_t len)
+{
+    int fd = ((tree_loopback_t*)ctx)->fd[peer];
+    char* p = buf;
+    while (len) {
+        ssize_t r = recv(fd, p, len, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) return -1;
+        p += r;
+        len -= r;
+    }
+    return 0;
+}
+
+static int loopback_sendrecv(void* ctx, int dst, const void* sbuf, size_t slen,
+                             int src, void* rbuf, size_t rlen)
+{
+    tree_loopback_t* lb = ctx;
+    const char* sp = sbuf;
+    char* rp = rbuf;
+
+    // both directions progress together, two nodes sending to each other
+    // cannot block on full socket buffers
+    while (slen || rlen) {
+        struct pollfd pfd[2];
+        int nfd = 0, si = -1, ri = -1;
+        if (slen) {
+            pfd[nfd].fd = lb->fd[dst];
+            pfd[nfd].events = POLLOUT;
+            si = nfd++;
+        }
+        if (rlen) {
+            if (si >= 0 && lb->fd[src] == lb->fd[dst]) {
+                pfd[si].events |= POLLIN;
+                ri = si;
+            } else {
+                pfd[nfd].fd = lb->fd[src];
+                pfd[nfd].events = POLLIN;
+                ri = nfd++;
+            }
+        }
+        if (poll(pfd, nfd, -1) < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        if (si >= 0 && (pfd[si].revents & (POLLOUT | POLLERR | POLLHUP))) {
+            ssize_t r = send(lb->fd[dst], sp, slen, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (r < 0 && errno != EAGAIN && errno != EINTR) return -1;
+            if (r > 0) {
+                sp += r;
+                slen -= r;
+            }
+        }
+        if (ri >= 0 && (pfd[ri].revents & (POLLIN | POLLERR | POLLHUP))) {
+            ssize_t r = recv(lb->fd[src], rp, rlen, MSG_DONTWAIT);
+            if (r == 0 || (r < 0 && errno != EAGAIN && errno != EINTR)) return -1;
+            if (r > 0) {
+                rp += r;
+                rlen -= r;
+            }
+        }
+    }
+    return 0;
+}
+
+/// set the options of a connection to a peer
+static void loopback_setsockopt(int fd)
+{
+    int one = 1, bytes = TREE_SOCKBUF_BYTES;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof(bytes));
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof(bytes));
+}
+
+/**
+ * Connect the nodes of a reduction over TCP on 127.0.0.1, the stand-in
+ * for the FPGA network kernel when several nodes run on one host. Rank r
+ * listens on baseport + r, connects to every lower rank and accepts the
+ * higher ones.
+ * @param   tp          returned transport
+ * @param   rank        this node
+ * @param   nranks      number of nodes
+ * @param   baseport    port of rank 0
+ * @return  0 if ok else -1.
+ */
+int tree_loopback_open(tree_transport_t* tp, int rank, int nranks, int baseport)
+{
+    if (nranks < 1 || nranks > TREE_MAX_RANKS || rank < 0 || rank >= nranks) return -1;
+
+    tree_loopback_t* lb = malloc(sizeof(tree_loopback_t));
+    int i;
+    for (i = 0; i < TREE_MAX_RANKS; i++) lb->fd[i] = -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // the listener is up before connecting, the lower ranks queue in its backlog
+    int one = 1;
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    addr.sin_port = htons(baseport + rank);
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) || listen(lfd, nranks)) goto error;
+
+    for (i = 0; i < rank; i++) {
+        time_t deadline = time(NULL) + TREE_CONNECT_TIMEOUT;
+        int fd;
+        addr.sin_port = htons(baseport + i);
+        for (;;) {
+            fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0) goto error;
+            if (!connect(fd, (struct sockaddr*)&addr, sizeof(addr))) break;
+            close(fd);
+            if (time(NULL) > deadline) goto error;
+            usleep(10000);
+        }
+        loopback_setsockopt(fd);
+        lb->fd[i] = fd;
+        if (loopback_send(lb, i, &rank, sizeof(rank))) goto error;
+    }
+
+    for (i = rank + 1; i < nranks; i++) {
+        int peer;
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0) goto error;
+        if (recv(fd, &peer, sizeof(peer), MSG_WAITALL) != sizeof(peer) ||
+            peer <= rank || peer >= nranks || lb->fd[peer] >= 0) {
+            close(fd);
+            goto error;
+        }
+        loopback_setsockopt(fd);
+        lb->fd[peer] = fd;
+    }
+    close(lfd);
+
+    tp->rank = rank;
+    tp->nranks = nranks;
+    tp->ctx = lb;
+    tp->send = loopback_send;
+    tp->recv = loopback_recv;
+    tp->sendrecv = loopback_sendrecv;
+    return 0;
+
+error:
+    if (lfd >= 0) close(lfd);
+    for (i = 0; i < TREE_MAX_RANKS; i++) {
+        if (lb->fd[i] >= 0) close(lb->fd[i]);
+    }
+    free(lb);
+    return -1;
+}
+
+/**
+ * Close the connections of a loopback transport.
+ * @param   tp          transport
+ */
+void tree_loopback_close(tree_transport_t* tp)
+{
+    tree_loopback_t* lb = tp->ctx;
+    int i;
+    for (i = 0; i < TREE_MAX_RANKS; i++) {
+        if (lb->fd[i] >= 0) close(lb->fd[i]);
+    }
+    free(lb);
+    tp->ctx = NULL;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file
+ * @brief Multi-node reduction of partial aggregates across Flagger nodes.
+ *
+ * Every node first reduces its local clients on its own CSD, then the
+ * partial sums are combined across nodes along a tree or a ring. Data
+ * moves in chunks so that a node forwards the first chunk while later
+ * ones are still arriving, which hides the latency of each hop. Only
+ * sums compose this way; a median of medians is not the median.
+ */
+
+#ifndef _TREE_REDUCE_H
+#define _TREE_REDUCE_H
+
+#include <stddef.h>
+
+#include "libunvme.h"
+
+#define TREE_MAX_RANKS          256     ///< nodes of a reduction
+
+
+/// Reduction topology
+typedef enum {
+    TREE_TOPO_TREE          = 0,    ///< reduce to rank 0 along a k-ary tree, broadcast back
+    TREE_TOPO_RING          = 1,    ///< ring reduce-scatter followed by ring all-gather
+} tree_topo_t;
+
+/**
+ * Point to point byte transport between the nodes. The FPGA network
+ * kernel sessions and the loopback stand-in both fit behind it.
+ * Calls return 0 once all bytes went out or came in, else -1.
+ */
+typedef struct _tree_transport {
+    int                 rank;       ///< this node
+    int                 nranks;     ///< number of nodes
+    void*               ctx;        ///< transport private context
+    int               (*send)(void* ctx, int peer, const void* buf, size_t len);
+    int               (*recv)(void* ctx, int peer, void* buf, size_t len);
+    int               (*sendrecv)(void* ctx, int dst, const void* sbuf, size_t slen,
+                                  int src, void* rbuf, size_t rlen); ///< both at once
+} tree_transport_t;
+
+/// Multi-node all-reduce job
+typedef struct _tree_job {
+    int                 topo;       ///< tree_topo_t
+    int                 fanout;     ///< children per node of a tree
+    size_t              chunk;      ///< elements per message
+} tree_job_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int tree_allreduce(const tree_transport_t* tp, float* buf, size_t n, const tree_job_t* job);
+
+int tree_loopback_open(tree_transport_t* tp, int rank, int nranks, int baseport);
+
+void tree_loopback_close(tree_transport_t* tp);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // _TREE_REDUCE_H
@@ -26,216 +26,286 @@ HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABI
 OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
 EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 **********/
-#include "xcl2.hpp"
-#include "libunvme.h"
-#include <vector>
-#include <chrono>
-#include <stdint.h>
+#include "session.h"
+#include "tree_reduce.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <cstring>
 #include <iostream>
-#include <limits>
-#include <algorithm>
-#include <time.h>
-
-#define DATA_SIZE 62500000
-#define NVME_PAGESIZE 4096
-#define NVME_QDEPTH   32
-
-//Set IP address of FPGA
-// #define IP_ADDR 0x0A01D498
-// #define BOARD_NUMBER 0
-// #define ARP 0x0A01D498
-
-void wait_for_enter(const std::string &msg) {
-    std::cout << msg << std::endl;
-    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-}
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
-int main(int argc, char **argv) {
-    if (argc < 2) {
-        std::cout << "Usage: " << argv[0] << " <XCLBIN File> [<#RxByte> <Port> <local_IP> <boardNum>]" << std::endl;
-        return EXIT_FAILURE;
+// Serve rounds over a unix socket, one request line per round:
+//   round [clients=<n>] [bytes=<n>] [chunk=<n>] [op=sum|mean|fedavg|median|trimmed_mean] [trim=<n>]
+//         [deadline=<us>] [late=drop|fold]
+//   quit
+// Fields left out keep the values given on the command line. Each round is
+// answered with "ok <breakdown>" or "error <reason>", a round the device
+// failed included, and the service keeps serving.
+static void serve(stream_ctx& s, rx_backend& rx, uint32_t basePort,
+                  const round_desc& defaults, const char* path) {
+    int lfd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    unlink(path);
+    if (lfd < 0 || bind(lfd, (struct sockaddr*)&addr, sizeof(addr)) || listen(lfd, 4)) {
+        std::cerr << "control socket " << path << ": " << strerror(errno) << std::endl;
+        return;
     }
+    printf("serving rounds on %s\n", path);
 
-    std::string binaryFile = argv[1];
-
-    cl_int err;
-    cl::CommandQueue q;
-    cl::Context context;
-
-    cl::Kernel user_kernel;
-    cl::Kernel network_kernel;
-
-    uint32_t local_IP = 0x0A01D498;
-    uint32_t boardNum = 1;
-    
-    if (argc >= 5) {
-        std::string s = argv[4];
-        std::string delimiter = ".";
-        int ip[4];
-        size_t pos = 0;
-        std::string token;
-        int i = 0;
-        while ((pos = s.find(delimiter)) != std::string::npos) {
-            token = s.substr(0, pos);
-            ip[i] = stoi(token);
-            s.erase(0, pos + delimiter.length());
-            i++;
+    int round = 0;
+    bool quit = false;
+    while (!quit) {
+        int fd = accept(lfd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        // a stream for each direction, a read and write stream shares one
+        // buffer and may drop request lines read ahead
+        FILE* in = fdopen(fd, "r");
+        int wfd = in ? dup(fd) : -1;
+        FILE* out = wfd >= 0 ? fdopen(wfd, "w") : NULL;
+        if (!out) {
+            std::cerr << "control connection: " << strerror(errno) << std::endl;
+            if (wfd >= 0)
+                close(wfd);
+            if (in)
+                fclose(in);
+            else
+                close(fd);
+            continue;
         }
-        ip[i] = stoi(s); 
-        local_IP = ip[3] | (ip[2] << 8) | (ip[1] << 16) | (ip[0] << 24);
-    }
+        char line[512];
+        while (!quit && fgets(line, sizeof(line), in)) {
+            std::string cmd;
+            std::vector<std::string> fields;
+            char* save = NULL;
+            for (char* tok = strtok_r(line, " \t\r\n", &save); tok; tok = strtok_r(NULL, " \t\r\n", &save))
+                fields.push_back(tok);
+            if (fields.empty())
+                continue;
 
-    if (argc >= 6) {
-        boardNum = strtol(argv[5], NULL, 10);
-    }
+            if (fields[0] == "quit") {
+                fprintf(out, "ok\n");
+                quit = true;
+                break;
+            }
+            if (fields[0] != "round") {
+                fprintf(out, "error unknown command %s\n", fields[0].c_str());
+                fflush(out);
+                continue;
+            }
+
+            round_desc rd = defaults;
+            const char* bad = NULL;
+            for (size_t i = 1; i < fields.size() && !bad; i++) {
+                size_t eq = fields[i].find('=');
+                std::string key = fields[i].substr(0, eq);
+                std::string val = (eq == std::string::npos) ? "" : fields[i].substr(eq + 1);
+                if (key == "clients")
+                    rd.clients = strtoul(val.c_str(), NULL, 10);
+                else if (key == "bytes")
+                    rd.bytes = strtoul(val.c_str(), NULL, 10);
+                else if (key == "chunk")
+                    rd.chunkBytes = strtoul(val.c_str(), NULL, 10);
+                else if (key == "trim")
+                    rd.trim = strtoul(val.c_str(), NULL, 10);
+                else if (key == "deadline")
+                    rd.deadlineUs = strtoul(val.c_str(), NULL, 10);
+                else if (key == "late" && (val == "drop" || val == "fold"))
+                    rd.late = (val == "fold") ? LATE_FOLD : LATE_DROP;
+                else if (key != "op" || !parse_op(val, &rd.op, &rd.trim))
+                    bad = "bad field";
+            }
+            if (!bad)
+                bad = check_round(s, rx, rd);
+            if (bad) {
+                fprintf(out, "error %s\n", bad);
+                fflush(out);
+                continue;
+            }
 
-    printf("local_IP:%x, boardNum:%d\n", local_IP, boardNum);
-
-    auto size = DATA_SIZE;
-    auto vector_size_bytes = sizeof(int) * size;
-    std::vector<int, aligned_allocator<int>> network_ptr0(size);
-    std::vector<int, aligned_allocator<int>> network_ptr1(size);
-
-    // OPENCL HOST CODE AREA START
-    auto devices = xcl::get_xil_devices();
-    auto fileBuf = xcl::read_binary_file(binaryFile);
-    cl::Program::Binaries bins{{fileBuf.data(), fileBuf.size()}};
-    int valid_device = 0;
-    for (unsigned int i = 0; i < devices.size(); i++) {
-        auto device = devices[i];
-        OCL_CHECK(err, context = cl::Context({device}, NULL, NULL, NULL, &err));
-        OCL_CHECK(err, q = cl::CommandQueue(context, {device}, CL_QUEUE_PROFILING_ENABLE, &err));
-
-        std::cout << "Trying to program device[" << i
-                  << "]: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
-        cl::Program program(context, {device}, bins, NULL, &err);
-        if (err != CL_SUCCESS) {
-            std::cout << "Failed to program device[" << i << "] with xclbin file!\n";
-        } else {
-            std::cout << "Device[" << i << "]: program successful!\n";
-            OCL_CHECK(err, network_kernel = cl::Kernel(program, "network_krnl", &err));
-            OCL_CHECK(err, user_kernel = cl::Kernel(program, "hls_recv_krnl", &err));
-            valid_device++;
-            break;
+            round_report rep;
+            run_round(s, rx, basePort, rd, rep);
+            char report[512];
+            format_report(report, sizeof(report), round++, rep);
+            printf("%s\n", report);
+            if (rep.error)
+                fprintf(out, "error %s\n", rep.error);
+            else
+                fprintf(out, "ok %s\n", report);
+            fflush(out);
         }
+        fclose(out);
+        fclose(in);
     }
-    if (valid_device == 0) {
-        std::cout << "Failed to program any device found, exit!\n";
-        exit(EXIT_FAILURE);
+    close(lfd);
+    unlink(path);
+}
+
+#define NODE_PORT 7001          // node transport port of rank 0
+#define NODE_TREE_FANOUT 2
+
+// Byte transport between the nodes. On the software network the nodes
+// talk TCP on 127.0.0.1, so several of them can share a host. Over the
+// FPGA they would talk through sessions of network_krnl, which has no
+// kernel for it yet.
+static int node_open(tree_transport_t* tp, bool softNet, int rank, int nranks, int port) {
+    if (softNet)
+        return tree_loopback_open(tp, rank, nranks, port);
+    errno = ENOSYS;
+    return -1;
+}
+
+// Only a sum composes across nodes. A node weights the mean it aggregated
+// by the clients it took, or their samples for fedavg, the weighted means
+// and the weights are summed over the nodes and every node writes the
+// total over its aggregate on the CSD, where it is read back to check.
+// out and at hold the aggregate as stream_readback returns it. Every node
+// takes part in every exchange, a node whose round failed makes the
+// others skip the combine. Returns the failures.
+static int node_combine(stream_ctx& s, const tree_transport_t& tp, const tree_job_t& job, bool failed,
+                        std::vector<char>& out, const std::vector<size_t>& at) {
+    float bad = failed;
+    if (tree_allreduce(&tp, &bad, 1, &job)) {
+        std::cerr << "node " << tp.rank << ": exchange failed" << std::endl;
+        return 1;
+    }
+    if (bad) {
+        printf("node %d: %g of %d node(s) failed the round, nothing combined\n", tp.rank, bad, tp.nranks);
+        return 1;
     }
-    
-    wait_for_enter("\nPress ENTER to continue after setting up ILA trigger...");
-
-    OCL_CHECK(err, err = network_kernel.setArg(0, local_IP));
-    OCL_CHECK(err, err = network_kernel.setArg(1, boardNum));
-    OCL_CHECK(err, err = network_kernel.setArg(2, local_IP));
-
-    OCL_CHECK(err, cl::Buffer buffer_r1(context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_WRITE, vector_size_bytes, network_ptr0.data(), &err));
-    OCL_CHECK(err, cl::Buffer buffer_r2(context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_WRITE, vector_size_bytes, network_ptr1.data(), &err));
-
-    OCL_CHECK(err, err = network_kernel.setArg(3, buffer_r1));
-    OCL_CHECK(err, err = network_kernel.setArg(4, buffer_r2));
-
-    printf("enqueue network kernel...\n");
-    OCL_CHECK(err, err = q.enqueueTask(network_kernel));
-    OCL_CHECK(err, err = q.finish());
-    
-    uint32_t connection = 1;
-    uint32_t basePort = 5001; 
-    uint32_t rxByteCnt = 320000;
-
-    if (argc >= 3)
-        rxByteCnt = strtol(argv[2], NULL, 10);
-
-    if (argc >= 4)
-        basePort = strtol(argv[3], NULL, 10);
-
-    OCL_CHECK(err, err = user_kernel.setArg(16, connection));
-    OCL_CHECK(err, err = user_kernel.setArg(17, basePort));
-    OCL_CHECK(err, err = user_kernel.setArg(18, rxByteCnt));
-
-    auto start = std::chrono::high_resolution_clock::now();
-    printf("enqueue user kernel...\n");
-    OCL_CHECK(err, err = q.enqueueTask(user_kernel));
-    OCL_CHECK(err, err = q.finish());
-    auto end = std::chrono::high_resolution_clock::now();
-    double durationUs = (std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / 1000.0);
-    printf("durationUs:%f\n", durationUs);
-    // OPENCL HOST CODE AREA END    
 
-    
-    std::cout << "Network/kernel operations completed." << std::endl;
+    float weight = 0;
+    for (int j = 0; j < s.aggSlots; j++)
+        weight += (s.rd.op == UNVME_AGG_WEIGHTED_MEAN) ? s.slotWeights[j] : 1;
+    size_t n = out.size() / sizeof(float);
+    float* mean = (float*)out.data();
+    std::vector<float> part(n + 1);
+    for (size_t i = 0; i < n; i++)
+        part[i] = mean[i] * weight;
+    part[n] = weight;
+    if (tree_allreduce(&tp, part.data(), n + 1, &job) || !(part[n] > 0)) {
+        std::cerr << "node " << tp.rank << ": reduction failed" << std::endl;
+        return 1;
+    }
+    for (size_t i = 0; i < n; i++)
+        mean[i] = part[i] / part[n];
+    printf("node %d of %d: total weight %g over the nodes\n", tp.rank, tp.nranks, part[n]);
 
-    const char* pciName = "0000:01:00.0"; 
-    int nsid = 1;
-    const unvme_ns_t* ns = unvme_open(pciName, nsid, 4, NVME_QDEPTH);
-    if (!ns) {
-        std::cerr << "unvme_open failed: " << strerror(errno) << std::endl;
-        exit(EXIT_FAILURE);
+    std::vector<char> check;
+    std::vector<size_t> checkAt;
+    if (!stream_writeback(s, out, at) || !stream_readback(s, check, checkAt) || check != out) {
+        printf("node %d: total not on the CSD\n", tp.rank);
+        return 1;
     }
-    size_t total_bytes = rxByteCnt;
-    int num_pages = (total_bytes + NVME_PAGESIZE - 1) / NVME_PAGESIZE;
-    unvme_page_t* pages = unvme_alloc(ns, 0, num_pages);
-    if (!pages) {
-        std::cerr << "unvme_alloc failed for " << num_pages << " pages" << std::endl;
-        unvme_close(ns);
-        exit(EXIT_FAILURE);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char* prog = argv[0];
+    const char* sockPath = NULL;
+    int rank = 0;
+    int nranks = 1;                 // nodes the round is combined over
+    int nodePort = NODE_PORT;
+    int topo = TREE_TOPO_TREE;
+    session_opts o;
+    session_defaults(o);
+    int opt;
+    while ((opt = getopt(argc, argv, "s:r:R:T:P:" SESSION_OPTS)) != -1) {
+        if (opt == 's')
+            sockPath = optarg;
+        else if (opt == 'r')
+            rank = strtol(optarg, NULL, 10);
+        else if (opt == 'R')
+            nranks = strtol(optarg, NULL, 10);
+        else if (opt == 'T' && (!strcmp(optarg, "tree") || !strcmp(optarg, "ring")))
+            topo = strcmp(optarg, "ring") ? TREE_TOPO_TREE : TREE_TOPO_RING;
+        else if (opt == 'P')
+            nodePort = strtol(optarg, NULL, 10);
+        else if (!session_option(o, opt, optarg))
+            return EXIT_FAILURE;
     }
-    for (int i = 0; i < num_pages; ++i) {
-        pages[i].buf = network_ptr0.data() + i * NVME_PAGESIZE;
-        pages[i].actid = (i * NVME_PAGESIZE) / ns->actid_blocksize;
-        pages[i].nlb = NVME_PAGESIZE / ns->actid_blocksize;
-        pages[i].qid = i % ns->maxppq;
+    // the positional arguments keep their indices
+    argc -= optind - 1;
+    argv += optind - 1;
+
+    if (argc < 2) {
+        std::cout << "Usage: " << prog << " [-s <control socket>|-r <rank> -R <nodes> [-T tree|ring] [-P <node port>]] "
+                  SESSION_USAGE << std::endl;
+        return EXIT_FAILURE;
     }
-    if (unvme_awrite(ns, pages, num_pages)) {
-        std::cerr << "Batch write failed: " << strerror(errno) << std::endl;
-        unvme_free(ns, pages);
-        unvme_close(ns);
-        exit(EXIT_FAILURE);
+    if (const char* bad = session_args(o, argc, argv)) {
+        std::cout << bad << std::endl;
+        return EXIT_FAILURE;
     }
-    uint64_t start_lba = 0;
-    uint64_t end_lba = (total_bytes + ns->actid_blocksize - 1) / ns->actid_blocksize;
-    if (unvme_aggregate_start(ns, pages, start_lba, end_lba)) {
-        std::cerr << "Aggregation failed: " << strerror(errno) << std::endl;
-        unvme_free(ns, pages);
-        unvme_close(ns);
-        exit(EXIT_FAILURE);
+    if (nranks < 1 || nranks > TREE_MAX_RANKS || rank < 0 || rank >= nranks || (nranks > 1 && sockPath)) {
+        std::cout << "-r takes a rank below the node count -R, the control socket serves a single node" << std::endl;
+        return EXIT_FAILURE;
     }
-    unvme_page_t* read_pages = unvme_alloc(ns, 1, num_pages);
-    if (!read_pages) {
-        std::cerr << "Alloc read buffer failed" << std::endl;
-        unvme_free(ns, pages);
-        unvme_close(ns);
-        exit(EXIT_FAILURE);
+    if (nranks > 1 && o.rd.op != UNVME_AGG_WEIGHTED_MEAN && !(o.rd.op == UNVME_AGG_TRIMMED_MEAN && o.rd.trim == 0)) {
+        std::cout << "only mean and fedavg rounds combine across nodes" << std::endl;
+        return EXIT_FAILURE;
     }
-    memcpy(read_pages, pages, num_pages * sizeof(unvme_page_t));
-    if (unvme_aread(ns, read_pages, num_pages)) {
-        std::cerr << "Batch read failed" << std::endl;
-        unvme_free(ns, read_pages);
-        unvme_free(ns, pages);
-        unvme_close(ns);
-        exit(EXIT_FAILURE);
+
+    session ss;
+    session_open(ss, o);
+    stream_ctx& s = ss.s;
+    const round_desc& rd = o.rd;
+
+    // every node is up before the first round, a round is not held back
+    // waiting for a slow node to start
+    tree_transport_t tp = {};
+    tree_job_t job = {topo, NODE_TREE_FANOUT, rd.chunkBytes / sizeof(float)};
+    if (nranks > 1 && node_open(&tp, o.softNet, rank, nranks, nodePort)) {
+        std::cerr << "node " << rank << " transport: " << strerror(errno) << std::endl;
+        session_close(ss);
+        return EXIT_FAILURE;
     }
-    time_t poll_start = time(NULL);
-    while (true) {
-        int completed = unvme_apoll(ns, 0, 1);
-        if (completed == num_pages) break;
-        if (time(NULL) - poll_start > 5) {
-            std::cerr << "Operation timeout" << std::endl;
-            break;
+
+    int status = EXIT_SUCCESS;
+    if (sockPath) {
+        // kernels, buffers and the unvme session stay warm across rounds
+        serve(s, *ss.rx, o.basePort, rd, sockPath);
+    } else if (const char* bad = check_round(s, *ss.rx, rd)) {
+        printf("%s\n", bad);
+        status = EXIT_FAILURE;
+    } else {
+        printf("enqueue user kernel, %u connection(s) x %u bytes in chunks of %u bytes...\n", rd.clients, rd.bytes, rd.chunkBytes);
+        round_report rep;
+        run_round(s, *ss.rx, o.basePort, rd, rep);
+        printf("durationUs:%f roundUs:%f\n", rep.rxUs, rep.roundUs);
+        char report[512];
+        format_report(report, sizeof(report), 0, rep);
+        printf("%s\n", report);
+
+        // the CSD returns the CRC32C of every aggregated chunk, a sum is
+        // verified without reading it back. The other operators are read
+        // back and recomputed on the host.
+        std::vector<char> out;
+        std::vector<size_t> at;
+        if (rd.op != UNVME_AGG_DENSE_SUM) {
+            if (!stream_readback(s, out, at))
+                rep.failures++;
+            rep.failures += stream_verify(s, out, at);
+            rep.failures += stream_reference(s, out, at);
         }
+        if (nranks > 1)
+            rep.failures += node_combine(s, tp, job, rep.failures != 0, out, at);
+        if (rep.failures == 0)
+            std::cout << "Data verification passed" << std::endl;
+        else
+            printf("Data verification failed: %d aggregation(s) done, %d error(s)\n", rep.aggs, rep.failures);
     }
-    if (memcmp(network_ptr1.data(), read_pages[0].buf, total_bytes) == 0) {
-        std::cout << "Data verification passed" << std::endl;
-    }
-    unvme_free(ns, read_pages);
-    unvme_free(ns, pages);
-    unvme_close(ns);
+    // OPENCL HOST CODE AREA END    
+    if (nranks > 1)
+        tree_loopback_close(&tp);
+    session_close(ss);
 
     std::cout << "SSD operations completed." << std::endl;
     std::cout << "EXIT recorded" << std::endl;
-    return 0;
+    return status;
 }
@@ -0,0 +1,259 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#include "rx_backend.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+rx_run rx_fpga::enqueue(uint32_t port, char* dst, uint32_t bytes, const std::vector<rx_run>& after) {
+    if (dst != rxBase) {
+        std::cerr << "receive at offset " << dst - rxBase << " cannot be placed by hls_recv_krnl" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    cl_int err;
+    std::vector<cl::Event> wait;
+    for (const rx_run& r : after)
+        wait.push_back(r.ev);
+    rx_run run;
+    OCL_CHECK(err, err = kernel.setArg(16, (uint32_t)1));
+    OCL_CHECK(err, err = kernel.setArg(17, port));
+    OCL_CHECK(err, err = kernel.setArg(18, bytes));
+    OCL_CHECK(err, err = q.enqueueTask(kernel, wait.empty() ? NULL : &wait, &run.ev));
+    return run;
+}
+
+void rx_fpga::flush() {
+    cl_int err;
+    OCL_CHECK(err, err = q.flush());
+}
+
+// What a synthetic client sends for receive buffer bytes off..off+len-1,
+// a function of the offset only
+static uint32_t synth_word(size_t off) {
+    return (uint32_t)(off / 4) * 2654435761u;
+}
+
+// Sample count a synthetic client reports for its update
+static uint32_t synth_samples(uint32_t p) {
+    return 100 + p * 37 % 1000;
+}
+
+static void synth_fill(char* buf, size_t off, size_t len) {
+    size_t i = 0;
+    for (; i < len && (off + i) % 4; i++)
+        buf[i] = (char)(synth_word(off + i) >> (8 * ((off + i) % 4)));
+    for (; i + 4 <= len; i += 4) {
+        uint32_t word = synth_word(off + i);
+        memcpy(buf + i, &word, 4);
+    }
+    for (; i < len; i++)
+        buf[i] = (char)(synth_word(off + i) >> (8 * ((off + i) % 4)));
+}
+
+rx_socket::rx_socket(uint32_t localIP, uint32_t basePort, uint32_t numPorts, char* rxBase, char* ref, size_t hdrBase, bool synth)
+    : localIP(localIP), basePort(basePort), rxBase(rxBase), ref(ref), hdrBase(hdrBase), synth(synth), stop(false), ports(numPorts) {
+    wakeFd = eventfd(0, EFD_NONBLOCK);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(localIP);
+    for (uint32_t p = 0; p < numPorts; p++) {
+        int one = 1;
+        port_state& ps = ports[p];
+        ps.fd = -1;
+        ps.lfd = socket(AF_INET, SOCK_STREAM, 0);
+        addr.sin_port = htons(basePort + p);
+        setsockopt(ps.lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (ps.lfd < 0 || bind(ps.lfd, (struct sockaddr*)&addr, sizeof(addr)) || listen(ps.lfd, 1)) {
+            std::cerr << "listen on port " << basePort + p << ": " << strerror(errno) << std::endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+    receiverThread = std::thread(&rx_socket::receiver, this);
+    for (uint32_t p = 0; synth && p < numPorts; p++)
+        ports[p].sender = std::thread(&rx_socket::sender, this, p);
+}
+
+rx_socket::~rx_socket() {
+    {
+        std::lock_guard<std::mutex> g(lock);
+        stop = true;
+    }
+    cv.notify_all();
+    wake();
+    receiverThread.join();
+    for (port_state& ps : ports) {
+        if (ps.sender.joinable())
+            ps.sender.join();
+        if (ps.fd >= 0)
+            close(ps.fd);
+        close(ps.lfd);
+    }
+    close(wakeFd);
+}
+
+rx_run rx_socket::enqueue(uint32_t port, char* dst, uint32_t bytes, const std::vector<rx_run>& after) {
+    if (port < basePort || port - basePort >= ports.size()) {
+        std::cerr << "port " << port << " is not served" << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    rx_run run;
+    run.done = std::make_shared<std::atomic<bool>>(bytes == 0);
+    {
+        std::lock_guard<std::mutex> g(lock);
+        port_state& ps = ports[port - basePort];
+        if (synth)
+            ps.sends.push_back({(size_t)(dst - rxBase), bytes});
+        if (bytes)
+            ps.jobs.push_back({dst, bytes, 0, after, run.done});
+    }
+    cv.notify_all();
+    wake();
+    return run;
+}
+
+void rx_socket::wake() {
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        std::cerr << "receiver wake up failed: " << strerror(errno) << std::endl;
+}
+
+void rx_socket::receiver() {
+    std::unique_lock<std::mutex> g(lock);
+    while (!stop) {
+        // a port is polled while its next receive may start
+        std::vector<struct pollfd> pfd(1, {wakeFd, POLLIN, 0});
+        std::vector<uint32_t> who(1, 0);
+        bool chained = false;
+        for (uint32_t p = 0; p < ports.size(); p++) {
+            port_state& ps = ports[p];
+            if (ps.jobs.empty())
+                continue;
+            bool ready = true;
+            for (const rx_run& r : ps.jobs.front().after)
+                ready = ready && r.complete();
+            if (!ready) {
+                chained = true;
+                continue;
+            }
+            pfd.push_back({ps.fd >= 0 ? ps.fd : ps.lfd, POLLIN, 0});
+            who.push_back(p);
+        }
+
+        g.unlock();
+        // receives chained behind others are checked again shortly
+        struct timespec ts = {0, 50000};
+        ppoll(pfd.data(), pfd.size(), chained ? &ts : NULL, NULL);
+        uint64_t n;
+        if (pfd[0].revents && read(wakeFd, &n, sizeof(n)) < 0 && errno != EAGAIN)
+            std::cerr << "receiver wake up failed: " << strerror(errno) << std::endl;
+        g.lock();
+
+        for (size_t i = 1; i < pfd.size(); i++) {
+            if (!pfd[i].revents)
+                continue;
+            port_state& ps = ports[who[i]];
+            if (ps.fd < 0) {
+                ps.fd = accept(ps.lfd, NULL, NULL);
+                if (ps.fd >= 0) {
+                    int one = 1;
+                    setsockopt(ps.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+                }
+                continue;
+            }
+            recv_job& job = ps.jobs.front();
+            ssize_t r = recv(ps.fd, job.dst + job.got, job.bytes - job.got, MSG_DONTWAIT);
+            if (r > 0) {
+                job.got += r;
+                if (job.got == job.bytes) {
+                    job.done->store(true);
+                    ps.jobs.pop_front();
+                }
+            } else if (r == 0 || (errno != EAGAIN && errno != EINTR)) {
+                // the client went away, the next one may connect
+                close(ps.fd);
+                ps.fd = -1;
+            }
+        }
+    }
+}
+
+void rx_socket::sender(uint32_t p) {
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(localIP);
+    addr.sin_port = htons(basePort + p);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr))) {
+        std::cerr << "synthetic client of port " << basePort + p << ": " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    std::unique_lock<std::mutex> g(lock);
+    for (;;) {
+        cv.wait(g, [&] { return stop || !ports[p].sends.empty(); });
+        if (stop)
+            break;
+        send_job sj = ports[p].sends.front();
+        ports[p].sends.pop_front();
+        g.unlock();
+        // the reference is written before the bytes can be aggregated
+        char* buf = ref + sj.offset;
+        synth_fill(buf, sj.offset, sj.bytes);
+        if (sj.offset >= hdrBase) {
+            client_header hdr = {};
+            hdr.samples = synth_samples(p);
+            memcpy(buf, &hdr, std::min<size_t>(sj.bytes, sizeof(hdr)));
+        }
+        for (size_t done = 0; done < sj.bytes; ) {
+            ssize_t r = send(fd, buf + done, sj.bytes - done, MSG_NOSIGNAL);
+            if (r < 0 && errno == EINTR)
+                continue;
+            if (r <= 0) {
+                std::cerr << "synthetic client of port " << basePort + p << ": " << strerror(errno) << std::endl;
+                exit(EXIT_FAILURE);
+            }
+            done += r;
+        }
+        g.lock();
+    }
+    close(fd);
+}
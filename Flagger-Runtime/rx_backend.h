@@ -0,0 +1,143 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#ifndef _RX_BACKEND_H
+#define _RX_BACKEND_H
+
+#include "xcl2.hpp"
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// A queued receive, complete once all of its bytes are in the buffer
+struct rx_run {
+    cl::Event ev;                               // hls_recv_krnl run
+    std::shared_ptr<std::atomic<bool>> done;    // receive of the socket backend
+
+    bool complete() const {
+        return done ? done->load() : ev.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() == CL_COMPLETE;
+    }
+};
+
+// Receive side of the network. A receive takes the next bytes of a port
+// into the receive buffer once the receives it is chained after are
+// complete, receives of one port complete in the order they were queued.
+class rx_backend {
+public:
+    virtual ~rx_backend() {}
+    virtual rx_run enqueue(uint32_t port, char* dst, uint32_t bytes, const std::vector<rx_run>& after) = 0;
+    virtual void flush() {}
+    // false if the bytes of a receive land at the start of the receive
+    // buffer whatever dst is, a round then has a single client
+    virtual bool placesAtDst() const { return true; }
+};
+
+// hls_recv_krnl runs on the FPGA. The kernel takes a connection count, a
+// port and a byte count, and places the bytes at the start of the buffer
+// network_krnl was given. It takes no destination offset, so a receive
+// cannot be steered to dst and the regions of several connections cannot
+// be told apart. A receive for anywhere else than rxBase is refused.
+class rx_fpga : public rx_backend {
+public:
+    rx_fpga(cl::CommandQueue& q, cl::Kernel& kernel, char* rxBase) : q(q), kernel(kernel), rxBase(rxBase) {}
+
+    rx_run enqueue(uint32_t port, char* dst, uint32_t bytes, const std::vector<rx_run>& after) override;
+    void flush() override;
+    bool placesAtDst() const override { return false; }
+
+private:
+    cl::CommandQueue& q;
+    cl::Kernel& kernel;
+    char* rxBase;
+};
+
+// Sent by a client ahead of its update when the round takes a weighted
+// mean, padded to 16 bytes
+struct client_header {
+    uint32_t samples;           // weight of the update, the client's sample count
+    uint32_t rsvd[3];
+};
+
+// Kernel TCP stand-in for network_krnl and hls_recv_krnl, so that the
+// pipeline runs on a host without the FPGA. Port basePort + c listens on
+// local_IP for one client, a single thread moves the bytes of every port
+// straight into the receive buffer. Synthetic clients, one per port, send
+// what each receive waits for and put the same bytes in the reference
+// buffer the aggregation output is checked against. Bytes for the client
+// headers at hdrBase carry the sample count of the client instead.
+class rx_socket : public rx_backend {
+public:
+    rx_socket(uint32_t localIP, uint32_t basePort, uint32_t numPorts, char* rxBase, char* ref, size_t hdrBase, bool synth);
+    ~rx_socket();
+
+    rx_run enqueue(uint32_t port, char* dst, uint32_t bytes, const std::vector<rx_run>& after) override;
+
+private:
+    struct recv_job {
+        char* dst;
+        uint32_t bytes;
+        uint32_t got;
+        std::vector<rx_run> after;
+        std::shared_ptr<std::atomic<bool>> done;
+    };
+    struct send_job {
+        size_t offset;              // receive buffer offset the bytes are for
+        uint32_t bytes;
+    };
+    struct port_state {
+        int lfd;
+        int fd;                     // the client, -1 until it connects
+        std::deque<recv_job> jobs;
+        std::deque<send_job> sends;
+        std::thread sender;
+    };
+
+    void wake();
+    void receiver();
+    void sender(uint32_t p);
+
+    uint32_t localIP;
+    uint32_t basePort;
+    char* rxBase;
+    char* ref;
+    size_t hdrBase;
+    bool synth;
+    bool stop;
+    int wakeFd;
+    std::mutex lock;
+    std::condition_variable cv;
+    std::vector<port_state> ports;
+    std::thread receiverThread;
+};
+
+#endif // _RX_BACKEND_H
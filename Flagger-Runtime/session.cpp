@@ -0,0 +1,320 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#include "session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <algorithm>
+
+void wait_for_enter(const std::string &msg) {
+    std::cout << msg << std::endl;
+    std::cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+}
+
+void session_defaults(session_opts& o) {
+    o = session_opts();
+    o.numaNode = -2;
+    o.numQueues = NVME_QUEUES;
+    o.qdepth = NVME_QDEPTH;
+    o.localIP = 0x0A01D498;
+    o.boardNum = 1;
+    o.basePort = 5001;
+    o.nsid = 1;
+    o.rxMode = RX_COPY;
+    o.rd.clients = 1;
+    o.rd.bytes = 320000;            // per connection
+    o.rd.chunkBytes = STREAM_CHUNK_BYTES;
+    o.rd.op = UNVME_AGG_DENSE_SUM;
+}
+
+bool session_option(session_opts& o, int opt, const char* arg) {
+    if (opt == 'w')
+        o.ilaWait = true;
+    else if (opt == 'n')
+        o.softNet = true;
+    else if (opt == 'g')
+        o.softNet = o.synth = true;
+    else if (opt == 'N')
+        o.numaNode = strtol(arg, NULL, 10);
+    else if (opt == 'q')
+        o.numQueues = strtol(arg, NULL, 10);
+    else if (opt == 'd')
+        o.qdepth = strtol(arg, NULL, 10);
+    else if (opt == 'o')
+        return parse_op(arg, &o.rd.op, &o.rd.trim);
+    else
+        return false;
+    return true;
+}
+
+const char* session_args(session_opts& o, int argc, char** argv) {
+    if (o.numQueues < 1 || o.qdepth < 2)
+        return "-q and -d take a queue count and depth";
+    o.binaryFile = argv[1];
+
+    if (argc >= 3)
+        o.rd.bytes = strtol(argv[2], NULL, 10);
+
+    if (argc >= 4)
+        o.basePort = strtol(argv[3], NULL, 10);
+
+    if (argc >= 5) {
+        std::string s = argv[4];
+        std::string delimiter = ".";
+        int ip[4];
+        size_t pos = 0;
+        std::string token;
+        int i = 0;
+        while ((pos = s.find(delimiter)) != std::string::npos) {
+            token = s.substr(0, pos);
+            ip[i] = stoi(token);
+            s.erase(0, pos + delimiter.length());
+            i++;
+        }
+        ip[i] = stoi(s); 
+        o.localIP = ip[3] | (ip[2] << 8) | (ip[1] << 16) | (ip[0] << 24);
+    }
+
+    if (argc >= 6) {
+        o.boardNum = strtol(argv[5], NULL, 10);
+    }
+
+    if (argc >= 7)
+        o.nsid = strtol(argv[6], NULL, 10);
+
+    if (argc >= 8)
+        o.rd.chunkBytes = strtol(argv[7], NULL, 10);
+    o.rd.chunkBytes = std::max<uint32_t>(o.rd.chunkBytes / NVME_PAGESIZE, 1) * NVME_PAGESIZE;
+
+    if (argc >= 9) {
+        std::string mode = argv[8];
+        if (mode == "host")
+            o.rxMode = RX_HOST;
+        else if (mode == "p2p")
+            o.rxMode = RX_P2P;
+        else if (mode != "copy")
+            return "unknown receive mode";
+    }
+    if (o.softNet && o.rxMode == RX_P2P)
+        return "p2p receive needs the FPGA network kernels";
+
+    if (argc >= 10)
+        o.rd.clients = strtol(argv[9], NULL, 10);
+    if (o.rd.clients < 1 || o.rd.clients > MAX_CONNECTIONS)
+        return "connection count out of range";
+
+    if (argc >= 11)
+        o.rd.deadlineUs = strtoul(argv[10], NULL, 10);
+    return NULL;
+}
+
+void session_open(session& ss, const session_opts& o) {
+    cl_int err;
+
+    // setup stages of the benchmark timeline
+    ss.t0 = std::chrono::high_resolution_clock::now();
+    ss.spans.clear();
+    auto setupSpan = [&](const char* name, std::chrono::high_resolution_clock::time_point from) {
+        ss.spans.push_back({name, 0, -1, since_us(ss.t0, from), since_us(from, std::chrono::high_resolution_clock::now())});
+    };
+    auto stageStart = ss.t0;
+
+    printf("local_IP:%x, boardNum:%d, rxMode:%d\n", o.localIP, o.boardNum, o.rxMode);
+
+    // the receive and reference buffers are set up once and serve every
+    // round. Without -N they go to the node of the network card, which
+    // writes them as the bytes arrive. The software network has no card,
+    // the node of the CSD that reads them is taken instead.
+    const char* pciName = "0000:01:00.0"; 
+    char nicBdf[20] = "";
+
+    // OPENCL HOST CODE AREA START
+    stageStart = std::chrono::high_resolution_clock::now();
+    if (!o.softNet) {
+        auto devices = xcl::get_xil_devices();
+        auto fileBuf = xcl::read_binary_file(o.binaryFile);
+        cl::Program::Binaries bins{{fileBuf.data(), fileBuf.size()}};
+        int valid_device = 0;
+        for (unsigned int i = 0; i < devices.size(); i++) {
+            auto device = devices[i];
+            OCL_CHECK(err, ss.context = cl::Context({device}, NULL, NULL, NULL, &err));
+            // out of order, so receive runs of different connections can overlap
+            OCL_CHECK(err, ss.q = cl::CommandQueue(ss.context, {device}, CL_QUEUE_PROFILING_ENABLE | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &err));
+
+            std::cout << "Trying to program device[" << i
+                      << "]: " << device.getInfo<CL_DEVICE_NAME>() << std::endl;
+            cl::Program program(ss.context, {device}, bins, NULL, &err);
+            if (err != CL_SUCCESS) {
+                std::cout << "Failed to program device[" << i << "] with xclbin file!\n";
+            } else {
+                std::cout << "Device[" << i << "]: program successful!\n";
+                OCL_CHECK(err, err = device.getInfo(CL_DEVICE_PCIE_BDF, &nicBdf));
+                OCL_CHECK(err, ss.network_kernel = cl::Kernel(program, "network_krnl", &err));
+                OCL_CHECK(err, ss.user_kernel = cl::Kernel(program, "hls_recv_krnl", &err));
+                valid_device++;
+                break;
+            }
+        }
+        if (valid_device == 0) {
+            std::cout << "Failed to program any device found, exit!\n";
+            exit(EXIT_FAILURE);
+        }
+
+        if (o.ilaWait)
+            wait_for_enter("\nPress ENTER to continue after setting up ILA trigger...");
+
+        setupSpan("program", stageStart);
+    }
+
+    int numaNode = o.numaNode;
+    if (numaNode == -2)
+        numaNode = pci_numa_node(o.softNet ? pciName : nicBdf);
+    size_t vector_size_bytes = sizeof(int) * DATA_SIZE;
+    stageStart = std::chrono::high_resolution_clock::now();
+    if (!hp_alloc(ss.rxPool, vector_size_bytes, numaNode) || !hp_alloc(ss.refPool, vector_size_bytes, numaNode)) {
+        std::cerr << "receive buffer allocation failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    setupSpan("buffers", stageStart);
+    printf("receive buffers: %zu MiB in %zu KiB pages, NUMA node %d\n", ss.rxPool.bytes >> 20, ss.rxPool.pageBytes >> 10, numaNode);
+
+    char* rxBuf = ss.rxPool.buf;
+    stageStart = std::chrono::high_resolution_clock::now();
+    if (!o.softNet) {
+        OCL_CHECK(err, err = ss.network_kernel.setArg(0, o.localIP));
+        OCL_CHECK(err, err = ss.network_kernel.setArg(1, o.boardNum));
+        OCL_CHECK(err, err = ss.network_kernel.setArg(2, o.localIP));
+
+        // in p2p mode the receive buffer is device memory exported on the PCIe
+        // BAR, its host mapping is what the CSD gets to DMA from
+        if (o.rxMode == RX_P2P) {
+            cl_mem_ext_ptr_t p2pExt;
+            p2pExt.flags = XCL_MEM_EXT_P2P_BUFFER;
+            p2pExt.obj = NULL;
+            p2pExt.param = 0;
+            OCL_CHECK(err, ss.buffer_r1 = cl::Buffer(ss.context, CL_MEM_READ_WRITE | CL_MEM_EXT_PTR_XILINX, vector_size_bytes, &p2pExt, &err));
+            OCL_CHECK(err, rxBuf = (char*)ss.q.enqueueMapBuffer(ss.buffer_r1, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, vector_size_bytes, NULL, NULL, &err));
+        } else {
+            OCL_CHECK(err, ss.buffer_r1 = cl::Buffer(ss.context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_WRITE, vector_size_bytes, ss.rxPool.buf, &err));
+        }
+        OCL_CHECK(err, ss.buffer_r2 = cl::Buffer(ss.context, CL_MEM_USE_HOST_PTR | CL_MEM_READ_WRITE, vector_size_bytes, ss.refPool.buf, &err));
+
+        OCL_CHECK(err, err = ss.network_kernel.setArg(3, ss.buffer_r1));
+        OCL_CHECK(err, err = ss.network_kernel.setArg(4, ss.buffer_r2));
+
+        printf("enqueue network kernel...\n");
+        OCL_CHECK(err, err = ss.q.enqueueTask(ss.network_kernel));
+        OCL_CHECK(err, err = ss.q.finish());
+        setupSpan("network", stageStart);
+    }
+
+    // the CSD is opened first so that writes can start with the first chunk.
+    // Every connection of the largest round gets a queue of its own.
+    ss.numQueues = std::max<int>(o.numQueues, o.rd.clients);
+    stageStart = std::chrono::high_resolution_clock::now();
+    const unvme_ns_t* ns = unvme_open(pciName, o.nsid, ss.numQueues, o.qdepth);
+    if (!ns) {
+        std::cerr << "unvme_open failed: " << strerror(errno) << std::endl;
+        exit(EXIT_FAILURE);
+    }
+    ss.ns = ns;
+    setupSpan("open", stageStart);
+
+    stream_ctx& s = ss.s;
+    s = stream_ctx();
+    s.ns = ns;
+    s.src = rxBuf;
+    s.srcBytes = vector_size_bytes;
+    s.ref = ss.refPool.buf;
+    // the client headers take the last page of the receive buffer
+    s.hdrBase = vector_size_bytes - NVME_PAGESIZE;
+    s.pagesPerIo = std::min<int>(ns->maxppio, o.rd.chunkBytes / ns->pagesize);
+    s.poolPagesPerIo = s.pagesPerIo;
+
+    // the host buffer goes through the same IOMMU mapping as the P2P
+    // buffer, only the DMA target behind the address differs
+    ss.xb = NULL;
+    if (o.rxMode != RX_COPY) {
+        stageStart = std::chrono::high_resolution_clock::now();
+        ss.xb = unvme_map_xbuf(ns, rxBuf, vector_size_bytes);
+        if (!ss.xb) {
+            std::cerr << "unvme_map_xbuf failed: " << strerror(errno) << std::endl;
+            unvme_close(ns);
+            exit(EXIT_FAILURE);
+        }
+        s.xb = ss.xb;
+        s.poolPagesPerIo = 1;       // the page only tracks the command
+        setupSpan("map", stageStart);
+    }
+
+    stageStart = std::chrono::high_resolution_clock::now();
+    int numQueues = ss.numQueues;
+    int iosPerQueue = std::min(ns->maxiopq, ns->maxppq / s.poolPagesPerIo);
+    s.pool.resize(numQueues);
+    s.freeIo.resize(numQueues);
+    s.rxTail.resize(numQueues);
+    s.ios.resize(numQueues * iosPerQueue);
+    for (int qid = 0; qid < numQueues; qid++) {
+        s.pool[qid] = unvme_alloc(ns, qid, iosPerQueue * s.poolPagesPerIo);
+        if (!s.pool[qid]) {
+            std::cerr << "unvme_alloc failed for " << iosPerQueue * s.poolPagesPerIo << " pages" << std::endl;
+            unvme_close(ns);
+            exit(EXIT_FAILURE);
+        }
+        for (int i = 0; i < iosPerQueue; i++) {
+            stream_io* io = &s.ios[qid * iosPerQueue + i];
+            io->pa = s.pool[qid] + i * s.poolPagesPerIo;
+            io->pa->data = io;
+            s.freeIo[qid].push_back(io);
+        }
+    }
+
+    setupSpan("alloc", stageStart);
+
+    // the software network serves every port a round may use
+    if (o.softNet)
+        ss.rx.reset(new rx_socket(o.localIP, o.basePort, numQueues, rxBuf, ss.refPool.buf, s.hdrBase, o.synth));
+    else
+        ss.rx.reset(new rx_fpga(ss.q, ss.user_kernel, rxBuf));
+}
+
+void session_close(session& ss) {
+    ss.rx.reset();
+
+    for (int qid = 0; qid < ss.numQueues; qid++)
+        unvme_free(ss.ns, ss.s.pool[qid]);
+    if (ss.xb)
+        unvme_unmap_xbuf(ss.ns, ss.xb);
+    unvme_close(ss.ns);
+    hp_free(ss.rxPool);
+    hp_free(ss.refPool);
+}
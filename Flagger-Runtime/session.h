@@ -0,0 +1,124 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#ifndef _SESSION_H
+#define _SESSION_H
+
+#include "xcl2.hpp"
+#include "libunvme.h"
+#include "buffer_pool.h"
+#include "rx_backend.h"
+#include "stream.h"
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <memory>
+
+#define DATA_SIZE 62500000
+#define NVME_QDEPTH   32
+#define NVME_QUEUES   4
+#define MAX_CONNECTIONS 64
+#define STREAM_CHUNK_BYTES (1024 * 1024)
+
+//Set IP address of FPGA
+// #define IP_ADDR 0x0A01D498
+// #define BOARD_NUMBER 0
+// #define ARP 0x0A01D498
+
+// Options every program on the node takes, to be added to its own
+#define SESSION_OPTS "wngN:q:d:o:"
+#define SESSION_USAGE "[-w] [-n|-g] [-N <numa node>] [-q <queues>] [-d <queue depth>] [-o sum|mean|fedavg|median] " \
+                      "<XCLBIN File|-> [<#RxByte> <Port> <local_IP> <boardNum> <nsid> <chunkByte> <copy|host|p2p> <#connection> <deadlineUs>]"
+
+// How the node is set up and the round the command line describes
+struct session_opts {
+    std::string binaryFile;
+    bool ilaWait;
+    bool softNet;               // kernel TCP instead of the FPGA network kernels
+    bool synth;                 // synthetic clients feed the software network
+    int numaNode;               // node of the receive buffers, -2 for the card's
+    int numQueues;
+    int qdepth;
+    uint32_t localIP;
+    uint32_t boardNum;
+    uint32_t basePort;
+    int nsid;
+    rx_mode rxMode;
+    round_desc rd;
+};
+
+// A span of the benchmark timeline, tid 0 is setup and tid 1 the rounds
+struct trace_span {
+    const char* name;
+    int tid;
+    int round;                  // -1 for setup
+    double ts;                  // us since the program started
+    double dur;
+};
+
+static inline double since_us(std::chrono::high_resolution_clock::time_point t0,
+                              std::chrono::high_resolution_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t - t0).count() / 1000.0;
+}
+
+// What the node keeps warm across rounds: the receive and reference
+// buffers, the network kernels, the unvme session and its command pool
+struct session {
+    std::chrono::high_resolution_clock::time_point t0;
+    std::vector<trace_span> spans;      // setup stages
+    hp_buf rxPool;
+    hp_buf refPool;
+    cl::CommandQueue q;
+    cl::Context context;
+    cl::Kernel user_kernel;
+    cl::Kernel network_kernel;
+    cl::Buffer buffer_r1;
+    cl::Buffer buffer_r2;
+    const unvme_ns_t* ns;
+    unvme_xbuf_t* xb;
+    int numQueues;
+    stream_ctx s;
+    std::unique_ptr<rx_backend> rx;
+};
+
+void session_defaults(session_opts& o);
+
+// One of SESSION_OPTS, false if its argument is not valid
+bool session_option(session_opts& o, int opt, const char* arg);
+
+// The positional arguments, argv[1] is the XCLBIN file. NULL if they are
+// valid, else what is wrong with them.
+const char* session_args(session_opts& o, int argc, char** argv);
+
+// Exits on failure, the node is of no use without any part of it
+void session_open(session& ss, const session_opts& o);
+
+void session_close(session& ss);
+
+#endif // _SESSION_H
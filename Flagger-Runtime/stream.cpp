@@ -0,0 +1,747 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#include "stream.h"
+#include "agg_model.h"
+#include <stdio.h>
+#include <math.h>
+#include <errno.h>
+#include <cstring>
+#include <iostream>
+#include <algorithm>
+
+// A command the device does not take fails the round, not the session,
+// a warm service goes on with the next round
+static void stream_fail(stream_ctx& s, stream_io* io, const char* what) {
+    std::cerr << what << ": " << strerror(errno) << std::endl;
+    if (!s.error)
+        s.error = what;
+    s.failures++;
+    if (io)
+        s.freeIo[io->pa->qid].push_back(io);
+}
+
+static stream_io* stream_take_io(stream_ctx& s, int conn) {
+    rx_conn& rc = s.conns[conn];
+    for (int i = 0; i < s.queuesPerConn; i++) {
+        int qid = rc.firstQueue + (rc.nextQueue + i) % s.queuesPerConn;
+        if (!s.freeIo[qid].empty()) {
+            stream_io* io = s.freeIo[qid].back();
+            s.freeIo[qid].pop_back();
+            rc.nextQueue = (qid - rc.firstQueue + 1) % s.queuesPerConn;
+            return io;
+        }
+    }
+    return NULL;
+}
+
+// A sum is taken per chunk, a robust operator once every client has
+// written the chunk, as it reduces over the clients
+static void stream_chunk_written(stream_ctx& s, int c) {
+    if (s.deferAgg)
+        return;
+    if (s.rd.op == UNVME_AGG_DENSE_SUM)
+        s.aggReady.push_back(c);
+    else if (--s.slotsPending[s.chunks[c].index] == 0)
+        s.aggReady.push_back(s.chunks[c].index * s.rd.clients);
+}
+
+static void stream_complete(stream_ctx& s, unvme_page_t* pa) {
+    stream_io* io = (stream_io*)pa->data;
+    stream_chunk& chunk = s.chunks[io->chunk];
+
+    if (pa->stat) {
+        fprintf(stderr, "chunk %d %s failed: status %d\n", io->chunk,
+                io->readDst ? "read back" : io->agg ? "aggregation" : "write", pa->stat);
+        s.failures++;
+    }
+    if (io->readDst) {
+        size_t bytes = (size_t)pa->nlb * s.ns->actid_blocksize;
+        for (size_t done = 0; !pa->stat && done < bytes; done += s.ns->pagesize)
+            memcpy(io->readDst + done, io->pa[done / s.ns->pagesize].buf, std::min<size_t>(s.ns->pagesize, bytes - done));
+        io->readDst = NULL;
+        s.readsPending--;
+    } else if (io->agg) {
+        if (!pa->stat && s.rd.op == UNVME_AGG_DENSE_SUM && chunk.ref && pa->cs != chunk.expectedCrc) {
+            printf("chunk %d verification failed: crc32c %08x expected %08x\n", io->chunk, pa->cs, chunk.expectedCrc);
+            s.failures++;
+        }
+        chunk.aggregated = true;
+        chunk.hasResult = !pa->stat;
+        chunk.resultCrc = pa->cs;
+        s.aggsDone++;
+    } else {
+        s.writeEnd = std::chrono::high_resolution_clock::now();
+        s.writesPending--;
+        if (!io->writeBack && --chunk.pendingWrites == 0 && chunk.received)
+            stream_chunk_written(s, io->chunk);
+    }
+    s.freeIo[pa->qid].push_back(io);
+}
+
+// Process the completions at hand and start the aggregations they unblock
+static void stream_reap(stream_ctx& s) {
+    for (int qid = 0; qid < (int)s.pool.size(); qid++) {
+        unvme_page_t* pa;
+        while ((pa = unvme_apoll(s.ns, qid, 0)))
+            stream_complete(s, pa);
+    }
+
+    // a connection out of free commands does not hold back the others
+    for (auto it = s.aggReady.begin(); it != s.aggReady.end(); ) {
+        int c = *it;
+        stream_chunk& chunk = s.chunks[c];
+        stream_io* io = stream_take_io(s, chunk.conn);
+        if (!io) {
+            ++it;
+            continue;
+        }
+        it = s.aggReady.erase(it);
+
+        unvme_agg_t agg = {};
+        agg.actid = chunk.offset / s.ns->actid_blocksize;
+        agg.startoff = 0;
+        agg.endoff = chunk.bytes;
+        agg.op = s.rd.op;
+        agg.flags = UNVME_AGG_CRC32C;
+        chunk.resultOffset = chunk.offset;
+        if (s.rd.op == UNVME_AGG_DENSE_SUM) {
+            if (chunk.ref)
+                chunk.expectedCrc = unvme_crc32c(0, chunk.ref, chunk.bytes);
+        } else {
+            // slot i is the region at i * regionBytes, the result goes past the last one
+            agg.nslots = s.aggSlots;
+            agg.trim = s.aggTrim;
+            agg.slotstride = s.regionBytes / s.ns->actid_blocksize;
+            agg.dstactid = (s.dstBase + chunk.offset) / s.ns->actid_blocksize;
+            chunk.resultOffset = s.dstBase + chunk.offset;
+            if (s.rd.op == UNVME_AGG_WEIGHTED_MEAN)
+                agg.weights = s.slotWeights.data();
+        }
+        io->chunk = c;
+        io->agg = true;
+        if (!s.aggStarted) {
+            s.aggStart = std::chrono::high_resolution_clock::now();
+            s.aggStarted = true;
+        }
+        if (unvme_aggregate(s.ns, io->pa, &agg)) {
+            stream_fail(s, io, "aggregation failed");
+            chunk.aggregated = true;
+            s.aggsDone++;
+        }
+    }
+}
+
+// NULL if no command of the connection completes in time
+static stream_io* stream_wait_io(stream_ctx& s, int conn) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(UNVME_TIMEOUT);
+    stream_io* io;
+    while (!(io = stream_take_io(s, conn))) {
+        stream_reap(s);
+        if (std::chrono::steady_clock::now() > deadline) {
+            errno = ETIMEDOUT;
+            stream_fail(s, NULL, "device timeout");
+            return NULL;
+        }
+    }
+    return io;
+}
+
+static void stream_write_chunk(stream_ctx& s, int c) {
+    stream_chunk& chunk = s.chunks[c];
+    // bytes outside the mapped receive buffer go through the pool pages
+    bool mapped = s.xb && chunk.data >= s.src && chunk.data < s.src + s.srcBytes;
+    size_t ioBytes = (size_t)(mapped ? s.pagesPerIo : s.poolPagesPerIo) * s.ns->pagesize;
+
+    // a chunk that is not fully written is still aggregated, the round has failed
+    for (size_t off = 0; off < chunk.bytes; off += ioBytes) {
+        stream_io* io = stream_wait_io(s, chunk.conn);
+        if (!io)
+            break;
+        size_t len = std::min(ioBytes, chunk.bytes - off);
+        const char* src = chunk.data + off;
+
+        // pool pages are not contiguous, copy them one by one
+        for (size_t done = 0; !mapped && done < len; done += s.ns->pagesize) {
+            size_t n = std::min((size_t)s.ns->pagesize, len - done);
+            char* dst = (char*)io->pa[done / s.ns->pagesize].buf;
+            memcpy(dst, src + done, n);
+            memset(dst + n, 0, s.ns->pagesize - n);
+        }
+        io->pa->actid = (chunk.offset + off) / s.ns->actid_blocksize;
+        io->pa->nlb = (len + s.ns->actid_blocksize - 1) / s.ns->actid_blocksize;
+        io->pa->offset = 0;
+        io->chunk = c;
+        io->agg = false;
+        io->writeBack = false;
+        if (mapped ? unvme_awrite_xbuf(s.ns, io->pa, s.xb, src - s.src) : unvme_awrite(s.ns, io->pa)) {
+            stream_fail(s, io, "write failed");
+            break;
+        }
+        chunk.pendingWrites++;
+        s.writesPending++;
+    }
+
+    chunk.received = true;
+    if (chunk.pendingWrites == 0)
+        stream_chunk_written(s, c);
+}
+
+// Reap until no write is in flight, false on timeout
+static bool stream_wait_writes(stream_ctx& s) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(UNVME_TIMEOUT);
+    while (s.writesPending) {
+        stream_reap(s);
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cerr << "Operation timeout" << std::endl;
+            if (!s.error)
+                s.error = "device timeout";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Late updates of the round before that have fully arrived by now are
+// copied out before this round's receive runs reuse their regions
+static void stream_fold_late(stream_ctx& s, const round_desc& rd, round_report& rep) {
+    s.carry.clear();
+    s.carryWeights.clear();
+    for (const late_update& lu : s.late) {
+        if (lu.bytes == rd.bytes && s.carry.size() < rd.clients &&
+            (lu.hdr || rd.op != UNVME_AGG_WEIGHTED_MEAN) && lu.last.complete()) {
+            s.carry.emplace_back(s.src + lu.base, s.src + lu.base + lu.bytes);
+            s.carryWeights.push_back(lu.hdr ? lu.hdr->samples : 0);
+        } else
+            rep.dropped++;
+    }
+    s.late.clear();
+}
+
+// Weight of the update of connection c, valid once its header is received
+static float stream_client_weight(const stream_ctx& s, int c) {
+    return ((const client_header*)(s.src + s.hdrBase))[c].samples;
+}
+
+// Lay out the updates taken by the round in slots 0..m-1, so that the
+// aggregation covers them and nothing else. An update that already sits in
+// such a slot stays, the others are written again into the slots of the
+// clients that are missing. Returns the number of aggregations to expect.
+static int stream_compact(stream_ctx& s, const std::vector<bool>& in, int chunksPerConn, round_report& rep) {
+    const round_desc& rd = s.rd;
+    uint32_t clients = rd.clients;
+    std::vector<const char*> movers;
+    std::vector<const char*> moverRefs;
+    std::vector<float> moverWeights;
+    std::vector<bool> taken;
+    int m = 0;
+    for (uint32_t c = 0; c < clients; c++)
+        m += in[c];
+
+    // folded updates past the device capacity are dropped
+    size_t maxSlots = s.ns->max_actid_blocks * s.ns->actid_blocksize / s.regionBytes - 1;
+    long room = (long)maxSlots - std::max<int>(m, clients);
+    int carried = std::min<long>(s.carry.size(), std::max<long>(room, 0));
+    rep.dropped += s.carry.size() - carried;
+    rep.folded = carried;
+    m += carried;
+
+    // the weights follow their updates into the slots
+    std::vector<float> weights(m, 0);
+    std::vector<const char*> refs(m, NULL);
+    taken.assign(m, false);
+    for (uint32_t c = 0; c < clients; c++) {
+        if (!in[c])
+            continue;
+        if ((int)c < m) {
+            taken[c] = true;
+            weights[c] = s.slotWeights[c];
+            refs[c] = s.ref + s.conns[c].base;
+        } else {
+            movers.push_back(s.src + s.conns[c].base);
+            moverRefs.push_back(s.ref + s.conns[c].base);
+            moverWeights.push_back(s.slotWeights[c]);
+        }
+    }
+    // the region a folded update came in has been received into again since,
+    // the copy taken then is what it is checked against
+    for (int i = 0; i < carried; i++) {
+        movers.push_back(s.carry[i].data());
+        moverRefs.push_back(s.carry[i].data());
+        moverWeights.push_back(s.carryWeights[i]);
+    }
+
+    // slot j holds chunk k of its update in slotChunks[j][k]
+    std::vector<std::vector<int>> slotChunks(m);
+    for (int j = 0; j < m; j++) {
+        if (!taken[j])
+            continue;
+        for (int k = 0; k < chunksPerConn; k++)
+            slotChunks[j].push_back(k * clients + j);
+    }
+    int hole = 0;
+    for (size_t i = 0; i < movers.size(); i++) {
+        const char* data = movers[i];
+        while (taken[hole])
+            hole++;
+        taken[hole] = true;
+        weights[hole] = moverWeights[i];
+        refs[hole] = moverRefs[i];
+        for (int k = 0; k < chunksPerConn; k++) {
+            stream_chunk chunk = {};
+            size_t off = (size_t)k * rd.chunkBytes;
+            chunk.conn = hole % clients;
+            chunk.index = k;
+            chunk.offset = hole * s.regionBytes + off;
+            chunk.bytes = std::min<size_t>(rd.chunkBytes, rd.bytes - off);
+            chunk.data = data + off;
+            chunk.ref = moverRefs[i] + off;
+            s.chunks.push_back(chunk);
+            slotChunks[hole].push_back(s.chunks.size() - 1);
+            stream_write_chunk(s, s.chunks.size() - 1);
+        }
+    }
+    if (!stream_wait_writes(s))
+        s.failures++;
+
+    // a mean over the m slots taken is weighted by 1/m, not 1/clients
+    s.slotWeights = weights;
+    s.slotRef = refs;
+    s.aggSlots = m;
+    s.aggTrim = m ? std::min<uint32_t>(rd.trim, (m - 1) / 2) : 0;
+    s.dstBase = std::max<int>(m, clients) * s.regionBytes;
+    rep.clientsIn = m;
+    if (m == 0)
+        return 0;
+    if (rd.op != UNVME_AGG_DENSE_SUM) {
+        for (int k = 0; k < chunksPerConn; k++)
+            s.aggReady.push_back(slotChunks[0][k]);
+        return chunksPerConn;
+    }
+    for (int j = 0; j < m; j++)
+        s.aggReady.insert(s.aggReady.end(), slotChunks[j].begin(), slotChunks[j].end());
+    return m * chunksPerConn;
+}
+
+const char* check_round(const stream_ctx& s, const rx_backend& rx, const round_desc& rd) {
+    size_t regionBytes = ((size_t)rd.bytes + NVME_PAGESIZE - 1) / NVME_PAGESIZE * NVME_PAGESIZE;
+    if (rd.clients < 1 || rd.clients > s.pool.size())
+        return "client count out of range";
+    if (rd.clients > 1 && !rx.placesAtDst())
+        return "the FPGA receive takes a single client, use -n for more";
+    if (rd.bytes == 0 || rd.clients * regionBytes > s.hdrBase)
+        return "clients do not fit the receive buffer";
+    if (rd.chunkBytes == 0 || rd.chunkBytes % NVME_PAGESIZE)
+        return "chunk size is not a multiple of the page size";
+    if (rd.op != UNVME_AGG_DENSE_SUM && rd.op != UNVME_AGG_MEDIAN && rd.op != UNVME_AGG_TRIMMED_MEAN &&
+        rd.op != UNVME_AGG_WEIGHTED_MEAN)
+        return "unsupported operator";
+    if (rd.op == UNVME_AGG_TRIMMED_MEAN && 2 * rd.trim >= rd.clients)
+        return "trim leaves no values";
+    if (rd.op == UNVME_AGG_WEIGHTED_MEAN && rd.trim)
+        return "fedavg does not trim";
+    // the client header is a receive of its own, placed past the regions
+    if (rd.op == UNVME_AGG_WEIGHTED_MEAN && !rx.placesAtDst())
+        return "fedavg needs client headers the FPGA receive cannot place, use -n";
+    if (rd.op != UNVME_AGG_DENSE_SUM && (rd.clients + 1) * regionBytes / s.ns->actid_blocksize > s.ns->max_actid_blocks)
+        return "result does not fit the device";
+    if (rd.late != LATE_DROP && rd.late != LATE_FOLD)
+        return "unknown late policy";
+    return NULL;
+}
+
+double percentile(std::vector<double> v, double p) {
+    if (v.empty())
+        return 0;
+    std::sort(v.begin(), v.end());
+    size_t i = (size_t)(p * v.size() + 0.999999);
+    return v[std::min(std::max<size_t>(i, 1), v.size()) - 1];
+}
+
+// One federated round: every client sends rd.bytes on its own connection,
+// the bytes are written and aggregated on the CSD as they arrive. With a
+// deadline, the clients whose update has not fully arrived by then are left
+// out of the aggregation and handled by rd.late. For a weighted mean each
+// client sends a client_header ahead of its update.
+void run_round(stream_ctx& s, rx_backend& rx, uint32_t basePort,
+               const round_desc& desc, round_report& rep) {
+    rep = round_report();
+    stream_fold_late(s, desc, rep);
+
+    // a receive run left from an earlier round writes to its port's region
+    // as laid out then, on a new layout every connection waits for it
+    size_t regionBytes = ((size_t)desc.bytes + NVME_PAGESIZE - 1) / NVME_PAGESIZE * NVME_PAGESIZE;
+    std::vector<rx_run> allTails;
+    if (regionBytes != s.regionBytes) {
+        for (auto& tail : s.rxTail)
+            allTails.insert(allTails.end(), tail.begin(), tail.end());
+    }
+
+    // a receive that cannot be placed lands at the start of the buffer,
+    // where nothing says the next run goes on. The update is then taken in
+    // a single run, and only its writes to the CSD are cut into commands.
+    round_desc rd = desc;
+    if (!rx.placesAtDst())
+        rd.chunkBytes = std::max<size_t>(rd.chunkBytes, regionBytes);
+
+    s.rd = rd;
+    s.regionBytes = regionBytes;
+    s.queuesPerConn = std::max<int>(s.pool.size() / rd.clients, 1);
+    s.conns.assign(rd.clients, rx_conn());
+    for (uint32_t c = 0; c < rd.clients; c++) {
+        s.conns[c].port = basePort + c;
+        s.conns[c].base = c * s.regionBytes;
+        s.conns[c].firstQueue = c * s.queuesPerConn;
+    }
+
+    // chunk k of connection c is s.chunks[k * clients + c]
+    int chunksPerConn = (rd.bytes + rd.chunkBytes - 1) / rd.chunkBytes;
+    int numChunks = chunksPerConn * rd.clients;
+    s.chunks.assign(numChunks, stream_chunk());
+    for (int k = 0; k < numChunks; k++) {
+        stream_chunk& chunk = s.chunks[k];
+        chunk.conn = k % rd.clients;
+        chunk.index = k / rd.clients;
+        size_t off = (size_t)chunk.index * rd.chunkBytes;
+        chunk.offset = s.conns[chunk.conn].base + off;
+        chunk.bytes = std::min<size_t>(rd.chunkBytes, rd.bytes - off);
+        chunk.data = s.src + chunk.offset;
+        chunk.ref = s.ref + chunk.offset;
+    }
+    s.slotsPending.assign(chunksPerConn, rd.clients);
+    s.aggReady.clear();
+    s.deferAgg = rd.deadlineUs || !s.carry.empty();
+    s.aggSlots = rd.clients;
+    s.aggTrim = rd.trim;
+    s.dstBase = rd.clients * s.regionBytes;
+    s.slotWeights.assign(rd.clients, 0);
+    s.slotRef.resize(rd.clients);
+    for (uint32_t c = 0; c < rd.clients; c++)
+        s.slotRef[c] = s.ref + s.conns[c].base;
+    s.writesPending = 0;
+    s.readsPending = 0;
+    s.aggStarted = false;
+    s.aggsDone = 0;
+    s.failures = 0;
+    s.error = NULL;
+    int aggsExpected = (rd.op == UNVME_AGG_DENSE_SUM) ? numChunks : chunksPerConn;
+
+    // one receive kernel run per chunk and connection. Runs of a connection
+    // are chained so its bytes append in order to its region, runs of
+    // different connections are independent.
+    auto start = std::chrono::high_resolution_clock::now();
+    s.writeEnd = start;
+    bool weighted = rd.op == UNVME_AGG_WEIGHTED_MEAN;
+    std::vector<std::vector<rx_run>> first(rd.clients);
+    for (uint32_t c = 0; c < rd.clients; c++) {
+        first[c] = allTails.empty() ? s.rxTail[c] : allTails;
+        if (weighted) {
+            char* hdr = (char*)s.src + s.hdrBase + c * sizeof(client_header);
+            first[c].assign(1, rx.enqueue(s.conns[c].port, hdr, sizeof(client_header), first[c]));
+        }
+    }
+    std::vector<rx_run> rxEvents(numChunks);
+    for (int k = 0; k < numChunks; k++) {
+        int c = s.chunks[k].conn;
+        std::vector<rx_run> prev;
+        if (k >= (int)rd.clients)
+            prev.push_back(rxEvents[k - rd.clients]);
+        else
+            prev = first[c];
+        rxEvents[k] = rx.enqueue(s.conns[c].port, (char*)s.chunks[k].data, s.chunks[k].bytes, prev);
+    }
+    for (uint32_t c = 0; c < rd.clients; c++)
+        s.rxTail[c].assign(1, rxEvents[numChunks - rd.clients + c]);
+    rx.flush();
+    auto enqueueEnd = std::chrono::high_resolution_clock::now();
+
+    auto us = [start](std::chrono::high_resolution_clock::time_point t) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t - start).count() / 1000.0;
+    };
+
+    // each connection is written as its chunks arrive, a slow client does
+    // not hold back the others
+    auto cutoff = start + std::chrono::microseconds(rd.deadlineUs);
+    auto rxFirst = start;
+    auto rxEnd = start;
+    std::vector<int> nextChunk(rd.clients, 0);
+    std::vector<double> arrived;
+    for (int written = 0; written < numChunks; ) {
+        if (rd.deadlineUs && std::chrono::high_resolution_clock::now() >= cutoff)
+            break;
+        for (uint32_t c = 0; c < rd.clients; c++) {
+            if (nextChunk[c] == chunksPerConn)
+                continue;
+            int k = nextChunk[c] * rd.clients + c;
+            if (!rxEvents[k].complete())
+                continue;
+            rxEnd = std::chrono::high_resolution_clock::now();
+            if (written == 0)
+                rxFirst = rxEnd;
+            // the header came in ahead of the first chunk
+            if (weighted && nextChunk[c] == 0)
+                s.slotWeights[c] = stream_client_weight(s, c);
+            stream_write_chunk(s, k);
+            if (++nextChunk[c] == chunksPerConn)
+                arrived.push_back(us(rxEnd));
+            written++;
+        }
+        stream_reap(s);
+    }
+
+    if (s.deferAgg) {
+        // writes of the clients cut off must land before their slots are
+        // handed to others
+        if (!stream_wait_writes(s))
+            s.failures++;
+        std::vector<bool> in(rd.clients);
+        for (uint32_t c = 0; c < rd.clients; c++) {
+            in[c] = nextChunk[c] == chunksPerConn;
+            if (in[c])
+                continue;
+            rep.clientsLate++;
+            if (rd.late == LATE_FOLD) {
+                const client_header* hdr = weighted ? (const client_header*)(s.src + s.hdrBase) + c : NULL;
+                s.late.push_back({s.conns[c].base, rd.bytes, hdr, rxEvents[numChunks - rd.clients + c]});
+            }
+        }
+        aggsExpected = stream_compact(s, in, chunksPerConn, rep);
+    } else {
+        rep.clientsIn = rd.clients;
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(UNVME_TIMEOUT);
+    while (s.aggsDone < aggsExpected) {
+        stream_reap(s);
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cerr << "Operation timeout" << std::endl;
+            if (!s.error)
+                s.error = "device timeout";
+            s.failures++;
+            break;
+        }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    rep.enqueueUs = us(enqueueEnd);
+    rep.firstRxUs = us(rxFirst);
+    rep.rxUs = us(rxEnd);
+    rep.writeUs = us(s.writeEnd);
+    rep.roundUs = us(end);
+    rep.aggStartUs = s.aggStarted ? us(s.aggStart) : rep.roundUs;
+    rep.arriveUs[0] = percentile(arrived, 0.50);
+    rep.arriveUs[1] = percentile(arrived, 0.90);
+    rep.arriveUs[2] = percentile(arrived, 0.99);
+    rep.arriveUs[3] = percentile(arrived, 1.0);
+    rep.aggs = s.aggsDone;
+    rep.failures = s.failures + (aggsExpected - s.aggsDone);
+    rep.error = s.error;
+}
+
+// Read the output of every aggregation of the round back from the CSD.
+// Chunk c lands in out at the page aligned at[c], npos if it has none.
+bool stream_readback(stream_ctx& s, std::vector<char>& out, std::vector<size_t>& at) {
+    size_t total = 0;
+    at.assign(s.chunks.size(), std::string::npos);
+    for (size_t c = 0; c < s.chunks.size(); c++) {
+        if (!s.chunks[c].hasResult)
+            continue;
+        at[c] = total;
+        total += (s.chunks[c].bytes + s.ns->pagesize - 1) / s.ns->pagesize * s.ns->pagesize;
+    }
+    out.resize(total);
+
+    // reads already submitted land in out even if a later one fails
+    size_t ioBytes = (size_t)s.poolPagesPerIo * s.ns->pagesize;
+    bool ok = true;
+    for (size_t c = 0; ok && c < s.chunks.size(); c++) {
+        const stream_chunk& chunk = s.chunks[c];
+        for (size_t off = 0; ok && at[c] != std::string::npos && off < chunk.bytes; off += ioBytes) {
+            stream_io* io = stream_wait_io(s, chunk.conn);
+            if (!io) {
+                ok = false;
+                break;
+            }
+            size_t len = std::min(ioBytes, chunk.bytes - off);
+            io->pa->actid = (chunk.resultOffset + off) / s.ns->actid_blocksize;
+            io->pa->nlb = (len + s.ns->actid_blocksize - 1) / s.ns->actid_blocksize;
+            io->pa->offset = 0;
+            io->chunk = c;
+            io->agg = false;
+            io->readDst = out.data() + at[c] + off;
+            if (unvme_aread(s.ns, io->pa)) {
+                io->readDst = NULL;
+                stream_fail(s, io, "read back failed");
+                ok = false;
+                break;
+            }
+            s.readsPending++;
+        }
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(UNVME_TIMEOUT);
+    while (s.readsPending) {
+        stream_reap(s);
+        if (std::chrono::steady_clock::now() > deadline) {
+            std::cerr << "Operation timeout" << std::endl;
+            return false;
+        }
+    }
+    return ok;
+}
+
+// Write in, laid out as stream_readback returns it, over the output of
+// every aggregation of the round on the CSD
+bool stream_writeback(stream_ctx& s, const std::vector<char>& in, const std::vector<size_t>& at) {
+    size_t ioBytes = (size_t)s.poolPagesPerIo * s.ns->pagesize;
+    bool ok = true;
+    for (size_t c = 0; ok && c < s.chunks.size(); c++) {
+        const stream_chunk& chunk = s.chunks[c];
+        for (size_t off = 0; ok && at[c] != std::string::npos && off < chunk.bytes; off += ioBytes) {
+            stream_io* io = stream_wait_io(s, chunk.conn);
+            if (!io) {
+                ok = false;
+                break;
+            }
+            size_t len = std::min(ioBytes, chunk.bytes - off);
+            const char* src = in.data() + at[c] + off;
+            for (size_t done = 0; done < len; done += s.ns->pagesize) {
+                size_t n = std::min((size_t)s.ns->pagesize, len - done);
+                char* dst = (char*)io->pa[done / s.ns->pagesize].buf;
+                memcpy(dst, src + done, n);
+                memset(dst + n, 0, s.ns->pagesize - n);
+            }
+            io->pa->actid = (chunk.resultOffset + off) / s.ns->actid_blocksize;
+            io->pa->nlb = (len + s.ns->actid_blocksize - 1) / s.ns->actid_blocksize;
+            io->pa->offset = 0;
+            io->chunk = c;
+            io->agg = false;
+            io->writeBack = true;
+            if (unvme_awrite(s.ns, io->pa)) {
+                stream_fail(s, io, "write back failed");
+                ok = false;
+                break;
+            }
+            s.writesPending++;
+        }
+    }
+    return stream_wait_writes(s) && ok;
+}
+
+// Check the output read back against the CRC32C the device reported for
+// it, returns the chunks that do not match
+int stream_verify(const stream_ctx& s, const std::vector<char>& out, const std::vector<size_t>& at) {
+    int bad = 0;
+    for (size_t c = 0; c < s.chunks.size(); c++) {
+        if (at[c] == std::string::npos)
+            continue;
+        uint32_t crc = unvme_crc32c(0, out.data() + at[c], s.chunks[c].bytes);
+        if (crc != s.chunks[c].resultCrc) {
+            printf("chunk %zu read back: crc32c %08x reported %08x\n", c, crc, s.chunks[c].resultCrc);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+// Recompute the output of a median, trimmed or weighted mean with the host
+// reference model from the updates the round took, and compare it with the
+// output read back. Median and trimmed mean match bit for bit, a weighted
+// mean up to rounding. Returns the chunks that do not match. A sum is
+// checked against its CRC32C as it completes.
+int stream_reference(const stream_ctx& s, const std::vector<char>& out, const std::vector<size_t>& at) {
+    if (s.rd.op == UNVME_AGG_DENSE_SUM)
+        return 0;
+    int bad = 0;
+    std::vector<float> expected;
+    std::vector<const float*> slots(s.aggSlots);
+    for (size_t c = 0; c < s.chunks.size(); c++) {
+        if (at[c] == std::string::npos)
+            continue;
+        const stream_chunk& chunk = s.chunks[c];
+        size_t off = (size_t)chunk.index * s.rd.chunkBytes;
+        size_t n = chunk.bytes / sizeof(float);
+        for (int j = 0; j < s.aggSlots; j++)
+            slots[j] = (const float*)(s.slotRef[j] + off);
+        expected.resize(n);
+        int err = (s.rd.op == UNVME_AGG_WEIGHTED_MEAN)
+            ? agg_model_weighted_mean(expected.data(), slots.data(), s.slotWeights.data(), s.aggSlots, n)
+            : agg_model_robust(expected.data(), slots.data(), s.aggSlots, n, s.rd.op, s.aggTrim);
+        if (err) {
+            // the device took a job the model rejects
+            printf("chunk %zu has no reference result\n", c);
+            bad++;
+            continue;
+        }
+
+        // updates are arbitrary bit patterns, NaN stays NaN
+        const float* got = (const float*)(out.data() + at[c]);
+        size_t i = 0;
+        for (; i < n; i++) {
+            if (memcmp(&got[i], &expected[i], sizeof(float)) == 0 || (std::isnan(got[i]) && std::isnan(expected[i])))
+                continue;
+            if (s.rd.op != UNVME_AGG_WEIGHTED_MEAN ||
+                !(fabsf(got[i] - expected[i]) <= 1e-5f * std::max(1.0f, fabsf(expected[i]))))
+                break;
+        }
+        if (i < n) {
+            printf("chunk %zu element %zu: %g, reference %g\n", c, i, got[i], expected[i]);
+            bad++;
+        }
+    }
+    return bad;
+}
+
+int format_report(char* buf, size_t len, int round, const round_report& rep) {
+    return snprintf(buf, len, "round=%d enqueue_us=%.1f first_rx_us=%.1f rx_us=%.1f write_us=%.1f round_us=%.1f "
+                    "arrive_p50_us=%.1f arrive_p90_us=%.1f arrive_p99_us=%.1f arrive_max_us=%.1f "
+                    "in=%d late=%d folded=%d dropped=%d aggs=%d failures=%d",
+                    round, rep.enqueueUs, rep.firstRxUs, rep.rxUs, rep.writeUs, rep.roundUs,
+                    rep.arriveUs[0], rep.arriveUs[1], rep.arriveUs[2], rep.arriveUs[3],
+                    rep.clientsIn, rep.clientsLate, rep.folded, rep.dropped, rep.aggs, rep.failures);
+}
+
+// "mean" is a trimmed mean that trims nothing, "fedavg" the mean weighted
+// by the sample counts the clients send
+bool parse_op(const std::string& name, uint32_t* op, uint32_t* trim) {
+    if (name == "sum")
+        *op = UNVME_AGG_DENSE_SUM;
+    else if (name == "median")
+        *op = UNVME_AGG_MEDIAN;
+    else if (name == "trimmed_mean")
+        *op = UNVME_AGG_TRIMMED_MEAN;
+    else if (name == "mean") {
+        *op = UNVME_AGG_TRIMMED_MEAN;
+        *trim = 0;
+    } else if (name == "fedavg") {
+        *op = UNVME_AGG_WEIGHTED_MEAN;
+        *trim = 0;
+    } else
+        return false;
+    return true;
+}
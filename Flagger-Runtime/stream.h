@@ -0,0 +1,190 @@
+/**********
+Copyright (c) 2019, Xilinx, Inc.
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice,
+this list of conditions and the following disclaimer.
+
+2. Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+3. Neither the name of the copyright holder nor the names of its contributors
+may be used to endorse or promote products derived from this software
+without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+**********/
+#ifndef _STREAM_H
+#define _STREAM_H
+
+#include "libunvme.h"
+#include "rx_backend.h"
+#include <stdint.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <chrono>
+
+#define NVME_PAGESIZE 4096
+
+// The receive is cut into chunks. A chunk is written to the CSD as soon as
+// the receive kernel run carrying it completes, and aggregated once all of
+// its writes have completed, so receive, store and aggregate overlap.
+struct stream_chunk {
+    int conn;                   // connection whose queues carry the chunk
+    int index;                  // chunk index within the connection
+    size_t offset;              // first byte on the CSD
+    size_t bytes;
+    const char* data;           // bytes written
+    int pendingWrites;          // writes submitted and not completed
+    bool received;              // all writes of the chunk submitted
+    const char* ref;            // bytes a sum is checked against, NULL if none
+    bool aggregated;
+    bool hasResult;             // aggregation succeeded, its output is on the CSD
+    size_t resultOffset;        // first byte of the output on the CSD
+    uint32_t resultCrc;         // CRC32C of the output, as the device reported it
+    uint32_t expectedCrc;
+};
+
+// Where the CSD takes the received bytes from
+enum rx_mode {
+    RX_COPY,    // copied into unvme pages, the bytes cross host memory twice
+    RX_HOST,    // host receive buffer mapped for CSD DMA, stand-in for RX_P2P
+    RX_P2P,     // P2P receive buffer, the CSD reads them from the FPGA card
+};
+
+// What becomes of the clients a deadline round leaves behind
+enum late_policy {
+    LATE_DROP,  // their update is discarded
+    LATE_FOLD,  // their update joins the next round if it has arrived by then
+};
+
+// A client session. Its bytes land in a region of the receive buffer of
+// its own and are written through unvme queues of its own.
+struct rx_conn {
+    uint32_t port;
+    size_t base;                // first byte of the region
+    int firstQueue;
+    int nextQueue;              // queues of the connection are used round robin
+};
+
+// One command worth of pages, all from the pool of one queue
+struct stream_io {
+    unvme_page_t* pa;
+    int chunk;
+    bool agg;
+    char* readDst;              // read back: where the pages go, NULL otherwise
+    bool writeBack;             // write of an output, no chunk waits for it
+};
+
+// What a round receives and how it is aggregated
+struct round_desc {
+    uint32_t clients;           // connections, one per client
+    uint32_t bytes;             // bytes per client
+    uint32_t chunkBytes;
+    uint32_t op;                // unvme_agg_op_t
+    uint32_t trim;              // values dropped per side by trimmed mean
+    uint32_t deadlineUs;        // aggregate what arrived by then, 0 waits for all
+    uint32_t late;              // late_policy
+};
+
+// Round latency breakdown, all times in us from the start of the round
+struct round_report {
+    double enqueueUs;           // receive runs queued
+    double firstRxUs;           // first chunk received
+    double rxUs;                // last chunk received
+    double writeUs;             // last write completed
+    double aggStartUs;          // first aggregation started
+    double roundUs;             // last aggregation completed
+    double arriveUs[4];         // p50, p90, p99 and max of client updates received
+    int aggs;
+    int failures;
+    const char* error;          // first device error, NULL if none
+    int clientsIn;              // updates aggregated, the weight of a mean
+    int clientsLate;            // clients cut off by the deadline
+    int folded;                 // late updates of the round before aggregated
+    int dropped;                // late updates of the round before discarded
+};
+
+// A client a deadline round left behind, its receive runs still going
+struct late_update {
+    size_t base;                // its region in the receive buffer
+    uint32_t bytes;
+    const client_header* hdr;   // its weight, NULL if the round took none
+    rx_run last;                // last receive of the client
+};
+
+// Device state kept across rounds, and the state of the current round
+struct stream_ctx {
+    const unvme_ns_t* ns;
+    const char* src;            // received bytes
+    const unvme_xbuf_t* xb;     // src mapped for CSD DMA, NULL to copy
+    const char* ref;            // bytes the aggregation output is checked against
+    size_t srcBytes;
+    int pagesPerIo;             // bytes per write in pages
+    int poolPagesPerIo;         // pool pages a write holds
+    std::vector<unvme_page_t*> pool;
+    std::vector<stream_io> ios;
+    std::vector<std::vector<stream_io*>> freeIo;
+    std::vector<std::vector<rx_run>> rxTail;       // last receive per port
+    std::vector<late_update> late;
+    std::vector<std::vector<char>> carry;           // late updates folded into the round
+    std::vector<float> carryWeights;                // their weights
+    size_t hdrBase;             // client headers, one per port, past the regions
+
+    round_desc rd;
+    size_t regionBytes;         // receive buffer bytes of a connection
+    int queuesPerConn;
+    std::vector<rx_conn> conns;
+    std::vector<stream_chunk> chunks;
+    std::vector<int> slotsPending;  // robust operators: clients still writing chunk k
+    std::deque<int> aggReady;   // chunks written and not aggregated yet
+    bool deferAgg;              // aggregate once the updates taken are known
+    int aggSlots;               // slots a robust operator reduces over
+    uint32_t aggTrim;
+    size_t dstBase;             // first byte of the robust operator output
+    std::vector<float> slotWeights; // weighted mean: weight of each slot
+    std::vector<const char*> slotRef;   // reference of the update in each slot
+    int writesPending;
+    int readsPending;
+    bool aggStarted;
+    int aggsDone;
+    int failures;
+    const char* error;          // first device error of the round, NULL if none
+    std::chrono::high_resolution_clock::time_point writeEnd;
+    std::chrono::high_resolution_clock::time_point aggStart;
+};
+
+// Checks a round against the device, the receive buffer and the receive
+// backend, NULL if it can run
+const char* check_round(const stream_ctx& s, const rx_backend& rx, const round_desc& rd);
+
+void run_round(stream_ctx& s, rx_backend& rx, uint32_t basePort, const round_desc& rd, round_report& rep);
+
+bool stream_readback(stream_ctx& s, std::vector<char>& out, std::vector<size_t>& at);
+
+bool stream_writeback(stream_ctx& s, const std::vector<char>& in, const std::vector<size_t>& at);
+
+int stream_verify(const stream_ctx& s, const std::vector<char>& out, const std::vector<size_t>& at);
+
+int stream_reference(const stream_ctx& s, const std::vector<char>& out, const std::vector<size_t>& at);
+
+double percentile(std::vector<double> v, double p);
+
+int format_report(char* buf, size_t len, int round, const round_report& rep);
+
+bool parse_op(const std::string& name, uint32_t* op, uint32_t* trim);
+
+#endif // _STREAM_H
@@ -35,8 +35,13 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 #include "unvme.h"
 
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
 
 /// Global client info
 unvme_client_t  client = {  .lock = PTHREAD_MUTEX_INITIALIZER,
@@ -212,11 +217,363 @@ int unvme_awrite(const unvme_ns_t* ns, unvme_page_t* pa)
 }
 
 
+/**
+ * Map a buffer outside of the page pools for device DMA. The buffer must
+ * be page aligned. It may be host memory or the host mapping of a P2P
+ * buffer of another PCIe device, in which case the device DMA address
+ * routes to that device.
+ * @param   ns          namespace handle
+ * @param   buf         buffer
+ * @param   size        buffer size
+ * @return  mapped buffer or NULL if error.
+ */
+unvme_xbuf_t* unvme_map_xbuf(const unvme_ns_t* ns, void* buf, size_t size)
+{
+    unvme_xbuf_t* xb = zalloc(sizeof(unvme_xbuf_t));
+    xb->buf = buf;
+    xb->size = size;
+
+    pthread_mutex_lock(&client.lock);
+    int err = client_map_xbuf(ns, xb);
+    pthread_mutex_unlock(&client.lock);
+    if (err) {
+        free(xb);
+        return NULL;
+    }
+    return xb;
+}
+
+/**
+ * Unmap a buffer mapped by unvme_map_xbuf.
+ * @param   ns          namespace handle
+ * @param   xb          mapped buffer
+ * @return  0 if ok else -1.
+ */
+int unvme_unmap_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_unmap_xbuf(ns, xb);
+    pthread_mutex_unlock(&client.lock);
+    if (!err) free(xb);
+    return err;
+}
+
+/**
+ * Read pa->nlb blocks into a mapped buffer asynchronously (caller is to
+ * poll for completion on pa).
+ * @param   ns          namespace handle
+ * @param   pa          page tracking the command
+ * @param   xb          mapped buffer
+ * @param   off         byte offset within the buffer
+ * @return  0 if ok else error code.
+ */
+int unvme_aread_xbuf(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_xbuf_t* xb, size_t off)
+{
+    if (off + (size_t)pa->nlb * ns->actid_blocksize > xb->size) return -1;
+    return client_rw_xbuf(ns, pa, NVME_CMD_READ, xb->addr + off);
+}
+
+/**
+ * Write pa->nlb blocks from a mapped buffer asynchronously (caller is to
+ * poll for completion on pa).
+ * @param   ns          namespace handle
+ * @param   pa          page tracking the command
+ * @param   xb          mapped buffer
+ * @param   off         byte offset within the buffer
+ * @return  0 if ok else error code.
+ */
+int unvme_awrite_xbuf(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_xbuf_t* xb, size_t off)
+{
+    if (off + (size_t)pa->nlb * ns->actid_blocksize > xb->size) return -1;
+    return client_rw_xbuf(ns, pa, NVME_CMD_WRITE, xb->addr + off);
+}
+
+/**
+ * Start a dense aggregation over a segment (caller is to poll for completion).
+ * @param   ns          namespace handle
+ * @param   pa          page whose actid is the first block of the segment
+ * @param   start_offset segment start byte offset
+ * @param   end_offset  segment end byte offset
+ * @return  0 if ok else error code.
+ */
 int unvme_aggregate_start(const unvme_ns_t* ns, unvme_page_t* pa, u64 start_offset, u64 end_offset) {
-    pa->nlb = (end_offset - start_offset) / ns->actid_blocksize;
-    return client_rw(ns, pa, NVME_CMD_AGGREGATE_START);
+    unvme_agg_t agg = { .actid = pa->actid, .startoff = start_offset,
+                        .endoff = end_offset, .op = UNVME_AGG_DENSE_SUM };
+    return client_aggregate(ns, pa, &agg);
 }
 
 int unvme_aggregate_done(const unvme_ns_t* ns, unvme_page_t* pa) {
     return client_rw(ns, pa, NVME_CMD_AGGREGATE_DONE);
-}
\ No newline at end of file
+}
+
+#if defined(__x86_64__)
+/**
+ * CRC32C register update using the SSE4.2 crc32 instruction.
+ * @param   crc         crc register
+ * @param   p           data
+ * @param   len         data length
+ * @return  updated crc register.
+ */
+__attribute__((target("sse4.2")))
+static u32 crc32c_sse42(u32 crc, const u8* p, size_t len)
+{
+    for (; len && ((uintptr_t)p & 0x7); len--) crc = _mm_crc32_u8(crc, *p++);
+    u64 crc64 = crc;
+    for (; len >= 8; len -= 8, p += 8) crc64 = _mm_crc32_u64(crc64, *(const u64*)p);
+    crc = crc64;
+    for (; len; len--) crc = _mm_crc32_u8(crc, *p++);
+    return crc;
+}
+#endif
+
+/// CRC32C table of the portable path
+static u32 crc32c_table[256];
+static pthread_once_t crc32c_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Build the CRC32C table of the portable path.
+ */
+static void crc32c_init(void)
+{
+    int i, b;
+    for (i = 0; i < 256; i++) {
+        u32 c = i;
+        for (b = 0; b < 8; b++) c = (c >> 1) ^ ((c & 1) ? 0x82F63B78 : 0);
+        crc32c_table[i] = c;
+    }
+}
+
+/**
+ * Compute the CRC32C (Castagnoli) of a buffer, as the CSD returns for an
+ * aggregation job with UNVME_AGG_CRC32C. Chains like zlib crc32(), so the
+ * output can be checked while it streams in.
+ * @param   crc         crc of the preceding data (0 for none)
+ * @param   buf         data
+ * @param   len         data length
+ * @return  crc of the data so far.
+ */
+u32 unvme_crc32c(u32 crc, const void* buf, size_t len)
+{
+    const u8* p = buf;
+
+    crc = ~crc;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2")) return ~crc32c_sse42(crc, p, len);
+#endif
+    pthread_once(&crc32c_once, crc32c_init);
+    for (; len; len--) crc = (crc >> 8) ^ crc32c_table[(crc ^ *p++) & 0xFF];
+    return ~crc;
+}
+
+/**
+ * Start an aggregation job (caller is to poll for completion).
+ * The page tracks the job. Only the weights of a weighted mean are
+ * transferred, the device reads them from the page.
+ * @param   ns          namespace handle
+ * @param   pa          page
+ * @param   agg         aggregation job
+ * @return  0 if ok else error code.
+ */
+int unvme_aggregate(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_agg_t* agg)
+{
+    if (agg->weights) {
+        if (!agg->nslots || agg->nslots * sizeof(float) > (size_t)ns->pagesize) return -1;
+        memcpy(pa->buf, agg->weights, agg->nslots * sizeof(float));
+    }
+    return client_aggregate(ns, pa, agg);
+}
+
+/**
+ * Read the aggregation engine telemetry (vendor log page 0xC0).
+ * Rates over the last window are the window counters divided by
+ * windowticks / tickspersec.
+ * @param   ns          namespace handle
+ * @param   stats       returned telemetry
+ * @return  0 if ok else error code.
+ */
+int unvme_get_agg_stats(const unvme_ns_t* ns, unvme_agg_stats_t* stats)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_get_agg_stats(ns, stats);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Program a transform descriptor (vendor feature 0xE2).
+ * Reprogramming a descriptor drops window data not dequantized yet.
+ * @param   ns          namespace handle
+ * @param   index       descriptor index (0 to UNVME_XFORM_MAX - 1)
+ * @param   xf          descriptor (format UNVME_XFORM_NONE releases it)
+ * @return  0 if ok else error code.
+ */
+int unvme_set_xform(const unvme_ns_t* ns, int index, const unvme_xform_t* xf)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_set_xform(ns, index, xf);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Set up an epoch ring (vendor admin command 0xC0).
+ * The ring starts at round 0, which clients write through the view.
+ * @param   ns          namespace handle
+ * @param   ring        ring index
+ * @param   er          ring layout (nepochs 0 releases the ring)
+ * @return  0 if ok else error code.
+ */
+int unvme_epoch_config(const unvme_ns_t* ns, int ring, const unvme_epoch_ring_t* er)
+{
+    u32 cdw[4] = { er->actid, er->nblocks, er->nepochs, er->viewactid };
+
+    pthread_mutex_lock(&client.lock);
+    int err = client_epoch(ns, NVME_EPOCH_CONFIGURE, ring, cdw, 0);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Atomically make the next round current. Writes handled by the device
+ * after this point land in the new round; the previous round stays in
+ * its epoch for aggregation and read-out until it is released.
+ * Fails if the next epoch still holds a round that was not released.
+ * @param   ns          namespace handle
+ * @param   ring        ring index
+ * @param   clear       zero the new epoch (for accumulators)
+ * @param   round       returned new round
+ * @return  0 if ok else error code.
+ */
+int unvme_epoch_advance(const unvme_ns_t* ns, int ring, int clear, u32* round)
+{
+    u32 cdw[4] = { clear ? 1 : 0, 0, 0, 0 };
+
+    pthread_mutex_lock(&client.lock);
+    int err = client_epoch(ns, NVME_EPOCH_ADVANCE, ring, cdw, round);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Hand the epoch of a read out round back to the ring.
+ * @param   ns          namespace handle
+ * @param   ring        ring index
+ * @param   round       completed round
+ * @return  0 if ok else error code.
+ */
+int unvme_epoch_release(const unvme_ns_t* ns, int ring, u32 round)
+{
+    u32 cdw[4] = { round, 0, 0, 0 };
+
+    pthread_mutex_lock(&client.lock);
+    int err = client_epoch(ns, NVME_EPOCH_RELEASE, ring, cdw, 0);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * First block of the epoch holding a round.
+ * @param   er          ring layout
+ * @param   round       round
+ * @return  epoch ACTID.
+ */
+u64 unvme_epoch_actid(const unvme_epoch_ring_t* er, u32 round)
+{
+    return er->actid + (u64)(round % er->nepochs) * er->nblocks;
+}
+
+/**
+ * Configure the compressed store (vendor feature 0xE3).
+ * Reconfiguring the store drops its content.
+ * @param   ns          namespace handle
+ * @param   cs          store layout (flags 0 disables the store)
+ * @return  0 if ok else error code.
+ */
+int unvme_set_cstore(const unvme_ns_t* ns, const unvme_cstore_t* cs)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_set_cstore(ns, cs);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Read the compressed store statistics (vendor log page 0xC1).
+ * The compression ratio of the stored data is
+ * mapped * 4096 / storedbytes.
+ * @param   ns          namespace handle
+ * @param   stats       returned statistics
+ * @return  0 if ok else error code.
+ */
+int unvme_get_cstore_stats(const unvme_ns_t* ns, unvme_cstore_stats_t* stats)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_get_cstore_stats(ns, stats);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Read the per command class cycle profile of the CSD firmware. Mean
+ * cycles of a stage are cycles / count, cyclespersec converts them to time.
+ * @param   ns          namespace handle
+ * @param   prof        returned profile
+ * @param   clear       clear the firmware counters after the read
+ * @return  0 if ok else error code.
+ */
+int unvme_get_cmd_profile(const unvme_ns_t* ns, unvme_cmd_profile_t* prof, int clear)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_get_cmd_profile(ns, prof, clear);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Create a namespace of nblocks blocks and attach it to the controller.
+ * A session on the new namespace is opened with unvme_open.
+ * @param   ns          namespace handle
+ * @param   nblocks     blocks of the namespace
+ * @param   nsid        returned namespace id
+ * @return  0 if ok else error code.
+ */
+int unvme_ns_create(const unvme_ns_t* ns, u64 nblocks, int* nsid)
+{
+    u32 id = 0;
+    pthread_mutex_lock(&client.lock);
+    int err = client_ns(ns, NVME_NS_CREATE, 0, nblocks, &id);
+    pthread_mutex_unlock(&client.lock);
+    if (!err) *nsid = id;
+    return err;
+}
+
+/**
+ * Detach and delete a namespace. Its hot region blocks read back as
+ * zeroes once the space is reused. Sessions on the namespace must be
+ * closed first.
+ * @param   ns          namespace handle
+ * @param   nsid        namespace id
+ * @return  0 if ok else error code.
+ */
+int unvme_ns_delete(const unvme_ns_t* ns, int nsid)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_ns(ns, NVME_NS_DELETE, nsid, 0, NULL);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
+
+/**
+ * Set the aggregation configuration of a namespace (vendor feature 0xE4).
+ * @param   ns          namespace handle
+ * @param   nsid        namespace id
+ * @param   na          aggregation configuration
+ * @return  0 if ok else error code.
+ */
+int unvme_set_ns_agg(const unvme_ns_t* ns, int nsid, const unvme_ns_agg_t* na)
+{
+    pthread_mutex_lock(&client.lock);
+    int err = client_set_ns_agg(ns, nsid, na);
+    pthread_mutex_unlock(&client.lock);
+    return err;
+}
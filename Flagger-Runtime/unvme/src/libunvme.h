@@ -38,6 +38,7 @@
 #define _LIBUNVME_H
 
 #include <stdint.h>
+#include <stddef.h>
 
 
 #ifndef _UNVME_TYPE
@@ -53,6 +54,8 @@ typedef uint64_t        u64;        ///< 64-bit unsigned
 #endif // _UNVME_TYPE
 
 #define UNVME_TIMEOUT   60          ///< I/O timeout in seconds
+#define UNVME_AGG_LATENCY_BUCKETS 32 ///< log2 microsecond latency buckets
+#define UNVME_XFORM_MAX 8           ///< transform descriptors per device
 
 
 /// Namespace attributes structure
@@ -83,11 +86,234 @@ typedef struct _unvme_page {
     u16                 nlb;        ///< number of logical blocks
     u16                 offset;     ///< first buffer offset
     int                 stat;       ///< I/O status (0 = completed)
+    u32                 cs;         ///< command specific result (aggregation CRC32C)
     u16                 id;         ///< page id
     u16                 qid;        ///< session queue id
     void*               data;       ///< application private data
 } unvme_page_t;
 
+/**
+ * Buffer outside of the unvme page pools mapped for device DMA. Commands
+ * on it take their PRPs from addr, so the data is never copied. buf may
+ * be the host mapping of an FPGA P2P buffer, which lets the CSD pull the
+ * data straight from the peer card.
+ */
+typedef struct _unvme_xbuf {
+    void*               buf;        ///< mapped buffer
+    size_t              size;       ///< mapped size
+    u64                 addr;       ///< device DMA address of buf
+    void*               id;         ///< private id
+} unvme_xbuf_t;
+
+/// Aggregation operator
+typedef enum {
+    UNVME_AGG_DENSE_SUM     = 0,    ///< accelerator sums the segment in place
+    UNVME_AGG_SPARSE_SUM    = 1,    ///< scatter-add (index, value) lists
+    UNVME_AGG_MEDIAN        = 2,    ///< coordinate-wise median over slots
+    UNVME_AGG_TRIMMED_MEAN  = 3,    ///< coordinate-wise trimmed mean over slots
+    UNVME_AGG_WEIGHTED_MEAN = 4,    ///< coordinate-wise mean over slots weighted per slot
+    UNVME_AGG_NAMESPACE     = 0xFF, ///< operator configured for the namespace
+} unvme_agg_op_t;
+
+/// Aggregation job flags
+typedef enum {
+    UNVME_AGG_CRC32C        = 0x1,  ///< return the CRC32C of the output in pa->cs
+} unvme_agg_flag_t;
+
+/// Sparse list header, followed by nnz unvme_agg_entry_t
+typedef struct _unvme_agg_sparse {
+    u32                 nnz;        ///< number of entries
+    u32                 denselen;   ///< accumulator length in elements
+} unvme_agg_sparse_t;
+
+/// Sparse list entry
+typedef struct _unvme_agg_entry {
+    u32                 index;      ///< accumulator element index
+    float               value;      ///< value added to the element
+} unvme_agg_entry_t;
+
+/// Aggregation job over a segment of the device hot region
+typedef struct _unvme_agg {
+    u64                 actid;      ///< first block of the segment
+    u32                 startoff;   ///< segment start byte offset within actid
+    u32                 endoff;     ///< segment end byte offset within actid
+    u32                 op;         ///< aggregation operator
+    u32                 dstactid;   ///< first block of the FP32 accumulator
+    u32                 nslots;     ///< client slots of a robust operator (1-256)
+    u32                 trim;       ///< values dropped per side by trimmed mean
+    u32                 slotstride; ///< blocks between consecutive slots
+    u32                 flags;      ///< aggregation job flags
+    const float*        weights;    ///< nslots weights of the weighted mean (FedAvg
+                                    ///< sample counts), sent in the job page
+} unvme_agg_t;
+
+/// Quantized format of a transform descriptor
+typedef enum {
+    UNVME_XFORM_NONE        = 0,    ///< descriptor unused
+    UNVME_XFORM_INT8        = 1,    ///< symmetric INT8, one FP32 scale per group
+} unvme_xform_format_t;
+
+/// Transform descriptor flags
+typedef enum {
+    UNVME_XFORM_QUANTIZE_ON_READ = 0x1, ///< reading the window quantizes the region
+} unvme_xform_flag_t;
+
+/**
+ * Transform descriptor pairing an FP32 region of the hot region with a
+ * quantized window. The window holds nblocks / 4 blocks of INT8 values
+ * followed by the FP32 scales, one per 2^groupshift elements. Window
+ * writes are dequantized into the region before the region is read or
+ * aggregated.
+ */
+typedef struct _unvme_xform {
+    u32                 format;     ///< quantized format
+    u32                 flags;      ///< transform flags
+    u32                 groupshift; ///< log2 of elements per scale (5-10)
+    u32                 actid;      ///< first block of the FP32 region
+    u32                 nblocks;    ///< region blocks, a multiple of 4
+    u32                 windowactid; ///< first block of the window
+} unvme_xform_t;
+
+/**
+ * Epoch ring of federated rounds. Round r lives in epoch r % nepochs,
+ * nblocks blocks at actid + (r % nepochs) * nblocks. Clients write the
+ * current round to the view; older rounds stay addressable through
+ * their epoch until the host releases them.
+ */
+typedef struct _unvme_epoch_ring {
+    u32                 actid;      ///< first block of epoch 0
+    u32                 nblocks;    ///< blocks per epoch
+    u32                 nepochs;    ///< epochs in the ring (2-32, 0 releases it)
+    u32                 viewactid;  ///< first block of the view
+} unvme_epoch_ring_t;
+
+/// Compressed store flags
+typedef enum {
+    UNVME_CSTORE_ENABLE     = 0x1,  ///< store the range compressed
+    UNVME_CSTORE_SHUFFLE4   = 0x2,  ///< compress byte planes of 4-byte elements
+} unvme_cstore_flag_t;
+
+/**
+ * Compressed store layout. Blocks of [actid, actid + nblocks) are kept
+ * LZ4 compressed in the poolblocks hot region blocks at poolactid,
+ * which must not overlap the range. Unwritten blocks read as zeroes,
+ * deallocation frees their space. Writes fail with capacity exceeded
+ * once the pool cannot take them uncompressed.
+ */
+typedef struct _unvme_cstore {
+    u32                 flags;      ///< store flags, 0 disables the store
+    u32                 actid;      ///< first block of the range
+    u32                 nblocks;    ///< blocks of the range
+    u32                 poolactid;  ///< first block of the pool
+    u32                 poolblocks; ///< blocks of the pool
+} unvme_cstore_t;
+
+/// Compressed store statistics (layout of the CSD vendor log page 0xC1)
+typedef struct _unvme_cstore_stats {
+    u32                 version;    ///< log page version
+    u32                 flags;      ///< store flags
+    u64                 tickspersec; ///< timer ticks per second
+    u32                 nblocks;    ///< blocks of the range
+    u32                 mapped;     ///< blocks holding data
+    u32                 raw;        ///< mapped blocks kept uncompressed
+    u32                 heapsectors; ///< 512-byte sectors of the pool heap
+    u32                 freesectors; ///< sectors not in use
+    u32                 pending;    ///< written blocks not compressed yet
+    u64                 storedbytes; ///< bytes held by the mapped blocks
+    u64                 compblocks; ///< blocks compressed
+    u64                 compbytes;  ///< bytes produced by compression
+    u64                 compticks;  ///< compression time in timer ticks
+    u64                 decompblocks; ///< blocks decompressed
+    u64                 decompticks; ///< decompression time in timer ticks
+    u8                  rsvd88[424]; ///< reserved (88-511)
+} unvme_cstore_stats_t;
+
+/// Element type of a namespace aggregation configuration
+typedef enum {
+    UNVME_DTYPE_FP32        = 0,    ///< 32-bit float
+} unvme_dtype_t;
+
+#define UNVME_NS_AGG_ANY    0xFF    ///< namespace accepts any operator
+
+/**
+ * Aggregation configuration of a namespace. Jobs submitted with
+ * UNVME_AGG_NAMESPACE take op, nslots, trim and slotstride from here.
+ * Jobs naming an operator must match op unless op is UNVME_NS_AGG_ANY.
+ */
+typedef struct _unvme_ns_agg {
+    u32                 op;         ///< operator or UNVME_NS_AGG_ANY
+    u32                 dtype;      ///< element type
+    u32                 nslots;     ///< client slots of a robust operator (1-256)
+    u32                 trim;       ///< values dropped per side by trimmed mean
+    u32                 slotstride; ///< blocks between consecutive slots
+} unvme_ns_agg_t;
+
+/// Aggregation engine counters (layout of the CSD vendor log page 0xC0)
+typedef struct _unvme_agg_counters {
+    u64                 jobs;       ///< aggregation commands completed
+    u64                 bytes;      ///< bytes reduced by the accelerator
+    u64                 busyticks;  ///< accelerator busy time in timer ticks
+    u64                 readbytes;  ///< bytes moved to the host by reads
+    u64                 writebytes; ///< bytes moved from the host by writes
+    u64                 qdepthsum;  ///< queue depth summed over the jobs
+    u32                 qdepthmax;  ///< max queue depth seen by a job
+    u32                 rsvd;       ///< reserved
+    u32                 latency[UNVME_AGG_LATENCY_BUCKETS]; ///< bucket b counts
+                                    ///< jobs of [2^(b-1), 2^b) us
+} unvme_agg_counters_t;
+
+/// Aggregation engine telemetry
+typedef struct _unvme_agg_stats {
+    u32                 version;    ///< log page version
+    u32                 nbuckets;   ///< number of latency buckets
+    u64                 tickspersec; ///< timer ticks per second
+    u64                 uptime;     ///< ticks since power-on
+    u64                 windowticks; ///< length of the reported window
+    u32                 qdepth;     ///< commands queued on the device now
+    u32                 rsvd;       ///< reserved
+    unvme_agg_counters_t total;     ///< counters since power-on
+    unvme_agg_counters_t window;    ///< counters of the last window
+    u8                  rsvd408[104]; ///< reserved (408-511)
+} unvme_agg_stats_t;
+
+#define UNVME_PROF_CLASS_ADMIN      0   ///< admin commands
+#define UNVME_PROF_CLASS_READ       1   ///< reads
+#define UNVME_PROF_CLASS_WRITE      2   ///< writes
+#define UNVME_PROF_CLASS_AGGREGATE  3   ///< aggregations
+#define UNVME_PROF_CLASS_OTHER      4   ///< other IO commands
+#define UNVME_PROF_CLASSES          5   ///< number of command classes
+
+#define UNVME_PROF_STAGE_FETCH      0   ///< command fetch and arbitration
+#define UNVME_PROF_STAGE_DECODE     1   ///< handler minus DMA and completion
+#define UNVME_PROF_STAGE_DMA        2   ///< host DMA descriptors issued
+#define UNVME_PROF_STAGE_CPL        3   ///< completion posting
+#define UNVME_PROF_STAGE_TOTAL      4   ///< whole command
+#define UNVME_PROF_STAGES           5   ///< number of stages
+
+#define UNVME_PROF_BUCKETS          20  ///< cycle histogram buckets
+#define UNVME_PROF_LSP_CLEAR        0x1 ///< log specific field clearing the counters
+
+/// Cycle counters of one stage of one command class
+typedef struct _unvme_prof_stage {
+    u64                 cycles;     ///< cycles summed over the commands
+    u32                 count;      ///< commands sampled
+    u32                 maxcycles;  ///< longest sample
+    u32                 histogram[UNVME_PROF_BUCKETS]; ///< bucket b counts
+                                    ///< [2^(b+5), 2^(b+6)) cycles, 0 below 64
+} unvme_prof_stage_t;
+
+/// Command processing profile (layout of the CSD vendor log page 0xC2)
+typedef struct _unvme_cmd_profile {
+    u32                 version;    ///< log page version
+    u32                 nclasses;   ///< number of command classes
+    u32                 nstages;    ///< number of stages
+    u32                 nbuckets;   ///< number of histogram buckets
+    u64                 cyclespersec; ///< firmware cycle counter rate
+    u64                 tickspersec; ///< timer ticks per second
+    u64                 elapsedticks; ///< ticks since power-on or the last clear
+    unvme_prof_stage_t  stage[UNVME_PROF_CLASSES][UNVME_PROF_STAGES]; ///< counters
+} unvme_cmd_profile_t;
+
 
 // Export functions
 const unvme_ns_t* unvme_open(const char* pciname, int nsid, int qcount, int qsize);
@@ -104,8 +330,32 @@ int unvme_awrite(const unvme_ns_t* ns, unvme_page_t* pa);
 unvme_page_t* unvme_poll(const unvme_ns_t* ns, unvme_page_t* pa, int sec);
 unvme_page_t* unvme_apoll(const unvme_ns_t* ns, int qid, int sec);
 
+unvme_xbuf_t* unvme_map_xbuf(const unvme_ns_t* ns, void* buf, size_t size);
+int unvme_unmap_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb);
+int unvme_aread_xbuf(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_xbuf_t* xb, size_t off);
+int unvme_awrite_xbuf(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_xbuf_t* xb, size_t off);
+
 int unvme_aggregate_start(const unvme_ns_t* ns, unvme_page_t* pa, u64 start_offset, u64 end_offset);
 int unvme_aggregate_done(const unvme_ns_t* ns, unvme_page_t* pa);
+int unvme_aggregate(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_agg_t* agg);
+u32 unvme_crc32c(u32 crc, const void* buf, size_t len);
+
+int unvme_get_agg_stats(const unvme_ns_t* ns, unvme_agg_stats_t* stats);
+int unvme_set_xform(const unvme_ns_t* ns, int index, const unvme_xform_t* xf);
+
+int unvme_epoch_config(const unvme_ns_t* ns, int ring, const unvme_epoch_ring_t* er);
+int unvme_epoch_advance(const unvme_ns_t* ns, int ring, int clear, u32* round);
+int unvme_epoch_release(const unvme_ns_t* ns, int ring, u32 round);
+u64 unvme_epoch_actid(const unvme_epoch_ring_t* er, u32 round);
+
+int unvme_set_cstore(const unvme_ns_t* ns, const unvme_cstore_t* cs);
+int unvme_get_cstore_stats(const unvme_ns_t* ns, unvme_cstore_stats_t* stats);
+
+int unvme_get_cmd_profile(const unvme_ns_t* ns, unvme_cmd_profile_t* prof, int clear);
+
+int unvme_ns_create(const unvme_ns_t* ns, u64 nblocks, int* nsid);
+int unvme_ns_delete(const unvme_ns_t* ns, int nsid);
+int unvme_set_ns_agg(const unvme_ns_t* ns, int nsid, const unvme_ns_agg_t* na);
 
 
 #endif // _LIBUNVME_H
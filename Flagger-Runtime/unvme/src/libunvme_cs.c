@@ -35,6 +35,7 @@
  */
 
 #include <string.h>
+#include <errno.h>
 
 #include "unvme.h"
 
@@ -303,3 +304,250 @@ int client_rw(const unvme_ns_t* ns, unvme_page_t* pa, int opc)
     return 0;
 }
 
+/**
+ * Send a client IO request on an external buffer. The server process
+ * owns the device mappings, so external buffers are not supported.
+ * @param   ns          namespace
+ * @param   pa          page tracking the command
+ * @param   opc         op code
+ * @param   addr        device DMA address of the data
+ * @return  -1.
+ */
+int client_rw_xbuf(const unvme_ns_t* ns, unvme_page_t* pa, int opc, u64 addr)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+/**
+ * Map an external buffer for device DMA (not supported).
+ * @param   ns          namespace
+ * @param   xb          buffer
+ * @return  -1.
+ */
+int client_map_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb)
+{
+    ERROR("external buffers need the device in the client process");
+    errno = ENOTSUP;
+    return -1;
+}
+
+/**
+ * Unmap an external buffer (not supported).
+ * @param   ns          namespace
+ * @param   xb          buffer
+ * @return  -1.
+ */
+int client_unmap_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb)
+{
+    errno = ENOTSUP;
+    return -1;
+}
+
+/**
+ * Send a client aggregate start request.
+ * @param   ns          namespace handle
+ * @param   pa          page tracking the job
+ * @param   agg         aggregation job
+ * @return  0 if ok else error code.
+ */
+int client_aggregate(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_agg_t* agg)
+{
+    unvme_session_t* ses = ns->ses;
+    unvme_csif_t* csif = &ses->csif;
+    int qid = pa->qid;
+    unvme_msg_t* msg = csif->msgbuf + qid * csif->msglen;
+    ses->queues[qid].datapool.piostat[pa->id].cpa = pa;
+    msg->cmd = UNVME_CMD_AGG_START;
+    memcpy(&msg->agg, agg, sizeof(unvme_agg_t));
+    memcpy(&msg->aggpa, pa, sizeof(unvme_page_t));
+    csif_ioq(csif, qid, msg);
+    return 0;
+}
+
+/**
+ * Read the aggregation engine telemetry.
+ * @param   ns          namespace
+ * @param   stats       returned telemetry
+ * @return  0 if ok else -1.
+ */
+int client_get_agg_stats(const unvme_ns_t* ns, unvme_agg_stats_t* stats)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_AGG_STATS;
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+    if (!err) memcpy(stats, &msg->aggstats, sizeof(unvme_agg_stats_t));
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
+
+/**
+ * Program a transform descriptor.
+ * @param   ns          namespace
+ * @param   index       descriptor index
+ * @param   xf          descriptor
+ * @return  0 if ok else error code.
+ */
+int client_set_xform(const unvme_ns_t* ns, int index, const unvme_xform_t* xf)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_XFORM;
+    msg->xfindex = index;
+    memcpy(&msg->xform, xf, sizeof(unvme_xform_t));
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
+
+/**
+ * Submit an epoch ring command.
+ * @param   ns          namespace
+ * @param   action      epoch ring action
+ * @param   ring        ring index
+ * @param   cdw         action specific dwords 11 to 14
+ * @param   result      returned round of an advance
+ * @return  0 if ok else error code.
+ */
+int client_epoch(const unvme_ns_t* ns, int action, int ring,
+                 const u32* cdw, u32* result)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_EPOCH;
+    msg->epaction = action;
+    msg->epring = ring;
+    memcpy(msg->epcdw, cdw, sizeof(msg->epcdw));
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+    if (!err && result) *result = msg->epresult;
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
+
+/**
+ * Configure the compressed store.
+ * @param   ns          namespace
+ * @param   cs          store layout
+ * @return  0 if ok else error code.
+ */
+int client_set_cstore(const unvme_ns_t* ns, const unvme_cstore_t* cs)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_CSTORE;
+    memcpy(&msg->cstore, cs, sizeof(unvme_cstore_t));
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
+
+/**
+ * Read the compressed store statistics.
+ * @param   ns          namespace
+ * @param   stats       returned statistics
+ * @return  0 if ok else error code.
+ */
+int client_get_cstore_stats(const unvme_ns_t* ns, unvme_cstore_stats_t* stats)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_CSTORE_STATS;
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+    if (!err) memcpy(stats, &msg->cstats, sizeof(unvme_cstore_stats_t));
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
+
+/**
+ * Read the command processing profile.
+ * @param   ns          namespace
+ * @param   prof        returned profile
+ * @param   clear       clear the firmware counters after the read
+ * @return  0 if ok else error code.
+ */
+int client_get_cmd_profile(const unvme_ns_t* ns, unvme_cmd_profile_t* prof, int clear)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_PROFILE;
+    msg->profclear = clear;
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+    if (!err) memcpy(prof, &msg->prof, sizeof(unvme_cmd_profile_t));
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
+
+/**
+ * Create or delete a namespace.
+ * @param   ns          namespace
+ * @param   action      NVME_NS_CREATE or NVME_NS_DELETE
+ * @param   nsid        namespace to delete
+ * @param   nblocks     blocks of the namespace to create
+ * @param   result      returned id of the created namespace
+ * @return  0 if ok else error code.
+ */
+int client_ns(const unvme_ns_t* ns, int action, int nsid, u64 nblocks, u32* result)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_NS;
+    msg->nsmaction = action;
+    msg->nsmid = nsid;
+    msg->nsmblocks = nblocks;
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+    if (!err && result) *result = msg->nsmresult;
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
+
+/**
+ * Set the aggregation configuration of a namespace.
+ * @param   ns          namespace
+ * @param   nsid        namespace id
+ * @param   na          aggregation configuration
+ * @return  0 if ok else error code.
+ */
+int client_set_ns_agg(const unvme_ns_t* ns, int nsid, const unvme_ns_agg_t* na)
+{
+    // only one client process can access the admin message at a time
+    pthread_spin_lock(client.csif.lock);
+
+    unvme_msg_t* msg = client.csif.msgbuf;
+    msg->cmd = UNVME_CMD_NS_AGG;
+    msg->nsaggid = nsid;
+    memcpy(&msg->nsagg, na, sizeof(unvme_ns_agg_t));
+    csif_admin(&client.csif, msg);
+    int err = msg->stat;
+
+    pthread_spin_unlock(client.csif.lock);
+    return err;
+}
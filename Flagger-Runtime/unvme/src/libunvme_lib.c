@@ -149,20 +149,163 @@ int client_rw(const unvme_ns_t* ns, unvme_page_t* pa, int opc)
 {
     unvme_queue_t* ioq = ((unvme_session_t*)(ns->ses))->queues + pa->qid;
     ioq->datapool.piostat[pa->id].cpa = pa;
-
-    struct nvme_command cmd = {
-        .opc = opc,
-        .nsid = ns->id,
-        .cdw10 = (u32)(pa->actid & 0xFFFFFFFF),
-        .cdw11 = (u32)(pa->actid >> 32),
-        .cdw12 = pa->nlb | (opc >= NVME_CMD_AGGREGATE_START ? 0x8000 : 0)
-    };
-    
-    if (opc == NVME_CMD_AGGREGATE_START) {
-        cmd.cdw13 = (u32)(pa->offset & 0xFFFFFFFF);
-        cmd.cdw14 = (u32)(pa->offset >> 32);
-    }
-    
     return unvme_do_rw(ioq, pa, opc);
 }
 
+/**
+ * Send a client IO request on an external buffer.
+ * @param   ns          namespace
+ * @param   pa          page tracking the command
+ * @param   opc         op code
+ * @param   addr        device DMA address of the data
+ * @return  0 if ok else error code.
+ */
+int client_rw_xbuf(const unvme_ns_t* ns, unvme_page_t* pa, int opc, u64 addr)
+{
+    unvme_queue_t* ioq = ((unvme_session_t*)(ns->ses))->queues + pa->qid;
+    ioq->datapool.piostat[pa->id].cpa = pa;
+    return unvme_do_rw_xbuf(ioq, pa, opc, addr);
+}
+
+/**
+ * Map an external buffer for device DMA.
+ * @param   ns          namespace
+ * @param   xb          buffer
+ * @return  0 if ok else -1.
+ */
+int client_map_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_map_xbuf(ses->dev, xb);
+}
+
+/**
+ * Unmap an external buffer.
+ * @param   ns          namespace
+ * @param   xb          buffer
+ * @return  0 if ok else -1.
+ */
+int client_unmap_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb)
+{
+    return unvme_do_unmap_xbuf(xb);
+}
+
+/**
+ * Send a client aggregate start request.
+ * @param   ns          namespace
+ * @param   pa          page tracking the job
+ * @param   agg         aggregation job
+ * @return  0 if ok else error code.
+ */
+int client_aggregate(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_agg_t* agg)
+{
+    unvme_queue_t* ioq = ((unvme_session_t*)(ns->ses))->queues + pa->qid;
+    ioq->datapool.piostat[pa->id].cpa = pa;
+    return unvme_do_aggregate(ioq, pa, agg);
+}
+
+/**
+ * Read the aggregation engine telemetry.
+ * @param   ns          namespace
+ * @param   stats       returned telemetry
+ * @return  0 if ok else error code.
+ */
+int client_get_agg_stats(const unvme_ns_t* ns, unvme_agg_stats_t* stats)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_get_agg_stats(ses->dev, stats);
+}
+
+/**
+ * Program a transform descriptor.
+ * @param   ns          namespace
+ * @param   index       descriptor index
+ * @param   xf          descriptor
+ * @return  0 if ok else error code.
+ */
+int client_set_xform(const unvme_ns_t* ns, int index, const unvme_xform_t* xf)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_set_xform(ses->dev, index, xf);
+}
+
+/**
+ * Submit an epoch ring command.
+ * @param   ns          namespace
+ * @param   action      epoch ring action
+ * @param   ring        ring index
+ * @param   cdw         action specific dwords 11 to 14
+ * @param   result      returned round of an advance
+ * @return  0 if ok else error code.
+ */
+int client_epoch(const unvme_ns_t* ns, int action, int ring,
+                 const u32* cdw, u32* result)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_epoch(ses->dev, action, ring, cdw, result);
+}
+
+/**
+ * Configure the compressed store.
+ * @param   ns          namespace
+ * @param   cs          store layout
+ * @return  0 if ok else error code.
+ */
+int client_set_cstore(const unvme_ns_t* ns, const unvme_cstore_t* cs)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_set_cstore(ses->dev, cs);
+}
+
+/**
+ * Read the compressed store statistics.
+ * @param   ns          namespace
+ * @param   stats       returned statistics
+ * @return  0 if ok else error code.
+ */
+int client_get_cstore_stats(const unvme_ns_t* ns, unvme_cstore_stats_t* stats)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_get_cstore_stats(ses->dev, stats);
+}
+
+/**
+ * Read the command processing profile.
+ * @param   ns          namespace
+ * @param   prof        returned profile
+ * @param   clear       clear the firmware counters after the read
+ * @return  0 if ok else error code.
+ */
+int client_get_cmd_profile(const unvme_ns_t* ns, unvme_cmd_profile_t* prof, int clear)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_get_cmd_profile(ses->dev, prof, clear);
+}
+
+/**
+ * Create or delete a namespace.
+ * @param   ns          namespace
+ * @param   action      NVME_NS_CREATE or NVME_NS_DELETE
+ * @param   nsid        namespace to delete
+ * @param   nblocks     blocks of the namespace to create
+ * @param   result      returned id of the created namespace
+ * @return  0 if ok else error code.
+ */
+int client_ns(const unvme_ns_t* ns, int action, int nsid, u64 nblocks, u32* result)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_ns(ses->dev, action, nsid, nblocks, result);
+}
+
+/**
+ * Set the aggregation configuration of a namespace.
+ * @param   ns          namespace
+ * @param   nsid        namespace id
+ * @param   na          aggregation configuration
+ * @return  0 if ok else error code.
+ */
+int client_set_ns_agg(const unvme_ns_t* ns, int nsid, const unvme_ns_agg_t* na)
+{
+    unvme_session_t* ses = ns->ses;
+    return unvme_do_set_ns_agg(ses->dev, nsid, na);
+}
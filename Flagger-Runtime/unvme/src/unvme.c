@@ -91,14 +91,14 @@ static void unvme_ns_init(unvme_session_t* ses, int nsid)
     } else {
         memcpy(ns, &dev->ses->ns, sizeof(unvme_ns_t));
         nvme_identify_ns_t* idns = (nvme_identify_ns_t*)dma->buf;
-        ns->blockcount = (u64) idns->nuse;
-        ns->blocksize = 1 << idns->lbaf[idns->flbas & 0xF].lbads;
-        if (ns->blocksize > ns->pagesize || ns->blockcount < 8) {
+        ns->max_actid_blocks = (u64) idns->nuse;
+        ns->actid_blocksize = 1 << idns->lbaf[idns->flbas & 0xF].lbads;
+        if (ns->actid_blocksize > ns->pagesize || ns->max_actid_blocks < 8) {
             FATAL("ps=%d bs=%d bc=%ld",
-                  ns->pagesize, ns->blocksize, ns->blockcount);
+                  ns->pagesize, ns->actid_blocksize, ns->max_actid_blocks);
         }
-        ns->nbpp = ns->pagesize / ns->blocksize;
-        ns->maxbpio = ns->maxppio * ns->nbpp;
+        ns->nbpp = ns->pagesize / ns->actid_blocksize;
+        ns->maxactidio = ns->maxppio * ns->nbpp;
     }
     ns->maxppq =  ses->qsize * ns->maxppio;
     ns->maxiopq = ses->qsize - 1;
@@ -473,3 +473,320 @@ int unvme_do_rw(unvme_queue_t* ioq, unvme_page_t* pa, int opc)
     return err;
 }
 
+/**
+ * Process read write command on an external buffer. The page only
+ * tracks the command, the data is at the device DMA address addr.
+ * @param   ioq         io queue
+ * @param   pa          page tracking the command
+ * @param   opc         op code
+ * @param   addr        device DMA address of the data
+ * @return  0 if ok else -1.
+ */
+int unvme_do_rw_xbuf(unvme_queue_t* ioq, unvme_page_t* pa, int opc, u64 addr)
+{
+    unvme_session_t* ses = ioq->ses;
+    unvme_datapool_t* datapool = &ioq->datapool;
+    int cid = pa->id;
+
+    if (datapool->piostat[cid].ustat != UNVME_PS_READY) {
+        ERROR("page %d ustat=%d", cid, datapool->piostat[cid].ustat);
+        return -1;
+    }
+    if (pa->nlb > ses->ns.maxactidio) {
+        ERROR("nlb %d exceeds %d blocks per I/O", pa->nlb, ses->ns.maxactidio);
+        return -1;
+    }
+    datapool->piostat[cid].ustat = UNVME_PS_PENDING;
+
+    // only the first PRP entry may start within a page
+    u64 pagesize = ses->ns.pagesize;
+    u64 end = addr + (u64)pa->nlb * ses->ns.actid_blocksize;
+    u64 next = (addr & ~(pagesize - 1)) + pagesize;
+    u64 prp1 = addr;
+    u64 prp2 = 0;
+
+    if (end > next) {
+        if (end <= next + pagesize) {
+            prp2 = next;
+        } else {
+            int slot = cid * pagesize;
+            u64* prplist = datapool->prplist->buf + slot;
+            for (; next < end; next += pagesize) *prplist++ = next;
+            prp2 = datapool->prplist->addr + slot;
+        }
+    }
+
+    int err = nvme_cmd_rw(opc, ioq->nvq, ses->ns.id,
+                          cid, pa->actid, pa->nlb, prp1, prp2);
+
+    if (unvme_model != UNVME_MODEL_APC && !err) err = sem_post(&ses->tpc.sem);
+
+    return err;
+}
+
+/**
+ * Map an external buffer for device DMA.
+ * @param   dev         device context
+ * @param   xb          buffer with buf and size set, returns addr and id
+ * @return  0 if ok else -1.
+ */
+int unvme_do_map_xbuf(unvme_device_t* dev, unvme_xbuf_t* xb)
+{
+    if ((u64)xb->buf & ((1 << dev->nvmedev->pageshift) - 1)) {
+        ERROR("buffer %p is not page aligned", xb->buf);
+        return -1;
+    }
+    vfio_dma_t* dma = vfio_dma_map(dev->vfiodev, xb->size, xb->buf);
+    if (!dma) return -1;
+    xb->addr = dma->addr;
+    xb->id = dma;
+    return 0;
+}
+
+/**
+ * Unmap an external buffer.
+ * @param   xb          buffer
+ * @return  0 if ok else -1.
+ */
+int unvme_do_unmap_xbuf(unvme_xbuf_t* xb)
+{
+    return vfio_dma_unmap(xb->id);
+}
+
+/**
+ * Process aggregate start command.
+ * @param   ioq         io queue
+ * @param   pa          page tracking the job
+ * @param   agg         aggregation job
+ * @return  0 if ok else -1.
+ */
+int unvme_do_aggregate(unvme_queue_t* ioq, unvme_page_t* pa, const unvme_agg_t* agg)
+{
+    unvme_session_t* ses = ioq->ses;
+    unvme_datapool_t* datapool = &ioq->datapool;
+    int cid = pa->id;
+
+    if (datapool->piostat[cid].ustat != UNVME_PS_READY) {
+        ERROR("page %d ustat=%d", cid, datapool->piostat[cid].ustat);
+        return -1;
+    }
+    if (agg->nslots > 256 || agg->trim > 255) {
+        ERROR("nslots=%u trim=%u", agg->nslots, agg->trim);
+        return -1;
+    }
+    datapool->piostat[cid].ustat = UNVME_PS_PENDING;
+
+    // the page carries the job's host data, the weights of a weighted mean
+    u64 prp1 = datapool->data->addr + cid * ses->ns.pagesize;
+    u32 op = agg->op | ((agg->nslots ? agg->nslots - 1 : 0) << 8) | (agg->trim << 16) |
+             ((agg->flags & 0xFF) << 24);
+    int err = nvme_cmd_aggregate(ioq->nvq, ses->ns.id, cid, agg->actid,
+                                 agg->startoff, agg->endoff, op, agg->dstactid,
+                                 agg->slotstride, prp1);
+
+    if (unvme_model != UNVME_MODEL_APC && !err) err = sem_post(&ses->tpc.sem);
+
+    return err;
+}
+
+/**
+ * Read the aggregation engine telemetry log page.
+ * @param   dev         device context
+ * @param   stats       returned telemetry
+ * @return  0 if ok else error code.
+ */
+int unvme_do_get_agg_stats(unvme_device_t* dev, unvme_agg_stats_t* stats)
+{
+    vfio_dma_t* dma = vfio_dma_alloc(dev->vfiodev, 1 << dev->nvmedev->pageshift);
+    if (!dma) return -1;
+
+    // the log page is controller wide, hence the global namespace id
+    int err = nvme_acmd_get_log_page(dev->nvmedev, -1, NVME_LOG_AGG_STATS, 0,
+                                     sizeof(unvme_agg_stats_t) / sizeof(u32) - 1,
+                                     dma->addr, 0);
+    if (!err) memcpy(stats, dma->buf, sizeof(unvme_agg_stats_t));
+
+    if (vfio_dma_free(dma)) FATAL();
+    return err;
+}
+
+/**
+ * Program a transform descriptor.
+ * @param   dev         device context
+ * @param   index       descriptor index
+ * @param   xf          descriptor (format UNVME_XFORM_NONE releases it)
+ * @return  0 if ok else error code.
+ */
+int unvme_do_set_xform(unvme_device_t* dev, int index, const unvme_xform_t* xf)
+{
+    if (index < 0 || index >= UNVME_XFORM_MAX || xf->groupshift > 0xFF) {
+        ERROR("bad transform descriptor %d", index);
+        return -1;
+    }
+
+    u32 cdw[5];
+    cdw[0] = index | ((xf->format & 0xFF) << 8) | ((xf->flags & 0xFF) << 16) |
+             (xf->groupshift << 24);
+    cdw[1] = xf->actid;
+    cdw[2] = xf->nblocks;
+    cdw[3] = xf->windowactid;
+    cdw[4] = 0;
+
+    // descriptors are controller wide, hence the global namespace id
+    return nvme_acmd_set_features(dev->nvmedev, -1, NVME_FEATURE_XFORM, cdw);
+}
+
+/**
+ * Configure the compressed store.
+ * @param   dev         device context
+ * @param   cs          store layout (flags 0 disables the store)
+ * @return  0 if ok else error code.
+ */
+int unvme_do_set_cstore(unvme_device_t* dev, const unvme_cstore_t* cs)
+{
+    u32 cdw[5] = { cs->flags, cs->actid, cs->nblocks, cs->poolactid, cs->poolblocks };
+
+    // the store is controller wide, hence the global namespace id
+    return nvme_acmd_set_features(dev->nvmedev, -1, NVME_FEATURE_CSTORE, cdw);
+}
+
+/**
+ * Read the compressed store statistics log page.
+ * @param   dev         device context
+ * @param   stats       returned statistics
+ * @return  0 if ok else error code.
+ */
+int unvme_do_get_cstore_stats(unvme_device_t* dev, unvme_cstore_stats_t* stats)
+{
+    vfio_dma_t* dma = vfio_dma_alloc(dev->vfiodev, 1 << dev->nvmedev->pageshift);
+    if (!dma) return -1;
+
+    int err = nvme_acmd_get_log_page(dev->nvmedev, -1, NVME_LOG_CSTORE_STATS, 0,
+                                     sizeof(unvme_cstore_stats_t) / sizeof(u32) - 1,
+                                     dma->addr, 0);
+    if (!err) memcpy(stats, dma->buf, sizeof(unvme_cstore_stats_t));
+
+    if (vfio_dma_free(dma)) FATAL();
+    return err;
+}
+
+/**
+ * Read the command processing profile log page.
+ * @param   dev         device context
+ * @param   prof        returned profile
+ * @param   clear       clear the firmware counters after the read
+ * @return  0 if ok else error code.
+ */
+int unvme_do_get_cmd_profile(unvme_device_t* dev, unvme_cmd_profile_t* prof, int clear)
+{
+    vfio_dma_t* dma = vfio_dma_alloc(dev->vfiodev, 1 << dev->nvmedev->pageshift);
+    if (!dma) return -1;
+
+    int err = nvme_acmd_get_log_page(dev->nvmedev, -1, NVME_LOG_CMD_PROFILE,
+                                     clear ? UNVME_PROF_LSP_CLEAR : 0,
+                                     sizeof(unvme_cmd_profile_t) / sizeof(u32) - 1,
+                                     dma->addr, 0);
+    if (!err) memcpy(prof, dma->buf, sizeof(unvme_cmd_profile_t));
+
+    if (vfio_dma_free(dma)) FATAL();
+    return err;
+}
+
+/**
+ * Submit an epoch ring command.
+ * @param   dev         device context
+ * @param   action      epoch ring action
+ * @param   ring        ring index
+ * @param   cdw         action specific dwords 11 to 14
+ * @param   result      returned round of an advance
+ * @return  0 if ok else error code.
+ */
+int unvme_do_epoch(unvme_device_t* dev, int action, int ring,
+                   const u32* cdw, u32* result)
+{
+    return nvme_acmd_epoch_ring(dev->nvmedev, action, ring, cdw, result);
+}
+
+/**
+ * Attach or detach a namespace to this controller.
+ * @param   dev         device context
+ * @param   dma         data page for the controller list
+ * @param   nsid        namespace id
+ * @param   sel         NVME_NS_ATTACH or NVME_NS_DETACH
+ * @return  0 if ok else error code.
+ */
+static int unvme_ns_attach(unvme_device_t* dev, vfio_dma_t* dma, int nsid, int sel)
+{
+    // the controller id comes from the identify controller data
+    int err = nvme_acmd_identify(dev->nvmedev, 0, dma->addr, 0);
+    if (err) return err;
+    u16 cntlid = ((nvme_identify_ctlr_t*)dma->buf)->cntlid;
+
+    u16* list = dma->buf;
+    memset(list, 0, 1 << dev->nvmedev->pageshift);
+    list[0] = 1;
+    list[1] = cntlid;
+    return nvme_acmd_ns(dev->nvmedev, NVME_ACMD_NS_ATTACH, nsid, sel, dma->addr, NULL);
+}
+
+/**
+ * Create a namespace and attach it, or detach and delete one.
+ * @param   dev         device context
+ * @param   action      NVME_NS_CREATE or NVME_NS_DELETE
+ * @param   nsid        namespace to delete
+ * @param   nblocks     blocks of the namespace to create
+ * @param   result      returned id of the created namespace
+ * @return  0 if ok else error code.
+ */
+int unvme_do_ns(unvme_device_t* dev, int action, int nsid, u64 nblocks, u32* result)
+{
+    vfio_dma_t* dma = vfio_dma_alloc(dev->vfiodev, 1 << dev->nvmedev->pageshift);
+    if (!dma) return -1;
+
+    int err;
+    if (action == NVME_NS_CREATE) {
+        u32 id = 0;
+        nvme_identify_ns_t* idns = dma->buf;
+        memset(idns, 0, sizeof(*idns));
+        idns->nsze = nblocks;
+        idns->ncap = nblocks;
+        err = nvme_acmd_ns(dev->nvmedev, NVME_ACMD_NS_MGMT, 0, NVME_NS_CREATE,
+                           dma->addr, &id);
+        if (!err) {
+            err = unvme_ns_attach(dev, dma, id, NVME_NS_ATTACH);
+            if (err) nvme_acmd_ns(dev->nvmedev, NVME_ACMD_NS_MGMT, id,
+                                  NVME_NS_DELETE, 0, NULL);
+        }
+        if (!err) *result = id;
+    } else {
+        // a namespace that is already detached is deleted as well
+        unvme_ns_attach(dev, dma, nsid, NVME_NS_DETACH);
+        err = nvme_acmd_ns(dev->nvmedev, NVME_ACMD_NS_MGMT, nsid,
+                           NVME_NS_DELETE, 0, NULL);
+    }
+
+    if (vfio_dma_free(dma)) FATAL();
+    return err;
+}
+
+/**
+ * Set the aggregation configuration of a namespace.
+ * @param   dev         device context
+ * @param   nsid        namespace id
+ * @param   na          aggregation configuration
+ * @return  0 if ok else error code.
+ */
+int unvme_do_set_ns_agg(unvme_device_t* dev, int nsid, const unvme_ns_agg_t* na)
+{
+    if (na->nslots < 1 || na->nslots > 256 || na->trim > 0xFF) {
+        ERROR("bad namespace aggregation config nsid=%d", nsid);
+        return -1;
+    }
+
+    u32 cdw[5] = { 0 };
+    cdw[0] = (na->op & 0xFF) | ((na->dtype & 0xFF) << 8) |
+             ((na->nslots - 1) << 16) | (na->trim << 24);
+    cdw[1] = na->slotstride;
+
+    return nvme_acmd_set_features(dev->nvmedev, nsid, NVME_FEATURE_NS_AGG, cdw);
+}
@@ -89,6 +89,14 @@ typedef enum {
     UNVME_CMD_CLOSE     = 4,            ///< close
     UNVME_CMD_ALLOC     = 5,            ///< allocate a page
     UNVME_CMD_FREE      = 6,            ///< free a page
+    UNVME_CMD_AGG_STATS = 7,            ///< read aggregation telemetry
+    UNVME_CMD_XFORM     = 8,            ///< program a transform descriptor
+    UNVME_CMD_EPOCH     = 9,            ///< epoch ring command
+    UNVME_CMD_CSTORE    = 10,           ///< configure the compressed store
+    UNVME_CMD_CSTORE_STATS = 11,        ///< read compressed store statistics
+    UNVME_CMD_NS        = 12,           ///< create or delete a namespace
+    UNVME_CMD_NS_AGG    = 13,           ///< set namespace aggregation config
+    UNVME_CMD_PROFILE   = 14,           ///< read the command processing profile
     UNVME_CMD_AGG_START = 0x90,     
     UNVME_CMD_AGG_DONE  = 0x91      
 } unvme_cscmd_t;
@@ -111,6 +119,45 @@ typedef struct _unvme_msg {
         };
         // alloc-free message
         int                 pgid;       ///< returned page id
+        // aggregation message
+        struct {
+            unvme_agg_t     agg;        ///< aggregation job
+            unvme_page_t    aggpa;      ///< page tracking the job
+        };
+        // aggregation telemetry message
+        unvme_agg_stats_t   aggstats;   ///< returned telemetry
+        // compressed store messages
+        unvme_cstore_t      cstore;     ///< store layout
+        unvme_cstore_stats_t cstats;    ///< returned statistics
+        // command profile message
+        struct {
+            int             profclear;  ///< clear the counters after the read
+            unvme_cmd_profile_t prof;   ///< returned profile
+        };
+        // transform descriptor message
+        struct {
+            int             xfindex;    ///< descriptor index
+            unvme_xform_t   xform;      ///< descriptor
+        };
+        // epoch ring message
+        struct {
+            int             epaction;   ///< epoch ring action
+            int             epring;     ///< ring index
+            u32             epcdw[4];   ///< action specific dwords
+            u32             epresult;   ///< returned round
+        };
+        // namespace management message
+        struct {
+            int             nsmaction;  ///< create or delete
+            int             nsmid;      ///< namespace to delete
+            u64             nsmblocks;  ///< blocks of the namespace to create
+            u32             nsmresult;  ///< returned id of the created namespace
+        };
+        // namespace aggregation message
+        struct {
+            int             nsaggid;    ///< namespace id
+            unvme_ns_agg_t  nsagg;      ///< aggregation configuration
+        };
         // read-write message
         unvme_page_t        pa[0];      ///< page array
     };
@@ -153,6 +200,7 @@ typedef struct _unvme_piostat {
     unvme_page_t*           cpa;        ///< client page array reference
     unvme_ustat_t           ustat;      ///< page usage status
     int                     cstat;      ///< page completion status
+    u32                     ccs;        ///< page completion command specific
 } unvme_piostat_t;
 
 /// data pool in a queue
@@ -241,11 +289,37 @@ int unvme_do_close(unvme_device_t* dev, pid_t cpid, int sid);
 int unvme_do_alloc(unvme_queue_t* ioq);
 int unvme_do_free(unvme_queue_t* ioq, int id);
 int unvme_do_rw(unvme_queue_t* ioq, unvme_page_t* pa, int opc);
+int unvme_do_rw_xbuf(unvme_queue_t* ioq, unvme_page_t* pa, int opc, u64 addr);
+int unvme_do_map_xbuf(unvme_device_t* dev, unvme_xbuf_t* xb);
+int unvme_do_unmap_xbuf(unvme_xbuf_t* xb);
+int unvme_do_aggregate(unvme_queue_t* ioq, unvme_page_t* pa, const unvme_agg_t* agg);
+int unvme_do_get_agg_stats(unvme_device_t* dev, unvme_agg_stats_t* stats);
+int unvme_do_set_xform(unvme_device_t* dev, int index, const unvme_xform_t* xf);
+int unvme_do_epoch(unvme_device_t* dev, int action, int ring,
+                   const u32* cdw, u32* result);
+int unvme_do_set_cstore(unvme_device_t* dev, const unvme_cstore_t* cs);
+int unvme_do_get_cstore_stats(unvme_device_t* dev, unvme_cstore_stats_t* stats);
+int unvme_do_get_cmd_profile(unvme_device_t* dev, unvme_cmd_profile_t* prof, int clear);
+int unvme_do_ns(unvme_device_t* dev, int action, int nsid, u64 nblocks, u32* result);
+int unvme_do_set_ns_agg(unvme_device_t* dev, int nsid, const unvme_ns_agg_t* na);
 
 unvme_session_t* client_open(int vfid, int nsid, int qcount, int qsize);
 int client_close(const unvme_ns_t* ns);
 int client_alloc(const unvme_ns_t* ns, unvme_pal_t* pal);
 int client_free(const unvme_ns_t* ns, unvme_pal_t* pal);
 int client_rw(const unvme_ns_t* ns, unvme_page_t* pa, int opc);
+int client_rw_xbuf(const unvme_ns_t* ns, unvme_page_t* pa, int opc, u64 addr);
+int client_map_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb);
+int client_unmap_xbuf(const unvme_ns_t* ns, unvme_xbuf_t* xb);
+int client_aggregate(const unvme_ns_t* ns, unvme_page_t* pa, const unvme_agg_t* agg);
+int client_get_agg_stats(const unvme_ns_t* ns, unvme_agg_stats_t* stats);
+int client_set_xform(const unvme_ns_t* ns, int index, const unvme_xform_t* xf);
+int client_epoch(const unvme_ns_t* ns, int action, int ring,
+                 const u32* cdw, u32* result);
+int client_set_cstore(const unvme_ns_t* ns, const unvme_cstore_t* cs);
+int client_get_cstore_stats(const unvme_ns_t* ns, unvme_cstore_stats_t* stats);
+int client_get_cmd_profile(const unvme_ns_t* ns, unvme_cmd_profile_t* prof, int clear);
+int client_ns(const unvme_ns_t* ns, int action, int nsid, u64 nblocks, u32* result);
+int client_set_ns_agg(const unvme_ns_t* ns, int nsid, const unvme_ns_agg_t* na);
 
 #endif  // _UNVME_H
@@ -87,6 +87,7 @@ static unvme_page_t* unvme_check_cq(unvme_queue_t* ioq)
     if (cid < 0) return NULL;
     unvme_piostat_t* piostat = ioq->datapool.piostat;
     piostat[cid].cpa->stat = stat;
+    piostat[cid].cpa->cs = ioq->nvq->cq_cs;
     piostat[cid].ustat = UNVME_PS_READY;
     return piostat[cid].cpa;
 }
@@ -124,6 +124,96 @@ static void unvme_client_close(unvme_session_t* ses)
     msg->ack = msg->cmd;
 }
 
+/**
+ * Process client aggregation telemetry request.
+ * @param   ses         session
+ */
+static void unvme_client_agg_stats(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_get_agg_stats(ses->dev, &msg->aggstats);
+    msg->ack = msg->cmd;
+}
+
+/**
+ * Process client transform descriptor request.
+ * @param   ses         session
+ */
+static void unvme_client_xform(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_set_xform(ses->dev, msg->xfindex, &msg->xform);
+    msg->ack = msg->cmd;
+}
+
+/**
+ * Process client epoch ring request.
+ * @param   ses         session
+ */
+static void unvme_client_epoch(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_epoch(ses->dev, msg->epaction, msg->epring,
+                               msg->epcdw, &msg->epresult);
+    msg->ack = msg->cmd;
+}
+
+/**
+ * Process client compressed store configuration request.
+ * @param   ses         session
+ */
+static void unvme_client_cstore(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_set_cstore(ses->dev, &msg->cstore);
+    msg->ack = msg->cmd;
+}
+
+/**
+ * Process client compressed store statistics request.
+ * @param   ses         session
+ */
+static void unvme_client_cstore_stats(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_get_cstore_stats(ses->dev, &msg->cstats);
+    msg->ack = msg->cmd;
+}
+
+/**
+ * Process client command profile request.
+ * @param   ses         session
+ */
+static void unvme_client_cmd_profile(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_get_cmd_profile(ses->dev, &msg->prof, msg->profclear);
+    msg->ack = msg->cmd;
+}
+
+/**
+ * Process client namespace management request.
+ * @param   ses         session
+ */
+static void unvme_client_ns(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_ns(ses->dev, msg->nsmaction, msg->nsmid,
+                            msg->nsmblocks, &msg->nsmresult);
+    msg->ack = msg->cmd;
+}
+
+/**
+ * Process client namespace aggregation configuration request.
+ * @param   ses         session
+ */
+static void unvme_client_ns_agg(unvme_session_t* ses)
+{
+    unvme_msg_t* msg = ses->csif.msgbuf;
+    msg->stat = unvme_do_set_ns_agg(ses->dev, msg->nsaggid, &msg->nsagg);
+    msg->ack = msg->cmd;
+}
+
 /**
  * Process client allocation request.
  * @param   ioq         io queue
@@ -158,6 +248,17 @@ static inline void unvme_client_rw(unvme_queue_t* ioq, unvme_msg_t* msg)
     msg->ack = msg->cmd;
 }
 
+/**
+ * Process client aggregate start request.
+ * @param   ioq         io queue
+ * @param   msg         message
+ */
+static inline void unvme_client_aggregate(unvme_queue_t* ioq, unvme_msg_t* msg)
+{
+    msg->stat = unvme_do_aggregate(ioq, &msg->aggpa, &msg->agg);
+    msg->ack = msg->cmd;
+}
+
 /**
  * Create a session client server interface to process client commands. 
  * @param   ses         session
@@ -249,6 +350,30 @@ static void* unvme_csif_thread(void* arg)
             case UNVME_CMD_CLOSE:
                 unvme_client_close(ses);
                 break;
+            case UNVME_CMD_AGG_STATS:
+                unvme_client_agg_stats(ses);
+                break;
+            case UNVME_CMD_XFORM:
+                unvme_client_xform(ses);
+                break;
+            case UNVME_CMD_EPOCH:
+                unvme_client_epoch(ses);
+                break;
+            case UNVME_CMD_CSTORE:
+                unvme_client_cstore(ses);
+                break;
+            case UNVME_CMD_CSTORE_STATS:
+                unvme_client_cstore_stats(ses);
+                break;
+            case UNVME_CMD_PROFILE:
+                unvme_client_cmd_profile(ses);
+                break;
+            case UNVME_CMD_NS:
+                unvme_client_ns(ses);
+                break;
+            case UNVME_CMD_NS_AGG:
+                unvme_client_ns_agg(ses);
+                break;
             default:
                 ERROR("cmd=%d", msg->cmd);
                 goto end;
@@ -273,6 +398,9 @@ static void* unvme_csif_thread(void* arg)
             case UNVME_CMD_WRITE:
                 unvme_client_rw(ioq, msg);
                 break;
+            case UNVME_CMD_AGG_START:
+                unvme_client_aggregate(ioq, msg);
+                break;
             default:
                 ERROR("ses=%d.%d cmd=%d", ses->id, sqi, msg->cmd);
                 goto end;
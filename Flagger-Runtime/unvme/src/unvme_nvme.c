@@ -179,7 +179,8 @@ int nvme_check_completion(nvme_queue_t* q, int* stat)
     nvme_cq_entry_t* cqe = &q->cq[q->cq_head];
     if (cqe->p == q->cq_phase) return -1;
 
-    *stat = cqe->psf & 0xfe;
+    *stat = cqe->psf & 0xfffe;
+    q->cq_cs = cqe->cs;
     if (++q->cq_head == q->size) {
         q->cq_head = 0;
         q->cq_phase = !q->cq_phase;
@@ -260,12 +261,13 @@ int nvme_acmd_identify(nvme_device_t* dev, int nsid, u64 prp1, u64 prp2)
  * @param   nsid        namespace id
  * @param   numd        number of dwords
  * @param   lid         log page id
+ * @param   lsp         log specific field
  * @param   prp1        PRP1 address
  * @param   prp2        PRP2 address
  * @return  completion status (0 if ok).
  */
 int nvme_acmd_get_log_page(nvme_device_t* dev, int nsid,
-                           int lid, int numd, u64 prp1, u64 prp2)
+                           int lid, int lsp, int numd, u64 prp1, u64 prp2)
 {
     nvme_queue_t* adminq = &dev->adminq;
     int cid = adminq->sq_tail;
@@ -278,6 +280,7 @@ int nvme_acmd_get_log_page(nvme_device_t* dev, int nsid,
     cmd->common.prp1 = prp1;
     cmd->common.prp2 = prp2;
     cmd->lid = lid;
+    cmd->lsp = lsp;
     cmd->numd = numd;
 
     DEBUG_FN("cid=%#x lid=%d", cid, lid);
@@ -285,6 +288,98 @@ int nvme_acmd_get_log_page(nvme_device_t* dev, int nsid,
     return nvme_wait_completion(adminq, cid, 30);
 }
 
+/**
+ * NVMe set features command.
+ * Submit the command and wait for completion.
+ * @param   dev         device context
+ * @param   nsid        namespace id
+ * @param   fid         feature id
+ * @param   cdw11_15    feature specific dwords 11 to 15
+ * @return  completion status (0 if ok).
+ */
+int nvme_acmd_set_features(nvme_device_t* dev, int nsid, int fid,
+                           const u32* cdw11_15)
+{
+    nvme_queue_t* adminq = &dev->adminq;
+    int cid = adminq->sq_tail;
+    nvme_acmd_features_t* cmd = &adminq->sq[cid].features;
+
+    memset(cmd, 0, sizeof (*cmd));
+    cmd->common.opc = NVME_ACMD_SET_FEATURES;
+    cmd->common.cid = cid;
+    cmd->common.nsid = nsid;
+    cmd->fid = fid;
+    memcpy(cmd->cdw11_15, cdw11_15, 5 * sizeof(u32));
+
+    DEBUG_FN("cid=%#x fid=%#x cdw11=%#x", cid, fid, cdw11_15[0]);
+    nvme_submit_cmd(adminq);
+    return nvme_wait_completion(adminq, cid, 30);
+}
+
+/**
+ * Epoch ring management command (vendor).
+ * Submit the command and wait for completion.
+ * @param   dev         device context
+ * @param   action      epoch ring action
+ * @param   ring        ring index
+ * @param   cdw11_14    action specific dwords 11 to 14
+ * @param   cs          returned command specific dword (the round)
+ * @return  completion status (0 if ok).
+ */
+int nvme_acmd_epoch_ring(nvme_device_t* dev, int action, int ring,
+                         const u32* cdw11_14, u32* cs)
+{
+    nvme_queue_t* adminq = &dev->adminq;
+    int cid = adminq->sq_tail;
+    nvme_acmd_epoch_ring_t* cmd = &adminq->sq[cid].epoch_ring;
+
+    memset(cmd, 0, sizeof (*cmd));
+    cmd->common.opc = NVME_ACMD_EPOCH_RING;
+    cmd->common.cid = cid;
+    cmd->common.nsid = -1;
+    cmd->action = action;
+    cmd->ring = ring;
+    memcpy(cmd->cdw11_15, cdw11_14, 4 * sizeof(u32));
+
+    DEBUG_FN("cid=%#x action=%d ring=%d", cid, action, ring);
+    nvme_submit_cmd(adminq);
+    int err = nvme_wait_completion(adminq, cid, 30);
+    if (!err && cs) *cs = adminq->cq_cs;
+    return err;
+}
+
+/**
+ * NVMe namespace management or attachment command.
+ * Submit the command and wait for completion.
+ * @param   dev         device context
+ * @param   opc         NVME_ACMD_NS_MGMT or NVME_ACMD_NS_ATTACH
+ * @param   nsid        namespace id (ignored by create)
+ * @param   sel         select
+ * @param   prp1        PRP1 address of the data page (0 if none)
+ * @param   cs          returned command specific dword (the created nsid)
+ * @return  completion status (0 if ok).
+ */
+int nvme_acmd_ns(nvme_device_t* dev, int opc, int nsid, int sel,
+                 u64 prp1, u32* cs)
+{
+    nvme_queue_t* adminq = &dev->adminq;
+    int cid = adminq->sq_tail;
+    nvme_acmd_ns_t* cmd = &adminq->sq[cid].ns;
+
+    memset(cmd, 0, sizeof (*cmd));
+    cmd->common.opc = opc;
+    cmd->common.cid = cid;
+    cmd->common.nsid = nsid;
+    cmd->common.prp1 = prp1;
+    cmd->sel = sel;
+
+    DEBUG_FN("cid=%#x opc=%#x nsid=%d sel=%d", cid, opc, nsid, sel);
+    nvme_submit_cmd(adminq);
+    int err = nvme_wait_completion(adminq, cid, 30);
+    if (!err && cs) *cs = adminq->cq_cs;
+    return err;
+}
+
 /**
  * NVMe create I/O completion queue command.
  * Submit the command and wait for completion.
@@ -411,15 +506,11 @@ inline int nvme_cmd_rw(int opc, nvme_queue_t* ioq, int nsid,
     cmd->common.nsid = nsid;
     cmd->common.prp1 = prp1;
     cmd->common.prp2 = prp2;
-    cmd->actid = actid; 
+    cmd->actid = lba;
     cmd->nlb = nb - 1;
     DEBUG_FN("q=%d sqt=%d cid=%#x nsid=%d actid=%#lx nb=%d (%c)", ioq->id,
-             ioq->sq_tail, cid, nsid, actid, nb, 
+             ioq->sq_tail, cid, nsid, lba, nb, 
              opc >= NVME_CMD_AGGREGATE_START ? 'A' : (opc == NVME_CMD_READ? 'R' : 'W'));
-    if (opc == NVME_CMD_AGGREGATE_START) {
-        cmd->eilbrt = (u32)(prp1 >> 32); 
-        cmd->elbat = (u16)(prp1 & 0xFFFF);
-    } 
     nvme_submit_cmd(ioq);
     return 0;
 }
@@ -458,6 +549,43 @@ int nvme_cmd_write(nvme_queue_t* ioq, int nsid,
     return nvme_cmd_rw(NVME_CMD_WRITE, ioq, nsid, cid, lba, nb, prp1, prp2);
 }
 
+/**
+ * NVMe submit an aggregate start command.
+ * @param   ioq         io queue
+ * @param   nsid        namespace
+ * @param   cid         command id
+ * @param   actid       first block of the source segment
+ * @param   startoff    segment start byte offset within actid
+ * @param   endoff      segment end byte offset within actid
+ * @param   op          operator [7:0], slots - 1 [15:8], trim [23:16]
+ * @param   dstactid    first block of the accumulator
+ * @param   slotstride  blocks between client slots (cdw 2)
+ * @param   prp1        host data of the job, the weights of a weighted mean
+ * @return  0 if ok else -1.
+ */
+int nvme_cmd_aggregate(nvme_queue_t* ioq, int nsid, int cid, u64 actid,
+                       u32 startoff, u32 endoff, u32 op, u32 dstactid,
+                       u32 slotstride, u64 prp1)
+{
+    nvme_command_agg_t* cmd = &ioq->sq[ioq->sq_tail].agg;
+
+    memset(cmd, 0, sizeof (*cmd));
+    cmd->common.opc = NVME_CMD_AGGREGATE_START;
+    cmd->common.cid = cid;
+    cmd->common.nsid = nsid;
+    cmd->common.cdw2_3[0] = slotstride;
+    cmd->common.prp1 = prp1;
+    cmd->actid = actid;
+    cmd->startoff = startoff;
+    cmd->endoff = endoff;
+    cmd->op = op;
+    cmd->dstactid = dstactid;
+    DEBUG_FN("q=%d sqt=%d cid=%#x nsid=%d actid=%#lx off=%#x-%#x op=%#x dst=%#x",
+             ioq->id, ioq->sq_tail, cid, nsid, actid, startoff, endoff, op, dstactid);
+    nvme_submit_cmd(ioq);
+    return 0;
+}
+
 /**
  * Create an IO queue pair of completion and submission.
  * @param   dev         device context
@@ -83,8 +83,44 @@ enum {
     NVME_ACMD_SET_FEATURES  = 0x9,      ///< set features
     NVME_ACMD_GET_FEATURES  = 0xA,      ///< get features
     NVME_ACMD_ASYNC_EVENT   = 0xC,      ///< asynchronous event
+    NVME_ACMD_NS_MGMT       = 0xD,      ///< namespace management
     NVME_ACMD_FW_ACTIVATE   = 0x10,     ///< firmware activate
     NVME_ACMD_FW_DOWNLOAD   = 0x11,     ///< firmware image download
+    NVME_ACMD_NS_ATTACH     = 0x15,     ///< namespace attachment
+    NVME_ACMD_EPOCH_RING    = 0xC0,     ///< epoch ring management (vendor)
+};
+
+/// Epoch ring action (cdw10 [7:0] of NVME_ACMD_EPOCH_RING)
+enum {
+    NVME_EPOCH_CONFIGURE    = 0x0,      ///< set up or release a ring
+    NVME_EPOCH_ADVANCE      = 0x1,      ///< make the next round current
+    NVME_EPOCH_RELEASE      = 0x2,      ///< free the epoch of a read out round
+};
+
+/// Namespace management and attachment select (cdw10 [3:0])
+enum {
+    NVME_NS_CREATE          = 0x0,      ///< create a namespace
+    NVME_NS_DELETE          = 0x1,      ///< delete a namespace
+    NVME_NS_ATTACH          = 0x0,      ///< attach controllers
+    NVME_NS_DETACH          = 0x1,      ///< detach controllers
+};
+
+/// NVMe log page id
+enum {
+    NVME_LOG_ERROR          = 0x1,      ///< error information
+    NVME_LOG_HEALTH         = 0x2,      ///< SMART / health information
+    NVME_LOG_FW_SLOT        = 0x3,      ///< firmware slot information
+    NVME_LOG_AGG_STATS      = 0xC0,     ///< aggregation engine telemetry (vendor)
+    NVME_LOG_CSTORE_STATS   = 0xC1,     ///< compressed store statistics (vendor)
+    NVME_LOG_CMD_PROFILE    = 0xC2,     ///< command processing profile (vendor)
+};
+
+/// NVMe feature id
+enum {
+    NVME_FEATURE_AGG_PRIORITY = 0xE1,   ///< aggregation arbitration class (vendor)
+    NVME_FEATURE_XFORM      = 0xE2,     ///< quantize/dequantize descriptor (vendor)
+    NVME_FEATURE_CSTORE     = 0xE3,     ///< compressed store range (vendor)
+    NVME_FEATURE_NS_AGG     = 0xE4,     ///< namespace aggregation config (vendor)
 };
 
 /// Version
@@ -199,6 +235,16 @@ typedef struct _nvme_command_rw {
     u16                     elbatm;     ///< exp logical block app tag mask
 } nvme_command_rw_t;
 
+/// NVMe command:  Aggregate Start (vendor)
+typedef struct _nvme_command_agg {
+    nvme_command_common_t   common;     ///< common cdw 0
+    u64                     actid;      ///< first block of the segment (cdw 10)
+    u32                     startoff;   ///< segment start byte offset (cdw 12)
+    u32                     endoff;     ///< segment end byte offset (cdw 13)
+    u32                     op;         ///< operator, slots, trim, flags (cdw 14)
+    u32                     dstactid;   ///< first block of the accumulator (cdw 15)
+} nvme_command_agg_t;
+
 /// Admin command:  Delete I/O Submission & Completion Queue
 typedef struct _nvme_acmd_delete_ioq {
     nvme_command_common_t   common;     ///< common cdw 0
@@ -223,12 +269,39 @@ typedef struct _nvme_acmd_create_sq {
 typedef struct _nvme_acmd_get_log_page {
     nvme_command_common_t   common;     ///< common cdw 0
     u8                      lid;        ///< log page id (cdw 10)
-    u8                      rsvd10a;    ///< reserved (in cdw 10)
+    u8                      lsp : 4;    ///< log specific field (in cdw 10)
+    u8                      rsvd10a : 3; ///< reserved (in cdw 10)
+    u8                      rae : 1;    ///< retain asynchronous event
     u16                     numd : 12;  ///< number of dwords
     u16                     rsvd10b : 4; ///< reserved (in cdw 10)
     u32                     rsvd11[5];  ///< reserved (cdw 11-15)
 } nvme_acmd_get_log_page_t;
 
+/// Admin command:  Set & Get Features
+typedef struct _nvme_acmd_features {
+    nvme_command_common_t   common;     ///< common cdw 0
+    u8                      fid;        ///< feature id (cdw 10)
+    u8                      rsvd10[3];  ///< reserved (in cdw 10)
+    u32                     cdw11_15[5]; ///< feature specific (cdw 11-15)
+} nvme_acmd_features_t;
+
+/// Admin command:  Epoch Ring (vendor)
+typedef struct _nvme_acmd_epoch_ring {
+    nvme_command_common_t   common;     ///< common cdw 0
+    u8                      action;     ///< epoch ring action (cdw 10)
+    u8                      ring;       ///< ring index
+    u16                     rsvd10;     ///< reserved (in cdw 10)
+    u32                     cdw11_15[5]; ///< action specific (cdw 11-15)
+} nvme_acmd_epoch_ring_t;
+
+/// Admin command:  Namespace Management & Attachment
+typedef struct _nvme_acmd_ns {
+    nvme_command_common_t   common;     ///< common cdw 0
+    u32                     sel : 4;    ///< select (cdw 10)
+    u32                     rsvd10 : 28; ///< reserved (in cdw 10)
+    u32                     cdw11_15[5]; ///< reserved (cdw 11-15)
+} nvme_acmd_ns_t;
+
 /// Admin command:  Create I/O Completion Queue
 typedef struct _nvme_acmd_create_cq {
     nvme_command_common_t   common;     ///< common cdw 0
@@ -267,7 +340,8 @@ typedef struct _nvme_identify_ctlr {
     u8                      ieee[3];    ///< IEEE OUI identifier
     u8                      mic;        ///< multi-interface capabilities
     u8                      mdts;       ///< max data transfer size
-    u8                      rsvd78[178]; ///< reserved (78-255)
+    u16                     cntlid;     ///< controller id
+    u8                      rsvd80[176]; ///< reserved (80-255)
     u16                     oacs;       ///< optional admin command support
     u8                      acl;        ///< abort command limit
     u8                      aerl;       ///< async event request limit
@@ -366,6 +440,7 @@ typedef struct _nvme_log_page_fw {
 /// Submission queue entry
 typedef union _nvme_sq_entry {
     nvme_command_rw_t       rw;         ///< read/write command
+    nvme_command_agg_t      agg;        ///< aggregate start command
 
     nvme_acmd_abort_t       abort;      ///< admin abort command
     nvme_acmd_create_cq_t   create_cq;  ///< admin create IO completion queue
@@ -373,6 +448,9 @@ typedef union _nvme_sq_entry {
     nvme_acmd_delete_ioq_t  delete_ioq; ///< admin delete IO queue
     nvme_acmd_identify_t    identify;   ///< admin identify command
     nvme_acmd_get_log_page_t get_log_page; ///< get log page command
+    nvme_acmd_features_t    features;   ///< set features command
+    nvme_acmd_epoch_ring_t  epoch_ring; ///< epoch ring command
+    nvme_acmd_ns_t          ns;         ///< namespace management/attachment
 } nvme_sq_entry_t;
 
 /// Completion queue entry
@@ -409,6 +487,7 @@ typedef struct _nvme_queue {
     int                     sq_tail;    ///< submission queue tail
     int                     cq_head;    ///< completion queue head
     int                     cq_phase;   ///< completion queue phase bit
+    u32                     cq_cs;      ///< command specific dword of the last completion
 } nvme_queue_t;
 
 /// Device context
@@ -434,7 +513,13 @@ int nvme_delete_ioq(nvme_queue_t* ioq);
 
 int nvme_acmd_identify(nvme_device_t* dev, int nsid, u64 prp1, u64 prp2);
 int nvme_acmd_get_log_page(nvme_device_t* dev, int nsid,
-                          int lid, int numd, u64 prp1, u64 prp2);
+                          int lid, int lsp, int numd, u64 prp1, u64 prp2);
+int nvme_acmd_set_features(nvme_device_t* dev, int nsid, int fid,
+                           const u32* cdw11_15);
+int nvme_acmd_epoch_ring(nvme_device_t* dev, int action, int ring,
+                         const u32* cdw11_14, u32* cs);
+int nvme_acmd_ns(nvme_device_t* dev, int opc, int nsid, int sel,
+                 u64 prp1, u32* cs);
 int nvme_acmd_create_cq(nvme_queue_t* ioq, u64 prp, int ien);
 int nvme_acmd_create_sq(nvme_queue_t* ioq, u64 prp);
 int nvme_acmd_delete_cq(nvme_queue_t* ioq);
@@ -443,6 +528,9 @@ int nvme_acmd_delete_sq(nvme_queue_t* ioq);
 int nvme_cmd_rw(int opc, nvme_queue_t* ioq, int nsid, int cid, u64 lba, int nb, u64 prp1, u64 prp2);
 int nvme_cmd_read(nvme_queue_t* ioq, int nsid, int cid, u64 lba, int nb, u64 prp1, u64 prp2);
 int nvme_cmd_write(nvme_queue_t* ioq, int nsid, int cid, u64 lba, int nb, u64 prp1, u64 prp2);
+int nvme_cmd_aggregate(nvme_queue_t* ioq, int nsid, int cid, u64 actid,
+                       u32 startoff, u32 endoff, u32 op, u32 dstactid,
+                       u32 slotstride, u64 prp1);
 
 int nvme_check_completion(nvme_queue_t* q, int* stat);
 int nvme_wait_completion(nvme_queue_t* q, int cid, int timeout);
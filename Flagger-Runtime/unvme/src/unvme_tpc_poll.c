@@ -124,6 +124,7 @@ unvme_page_t* unvme_apoll(const unvme_ns_t* ns, int qid, int sec)
     // retrieve the first completion queue entry
     unvme_page_t* pa = piocpq->pa[piocpq->head];
     pa->stat = ioq->datapool.piostat[pa->id].cstat;
+    pa->cs = ioq->datapool.piostat[pa->id].ccs;
     if (++piocpq->head == piocpq->size) piocpq->head = 0;
     atomic_sub(&piocpq->count, 1);
 
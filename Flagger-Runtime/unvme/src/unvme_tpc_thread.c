@@ -66,6 +66,7 @@ void* unvme_tpc_thread(void* arg)
         }
         unvme_datapool_t* datapool = &ioqs[i].datapool;
         datapool->piostat[cid].cstat = stat;
+        datapool->piostat[cid].ccs = ioqs[i].nvq->cq_cs;
         datapool->piostat[cid].ustat = UNVME_PS_READY;
         unvme_piocpq_t* cpq = datapool->piocpq;
         cpq->pa[cpq->tail] = datapool->piostat[cid].cpa;